@@ -208,7 +208,7 @@ class TestEvent(EventType):
 class Event(object):
     class Header(object):
         MAGIC = "EVT"
-        VERSION = 1
+        VERSION = 2
 
         def __init__(self, app):
             self.__app = app
@@ -232,6 +232,8 @@ class Event(object):
         self.__app = app
         self.__id = 0
         self.__timestamp = 0
+        self.__thread = 0
+        self.__sequence = 0
         self.__type = EventType()
 
     @property
@@ -242,14 +244,23 @@ class Event(object):
     def id(self):
         return self.__id
 
+    # microseconds since the epoch
     @property
     def timestamp(self):
         return self.__timestamp
 
     @property
     def timestamp_str(self):
-        timestamp = datetime.datetime.fromtimestamp(self.timestamp)
-        return timestamp.strftime("%a %b %d %H:%M:%S %Z %Y")
+        timestamp = datetime.datetime.fromtimestamp(self.timestamp / 1000000.0)
+        return timestamp.strftime("%a %b %d %H:%M:%S.%f %Z %Y")
+
+    @property
+    def thread(self):
+        return self.__thread
+
+    @property
+    def sequence(self):
+        return self.__sequence
 
     @property
     def type(self):
@@ -266,6 +277,8 @@ class Event(object):
 
         self.__id = read_long(buffer)
         self.__timestamp = read_long(buffer)
+        self.__thread = read_int(buffer)
+        self.__sequence = read_long(buffer)
         type = read_int(buffer)
 
         self.__type = EventType.create_event_type(type)
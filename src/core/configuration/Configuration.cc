@@ -10,9 +10,16 @@ Configuration::Configuration()
     : _sections(), _map(), _listeners(), _header(), _dirty(false)
 {
     set_default("logging", "level", "info");
+    set_default("logging", "levels", "");
     set_default("logging", "stdout", "true");
     set_default("logging", "file", "false");
     set_default("logging", "filename", "");
+    set_default("logging", "binary_filename", "");
+
+    set_default("threads", "name", "worker");
+    set_default("threads", "affinity", "none");
+    set_default("threads", "cpus", "");
+    set_default("threads", "scratch_size", "0");
 
     load_defaults();
 }
@@ -265,6 +272,16 @@ Logger::Level Configuration::logging_level() const
     return Logger::level(get("logging", "level"));
 }
 
+ThreadPlacement Configuration::thread_placement() const
+{
+    ThreadPlacement placement;
+    placement.name = get("threads", "name");
+    parse_thread_affinity(get("threads", "affinity"), placement.affinity);
+    parse_cpu_list(get("threads", "cpus"), placement.cpus);
+    placement.scratch_size = std::max(std::atoi(get("threads", "scratch_size").c_str()), 0);
+    return placement;
+}
+
 void Configuration::validate() const throw(ConfigurationError)
 {
     try {
@@ -272,6 +289,25 @@ void Configuration::validate() const throw(ConfigurationError)
     } catch(const std::out_of_range&) {
         throw ConfigurationError("Logging level must be a valid level!");
     }
+
+    Logger::LevelMap levels;
+    if(!Logger::parse_levels(logging_levels(), levels)) {
+        throw ConfigurationError("Logging levels must be category=level pairs!");
+    }
+
+    ThreadAffinity affinity;
+    if(!parse_thread_affinity(get("threads", "affinity"), affinity)) {
+        throw ConfigurationError("Thread affinity must be none, core or node!");
+    }
+
+    std::vector<size_t> cpus;
+    if(!parse_cpu_list(get("threads", "cpus"), cpus)) {
+        throw ConfigurationError("Thread cpus must be a cpu list (eg. 0-3,8)!");
+    }
+
+    if(!is_int(get("threads", "scratch_size")) || std::atoi(get("threads", "scratch_size").c_str()) < 0) {
+        throw ConfigurationError("Thread scratch size must be a non-negative integer!");
+    }
 }
 
 Configuration::ConfigOptions& Configuration::section(const std::string& section)
@@ -429,6 +465,30 @@ public:
         config.set("test", "test_int", "twenty five");
         CPPUNIT_ASSERT_THROW(config.validate(), energonsoftware::ConfigurationError);
         config.set("test", "test_int", "25");
+
+        config.set("logging", "levels", "energonsoftware.core.network=debug, energonsoftware.core.thread=warning");
+        CPPUNIT_ASSERT_NO_THROW(config.validate());
+
+        config.set("logging", "levels", "energonsoftware.core.network=loud");
+        CPPUNIT_ASSERT_THROW(config.validate(), energonsoftware::ConfigurationError);
+        config.set("logging", "levels", "");
+
+        config.set("threads", "affinity", "socket");
+        CPPUNIT_ASSERT_THROW(config.validate(), energonsoftware::ConfigurationError);
+        config.set("threads", "affinity", "node");
+
+        config.set("threads", "cpus", "4-2");
+        CPPUNIT_ASSERT_THROW(config.validate(), energonsoftware::ConfigurationError);
+        config.set("threads", "cpus", "0-1,4");
+        CPPUNIT_ASSERT_NO_THROW(config.validate());
+
+        energonsoftware::ThreadPlacement placement(config.thread_placement());
+        CPPUNIT_ASSERT_EQUAL(std::string("worker"), placement.name);
+        CPPUNIT_ASSERT(energonsoftware::ThreadAffinity::Node == placement.affinity);
+        CPPUNIT_ASSERT(std::vector<size_t>({ 0, 1, 4 }) == placement.cpus);
+
+        config.set("threads", "affinity", "none");
+        config.set("threads", "cpus", "");
     }
 
     void test_get()
@@ -1,6 +1,8 @@
 #if !defined __CONFIGURATION_H__
 #define __CONFIGURATION_H__
 
+#include "src/core/thread/thread_util.h"
+
 namespace energonsoftware {
 
 class Logger;
@@ -134,8 +136,18 @@ public:
 
     virtual uint32_t logging_type() const final;
     virtual Logger::Level logging_level() const final;
+
+    // per-category levels, formatted as category=level[, category=level...]
+    // pass to Logger::configure_levels() (also from a listener to change them at runtime)
+    virtual std::string logging_levels() const final { return get("logging", "levels"); }
     virtual boost::filesystem::path logging_filename() const final { return get("logging", "filename"); }
 
+    // pass to Logger::configure_binary(), empty if there's no binary log
+    virtual boost::filesystem::path logging_binary_filename() const final { return get("logging", "binary_filename"); }
+
+    // pass to the ThreadPool constructor
+    virtual ThreadPlacement thread_placement() const final;
+
     virtual iterator begin() final { return _map.begin(); }
     virtual iterator end() final { return _map.end(); }
     virtual const_iterator begin() const final { return _map.begin(); }
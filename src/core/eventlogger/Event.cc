@@ -1,10 +1,18 @@
 #include "src/pch.h"
+#include "src/core/util/util.h"
 #include "Event.h"
 
 namespace energonsoftware {
 
+// per-thread event state
+static thread_local uint64_t event_next_id = 0;
+static thread_local uint64_t event_last_id = 0;
+static thread_local uint32_t event_thread = 0;
+static thread_local uint64_t event_sequence = 0;
+static thread_local std::chrono::system_clock::rep event_last_timestamp = 0;
+
 const std::string Event::Header::MAGIC("EVT");
-const uint32_t Event::Header::VERSION = 1;
+const uint32_t Event::Header::VERSION = 2;
 
 void Event::Header::serialize(Packer& packer) const throw(SerializationError)
 {
@@ -27,24 +35,66 @@ void Event::Header::deserialize(Unpacker& unpacker) throw(SerializationError)
     }
 }
 
+const uint64_t Event::ID_BLOCK_SIZE = 1024;
+
 std::atomic_uint_least64_t Event::_next_id(0UL);
+std::atomic_uint_least32_t Event::_next_thread(0U);
+
+uint64_t Event::next_id()
+{
+    if(event_next_id == event_last_id) {
+        event_next_id = _next_id.fetch_add(ID_BLOCK_SIZE);
+        event_last_id = event_next_id + ID_BLOCK_SIZE;
+    }
+    return ++event_next_id;
+}
+
+uint32_t Event::current_thread()
+{
+    if(0 == event_thread) {
+        event_thread = ++_next_thread;
+    }
+    return event_thread;
+}
 
 Event::Event()
     : Serializable(), _id(0UL),
-        _timestamp(std::chrono::system_clock::now()), _type()
+        _timestamp(std::chrono::system_clock::now()), _thread(0), _sequence(0UL), _type()
 {
 }
 
 Event::Event(std::shared_ptr<EventType> type)
     : Serializable(), _id(next_id()),
-        _timestamp(std::chrono::system_clock::now()), _type(type)
+        _timestamp(std::chrono::system_clock::now()), _thread(current_thread()), _sequence(++event_sequence), _type(type)
 {
+    // don't let clock adjustments reorder events within a thread
+    if(_timestamp.time_since_epoch().count() < event_last_timestamp) {
+        _timestamp = std::chrono::time_point<std::chrono::system_clock>(std::chrono::system_clock::duration(event_last_timestamp));
+    }
+    event_last_timestamp = _timestamp.time_since_epoch().count();
 }
 
 Event::~Event() noexcept
 {
 }
 
+uint64_t Event::timestamp_us() const
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(_timestamp.time_since_epoch()).count();
+}
+
+bool Event::operator<(const Event& rhs) const
+{
+    if(_timestamp != rhs._timestamp) {
+        return _timestamp < rhs._timestamp;
+    }
+
+    if(_thread != rhs._thread) {
+        return _thread < rhs._thread;
+    }
+    return _sequence < rhs._sequence;
+}
+
 void Event::serialize(Packer& packer) const throw(SerializationError)
 {
     if(!valid()) {
@@ -54,8 +104,9 @@ void Event::serialize(Packer& packer) const throw(SerializationError)
     Header().serialize(packer);
 
     packer.pack(_id, "id");
-    // TODO: fix this!
-    //packer.pack(static_cast<uint64_t>(get_time(_timestamp)), "timestamp");
+    packer.pack(timestamp_us(), "timestamp");
+    packer.pack(_thread, "thread");
+    packer.pack(_sequence, "sequence");
 
     packer.pack(_type->type(), "type");
     packer.pack(_type->version(), "type_version");
@@ -68,10 +119,12 @@ void Event::deserialize(Unpacker& unpacker) throw(SerializationError)
 
     unpacker.unpack(_id, "id");
 
-    // TODO: fix this!
-    /*uint64_t timestamp;
+    uint64_t timestamp;
     unpacker.unpack(timestamp, "timestamp");
-    _timestamp = from_time(timestamp);*/
+    _timestamp = std::chrono::time_point<std::chrono::system_clock>(std::chrono::microseconds(timestamp));
+
+    unpacker.unpack(_thread, "thread");
+    unpacker.unpack(_sequence, "sequence");
 
     uint32_t type;
     unpacker.unpack(type, "type");
@@ -95,8 +148,9 @@ void Event::deserialize(Unpacker& unpacker) throw(SerializationError)
 std::string Event::str() const
 {
     std::stringstream ss;
-    // TODO: fix this!
-    ss << "Event(id:" << _id << ", timestamp:" << /*boost::posix_time::to_simple_string(_timestamp)*/"Not Available!";
+    ss << "Event(id:" << _id
+        << ", timestamp:" << boost::posix_time::to_iso_extended_string(epoch_time() + boost::posix_time::microseconds(static_cast<int64_t>(timestamp_us())))
+        << ", thread:" << _thread << ", sequence:" << _sequence;
     if(_type) {
         ss << ", type:" << _type->str();
     } else {
@@ -186,4 +240,114 @@ void TestEvent::deserialize(energonsoftware::Unpacker& unpacker) throw(energonso
         throw energonsoftware::SerializationError("Error unpacking string!");
     }
 }
+
+#include "src/test/UnitTest.h"
+
+class EventTest : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(EventTest);
+        CPPUNIT_TEST(test_sequence);
+        CPPUNIT_TEST(test_threaded_ordering);
+        CPPUNIT_TEST(test_serialize_timestamp);
+    CPPUNIT_TEST_SUITE_END();
+
+private:
+    static const int THREAD_COUNT;
+    static const int EVENT_COUNT;
+
+public:
+    EventTest() : CppUnit::TestFixture() {}
+    virtual ~EventTest() noexcept {}
+
+public:
+    void test_sequence()
+    {
+        energonsoftware::Event first(std::make_shared<TestEvent>());
+        energonsoftware::Event second(std::make_shared<TestEvent>());
+
+        CPPUNIT_ASSERT(first.valid());
+        CPPUNIT_ASSERT(second.valid());
+        CPPUNIT_ASSERT_EQUAL(first.thread(), second.thread());
+        CPPUNIT_ASSERT_EQUAL(first.sequence() + 1, second.sequence());
+        CPPUNIT_ASSERT(first.id() < second.id());
+        CPPUNIT_ASSERT(!(second.timestamp() < first.timestamp()));
+        CPPUNIT_ASSERT(first < second);
+        CPPUNIT_ASSERT(!(second < first));
+    }
+
+    void test_threaded_ordering()
+    {
+        std::vector<std::vector<energonsoftware::Event>> events(THREAD_COUNT);
+
+        std::vector<std::thread> threads;
+        for(int i=0; i<THREAD_COUNT; ++i) {
+            threads.push_back(std::thread([&events, i]() {
+                for(int j=0; j<EVENT_COUNT; ++j) {
+                    events[i].push_back(energonsoftware::Event(std::make_shared<TestEvent>()));
+                }
+            }));
+        }
+
+        for(std::thread& thread : threads) {
+            thread.join();
+        }
+
+        std::vector<energonsoftware::Event> merged;
+        std::vector<uint64_t> ids;
+        for(const auto& thread_events : events) {
+            merged.insert(merged.end(), thread_events.begin(), thread_events.end());
+            for(const energonsoftware::Event& event : thread_events) {
+                ids.push_back(event.id());
+            }
+        }
+
+        // ids are unique across threads
+        std::sort(ids.begin(), ids.end());
+        CPPUNIT_ASSERT(std::adjacent_find(ids.begin(), ids.end()) == ids.end());
+
+        // merging preserves the order within each thread
+        std::stable_sort(merged.begin(), merged.end());
+        std::unordered_map<uint32_t, uint64_t> last_sequence;
+        for(const energonsoftware::Event& event : merged) {
+            uint64_t& last = last_sequence[event.thread()];
+            CPPUNIT_ASSERT(event.sequence() > last);
+            last = event.sequence();
+        }
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(THREAD_COUNT), last_sequence.size());
+    }
+
+    void test_serialize_timestamp()
+    {
+        energonsoftware::Event event(std::make_shared<TestEvent>());
+
+        std::shared_ptr<energonsoftware::Packer> packer(energonsoftware::Packer::new_packer(energonsoftware::PackerType::Simple));
+        event.serialize(*packer);
+
+        std::shared_ptr<energonsoftware::Unpacker> unpacker(energonsoftware::Unpacker::new_unpacker(packer->buffer(), energonsoftware::PackerType::Simple));
+
+        std::string magic;
+        unpacker->unpack(magic, "magic");
+        uint32_t version;
+        unpacker->unpack(version, "version");
+
+        uint64_t id, timestamp, sequence;
+        uint32_t thread;
+        unpacker->unpack(id, "id");
+        unpacker->unpack(timestamp, "timestamp");
+        unpacker->unpack(thread, "thread");
+        unpacker->unpack(sequence, "sequence");
+
+        CPPUNIT_ASSERT_EQUAL(event.id(), id);
+        CPPUNIT_ASSERT_EQUAL(event.timestamp_us(), timestamp);
+        CPPUNIT_ASSERT_EQUAL(event.thread(), thread);
+        CPPUNIT_ASSERT_EQUAL(event.sequence(), sequence);
+    }
+};
+
+const int EventTest::THREAD_COUNT = 4;
+const int EventTest::EVENT_COUNT = 2500;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(EventTest);
+
 #endif
@@ -52,10 +52,17 @@ private:
     };
 
 private:
-    static uint64_t next_id() { return ++_next_id; }
+    // ids are reserved from _next_id in blocks of this size
+    // so that each thread only touches the shared counter once per block
+    static const uint64_t ID_BLOCK_SIZE;
+
+private:
+    static uint64_t next_id();
+    static uint32_t current_thread();
 
 private:
     static std::atomic_uint_least64_t _next_id;
+    static std::atomic_uint_least32_t _next_thread;
 
 public:
     Event();
@@ -63,17 +70,32 @@ public:
     virtual ~Event() noexcept;
 
 public:
+    // NOTE: ids are unique but are only increasing within a single thread,
+    // use operator< to order events created on different threads
     uint64_t id() const { return _id; }
 
     // universal timestamp in microseconds
-    // NOTE: this gets logged with second precision
+    // NOTE: this never goes backwards within a single thread
     const std::chrono::time_point<std::chrono::system_clock>& timestamp() const { return _timestamp; }
     void timestamp(const std::chrono::time_point<std::chrono::system_clock>& timestamp) { _timestamp = timestamp; }
 
+    // microseconds since the epoch
+    uint64_t timestamp_us() const;
+
+    // the (1-based) index of the thread that created the event
+    uint32_t thread() const { return _thread; }
+
+    // the (1-based) sequence of the event within its thread
+    uint64_t sequence() const { return _sequence; }
+
     const EventType& type() const { return *_type; }
 
     bool valid() const { return _id > 0 && _type && _type->valid(); }
 
+    // orders by timestamp, then thread, then sequence
+    // so that logs from multiple threads can be merged exactly
+    bool operator<(const Event& rhs) const;
+
     virtual void serialize(Packer& packer) const throw(SerializationError) override;
     virtual void deserialize(Unpacker& unpacker) throw(SerializationError) override;
 
@@ -82,6 +104,8 @@ public:
 private:
     uint64_t _id;
     std::chrono::time_point<std::chrono::system_clock> _timestamp;
+    uint32_t _thread;
+    uint64_t _sequence;
     std::shared_ptr<EventType> _type;
 };
 
@@ -0,0 +1,348 @@
+#include "src/pch.h"
+#include "BinaryLog.h"
+
+namespace energonsoftware {
+
+enum class BinaryLogRecord : uint8_t
+{
+    Header = 1,
+    Site,
+    Thread,
+    Record,
+    Text,
+};
+
+const std::string BinaryLogWriter::MAGIC("BLOG");
+const uint32_t BinaryLogWriter::VERSION = 1;
+
+template<typename T>
+static void write_value(std::ostream& out, const T& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static void write_string(std::ostream& out, const char* value, size_t length)
+{
+    write_value(out, static_cast<uint32_t>(length));
+    out.write(value, length);
+}
+
+static void write_string(std::ostream& out, const std::string& value)
+{
+    write_string(out, value.c_str(), value.length());
+}
+
+template<typename T>
+static bool read_value(std::istream& in, T& value)
+{
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+static bool read_string(std::istream& in, std::string& value)
+{
+    uint32_t length;
+    if(!read_value(in, length)) {
+        return false;
+    }
+
+    value.resize(length);
+    return length == 0 || static_cast<bool>(in.read(&value[0], length));
+}
+
+BinaryLogWriter::BinaryLogWriter(const boost::filesystem::path& filename)
+    : _file(filename.string().c_str(), std::ios::binary | std::ios::app), _sites(), _threads()
+{
+    // every time the file is opened gets its own header
+    // so that sites and threads start over when it's appended to
+    write_value(_file, BinaryLogRecord::Header);
+    _file.write(MAGIC.c_str(), MAGIC.length());
+    write_value(_file, VERSION);
+}
+
+BinaryLogWriter::~BinaryLogWriter() noexcept
+{
+}
+
+void BinaryLogWriter::write_record(const Logger& logger, const LogSite& site, Logger::Level level, int64_t timestamp,
+    uint32_t thread, const std::string& thread_name, const unsigned char* args, size_t length)
+{
+    write_thread(thread, thread_name);
+
+    if(_sites.insert(site.id()).second) {
+        write_value(_file, BinaryLogRecord::Site);
+        write_value(_file, site.id());
+        write_string(_file, logger.category());
+        write_string(_file, site.file(), std::strlen(site.file()));
+        write_value(_file, static_cast<int32_t>(site.line()));
+        write_string(_file, site.format(), std::strlen(site.format()));
+    }
+
+    write_value(_file, BinaryLogRecord::Record);
+    write_value(_file, site.id());
+    write_value(_file, thread);
+    write_value(_file, static_cast<int8_t>(level));
+    write_value(_file, timestamp);
+    write_string(_file, reinterpret_cast<const char*>(args), length);
+}
+
+void BinaryLogWriter::write_text(const Logger& logger, Logger::Level level, int64_t timestamp,
+    uint32_t thread, const std::string& thread_name, const char* message, size_t length)
+{
+    write_thread(thread, thread_name);
+
+    write_value(_file, BinaryLogRecord::Text);
+    write_value(_file, thread);
+    write_value(_file, static_cast<int8_t>(level));
+    write_value(_file, timestamp);
+    write_string(_file, logger.category());
+    write_string(_file, message, length);
+}
+
+void BinaryLogWriter::write_thread(uint32_t thread, const std::string& name)
+{
+    if(_threads.insert(thread).second) {
+        write_value(_file, BinaryLogRecord::Thread);
+        write_value(_file, thread);
+        write_string(_file, name);
+    }
+}
+
+BinaryLogReader::BinaryLogReader()
+    : _sites(), _threads(), _args()
+{
+}
+
+BinaryLogReader::~BinaryLogReader() noexcept
+{
+}
+
+bool BinaryLogReader::decode(std::istream& in, std::ostream& out)
+{
+    uint8_t type;
+    while(read_value(in, type)) {
+        bool valid = false;
+        switch(static_cast<BinaryLogRecord>(type))
+        {
+        case BinaryLogRecord::Header:
+            {
+                std::string magic(BinaryLogWriter::MAGIC.length(), '\0');
+                uint32_t version;
+                valid = in.read(&magic[0], magic.length()) && read_value(in, version)
+                    && BinaryLogWriter::MAGIC == magic && BinaryLogWriter::VERSION == version;
+
+                _sites.clear();
+                _threads.clear();
+            }
+            break;
+        case BinaryLogRecord::Site:
+            valid = decode_site(in);
+            break;
+        case BinaryLogRecord::Thread:
+            valid = decode_thread(in);
+            break;
+        case BinaryLogRecord::Record:
+            valid = decode_record(in, out);
+            break;
+        case BinaryLogRecord::Text:
+            valid = decode_text(in, out);
+            break;
+        }
+
+        if(!valid) {
+            return false;
+        }
+    }
+    return in.eof();
+}
+
+bool BinaryLogReader::decode_site(std::istream& in)
+{
+    uint32_t id;
+    Site site;
+    if(!read_value(in, id) || !read_string(in, site.category) || !read_string(in, site.file)
+        || !read_value(in, site.line) || !read_string(in, site.format))
+    {
+        return false;
+    }
+
+    _sites[id] = site;
+    return true;
+}
+
+bool BinaryLogReader::decode_thread(std::istream& in)
+{
+    uint32_t id;
+    std::string name;
+    if(!read_value(in, id) || !read_string(in, name)) {
+        return false;
+    }
+
+    _threads[id] = name;
+    return true;
+}
+
+bool BinaryLogReader::decode_record(std::istream& in, std::ostream& out)
+{
+    uint32_t id, thread, length;
+    int8_t level;
+    int64_t timestamp;
+    if(!read_value(in, id) || !read_value(in, thread) || !read_value(in, level)
+        || !read_value(in, timestamp) || !read_value(in, length))
+    {
+        return false;
+    }
+
+    _args.resize(length);
+    if(length > 0 && !in.read(reinterpret_cast<char*>(_args.data()), length)) {
+        return false;
+    }
+
+    const auto site = _sites.find(id);
+    if(site == _sites.end()) {
+        return false;
+    }
+
+    try {
+        write_prefix(out, timestamp, thread, site->second.category, level);
+    } catch(const std::out_of_range&) {
+        return false;
+    }
+    return log_format(out, site->second.format.c_str(), _args.data(), _args.size());
+}
+
+bool BinaryLogReader::decode_text(std::istream& in, std::ostream& out)
+{
+    uint32_t thread;
+    int8_t level;
+    int64_t timestamp;
+    std::string category, message;
+    if(!read_value(in, thread) || !read_value(in, level) || !read_value(in, timestamp)
+        || !read_string(in, category) || !read_string(in, message))
+    {
+        return false;
+    }
+
+    try {
+        write_prefix(out, timestamp, thread, category, level);
+    } catch(const std::out_of_range&) {
+        return false;
+    }
+    out << message;
+    return true;
+}
+
+void BinaryLogReader::write_prefix(std::ostream& out, int64_t timestamp, uint32_t thread, const std::string& category, int8_t level) const
+{
+    const std::string& name(_threads.at(thread));
+    out << log_timestamp(static_cast<std::time_t>(timestamp / 1000000)) << " [" << name << "] "
+        << category << " " << Logger::level(static_cast<Logger::Level>(level)) << ": ";
+}
+
+}
+
+#if defined WITH_UNIT_TESTS
+#include "src/test/UnitTest.h"
+
+class BinaryLogTest : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(BinaryLogTest);
+        CPPUNIT_TEST(test_decode);
+        CPPUNIT_TEST(test_truncated);
+    CPPUNIT_TEST_SUITE_END();
+
+private:
+    static energonsoftware::Logger& logger;
+
+public:
+    BinaryLogTest() : CppUnit::TestFixture(), _filename() {}
+    virtual ~BinaryLogTest() noexcept {}
+
+public:
+    void setUp() override
+    {
+        _filename = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%-%%%%.blog");
+    }
+
+    void tearDown() override
+    {
+        boost::filesystem::remove(_filename);
+    }
+
+    void test_decode()
+    {
+        static energonsoftware::LogSite site(__FILE__, __LINE__);
+        site.bind("sent {} bytes to {}\n");
+
+        std::vector<unsigned char> args(encode(25, "session"));
+        int64_t timestamp = 1000000LL * std::time(nullptr);
+
+        {
+            energonsoftware::BinaryLogWriter writer(_filename);
+            CPPUNIT_ASSERT(writer.good());
+
+            writer.write_record(logger, site, energonsoftware::Logger::Level::Info, timestamp, 1, "main", args.data(), args.size());
+            writer.write_text(logger, energonsoftware::Logger::Level::Error, timestamp, 2, "worker", "text message\n", 13);
+        }
+
+        // appending starts a new header
+        {
+            energonsoftware::BinaryLogWriter writer(_filename);
+            writer.write_record(logger, site, energonsoftware::Logger::Level::Debug, timestamp, 1, "restarted", args.data(), args.size());
+        }
+
+        std::string prefix(energonsoftware::log_timestamp(static_cast<std::time_t>(timestamp / 1000000)));
+        std::ifstream in(_filename.string().c_str(), std::ios::binary);
+        std::stringstream out;
+        CPPUNIT_ASSERT(energonsoftware::BinaryLogReader().decode(in, out));
+        CPPUNIT_ASSERT_EQUAL(
+            prefix + " [main] energonsoftware.core.logging.BinaryLogTest INFO: sent 25 bytes to session\n"
+            + prefix + " [worker] energonsoftware.core.logging.BinaryLogTest ERROR: text message\n"
+            + prefix + " [restarted] energonsoftware.core.logging.BinaryLogTest DEBUG: sent 25 bytes to session\n",
+            out.str());
+    }
+
+    void test_truncated()
+    {
+        static energonsoftware::LogSite site(__FILE__, __LINE__);
+        site.bind("value {}\n");
+
+        std::vector<unsigned char> args(encode(1));
+        {
+            energonsoftware::BinaryLogWriter writer(_filename);
+            writer.write_record(logger, site, energonsoftware::Logger::Level::Info, 0, 1, "main", args.data(), args.size());
+            writer.write_record(logger, site, energonsoftware::Logger::Level::Info, 0, 1, "main", args.data(), args.size());
+        }
+        boost::filesystem::resize_file(_filename, boost::filesystem::file_size(_filename) - 1);
+
+        // everything before the truncated record is still decoded
+        std::ifstream in(_filename.string().c_str(), std::ios::binary);
+        std::stringstream out;
+        CPPUNIT_ASSERT(!energonsoftware::BinaryLogReader().decode(in, out));
+        CPPUNIT_ASSERT(std::string::npos != out.str().find("INFO: value 1\n"));
+        CPPUNIT_ASSERT_EQUAL(out.str().find("INFO: value 1\n"), out.str().rfind("INFO: value 1\n"));
+    }
+
+private:
+    template<typename... Args>
+    std::vector<unsigned char> encode(const Args&... args)
+    {
+        return encode_values(energonsoftware::log_value(args)...);
+    }
+
+    template<typename... Args>
+    std::vector<unsigned char> encode_values(const Args&... args)
+    {
+        std::vector<unsigned char> encoded(energonsoftware::log_args_size(args...));
+        energonsoftware::log_args_encode(encoded.data(), args...);
+        return encoded;
+    }
+
+private:
+    boost::filesystem::path _filename;
+};
+energonsoftware::Logger& BinaryLogTest::logger(energonsoftware::Logger::instance("energonsoftware.core.logging.BinaryLogTest"));
+
+CPPUNIT_TEST_SUITE_REGISTRATION(BinaryLogTest);
+
+#endif
@@ -0,0 +1,93 @@
+#if !defined __BINARYLOG_H__
+#define __BINARYLOG_H__
+
+#include <unordered_set>
+
+namespace energonsoftware {
+
+/*
+Binary log of unformatted messages.
+
+Format sites and threads are written the first time a message refers to them,
+so the log can be decoded without the program that wrote it.
+A site is written with the category of the logger it was first logged to.
+
+NOTE: values are written in native byte order
+*/
+class BinaryLogWriter final
+{
+public:
+    static const std::string MAGIC;
+    static const uint32_t VERSION;
+
+public:
+    // appends to the file if it already exists
+    explicit BinaryLogWriter(const boost::filesystem::path& filename);
+    ~BinaryLogWriter() noexcept;
+
+public:
+    bool good() const { return _file.good(); }
+
+    // timestamps are microseconds since the epoch
+    void write_record(const Logger& logger, const LogSite& site, Logger::Level level, int64_t timestamp,
+        uint32_t thread, const std::string& thread_name, const unsigned char* args, size_t length);
+    void write_text(const Logger& logger, Logger::Level level, int64_t timestamp,
+        uint32_t thread, const std::string& thread_name, const char* message, size_t length);
+
+    void flush() { _file.flush(); }
+
+private:
+    void write_thread(uint32_t thread, const std::string& name);
+
+private:
+    std::ofstream _file;
+    std::unordered_set<uint32_t> _sites;
+    std::unordered_set<uint32_t> _threads;
+
+private:
+    BinaryLogWriter() = delete;
+    DISALLOW_COPY_AND_ASSIGN(BinaryLogWriter);
+};
+
+class BinaryLogReader final
+{
+private:
+    struct Site
+    {
+        Site() : category(), file(), line(0), format() {}
+
+        std::string category;
+        std::string file;
+        int32_t line;
+        std::string format;
+    };
+
+public:
+    BinaryLogReader();
+    ~BinaryLogReader() noexcept;
+
+public:
+    // writes each message the same way the text log does,
+    // returns false if the log is malformed (everything before that is still written)
+    bool decode(std::istream& in, std::ostream& out);
+
+private:
+    bool decode_site(std::istream& in);
+    bool decode_thread(std::istream& in);
+    bool decode_record(std::istream& in, std::ostream& out);
+    bool decode_text(std::istream& in, std::ostream& out);
+
+    void write_prefix(std::ostream& out, int64_t timestamp, uint32_t thread, const std::string& category, int8_t level) const;
+
+private:
+    std::unordered_map<uint32_t, Site> _sites;
+    std::unordered_map<uint32_t, std::string> _threads;
+    std::vector<unsigned char> _args;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(BinaryLogReader);
+};
+
+}
+
+#endif
@@ -0,0 +1,215 @@
+#include "src/pch.h"
+#include "LogBuffer.h"
+
+namespace energonsoftware {
+
+const uint32_t LogBuffer::PADDING = UINT32_MAX;
+
+// frames are kept 8 byte aligned so that records can hold 64-bit values
+static inline size_t frame_size(size_t length)
+{
+    return (length + 7) & ~static_cast<size_t>(7);
+}
+
+LogBuffer::LogBuffer(size_t capacity)
+    : _buffer(new unsigned char[capacity]), _capacity(capacity), _mask(capacity - 1),
+        _head(0), _reserved(0), _padding(), _tail(0), _read(0)
+{
+    assert(capacity > 0 && 0 == (capacity & (capacity - 1)));
+}
+
+LogBuffer::~LogBuffer() noexcept
+{
+}
+
+void* LogBuffer::reserve(size_t length)
+{
+    if(length > max_record()) {
+        return nullptr;
+    }
+
+    size_t head = _head.load(std::memory_order_relaxed);
+    size_t size = frame_size(sizeof(Frame) + length);
+
+    // records never wrap, so the end of the buffer gets padded out if necessary
+    size_t offset = head & _mask;
+    size_t padding = _capacity - offset;
+    if(padding >= size) {
+        padding = 0;
+    }
+
+    size_t used = head - _tail.load(std::memory_order_acquire);
+    if(used + padding + size > _capacity) {
+        return nullptr;
+    }
+
+    if(padding > 0) {
+        Frame* frame = reinterpret_cast<Frame*>(_buffer.get() + offset);
+        frame->size = static_cast<uint32_t>(padding);
+        frame->length = PADDING;
+
+        head += padding;
+        offset = 0;
+    }
+
+    Frame* frame = reinterpret_cast<Frame*>(_buffer.get() + offset);
+    frame->size = static_cast<uint32_t>(size);
+    frame->length = static_cast<uint32_t>(length);
+
+    _reserved = head + size;
+    return frame + 1;
+}
+
+void LogBuffer::commit()
+{
+    _head.store(_reserved, std::memory_order_release);
+}
+
+const void* LogBuffer::read(size_t& length)
+{
+    size_t head = _head.load(std::memory_order_acquire);
+    while(_read != head) {
+        const Frame* frame = reinterpret_cast<const Frame*>(_buffer.get() + (_read & _mask));
+        _read += frame->size;
+
+        if(PADDING != frame->length) {
+            length = frame->length;
+            return frame + 1;
+        }
+    }
+    return nullptr;
+}
+
+void LogBuffer::release()
+{
+    _tail.store(_read, std::memory_order_release);
+}
+
+}
+
+#if defined WITH_UNIT_TESTS
+#include "src/test/UnitTest.h"
+
+class LogBufferTest : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(LogBufferTest);
+        CPPUNIT_TEST(test_read_write);
+        CPPUNIT_TEST(test_full);
+        CPPUNIT_TEST(test_wrap);
+        CPPUNIT_TEST(test_threaded);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    LogBufferTest() : CppUnit::TestFixture() {}
+    virtual ~LogBufferTest() noexcept {}
+
+public:
+    void test_read_write()
+    {
+        energonsoftware::LogBuffer buffer(1024);
+        CPPUNIT_ASSERT(buffer.empty());
+
+        write(buffer, "first");
+        write(buffer, "second");
+        CPPUNIT_ASSERT(!buffer.empty());
+
+        CPPUNIT_ASSERT_EQUAL(std::string("first"), read(buffer));
+        CPPUNIT_ASSERT_EQUAL(std::string("second"), read(buffer));
+
+        size_t length;
+        CPPUNIT_ASSERT(nullptr == buffer.read(length));
+
+        // nothing is handed back until release()
+        CPPUNIT_ASSERT(!buffer.empty());
+        buffer.release();
+        CPPUNIT_ASSERT(buffer.empty());
+    }
+
+    void test_full()
+    {
+        energonsoftware::LogBuffer buffer(64);
+        CPPUNIT_ASSERT(nullptr == buffer.reserve(buffer.max_record() + 1));
+
+        // 24 bytes per record
+        std::string data(16, 'x');
+        write(buffer, data);
+        write(buffer, data);
+        CPPUNIT_ASSERT(nullptr == buffer.reserve(data.length()));
+
+        CPPUNIT_ASSERT_EQUAL(data, read(buffer));
+        buffer.release();
+        CPPUNIT_ASSERT(nullptr != buffer.reserve(data.length()));
+    }
+
+    void test_wrap()
+    {
+        energonsoftware::LogBuffer buffer(128);
+        for(int i=0; i<100; ++i) {
+            std::string data(i % 40, static_cast<char>('a' + (i % 26)));
+            write(buffer, data);
+            CPPUNIT_ASSERT_EQUAL(data, read(buffer));
+            buffer.release();
+        }
+        CPPUNIT_ASSERT(buffer.empty());
+    }
+
+    void test_threaded()
+    {
+        static const uint32_t COUNT = 100000;
+
+        energonsoftware::LogBuffer buffer(4096);
+        std::thread producer([&buffer]() {
+            for(uint32_t i=0; i<COUNT; ++i) {
+                size_t length = sizeof(uint32_t) * (1 + (i % 8));
+                uint32_t* record = nullptr;
+                while(nullptr == (record = reinterpret_cast<uint32_t*>(buffer.reserve(length)))) {
+                    std::this_thread::yield();
+                }
+
+                for(size_t j=0; j<length / sizeof(uint32_t); ++j) {
+                    record[j] = i;
+                }
+                buffer.commit();
+            }
+        });
+
+        uint32_t expected = 0;
+        while(expected < COUNT) {
+            size_t length;
+            const uint32_t* record;
+            while(nullptr != (record = reinterpret_cast<const uint32_t*>(buffer.read(length)))) {
+                CPPUNIT_ASSERT_EQUAL(sizeof(uint32_t) * (1 + (expected % 8)), length);
+                for(size_t j=0; j<length / sizeof(uint32_t); ++j) {
+                    CPPUNIT_ASSERT_EQUAL(expected, record[j]);
+                }
+                ++expected;
+            }
+            buffer.release();
+        }
+        producer.join();
+
+        CPPUNIT_ASSERT(buffer.empty());
+    }
+
+private:
+    void write(energonsoftware::LogBuffer& buffer, const std::string& data)
+    {
+        void* record = buffer.reserve(data.length());
+        CPPUNIT_ASSERT(nullptr != record);
+        std::memcpy(record, data.c_str(), data.length());
+        buffer.commit();
+    }
+
+    std::string read(energonsoftware::LogBuffer& buffer)
+    {
+        size_t length;
+        const void* record = buffer.read(length);
+        CPPUNIT_ASSERT(nullptr != record);
+        return std::string(reinterpret_cast<const char*>(record), length);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(LogBufferTest);
+
+#endif
@@ -0,0 +1,70 @@
+#if !defined __LOGBUFFER_H__
+#define __LOGBUFFER_H__
+
+namespace energonsoftware {
+
+/*
+Lock-free single-producer, single-consumer ring of variable sized records.
+
+The producer calls reserve() to get space for a record, fills it in, and then
+calls commit() to publish it. The consumer calls read() until it returns nullptr
+and then calls release() to hand everything it read back to the producer.
+*/
+class LogBuffer final
+{
+private:
+    // every record is prefixed by a frame that holds its total size
+    struct Frame
+    {
+        uint32_t size;
+        uint32_t length;
+    };
+
+    static const uint32_t PADDING;
+
+public:
+    // NOTE: capacity must be a power of 2
+    explicit LogBuffer(size_t capacity);
+    ~LogBuffer() noexcept;
+
+public:
+    size_t capacity() const { return _capacity; }
+
+    // the largest record that can ever fit in the buffer
+    size_t max_record() const { return (_capacity / 2) - sizeof(Frame); }
+
+    bool empty() const { return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire); }
+
+    // producer side
+    // returns nullptr if there is not currently enough room for the record
+    void* reserve(size_t length);
+    void commit();
+
+    // consumer side
+    // returns nullptr if there are no more committed records
+    const void* read(size_t& length);
+    void release();
+
+private:
+    std::unique_ptr<unsigned char[]> _buffer;
+    size_t _capacity, _mask;
+
+    // producer state
+    std::atomic<size_t> _head;
+    size_t _reserved;
+
+    // keeps the producer and consumer state on separate cache lines
+    unsigned char _padding[64];
+
+    // consumer state
+    std::atomic<size_t> _tail;
+    size_t _read;
+
+private:
+    LogBuffer() = delete;
+    DISALLOW_COPY_AND_ASSIGN(LogBuffer);
+};
+
+}
+
+#endif
@@ -0,0 +1,250 @@
+#include "src/pch.h"
+#include "LogFormat.h"
+
+namespace energonsoftware {
+
+std::atomic<uint32_t> LogSite::_next_id(1);
+
+LogSite::LogSite(const char* file, int line)
+    : _file(file), _line(line), _format(nullptr), _id(0)
+{
+}
+
+LogSite::~LogSite() noexcept
+{
+}
+
+void LogSite::register_site(const char* format)
+{
+    _format.store(format, std::memory_order_release);
+
+    // racing threads may both grab an id, but only one of them sticks
+    uint32_t expected = 0;
+    _id.compare_exchange_strong(expected, _next_id.fetch_add(1));
+}
+
+template<typename T>
+static bool read_arg(const unsigned char*& args, const unsigned char* end, T& value)
+{
+    if(static_cast<size_t>(end - args) < sizeof(T)) {
+        return false;
+    }
+
+    std::memcpy(&value, args, sizeof(T));
+    args += sizeof(T);
+    return true;
+}
+
+template<typename T>
+static bool format_arg(std::ostream& out, const unsigned char*& args, const unsigned char* end)
+{
+    T value;
+    if(!read_arg(args, end, value)) {
+        return false;
+    }
+
+    out << value;
+    return true;
+}
+
+static bool format_arg(std::ostream& out, const unsigned char*& args, const unsigned char* end)
+{
+    uint8_t type;
+    if(!read_arg(args, end, type)) {
+        return false;
+    }
+
+    switch(static_cast<LogArgType>(type))
+    {
+    case LogArgType::Bool:
+        {
+            uint8_t value;
+            if(!read_arg(args, end, value)) {
+                return false;
+            }
+            out << (0 != value);
+        }
+        return true;
+    case LogArgType::Char:
+        return format_arg<char>(out, args, end);
+    case LogArgType::Int32:
+        return format_arg<int32_t>(out, args, end);
+    case LogArgType::UInt32:
+        return format_arg<uint32_t>(out, args, end);
+    case LogArgType::Int64:
+        return format_arg<int64_t>(out, args, end);
+    case LogArgType::UInt64:
+        return format_arg<uint64_t>(out, args, end);
+    case LogArgType::Float:
+        return format_arg<float>(out, args, end);
+    case LogArgType::Double:
+        return format_arg<double>(out, args, end);
+    case LogArgType::String:
+        {
+            uint32_t length;
+            if(!read_arg(args, end, length) || static_cast<size_t>(end - args) < length) {
+                return false;
+            }
+            out.write(reinterpret_cast<const char*>(args), length);
+            args += length;
+        }
+        return true;
+    case LogArgType::Pointer:
+        {
+            uint64_t value;
+            if(!read_arg(args, end, value)) {
+                return false;
+            }
+
+            std::ios::fmtflags flags(out.flags());
+            out << "0x" << std::hex << value;
+            out.flags(flags);
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool log_format(std::ostream& out, const char* format, const unsigned char* args, size_t length)
+{
+    const unsigned char* end = args + length;
+    bool valid = true;
+
+    const char* start = format;
+    for(const char* p = format; '\0' != *p; ++p) {
+        if('{' != p[0] || '}' != p[1]) {
+            continue;
+        }
+
+        out.write(start, p - start);
+        if(!valid || args == end || !format_arg(out, args, end)) {
+            // leave the placeholder if there's nothing to put in it
+            out << "{}";
+            valid = false;
+        }
+
+        ++p;
+        start = p + 1;
+    }
+    out << start;
+
+    return valid && args == end;
+}
+
+std::string log_timestamp(std::time_t time)
+{
+    return boost::posix_time::to_simple_string(boost::posix_time::from_time_t(time)
+        + (boost::posix_time::second_clock::local_time() - boost::posix_time::second_clock::universal_time()));
+}
+
+}
+
+#if defined WITH_UNIT_TESTS
+#include "src/test/UnitTest.h"
+
+class LogFormatTest : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(LogFormatTest);
+        CPPUNIT_TEST(test_format);
+        CPPUNIT_TEST(test_values);
+        CPPUNIT_TEST(test_mismatched);
+        CPPUNIT_TEST(test_site);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    LogFormatTest() : CppUnit::TestFixture() {}
+    virtual ~LogFormatTest() noexcept {}
+
+public:
+    void test_format()
+    {
+        std::string name("session");
+        CPPUNIT_ASSERT_EQUAL(std::string("sent 25 bytes to session (1)\n"),
+            format("sent {} bytes to {} ({})\n", 25, name, true));
+        CPPUNIT_ASSERT_EQUAL(std::string("no arguments\n"), format("no arguments\n"));
+        CPPUNIT_ASSERT_EQUAL(std::string("{} is not expanded"), format("{} is not expanded", "{}"));
+    }
+
+    void test_values()
+    {
+        CPPUNIT_ASSERT_EQUAL(std::string("-5 7 -9000000000 18000000000"),
+            format("{} {} {} {}", static_cast<int8_t>(-5), static_cast<uint16_t>(7), -9000000000LL, 18000000000ULL));
+        CPPUNIT_ASSERT_EQUAL(std::string("x 0.5 0.25"), format("{} {} {}", 'x', 0.5f, 0.25));
+        CPPUNIT_ASSERT_EQUAL(std::string("0x0 text"), format("{} {}", static_cast<const void*>(nullptr), "text"));
+
+        // anything else is formatted up front
+        CPPUNIT_ASSERT_EQUAL(std::string("path \"a/b\""), format("path {}", boost::filesystem::path("a/b")));
+    }
+
+    void test_mismatched()
+    {
+        std::stringstream out;
+
+        // missing arguments leave the placeholder
+        std::vector<unsigned char> args(encode(1));
+        CPPUNIT_ASSERT(!energonsoftware::log_format(out, "{} {}", args.data(), args.size()));
+        CPPUNIT_ASSERT_EQUAL(std::string("1 {}"), out.str());
+
+        // extra arguments are dropped
+        out.str("");
+        args = encode(1, 2);
+        CPPUNIT_ASSERT(!energonsoftware::log_format(out, "{}", args.data(), args.size()));
+        CPPUNIT_ASSERT_EQUAL(std::string("1"), out.str());
+
+        // truncated arguments
+        out.str("");
+        args = encode(std::string("truncated"));
+        CPPUNIT_ASSERT(!energonsoftware::log_format(out, "{}", args.data(), args.size() - 1));
+        CPPUNIT_ASSERT_EQUAL(std::string("{}"), out.str());
+    }
+
+    void test_site()
+    {
+        energonsoftware::LogSite first(__FILE__, __LINE__), second(__FILE__, __LINE__);
+        CPPUNIT_ASSERT_EQUAL(0U, first.id());
+
+        first.bind("first");
+        second.bind("second");
+        CPPUNIT_ASSERT(0 != first.id());
+        CPPUNIT_ASSERT(first.id() != second.id());
+        CPPUNIT_ASSERT_EQUAL(std::string("first"), std::string(first.format()));
+
+        // binding again doesn't change anything
+        uint32_t id = first.id();
+        first.bind("other");
+        CPPUNIT_ASSERT_EQUAL(id, first.id());
+        CPPUNIT_ASSERT_EQUAL(std::string("first"), std::string(first.format()));
+    }
+
+private:
+    template<typename... Args>
+    std::vector<unsigned char> encode(const Args&... args)
+    {
+        return encode_values(energonsoftware::log_value(args)...);
+    }
+
+    template<typename... Args>
+    std::vector<unsigned char> encode_values(const Args&... args)
+    {
+        std::vector<unsigned char> encoded(energonsoftware::log_args_size(args...));
+        unsigned char* end = energonsoftware::log_args_encode(encoded.data(), args...);
+        CPPUNIT_ASSERT_EQUAL(encoded.size(), static_cast<size_t>(end - encoded.data()));
+        return encoded;
+    }
+
+    template<typename... Args>
+    std::string format(const char* format, const Args&... args)
+    {
+        std::vector<unsigned char> encoded(encode(args...));
+
+        std::stringstream out;
+        CPPUNIT_ASSERT(energonsoftware::log_format(out, format, encoded.data(), encoded.size()));
+        return out.str();
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(LogFormatTest);
+
+#endif
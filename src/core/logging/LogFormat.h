@@ -0,0 +1,235 @@
+#if !defined __LOGFORMAT_H__
+#define __LOGFORMAT_H__
+
+namespace energonsoftware {
+
+/*
+Structured log records are a format site and the raw argument values,
+formatting is put off until the record is written (or decoded offline).
+
+Each argument is encoded as a LogArgType followed by its value in native byte order,
+strings are encoded as a 32-bit length followed by the characters.
+*/
+
+// a structured log statement, there's one of these (static) per call site
+class LogSite final
+{
+public:
+    LogSite(const char* file, int line);
+    ~LogSite() noexcept;
+
+public:
+    // 0 until the site is first logged
+    uint32_t id() const { return _id.load(std::memory_order_acquire); }
+
+    const char* file() const { return _file; }
+    int line() const { return _line; }
+    const char* format() const { return _format.load(std::memory_order_acquire); }
+
+    // NOTE: the format must outlive the site (use a string literal)
+    void bind(const char* format)
+    {
+        if(0 == _id.load(std::memory_order_acquire)) {
+            register_site(format);
+        }
+    }
+
+private:
+    void register_site(const char* format);
+
+private:
+    static std::atomic<uint32_t> _next_id;
+
+    const char* _file;
+    int _line;
+    std::atomic<const char*> _format;
+    std::atomic<uint32_t> _id;
+
+private:
+    LogSite() = delete;
+    DISALLOW_COPY_AND_ASSIGN(LogSite);
+};
+
+enum class LogArgType : uint8_t
+{
+    Invalid = 0,
+    Bool,
+    Char,
+    Int32,
+    UInt32,
+    Int64,
+    UInt64,
+    Float,
+    Double,
+    String,
+    Pointer,
+};
+
+// maps an argument type to how it's stored in a record
+template<typename T, typename Enable=void>
+struct LogArgTraits;
+
+template<>
+struct LogArgTraits<bool>
+{
+    typedef uint8_t storage;
+    static const LogArgType type = LogArgType::Bool;
+    static storage value(bool v) { return v ? 1 : 0; }
+};
+
+template<>
+struct LogArgTraits<char>
+{
+    typedef char storage;
+    static const LogArgType type = LogArgType::Char;
+    static storage value(char v) { return v; }
+};
+
+template<typename T>
+struct LogArgTraits<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, char>::value>::type>
+{
+    typedef typename boost::mpl::if_c<std::is_signed<T>::value,
+        typename boost::mpl::if_c<(sizeof(T) > sizeof(int32_t)), int64_t, int32_t>::type,
+        typename boost::mpl::if_c<(sizeof(T) > sizeof(uint32_t)), uint64_t, uint32_t>::type>::type storage;
+    static const LogArgType type = std::is_signed<T>::value
+        ? (sizeof(T) > sizeof(int32_t) ? LogArgType::Int64 : LogArgType::Int32)
+        : (sizeof(T) > sizeof(uint32_t) ? LogArgType::UInt64 : LogArgType::UInt32);
+    static storage value(T v) { return static_cast<storage>(v); }
+};
+
+template<>
+struct LogArgTraits<float>
+{
+    typedef float storage;
+    static const LogArgType type = LogArgType::Float;
+    static storage value(float v) { return v; }
+};
+
+template<typename T>
+struct LogArgTraits<T, typename std::enable_if<std::is_same<T, double>::value || std::is_same<T, long double>::value>::type>
+{
+    typedef double storage;
+    static const LogArgType type = LogArgType::Double;
+    static storage value(T v) { return static_cast<storage>(v); }
+};
+
+template<typename T>
+struct LogArgTraits<T*>
+{
+    typedef uint64_t storage;
+    static const LogArgType type = LogArgType::Pointer;
+    static storage value(const T* v) { return static_cast<storage>(reinterpret_cast<uintptr_t>(v)); }
+};
+
+// log_value() picks how an argument gets recorded,
+// anything that isn't a number, pointer, or string is formatted with operator<< at the call site
+template<typename T>
+inline typename std::enable_if<std::is_arithmetic<T>::value || std::is_pointer<T>::value, const T&>::type log_value(const T& v)
+{
+    return v;
+}
+
+template<typename T>
+inline typename std::enable_if<std::is_enum<T>::value, int64_t>::type log_value(const T& v)
+{
+    return static_cast<int64_t>(v);
+}
+
+template<typename T>
+inline typename std::enable_if<!std::is_arithmetic<T>::value && !std::is_pointer<T>::value && !std::is_enum<T>::value, std::string>::type log_value(const T& v)
+{
+    std::stringstream str;
+    str << v;
+    return str.str();
+}
+
+template<size_t N>
+inline const char* log_value(const char (&v)[N])
+{
+    return v;
+}
+
+inline const char* log_value(const char* v) { return v; }
+inline const char* log_value(char* v) { return v; }
+inline const std::string& log_value(const std::string& v) { return v; }
+
+// encoded argument sizes
+template<typename T>
+inline size_t log_arg_size(const T& v)
+{
+    return 1 + sizeof(typename LogArgTraits<T>::storage);
+}
+
+inline size_t log_arg_size(const char* v)
+{
+    return 1 + sizeof(uint32_t) + (nullptr == v ? 0 : std::strlen(v));
+}
+
+inline size_t log_arg_size(const std::string& v)
+{
+    return 1 + sizeof(uint32_t) + v.length();
+}
+
+inline size_t log_args_size()
+{
+    return 0;
+}
+
+template<typename T, typename... Args>
+inline size_t log_args_size(const T& v, const Args&... args)
+{
+    return log_arg_size(v) + log_args_size(args...);
+}
+
+// argument encoding, each returns the end of what it wrote
+template<typename T>
+inline unsigned char* log_arg_encode(unsigned char* out, const T& v)
+{
+    typename LogArgTraits<T>::storage value(LogArgTraits<T>::value(v));
+    *out++ = static_cast<unsigned char>(LogArgTraits<T>::type);
+    std::memcpy(out, &value, sizeof(value));
+    return out + sizeof(value);
+}
+
+inline unsigned char* log_string_encode(unsigned char* out, const char* v, uint32_t length)
+{
+    *out++ = static_cast<unsigned char>(LogArgType::String);
+    std::memcpy(out, &length, sizeof(length));
+    out += sizeof(length);
+    if(length > 0) {
+        std::memcpy(out, v, length);
+    }
+    return out + length;
+}
+
+inline unsigned char* log_arg_encode(unsigned char* out, const char* v)
+{
+    return log_string_encode(out, v, nullptr == v ? 0 : static_cast<uint32_t>(std::strlen(v)));
+}
+
+inline unsigned char* log_arg_encode(unsigned char* out, const std::string& v)
+{
+    return log_string_encode(out, v.c_str(), static_cast<uint32_t>(v.length()));
+}
+
+inline unsigned char* log_args_encode(unsigned char* out)
+{
+    return out;
+}
+
+template<typename T, typename... Args>
+inline unsigned char* log_args_encode(unsigned char* out, const T& v, const Args&... args)
+{
+    return log_args_encode(log_arg_encode(out, v), args...);
+}
+
+// writes the format to the stream, replacing each {} with the next encoded argument
+// returns false if the arguments are malformed or don't match the format
+bool log_format(std::ostream& out, const char* format, const unsigned char* args, size_t length);
+
+// the timestamp written in front of each message (local time)
+std::string log_timestamp(std::time_t time);
+
+}
+
+#endif
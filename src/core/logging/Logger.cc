@@ -1,50 +1,483 @@
 #include "src/pch.h"
+#include <condition_variable>
+#include "src/core/text/string_util.h"
+#include "BinaryLog.h"
+#include "LogBuffer.h"
 #include "Logger.h"
 
 namespace energonsoftware {
 
 static const std::string LOG_LEVELS[] = { "DEBUG", "INFO", "WARNING", "ERROR", "CRITICAL" };
 
-std::recursive_mutex Logger::logger_mutex;
+// size of each thread's message buffer
+static const size_t THREAD_BUFFER_SIZE = 64 * 1024;
+
+// how long the writer sleeps when nothing wakes it up
+static const std::chrono::milliseconds WRITER_SLEEP_TIME(10);
+
+static int64_t microseconds(std::chrono::system_clock::rep timestamp)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::duration(timestamp)).count();
+}
+
+// written in front of the message text (or the structured arguments) in a LogBuffer record
+struct LogRecord
+{
+    const Logger* logger;
+
+    // nullptr for text messages
+    const LogSite* site;
+
+    std::chrono::system_clock::rep timestamp;
+    Logger::Level level;
+    uint32_t length;
+};
+
+// growable output stream that keeps its storage between messages
+class LogStream final : private std::streambuf, public std::ostream
+{
+private:
+    static const size_t INITIAL_SIZE = 256;
+
+public:
+    LogStream()
+        : std::streambuf(), std::ostream(this), _buffer(INITIAL_SIZE), _flags(flags())
+    {
+        reset();
+    }
+
+    virtual ~LogStream() noexcept {}
+
+public:
+    const char* data() const { return pbase(); }
+    size_t length() const { return pptr() - pbase(); }
+
+    void reset()
+    {
+        setp(&_buffer[0], &_buffer[0] + _buffer.size());
+
+        clear();
+        flags(_flags);
+        precision(6);
+        width(0);
+        fill(' ');
+    }
+
+protected:
+    virtual std::streambuf::int_type overflow(std::streambuf::int_type ch) override
+    {
+        size_t used = length();
+        _buffer.resize(_buffer.size() * 2);
+        setp(&_buffer[0], &_buffer[0] + _buffer.size());
+        pbump(static_cast<int>(used));
+
+        if(!std::streambuf::traits_type::eq_int_type(ch, std::streambuf::traits_type::eof())) {
+            *pptr() = std::streambuf::traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return std::streambuf::traits_type::not_eof(ch);
+    }
+
+private:
+    std::vector<char> _buffer;
+    std::ios::fmtflags _flags;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(LogStream);
+};
+
+// a thread's message buffer, owned by the writer once it's registered
+struct ThreadLog
+{
+    ThreadLog(uint32_t id, const std::string& thread)
+        : buffer(THREAD_BUFFER_SIZE), id(id), thread(thread), retired(false)
+    {
+    }
+
+    LogBuffer buffer;
+    uint32_t id;
+    std::string thread;
+
+    // set when the owning thread exits
+    std::atomic<bool> retired;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(ThreadLog);
+};
+
+class ThreadState final
+{
+public:
+    ThreadState() : log(nullptr), stream(), formatting(false) {}
+
+    ~ThreadState() noexcept
+    {
+        if(nullptr != log) {
+            log->retired = true;
+        }
+    }
+
+public:
+    ThreadLog* log;
+    LogStream stream;
+    bool formatting;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(ThreadState);
+};
+
+static thread_local ThreadState thread_state;
+
+// drains every thread's buffer on a background thread
+class LogWriter final
+{
+private:
+    enum class State
+    {
+        Stopped,
+        Running,
+        Shutdown,
+    };
+
+    struct PendingRecord
+    {
+        const LogRecord* record;
+        const ThreadLog* log;
+    };
+
+public:
+    static LogWriter& instance()
+    {
+        static LogWriter writer;
+        return writer;
+    }
+
+public:
+    ~LogWriter() noexcept
+    {
+        stop();
+    }
+
+public:
+    // returns nullptr if the record will never fit in the thread's buffer
+    void* reserve(const Logger& logger, const LogSite* site, Logger::Level level, const std::chrono::time_point<std::chrono::system_clock>& timestamp, size_t length);
+    void commit(Logger::Level level);
+
+    // writes a record that's too big for the thread's buffer
+    void write(const Logger& logger, const LogSite* site, Logger::Level level, const std::chrono::time_point<std::chrono::system_clock>& timestamp, const void* data, size_t length);
+
+    // writes everything that has been committed
+    void flush()
+    {
+        std::lock_guard<std::mutex> guard(_threads_mutex);
+        drain();
+    }
+
+    void stop();
+
+private:
+    void start();
+    void run();
+    void notify();
+
+    ThreadLog* thread_log();
+    ThreadLog* register_thread();
+
+    // NOTE: these must be called with the threads mutex held
+    void drain();
+    const std::string& timestamp(std::chrono::system_clock::rep timestamp);
+
+    // NOTE: this must be called with the threads and output mutexes held
+    void output(const LogRecord& record, const ThreadLog& log, const void* data);
+
+private:
+    std::mutex _state_mutex;
+    std::atomic<State> _state;
+    std::thread _thread;
+
+    std::mutex _wakeup_mutex;
+    std::condition_variable _wakeup;
+    bool _signaled;
+
+    std::mutex _threads_mutex;
+    std::list<std::unique_ptr<ThreadLog>> _threads;
+    uint32_t _next_thread;
+    std::vector<PendingRecord> _pending;
+
+    // structured messages are formatted into this
+    LogStream _format;
+
+    std::time_t _cached_time;
+    std::string _cached_timestamp;
+
+private:
+    LogWriter()
+        : _state_mutex(), _state(State::Stopped), _thread(),
+            _wakeup_mutex(), _wakeup(), _signaled(false),
+            _threads_mutex(), _threads(), _next_thread(1), _pending(), _format(),
+            _cached_time(0), _cached_timestamp()
+    {
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(LogWriter);
+};
+
+void* LogWriter::reserve(const Logger& logger, const LogSite* site, Logger::Level level, const std::chrono::time_point<std::chrono::system_clock>& timestamp, size_t length)
+{
+    ThreadLog* log = thread_log();
+
+    size_t size = sizeof(LogRecord) + length;
+    if(size > log->buffer.max_record()) {
+        return nullptr;
+    }
+
+    void* record = nullptr;
+    while(nullptr == (record = log->buffer.reserve(size))) {
+        // the writer is behind, so wake it up and wait for it
+        if(State::Running == _state.load()) {
+            notify();
+            std::this_thread::yield();
+        } else {
+            flush();
+        }
+    }
+
+    LogRecord* header = reinterpret_cast<LogRecord*>(record);
+    header->logger = &logger;
+    header->site = site;
+    header->timestamp = timestamp.time_since_epoch().count();
+    header->level = level;
+    header->length = static_cast<uint32_t>(length);
+    return header + 1;
+}
+
+void LogWriter::commit(Logger::Level level)
+{
+    thread_state.log->buffer.commit();
+
+    // critical messages are written before returning
+    // in case the application is about to go down
+    if(level >= Logger::Level::Critical || State::Running != _state.load()) {
+        flush();
+    } else if(level >= Logger::Level::Error) {
+        notify();
+    }
+}
+
+void LogWriter::write(const Logger& logger, const LogSite* site, Logger::Level level, const std::chrono::time_point<std::chrono::system_clock>& timestamp, const void* data, size_t length)
+{
+    const ThreadLog* log = thread_log();
+
+    LogRecord record;
+    record.logger = &logger;
+    record.site = site;
+    record.timestamp = timestamp.time_since_epoch().count();
+    record.level = level;
+    record.length = static_cast<uint32_t>(length);
+
+    // everything already committed goes first
+    std::lock_guard<std::mutex> guard(_threads_mutex);
+    drain();
+
+    std::lock_guard<std::mutex> output_guard(Logger::_output_mutex);
+    output(record, *log, data);
+    Logger::flush_outputs();
+}
+
+void LogWriter::stop()
+{
+    std::lock_guard<std::mutex> guard(_state_mutex);
+
+    State state = _state.exchange(State::Shutdown);
+    if(State::Running == state) {
+        notify();
+        _thread.join();
+    }
+
+    flush();
+}
+
+void LogWriter::start()
+{
+    std::lock_guard<std::mutex> guard(_state_mutex);
+
+    if(State::Stopped != _state.load()) {
+        return;
+    }
+
+    _state = State::Running;
+    _thread = std::thread(&LogWriter::run, this);
+}
+
+void LogWriter::run()
+{
+    while(State::Running == _state.load()) {
+        {
+            std::unique_lock<std::mutex> lock(_wakeup_mutex);
+            _wakeup.wait_for(lock, WRITER_SLEEP_TIME, [this]() { return _signaled; });
+            _signaled = false;
+        }
+
+        flush();
+    }
+}
+
+void LogWriter::notify()
+{
+    {
+        std::lock_guard<std::mutex> guard(_wakeup_mutex);
+        _signaled = true;
+    }
+    _wakeup.notify_one();
+}
+
+ThreadLog* LogWriter::thread_log()
+{
+    if(State::Stopped == _state.load()) {
+        start();
+    }
+
+    if(nullptr == thread_state.log) {
+        thread_state.log = register_thread();
+    }
+    return thread_state.log;
+}
+
+ThreadLog* LogWriter::register_thread()
+{
+    std::stringstream thread;
+    thread << std::this_thread::get_id();
+
+    std::lock_guard<std::mutex> guard(_threads_mutex);
+
+    _threads.push_back(std::unique_ptr<ThreadLog>(new ThreadLog(_next_thread++, thread.str())));
+    return _threads.back().get();
+}
+
+void LogWriter::drain()
+{
+    _pending.clear();
+    for(const auto& log : _threads) {
+        size_t length;
+        const void* record;
+        while(nullptr != (record = log->buffer.read(length))) {
+            _pending.push_back({ reinterpret_cast<const LogRecord*>(record), log.get() });
+        }
+    }
+
+    if(!_pending.empty()) {
+        // merge the threads back into timestamp order
+        std::stable_sort(_pending.begin(), _pending.end(),
+            [](const PendingRecord& lhs, const PendingRecord& rhs) { return lhs.record->timestamp < rhs.record->timestamp; });
+
+        std::lock_guard<std::mutex> guard(Logger::_output_mutex);
+        for(const PendingRecord& pending : _pending) {
+            output(*pending.record, *pending.log, pending.record + 1);
+        }
+        Logger::flush_outputs();
+    }
+
+    auto it = _threads.begin();
+    while(it != _threads.end()) {
+        (*it)->buffer.release();
+
+        // NOTE: retired has to be checked first to be sure nothing was committed after we checked empty
+        if((*it)->retired.load() && (*it)->buffer.empty()) {
+            it = _threads.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+const std::string& LogWriter::timestamp(std::chrono::system_clock::rep timestamp)
+{
+    std::time_t time = std::chrono::system_clock::to_time_t(
+        std::chrono::time_point<std::chrono::system_clock>(std::chrono::system_clock::duration(timestamp)));
+    if(time != _cached_time) {
+        _cached_time = time;
+        _cached_timestamp = log_timestamp(time);
+    }
+    return _cached_timestamp;
+}
+
+void LogWriter::output(const LogRecord& record, const ThreadLog& log, const void* data)
+{
+    const Logger& logger(*record.logger);
+    if(nullptr == record.site) {
+        const char* message = reinterpret_cast<const char*>(data);
+        if(Logger::config_text()) {
+            Logger::write(logger, record.level, timestamp(record.timestamp), log.thread, message, record.length);
+        }
+
+        if(Logger::config_binary()) {
+            Logger::_logger_binary->write_text(logger, record.level, microseconds(record.timestamp),
+                log.id, log.thread, message, record.length);
+        }
+        return;
+    }
+
+    const unsigned char* args = reinterpret_cast<const unsigned char*>(data);
+    if(Logger::config_text()) {
+        _format.reset();
+        log_format(_format, record.site->format(), args, record.length);
+        Logger::write(logger, record.level, timestamp(record.timestamp), log.thread, _format.data(), _format.length());
+    }
+
+    if(Logger::config_binary()) {
+        Logger::_logger_binary->write_record(logger, *record.site, record.level, microseconds(record.timestamp),
+            log.id, log.thread, args, record.length);
+    }
+}
+
+std::mutex Logger::_output_mutex;
 std::shared_ptr<Logger::ThreadSafeLoggerMap> Logger::_loggers;
 std::vector<std::ostream*> Logger::_callbacks;
 uint32_t Logger::_logger_type = LoggerTypeStdout;
-Logger::Level Logger::_logger_level = Level::Info;
+std::atomic<Logger::Level> Logger::_logger_level(Level::Info);
 boost::filesystem::path Logger::_logger_filename;
 std::shared_ptr<std::ofstream> Logger::_logger_file;
+std::shared_ptr<BinaryLogWriter> Logger::_logger_binary;
 
 Logger& Logger::instance(const std::string& category)
 {
     // NOTE: loggers don't go on an allocator
 
-    if(!_loggers) {
-        _loggers.reset(new ThreadSafeLoggerMap());
-    }
-
-    std::lock_guard<std::recursive_mutex> guard(_loggers->mutex);
+    std::lock_guard<std::recursive_mutex> guard(loggers().mutex);
 
     std::shared_ptr<Logger> logger;
     try {
         logger = _loggers->loggers.at(category);
     } catch(const std::out_of_range& ) {
         logger.reset(new Logger(category));
+        logger->_level = category_level(category);
         _loggers->loggers[category] = logger;
     }
     return *logger;
 }
 
+Logger::ThreadSafeLoggerMap& Logger::loggers()
+{
+    if(!_loggers) {
+        _loggers.reset(new ThreadSafeLoggerMap());
+    }
+    return *_loggers;
+}
+
 void Logger::register_callback(std::ostream* const callback)
 {
+    std::lock_guard<std::mutex> guard(_output_mutex);
+
     _callbacks.push_back(callback);
 }
 
 bool Logger::configure(uint32_t type, Level level, const boost::filesystem::path& filename)
 {
-    std::lock_guard<std::recursive_mutex> guard(logger_mutex);
+    std::lock_guard<std::mutex> guard(_output_mutex);
 
     _logger_type = type;
-    _logger_level = level;
     _logger_filename = filename;
+    set_log_level(level);
 
     if(config_file()) {
         _logger_file.reset(new std::ofstream(_logger_filename.string().c_str(), std::ios::app));
@@ -56,25 +489,133 @@ bool Logger::configure(uint32_t type, Level level, const boost::filesystem::path
 
 void Logger::configure(Level level)
 {
-    std::lock_guard<std::recursive_mutex> guard(logger_mutex);
+    std::lock_guard<std::mutex> guard(_output_mutex);
 
     _logger_type = LoggerTypeStdout;
-    _logger_level = level;
     _logger_filename = "";
+    set_log_level(level);
+}
+
+bool Logger::configure_binary(const boost::filesystem::path& filename)
+{
+    // anything already committed goes to the old log
+    flush();
+
+    std::lock_guard<std::mutex> guard(_output_mutex);
+
+    _logger_binary.reset();
+    if(filename.empty()) {
+        return true;
+    }
+
+    _logger_binary.reset(new BinaryLogWriter(filename));
+    if(!_logger_binary->good()) {
+        _logger_binary.reset();
+        return false;
+    }
+    return true;
+}
+
+void Logger::set_log_level(Level level)
+{
+    std::lock_guard<std::recursive_mutex> guard(loggers().mutex);
+
+    _logger_level = level;
+    update_levels();
+}
+
+void Logger::set_log_level(const std::string& category, Level level)
+{
+    std::lock_guard<std::recursive_mutex> guard(loggers().mutex);
+
+    _loggers->levels[category] = level;
+    update_levels();
+}
+
+void Logger::clear_log_level(const std::string& category)
+{
+    std::lock_guard<std::recursive_mutex> guard(loggers().mutex);
+
+    _loggers->levels.erase(category);
+    update_levels();
+}
+
+bool Logger::configure_levels(const std::string& levels)
+{
+    LevelMap parsed;
+    if(!parse_levels(levels, parsed)) {
+        return false;
+    }
+
+    std::lock_guard<std::recursive_mutex> guard(loggers().mutex);
+
+    _loggers->levels = parsed;
+    update_levels();
+    return true;
+}
+
+bool Logger::parse_levels(const std::string& levels, LevelMap& parsed)
+{
+    std::vector<std::string> entries;
+    tokenize(levels, entries, ",");
+    for(const std::string& entry : entries) {
+        if(boost::algorithm::trim_copy(entry).empty()) {
+            continue;
+        }
+
+        size_t pos = entry.find('=');
+        if(std::string::npos == pos) {
+            return false;
+        }
+
+        std::string category(boost::algorithm::trim_copy(entry.substr(0, pos)));
+        Level level = Logger::level(boost::algorithm::trim_copy(entry.substr(pos + 1)));
+        if(category.empty() || Level::Invalid == level) {
+            return false;
+        }
+        parsed[category] = level;
+    }
+    return true;
+}
+
+Logger::Level Logger::category_level(const std::string& category)
+{
+    // the most specific category with a level wins
+    std::string scratch(category);
+    while(true) {
+        LevelMap::const_iterator it = _loggers->levels.find(scratch);
+        if(it != _loggers->levels.end()) {
+            return it->second;
+        }
+
+        size_t pos = scratch.rfind('.');
+        if(std::string::npos == pos) {
+            break;
+        }
+        scratch.erase(pos);
+    }
+    return _logger_level;
+}
+
+void Logger::update_levels()
+{
+    for(const auto& logger : _loggers->loggers) {
+        logger.second->_level.store(category_level(logger.first), std::memory_order_relaxed);
+    }
 }
 
 Logger::Level Logger::level(const std::string& level)
 {
     std::string scratch(boost::algorithm::to_lower_copy(level));
-    if("debug" == level) {
+    if("debug" == scratch) {
         return Level::Debug;
-    } else if("info" == level) {
+    } else if("info" == scratch) {
         return Level::Info;
-    } else if("warning" == level) {
+    } else if("warning" == scratch) {
         return Level::Warning;
-    } else if("error" == level) {
+    } else if("error" == scratch) {
         return Level::Error;
-    } else if("critical" == level) {
+    } else if("critical" == scratch) {
         return Level::Critical;
     }
     return Level::Invalid;
@@ -88,6 +629,71 @@ const std::string& Logger::level(Level level) throw(std::out_of_range)
     return LOG_LEVELS[static_cast<int>(level)];
 }
 
+void Logger::flush()
+{
+    LogWriter::instance().flush();
+}
+
+void Logger::shutdown()
+{
+    LogWriter::instance().stop();
+}
+
+unsigned char* Logger::reserve_record(const Logger& logger, Level level, const LogSite& site, size_t length)
+{
+    return reinterpret_cast<unsigned char*>(LogWriter::instance().reserve(logger, &site, level, std::chrono::system_clock::now(), length));
+}
+
+void Logger::commit_record(Level level)
+{
+    LogWriter::instance().commit(level);
+}
+
+void Logger::write_record(const Logger& logger, Level level, const LogSite& site, const unsigned char* args, size_t length)
+{
+    LogWriter::instance().write(logger, &site, level, std::chrono::system_clock::now(), args, length);
+}
+
+void Logger::write(const Logger& logger, Level level, const std::string& timestamp, const std::string& thread, const char* message, size_t length)
+{
+    auto write_message = [&](std::ostream& out) {
+        out << timestamp << " [" << thread << "] " << logger.category() << " " << Logger::level(level) << ": ";
+        out.write(message, length);
+    };
+
+    if(config_stdout()) {
+        write_message(level >= Level::Error ? std::cerr : std::cout);
+    }
+
+    if(config_file()) {
+        write_message(logger_file());
+    }
+
+    for(std::ostream* callback : _callbacks) {
+        write_message(*callback);
+    }
+}
+
+void Logger::flush_outputs()
+{
+    if(config_stdout()) {
+        std::cout.flush();
+        std::cerr.flush();
+    }
+
+    if(config_file()) {
+        logger_file().flush();
+    }
+
+    if(config_binary()) {
+        _logger_binary->flush();
+    }
+
+    for(std::ostream* callback : _callbacks) {
+        callback->flush();
+    }
+}
+
 Logger::Logger(const std::string& category)
     : _category(category), _level(Level::Info)
 {
@@ -97,33 +703,44 @@ Logger::~Logger() noexcept
 {
 }
 
-Logger& Logger::operator<<(std::ostream& (*rhs)(std::ostream&))
+Logger::Message::Message(const Logger& logger, Level level)
+    : _logger(logger), _level(level), _timestamp(std::chrono::system_clock::now()),
+        _stream(nullptr), _nested(thread_state.formatting)
 {
-    std::lock_guard<std::recursive_mutex> guard(logger_mutex);
-
-    if(level() >= _logger_level) {
-        if(config_stdout()) {
-            if(level() >= Level::Error) {
-                std::cerr << rhs;
-            } else {
-                std::cout << rhs;
-            }
-        }
-
-        if(config_file()) {
-            logger_file() << rhs;
-        }
+    if(_nested) {
+        _stream = new LogStream();
+    } else {
+        _stream = &thread_state.stream;
+        _stream->reset();
+        thread_state.formatting = true;
     }
+}
 
-    return *this;
+Logger::Message::~Message() noexcept
+{
+    if(_nested) {
+        delete _stream;
+    } else {
+        thread_state.formatting = false;
+    }
 }
 
-Logger& operator<<(Logger& lhs, const Logger::Level& level)
+std::ostream& Logger::Message::stream()
 {
-    std::lock_guard<std::recursive_mutex> guard(Logger::logger_mutex);
+    return *_stream;
+}
 
-    lhs._level = level;
-    return lhs;
+void Logger::Message::commit()
+{
+    LogWriter& writer(LogWriter::instance());
+
+    void* record = writer.reserve(_logger, nullptr, _level, _timestamp, _stream->length());
+    if(nullptr != record) {
+        std::memcpy(record, _stream->data(), _stream->length());
+        writer.commit(_level);
+    } else {
+        writer.write(_logger, nullptr, _level, _timestamp, _stream->data(), _stream->length());
+    }
 }
 
 }
@@ -136,16 +753,45 @@ class LoggerTest : public CppUnit::TestFixture
 public:
     CPPUNIT_TEST_SUITE(LoggerTest);
         CPPUNIT_TEST(test_levels);
+        CPPUNIT_TEST(test_disabled_level);
+        CPPUNIT_TEST(test_category_levels);
+        CPPUNIT_TEST(test_configure_levels);
+        CPPUNIT_TEST(test_nested);
+        CPPUNIT_TEST(test_threaded);
+        CPPUNIT_TEST(test_structured);
+        CPPUNIT_TEST(test_binary);
     CPPUNIT_TEST_SUITE_END();
 
 private:
     static energonsoftware::Logger& logger;
+    static std::stringstream output;
 
 public:
-    LoggerTest() : CppUnit::TestFixture() {}
+    LoggerTest() : CppUnit::TestFixture(), _level(energonsoftware::Logger::Level::Invalid) {}
     virtual ~LoggerTest() noexcept {}
 
 public:
+    void setUp() override
+    {
+        static bool registered = false;
+        if(!registered) {
+            energonsoftware::Logger::register_callback(&output);
+            registered = true;
+        }
+
+        _level = energonsoftware::Logger::config_level();
+        energonsoftware::Logger::set_log_level(energonsoftware::Logger::Level::Debug);
+
+        energonsoftware::Logger::flush();
+        output.str("");
+        output.clear();
+    }
+
+    void tearDown() override
+    {
+        energonsoftware::Logger::set_log_level(_level);
+    }
+
     void test_levels()
     {
         LOG_DEBUG("DEBUG test\n");
@@ -153,9 +799,166 @@ public:
         LOG_WARNING("WARNING test\n");
         LOG_ERROR("ERROR test\n");
         LOG_CRITICAL("CRITICAL test\n");
+
+        energonsoftware::Logger::flush();
+        CPPUNIT_ASSERT(std::string::npos != output.str().find("energonsoftware.core.logging.LoggerTest DEBUG: DEBUG test\n"));
+        CPPUNIT_ASSERT(std::string::npos != output.str().find("energonsoftware.core.logging.LoggerTest CRITICAL: CRITICAL test\n"));
+    }
+
+    void test_disabled_level()
+    {
+        energonsoftware::Logger::set_log_level(energonsoftware::Logger::Level::Warning);
+
+        int evaluated = 0;
+        LOG_DEBUG("should not be evaluated " << ++evaluated << "\n");
+        LOG_INFO("should not be evaluated " << ++evaluated << "\n");
+        LOGF_DEBUG("should not be evaluated {}\n", ++evaluated);
+        CPPUNIT_ASSERT_EQUAL(0, evaluated);
+
+        LOG_WARNING("should be evaluated " << ++evaluated << "\n");
+        CPPUNIT_ASSERT_EQUAL(1, evaluated);
+
+        energonsoftware::Logger::flush();
+        CPPUNIT_ASSERT(std::string::npos == output.str().find("should not be evaluated"));
+        CPPUNIT_ASSERT(std::string::npos != output.str().find("should be evaluated 1\n"));
     }
+
+    void test_category_levels()
+    {
+        energonsoftware::Logger& network(energonsoftware::Logger::instance("energonsoftware.test.network"));
+        energonsoftware::Logger& session(energonsoftware::Logger::instance("energonsoftware.test.network.TcpSession"));
+        energonsoftware::Logger& thread(energonsoftware::Logger::instance("energonsoftware.test.thread"));
+
+        energonsoftware::Logger::set_log_level(energonsoftware::Logger::Level::Warning);
+        energonsoftware::Logger::set_log_level("energonsoftware.test.network", energonsoftware::Logger::Level::Debug);
+        CPPUNIT_ASSERT(network.enabled(energonsoftware::Logger::Level::Debug));
+        CPPUNIT_ASSERT(session.enabled(energonsoftware::Logger::Level::Debug));
+        CPPUNIT_ASSERT(!thread.enabled(energonsoftware::Logger::Level::Info));
+
+        // more specific categories win
+        energonsoftware::Logger::set_log_level("energonsoftware.test.network.TcpSession", energonsoftware::Logger::Level::Error);
+        CPPUNIT_ASSERT(network.enabled(energonsoftware::Logger::Level::Debug));
+        CPPUNIT_ASSERT(!session.enabled(energonsoftware::Logger::Level::Warning));
+
+        // new loggers pick up existing levels
+        energonsoftware::Logger& udp(energonsoftware::Logger::instance("energonsoftware.test.network.UdpSession"));
+        CPPUNIT_ASSERT(udp.enabled(energonsoftware::Logger::Level::Debug));
+
+        energonsoftware::Logger::clear_log_level("energonsoftware.test.network.TcpSession");
+        energonsoftware::Logger::clear_log_level("energonsoftware.test.network");
+        CPPUNIT_ASSERT(energonsoftware::Logger::Level::Warning == session.level());
+        CPPUNIT_ASSERT(energonsoftware::Logger::Level::Warning == udp.level());
+    }
+
+    void test_configure_levels()
+    {
+        energonsoftware::Logger& network(energonsoftware::Logger::instance("energonsoftware.test.network"));
+        energonsoftware::Logger& thread(energonsoftware::Logger::instance("energonsoftware.test.thread"));
+
+        CPPUNIT_ASSERT(energonsoftware::Logger::configure_levels("energonsoftware.test.network = critical, energonsoftware.test.thread=INFO"));
+        CPPUNIT_ASSERT(energonsoftware::Logger::Level::Critical == network.level());
+        CPPUNIT_ASSERT(energonsoftware::Logger::Level::Info == thread.level());
+
+        // invalid levels don't change anything
+        CPPUNIT_ASSERT(!energonsoftware::Logger::configure_levels("energonsoftware.test.network=loud"));
+        CPPUNIT_ASSERT(!energonsoftware::Logger::configure_levels("energonsoftware.test.network"));
+        CPPUNIT_ASSERT(energonsoftware::Logger::Level::Critical == network.level());
+
+        CPPUNIT_ASSERT(energonsoftware::Logger::configure_levels(""));
+        CPPUNIT_ASSERT(energonsoftware::Logger::Level::Debug == network.level());
+    }
+
+    void test_nested()
+    {
+        LOG_INFO("outer " << nested() << " message\n");
+
+        energonsoftware::Logger::flush();
+        CPPUNIT_ASSERT(std::string::npos != output.str().find("INFO: inner message\n"));
+        CPPUNIT_ASSERT(std::string::npos != output.str().find("INFO: outer nested message\n"));
+    }
+
+    void test_threaded()
+    {
+        static const int THREAD_COUNT = 4;
+        static const int MESSAGE_COUNT = 1000;
+
+        std::vector<std::thread> threads;
+        for(int i=0; i<THREAD_COUNT; ++i) {
+            threads.push_back(std::thread([i]() {
+                for(int j=0; j<MESSAGE_COUNT; ++j) {
+                    LOG_DEBUG("thread " << i << " message " << j << "\n");
+                }
+            }));
+        }
+
+        for(std::thread& thread : threads) {
+            thread.join();
+        }
+
+        energonsoftware::Logger::flush();
+
+        int count = 0;
+        std::string line;
+        while(std::getline(output, line)) {
+            if(std::string::npos != line.find("DEBUG: thread ")) {
+                ++count;
+            }
+        }
+        CPPUNIT_ASSERT_EQUAL(THREAD_COUNT * MESSAGE_COUNT, count);
+    }
+
+    void test_structured()
+    {
+        for(int i=0; i<3; ++i) {
+            LOGF_INFO("structured {} of {}: {}\n", i, 3, boost::filesystem::path("test.conf"));
+        }
+        LOGF_WARNING("no arguments\n");
+
+        // larger than the thread's buffer
+        std::string large(128 * 1024, 'x');
+        LOGF_DEBUG("large {} {}\n", large, 1);
+
+        energonsoftware::Logger::flush();
+        CPPUNIT_ASSERT(std::string::npos != output.str().find("energonsoftware.core.logging.LoggerTest INFO: structured 0 of 3: \"test.conf\"\n"));
+        CPPUNIT_ASSERT(std::string::npos != output.str().find("INFO: structured 2 of 3: \"test.conf\"\n"));
+        CPPUNIT_ASSERT(std::string::npos != output.str().find("WARNING: no arguments\n"));
+        CPPUNIT_ASSERT(std::string::npos != output.str().find("DEBUG: large " + large + " 1\n"));
+    }
+
+    void test_binary()
+    {
+        boost::filesystem::path filename(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%-%%%%.blog"));
+        CPPUNIT_ASSERT(energonsoftware::Logger::configure_binary(filename));
+        CPPUNIT_ASSERT(energonsoftware::Logger::config_binary());
+
+        LOGF_INFO("binary {} {}\n", 1, 2.5);
+        LOG_INFO("text message\n");
+
+        CPPUNIT_ASSERT(energonsoftware::Logger::configure_binary(""));
+        CPPUNIT_ASSERT(!energonsoftware::Logger::config_binary());
+
+        // decoding gives back the same text that was logged
+        std::ifstream in(filename.string().c_str(), std::ios::binary);
+        std::stringstream decoded;
+        CPPUNIT_ASSERT(energonsoftware::BinaryLogReader().decode(in, decoded));
+        CPPUNIT_ASSERT_EQUAL(output.str(), decoded.str());
+
+        in.close();
+        boost::filesystem::remove(filename);
+    }
+
+private:
+    std::string nested()
+    {
+        LOG_INFO("inner message\n");
+        return "nested";
+    }
+
+private:
+    energonsoftware::Logger::Level _level;
 };
 energonsoftware::Logger& LoggerTest::logger(energonsoftware::Logger::instance("energonsoftware.core.logging.LoggerTest"));
+std::stringstream LoggerTest::output;
 
 CPPUNIT_TEST_SUITE_REGISTRATION(LoggerTest);
 
@@ -4,79 +4,47 @@
 // TODO: get rid of these includes here by switching to a filter model
 #include <iostream>
 #include <fstream>
-
-/*<< __FILE__ << "[" << __LINE__ << "] " \*/
-
-#define LOG_DEBUG(e) do { \
-    std::lock_guard<std::recursive_mutex> guard(energonsoftware::Logger::logger_mutex); \
-    logger << energonsoftware::Logger::Level::Debug \
-        << boost::posix_time::to_simple_string(boost::posix_time::second_clock::local_time()) << " " \
-        << "[" << std::this_thread::get_id() << "] " \
-        << logger.category() << " " \
-        << energonsoftware::Logger::level(energonsoftware::Logger::Level::Debug) << ": " \
-        << e; \
-} while(false)
-
-#define LOG_INFO(e) do { \
-    std::lock_guard<std::recursive_mutex> guard(energonsoftware::Logger::logger_mutex); \
-    logger << energonsoftware::Logger::Level::Info \
-        << boost::posix_time::to_simple_string(boost::posix_time::second_clock::local_time()) << " " \
-        << "[" << std::this_thread::get_id() << "] " \
-        << logger.category() << " " \
-        << energonsoftware::Logger::level(energonsoftware::Logger::Level::Info) << ": " \
-        << e; \
-} while(false)
-
-#define LOG_WARNING(e) do { \
-    std::lock_guard<std::recursive_mutex> guard(energonsoftware::Logger::logger_mutex); \
-    logger << energonsoftware::Logger::Level::Warning \
-        << boost::posix_time::to_simple_string(boost::posix_time::second_clock::local_time()) << " " \
-        << "[" << std::this_thread::get_id() << "] " \
-        << logger.category() << " " \
-        << energonsoftware::Logger::level(energonsoftware::Logger::Level::Warning) << ": " \
-        << e; \
+#include "LogFormat.h"
+
+// NOTE: the message is only evaluated if the level is enabled
+#define LOG_LEVEL(l, e) do { \
+    if(logger.enabled((l))) { \
+        energonsoftware::Logger::Message __log_message(logger, (l)); \
+        __log_message.stream() << e; \
+        __log_message.commit(); \
+    } \
 } while(false)
 
-#define LOG_ERROR(e) do { \
-    std::lock_guard<std::recursive_mutex> guard(energonsoftware::Logger::logger_mutex); \
-    logger << energonsoftware::Logger::Level::Error \
-        << boost::posix_time::to_simple_string(boost::posix_time::second_clock::local_time()) << " " \
-        << "[" << std::this_thread::get_id() << "] " \
-        << logger.category() << " " \
-        << energonsoftware::Logger::level(energonsoftware::Logger::Level::Error) << ": " \
-        << e; \
+#define LOG_DEBUG(e) LOG_LEVEL(energonsoftware::Logger::Level::Debug, e)
+#define LOG_INFO(e) LOG_LEVEL(energonsoftware::Logger::Level::Info, e)
+#define LOG_WARNING(e) LOG_LEVEL(energonsoftware::Logger::Level::Warning, e)
+#define LOG_ERROR(e) LOG_LEVEL(energonsoftware::Logger::Level::Error, e)
+#define LOG_CRITICAL(e) LOG_LEVEL(energonsoftware::Logger::Level::Critical, e)
+
+// structured messages record the call site and the raw arguments
+// and are formatted by the writer (or offline from a binary log)
+// each {} in the format is replaced by the next argument
+// NOTE: the format must be a string literal
+#define LOG_RECORD(l, ...) do { \
+    if(logger.enabled((l))) { \
+        static energonsoftware::LogSite __log_site(__FILE__, __LINE__); \
+        energonsoftware::Logger::record(logger, (l), __log_site, __VA_ARGS__); \
+    } \
 } while(false)
 
-#define LOG_CRITICAL(e) do { \
-    std::lock_guard<std::recursive_mutex> guard(energonsoftware::Logger::logger_mutex); \
-    logger <<energonsoftware:: Logger::Level::Critical \
-        << boost::posix_time::to_simple_string(boost::posix_time::second_clock::local_time()) << " " \
-        << "[" << std::this_thread::get_id() << "] " \
-        << logger.category() << " " \
-        << energonsoftware::Logger::level(energonsoftware::Logger::Level::Critical) << ": " \
-        << e; \
-} while(false)
+#define LOGF_DEBUG(...) LOG_RECORD(energonsoftware::Logger::Level::Debug, __VA_ARGS__)
+#define LOGF_INFO(...) LOG_RECORD(energonsoftware::Logger::Level::Info, __VA_ARGS__)
+#define LOGF_WARNING(...) LOG_RECORD(energonsoftware::Logger::Level::Warning, __VA_ARGS__)
+#define LOGF_ERROR(...) LOG_RECORD(energonsoftware::Logger::Level::Error, __VA_ARGS__)
+#define LOGF_CRITICAL(...) LOG_RECORD(energonsoftware::Logger::Level::Critical, __VA_ARGS__)
 
 namespace energonsoftware {
 
+class LogStream;
+class BinaryLogWriter;
+
 class Logger final
 {
-private:
-    typedef std::unordered_map<std::string, std::shared_ptr<Logger>> LoggerMap;
-    class ThreadSafeLoggerMap
-    {
-    public:
-        ThreadSafeLoggerMap() : mutex(), loggers() { }
-        virtual ~ThreadSafeLoggerMap() noexcept { }
-
-    public:
-        std::recursive_mutex mutex;
-        LoggerMap loggers;
-
-    private:
-        DISALLOW_COPY_AND_ASSIGN(ThreadSafeLoggerMap);
-    };
-
 public:
     enum LoggerTypeMask
     {
@@ -95,16 +63,64 @@ public:
         Critical,
     };
 
+    typedef std::unordered_map<std::string, Level> LevelMap;
+
+private:
+    typedef std::unordered_map<std::string, std::shared_ptr<Logger>> LoggerMap;
+    class ThreadSafeLoggerMap
+    {
+    public:
+        ThreadSafeLoggerMap() : mutex(), loggers(), levels() { }
+        virtual ~ThreadSafeLoggerMap() noexcept { }
+
+    public:
+        std::recursive_mutex mutex;
+        LoggerMap loggers;
+
+        // per-category level overrides
+        LevelMap levels;
+
+    private:
+        DISALLOW_COPY_AND_ASSIGN(ThreadSafeLoggerMap);
+    };
+
 public:
-    static std::recursive_mutex logger_mutex;
+    // a single message, formatted on the calling thread
+    // and handed off to the background writer by commit()
+    class Message final
+    {
+    public:
+        Message(const Logger& logger, Level level);
+        ~Message() noexcept;
+
+    public:
+        std::ostream& stream();
+
+        void commit();
+
+    private:
+        const Logger& _logger;
+        Level _level;
+        std::chrono::time_point<std::chrono::system_clock> _timestamp;
+
+        // messages formatted while formatting another message get their own stream
+        LogStream* _stream;
+        bool _nested;
+
+    private:
+        Message() = delete;
+        DISALLOW_COPY_AND_ASSIGN(Message);
+    };
 
 private:
+    static std::mutex _output_mutex;
     static std::shared_ptr<ThreadSafeLoggerMap> _loggers;
     static std::vector<std::ostream*> _callbacks;
     static uint32_t _logger_type;
-    static Level _logger_level;
+    static std::atomic<Level> _logger_level;
     static boost::filesystem::path _logger_filename;
     static std::shared_ptr<std::ofstream> _logger_file;
+    static std::shared_ptr<BinaryLogWriter> _logger_binary;
 
 public:
     static Logger& instance(const std::string& category);
@@ -117,56 +133,103 @@ public:
     // configures for stdout, no file
     static void configure(Level level);
 
+    // also writes every message to a binary log that can be decoded offline by BinaryLogReader,
+    // structured messages aren't formatted at all if this is the only output
+    // an empty filename stops writing the binary log
+    static bool configure_binary(const boost::filesystem::path& filename);
+
     static bool config_stdout() { return LoggerTypeStdout == (_logger_type & LoggerTypeStdout); }
     static bool config_file() { return LoggerTypeFile == (_logger_type & LoggerTypeFile); }
-    //static bool config_level() { return _logger_level; }
+    static bool config_binary() { return static_cast<bool>(_logger_binary); }
+    static Level config_level() { return _logger_level.load(std::memory_order_relaxed); }
+
+    // sets the default level for every category without its own level
+    static void set_log_level(Level level);
+
+    // sets the level for a category and all of its sub-categories
+    // (eg. "energonsoftware.core.network" covers "energonsoftware.core.network.TcpSession")
+    // unless a more specific category has its own level
+    static void set_log_level(const std::string& category, Level level);
+
+    // removes a category level set by set_log_level()
+    static void clear_log_level(const std::string& category);
 
-    static void set_log_level(Level level) { _logger_level = level; }
+    // replaces all of the category levels
+    // levels are formatted as category=level[, category=level...]
+    // returns false (and changes nothing) if the levels can't be parsed
+    static bool configure_levels(const std::string& levels);
+    static bool parse_levels(const std::string& levels, LevelMap& parsed);
 
     static Level level(const std::string& level);
     static const std::string& level(Level level) throw(std::out_of_range);
 
+    // records a structured message, use the LOGF_* macros rather than calling this directly
+    template<typename... Args>
+    static void record(const Logger& logger, Level level, LogSite& site, const char* format, const Args&... args)
+    {
+        site.bind(format);
+        encode_record(logger, level, site, log_value(args)...);
+    }
+
+    // blocks until every committed message has been written
+    static void flush();
+
+    // flushes and stops the background writer,
+    // anything logged afterwards is written immediately
+    static void shutdown();
+
 private:
     static std::ofstream& logger_file() { return *_logger_file; }
 
+    static ThreadSafeLoggerMap& loggers();
+
+    template<typename... Args>
+    static void encode_record(const Logger& logger, Level level, const LogSite& site, const Args&... args)
+    {
+        size_t length = log_args_size(args...);
+
+        unsigned char* data = reserve_record(logger, level, site, length);
+        if(nullptr != data) {
+            log_args_encode(data, args...);
+            commit_record(level);
+        } else {
+            // too big for the thread's buffer
+            std::vector<unsigned char> buffer(length);
+            log_args_encode(buffer.data(), args...);
+            write_record(logger, level, site, buffer.data(), length);
+        }
+    }
+
+    // returns nullptr if the record will never fit in the thread's buffer
+    static unsigned char* reserve_record(const Logger& logger, Level level, const LogSite& site, size_t length);
+    static void commit_record(Level level);
+    static void write_record(const Logger& logger, Level level, const LogSite& site, const unsigned char* args, size_t length);
+
+    // NOTE: these must be called with the loggers mutex held
+    static Level category_level(const std::string& category);
+    static void update_levels();
+
+    // NOTE: these must be called with the output mutex held
+    static bool config_text() { return config_stdout() || config_file() || !_callbacks.empty(); }
+    static void write(const Logger& logger, Level level, const std::string& timestamp, const std::string& thread, const char* message, size_t length);
+    static void flush_outputs();
+
+    friend class LogWriter;
+
 public:
     ~Logger() noexcept;
 
 public:
     const std::string& category() const { return _category; }
-    Level level() const { return _level; }
 
-public:
-    Logger& operator<<(std::ostream& (*rhs)(std::ostream&));
-    friend Logger& operator<<(Logger& lhs, const Level& level);
+    // the level after applying any category levels
+    Level level() const { return _level.load(std::memory_order_relaxed); }
 
-    template<typename T> friend Logger& operator<<(Logger& lhs, const T& rhs)
-    {
-        std::lock_guard<std::recursive_mutex> guard(Logger::logger_mutex);
-
-        if(lhs.level() >= _logger_level) {
-            if(Logger::config_stdout()) {
-                if(lhs.level() >= Logger::Level::Error) {
-                    std::cerr << rhs;
-                } else {
-                    std::cout << rhs;
-                }
-            }
-
-            if(Logger::config_file()) {
-                Logger::logger_file() << rhs;
-            }
-
-            for(std::ostream* callback : _callbacks) {
-                (*callback) << rhs;
-            }
-        }
-        return lhs;
-    }
+    bool enabled(Level level) const { return level >= _level.load(std::memory_order_relaxed); }
 
 private:
     std::string _category;
-    Level _level;
+    std::atomic<Level> _level;
 
 private:
     Logger() = delete;
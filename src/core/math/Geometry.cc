@@ -1,8 +1,13 @@
 #include "src/pch.h"
 #include "Geometry.h"
+#include "MeshBatch.h"
 
 namespace energonsoftware {
 
+// these are handed straight to the graphics API so they can't have any padding
+static_assert(sizeof(PackedVertex) == 12 * sizeof(float), "PackedVertex is padded");
+static_assert(sizeof(QuantizedVertex) == 32, "QuantizedVertex is padded");
+
 Vertex::Vertex()
     : index(-1), position(), normal(), tangent(), bitangent(), texture_coords(),
         weight_start(0), weight_count(0)
@@ -42,115 +47,72 @@ std::string Edge::str() const
 
 void compute_tangents(Triangle* const triangles, size_t triangle_count, Vertex* const vertices, size_t vertex_count, MemoryAllocator& allocator, bool smooth)
 {
-    std::shared_ptr<Vector3> narray(MemoryAllocator_new_aligned<Vector3, 16>(vertex_count, allocator),
-        MemoryAllocator_delete_aligned<Vector[], 16>(vertex_count, &allocator));
-    std::shared_ptr<Vector3> tarray(MemoryAllocator_new_aligned<Vector3, 16>(vertex_count, allocator),
-        MemoryAllocator_delete_aligned<Vector[], 16>(vertex_count, &allocator));
-    std::shared_ptr<Vector3> btarray(MemoryAllocator_new_aligned<Vector3, 16>(vertex_count, allocator),
-        MemoryAllocator_delete_aligned<Vector[], 16>(vertex_count, &allocator));
-
-    // calculate the vertex normals and tangents (sum of each face normal/tangent)
-    // Mathematics for 3D Game Programming and Computer Graphics, section 7.8.3
-    for(size_t i=0; i<triangle_count; ++i) {
-        Triangle& triangle(triangles[i]);
-        const Vertex &p0(vertices[triangle.v1]), &p1(vertices[triangle.v2]), &p2(vertices[triangle.v3]);
-
-        const int idx0 = p0.index, idx1 = p1.index, idx2 = p2.index;
-
-        // face normal
-        const Vector3 q1(p1.position - p0.position), q2(p2.position - p0.position);
-        Vector3 normal(q1 ^ q2);
-        if(smooth) {
-            normal.normalize();
-        }
-        triangle.normal = normal.normalized();
-
-        narray.get()[idx0] += normal;
-        narray.get()[idx1] += normal;
-        narray.get()[idx2] += normal;
-
-        const float s1 = p1.texture_coords.x() - p0.texture_coords.x(), t1 = p1.texture_coords.y() - p0.texture_coords.y();
-        const float s2 = p2.texture_coords.x() - p0.texture_coords.x(), t2 = p2.texture_coords.y() - p0.texture_coords.y();
-
-        // face tangent (coefficient times the texture matrix times the position matrix)
-        const float coef = 1.0f / (s1 * t2 - s2 * t1);
-        Vector3 tangent(coef * Vector3(t2 * q1.x() - t1 * q2.x(), t2 * q1.y() - t1 * q2.y(), t2 * q1.z() - t1 * q2.z()));
-        if(smooth) {
-            tangent.normalize();
-        }
-
-        // Gram-Schmidt orthogonalize the tangent
-        Vector3 object_tangent(tangent - (normal * tangent) * normal);
-        if(smooth) {
-            object_tangent.normalize();
-        }
-
-        tarray.get()[idx0] += object_tangent;
-        tarray.get()[idx1] += object_tangent;
-        tarray.get()[idx2] += object_tangent;
-
-        Vector3 bitangent(coef * Vector3(s1 * q2.x() - s2 * q1.x(), s1 * q2.y() - s2 * q1.y(), s1 * q2.z() - s2 * q1.z()));
-        if(smooth) {
-            bitangent.normalize();
-        }
-
-        btarray.get()[idx0] += bitangent;
-        btarray.get()[idx1] += bitangent;
-        btarray.get()[idx2] += bitangent;
-    }
+    // the work is done over a structure-of-arrays copy of the mesh
+    MeshBatch mesh(&allocator);
+    mesh.assign(triangles, triangle_count, vertices, vertex_count);
+    mesh.compute_tangents(smooth);
+    mesh.copy_to(triangles, vertices);
+}
 
-    // store the vertex data
-    for(size_t i=0; i<vertex_count; ++i) {
-        Vertex& vertex(vertices[i]);
-        vertex.normal = narray.get()[i].normalized();
-        vertex.tangent = tarray.get()[i].normalized();
-        vertex.bitangent = btarray.get()[i].normalized();
-    }
+// the bitangent is stored as a sign on the tangent
+// Mathematics for 3D Game Programming and Computer Graphics, section 7.8.3
+static float handedness(const Vertex& vertex)
+{
+    const Vector3 bitangent(vertex.normal ^ vertex.tangent);
+    return bitangent.opposite_direction(vertex.bitangent) ? -1.0f : 1.0f;
 }
 
-Geometry::Geometry(size_t vertex_count, MemoryAllocator& allocator)
-    : _mutex(), _vertex_count(0),
+Geometry::Geometry(size_t vertex_count, MemoryAllocator& allocator, VertexLayout layout)
+    : _mutex(), _layout(layout), _allocator(allocator), _vertex_count(0),
         _vertex_buffer_size(0), _vertex_buffer(),
         _normal_buffer_size(0), _normal_buffer(),
         _tangent_buffer_size(0), _tangent_buffer(),
         _texture_buffer_size(0), _texture_buffer(),
-        _normal_line_buffer(), _tangent_line_buffer()
+        _interleaved_buffer_size(0), _interleaved_buffer(),
+        _index_buffer_size(0), _index_buffer(),
+        _line_buffers_dirty(true), _normal_line_buffer(), _tangent_line_buffer()
 {
     allocate_buffers(vertex_count, allocator);
 }
 
-Geometry::Geometry(const Vertex* const vertices, size_t vertex_count, MemoryAllocator& allocator)
-    : _mutex(), _vertex_count(0),
+Geometry::Geometry(const Vertex* const vertices, size_t vertex_count, MemoryAllocator& allocator, VertexLayout layout)
+    : _mutex(), _layout(layout), _allocator(allocator), _vertex_count(0),
         _vertex_buffer_size(0), _vertex_buffer(),
         _normal_buffer_size(0), _normal_buffer(),
         _tangent_buffer_size(0), _tangent_buffer(),
         _texture_buffer_size(0), _texture_buffer(),
-        _normal_line_buffer(), _tangent_line_buffer()
+        _interleaved_buffer_size(0), _interleaved_buffer(),
+        _index_buffer_size(0), _index_buffer(),
+        _line_buffers_dirty(true), _normal_line_buffer(), _tangent_line_buffer()
 {
     allocate_buffers(vertex_count, allocator);
     copy_vertices(vertices, vertex_count, 0);
 }
 
-Geometry::Geometry(size_t triangle_count, size_t vertex_count, MemoryAllocator& allocator)
-    : _mutex(), _vertex_count(0),
+Geometry::Geometry(size_t triangle_count, size_t vertex_count, MemoryAllocator& allocator, VertexLayout layout)
+    : _mutex(), _layout(layout), _allocator(allocator), _vertex_count(0),
         _vertex_buffer_size(0), _vertex_buffer(),
         _normal_buffer_size(0), _normal_buffer(),
         _tangent_buffer_size(0), _tangent_buffer(),
         _texture_buffer_size(0), _texture_buffer(),
-        _normal_line_buffer(), _tangent_line_buffer()
+        _interleaved_buffer_size(0), _interleaved_buffer(),
+        _index_buffer_size(0), _index_buffer(),
+        _line_buffers_dirty(true), _normal_line_buffer(), _tangent_line_buffer()
 {
-    allocate_buffers(triangle_count, vertex_count, allocator);
+    allocate_buffers(triangle_count * 3, allocator);
 }
 
-Geometry::Geometry(const Triangle* const triangles, size_t triangle_count, const Vertex* const vertices, size_t vertex_count, MemoryAllocator& allocator)
-    : _mutex(), _vertex_count(0),
+Geometry::Geometry(const Triangle* const triangles, size_t triangle_count, const Vertex* const vertices, size_t vertex_count, MemoryAllocator& allocator, VertexLayout layout)
+    : _mutex(), _layout(layout), _allocator(allocator), _vertex_count(0),
         _vertex_buffer_size(0), _vertex_buffer(),
         _normal_buffer_size(0), _normal_buffer(),
         _tangent_buffer_size(0), _tangent_buffer(),
         _texture_buffer_size(0), _texture_buffer(),
-        _normal_line_buffer(), _tangent_line_buffer()
+        _interleaved_buffer_size(0), _interleaved_buffer(),
+        _index_buffer_size(0), _index_buffer(),
+        _line_buffers_dirty(true), _normal_line_buffer(), _tangent_line_buffer()
 {
-    allocate_buffers(triangle_count, vertex_count, allocator);
+    allocate_buffers(triangle_count * 3, allocator);
     copy_triangles(triangles, triangle_count, vertices, vertex_count, 0);
 }
 
@@ -158,189 +120,274 @@ Geometry::~Geometry() noexcept
 {
 }
 
+size_t Geometry::vertex_stride() const
+{
+    switch(_layout)
+    {
+    case VertexLayout::Interleaved:
+        return sizeof(PackedVertex);
+    case VertexLayout::Quantized:
+        return sizeof(QuantizedVertex);
+    case VertexLayout::Separate:
+        break;
+    }
+    return 0;
+}
+
+const float* Geometry::normal_line_buffer()
+{
+    std::lock_guard<std::recursive_mutex> guard(_mutex);
+    build_line_buffers();
+    return _normal_line_buffer.get();
+}
+
+const float* Geometry::tangent_line_buffer()
+{
+    std::lock_guard<std::recursive_mutex> guard(_mutex);
+    build_line_buffers();
+    return _tangent_line_buffer.get();
+}
+
 void Geometry::allocate_buffers(size_t vertex_count, MemoryAllocator& allocator)
 {
     std::lock_guard<std::recursive_mutex> guard(_mutex);
 
     _vertex_count = vertex_count;
 
+    if(VertexLayout::Separate != _layout) {
+        // everything in one allocation
+        _interleaved_buffer_size = _vertex_count * vertex_stride();
+        _interleaved_buffer.reset(reinterpret_cast<unsigned char*>(allocator.allocate_aligned(_interleaved_buffer_size, 16)),
+            std::bind(&MemoryAllocator::release_aligned, &allocator, std::placeholders::_1, 16));
+        return;
+    }
+
     _vertex_buffer_size = _vertex_count * 3;
     _vertex_buffer.reset(new(allocator) float[_vertex_buffer_size], std::bind(&MemoryAllocator::release, &allocator, std::placeholders::_1));
 
     _normal_buffer_size = _vertex_count * 3;
     _normal_buffer.reset(new(allocator) float[_normal_buffer_size], std::bind(&MemoryAllocator::release, &allocator, std::placeholders::_1));
-    _normal_line_buffer.reset(new(allocator) float[_vertex_count * 2 * 3], std::bind(&MemoryAllocator::release, &allocator, std::placeholders::_1));
 
     _tangent_buffer_size = _vertex_count * 4;
     _tangent_buffer.reset(new(allocator) float[_tangent_buffer_size], std::bind(&MemoryAllocator::release, &allocator, std::placeholders::_1));
-    _tangent_line_buffer.reset(new(allocator) float[_vertex_count * 2 * 3], std::bind(&MemoryAllocator::release, &allocator, std::placeholders::_1));
 
     _texture_buffer_size = _vertex_count * 2;
     _texture_buffer.reset(new(allocator) float[_texture_buffer_size], std::bind(&MemoryAllocator::release, &allocator, std::placeholders::_1));
 }
 
-void Geometry::allocate_buffers(size_t triangle_count, size_t vertex_count, MemoryAllocator& allocator)
+void Geometry::write_vertex(size_t index, const Vertex& vertex)
 {
-    std::lock_guard<std::recursive_mutex> guard(_mutex);
+    assert(index < _vertex_count);
 
-    _vertex_count = triangle_count * 3;
+    const Position& position(vertex.position);
+    const Vector3 &normal(vertex.normal), &tangent(vertex.tangent);
+    const Vector2& texture_coords(vertex.texture_coords);
+    const float w = handedness(vertex);
 
-    _vertex_buffer_size = _vertex_count * 3;
-    _vertex_buffer.reset(new(allocator) float[_vertex_buffer_size], std::bind(&MemoryAllocator::release, &allocator, std::placeholders::_1));
+    switch(_layout)
+    {
+    case VertexLayout::Separate:
+        {
+            float* const va = _vertex_buffer.get() + (index * 3);
+            va[0] = position.x(); va[1] = position.y(); va[2] = position.z();
 
-    _normal_buffer_size = _vertex_count * 3;
-    _normal_buffer.reset(new(allocator) float[_normal_buffer_size], std::bind(&MemoryAllocator::release, &allocator, std::placeholders::_1));
-    _normal_line_buffer.reset(new(allocator) float[_vertex_count * 2 * 3], std::bind(&MemoryAllocator::release, &allocator, std::placeholders::_1));
+            float* const na = _normal_buffer.get() + (index * 3);
+            na[0] = normal.x(); na[1] = normal.y(); na[2] = normal.z();
 
-    _tangent_buffer_size = _vertex_count * 4;
-    _tangent_buffer.reset(new(allocator) float[_tangent_buffer_size], std::bind(&MemoryAllocator::release, &allocator, std::placeholders::_1));
-    _tangent_line_buffer.reset(new(allocator) float[_vertex_count * 2 * 3], std::bind(&MemoryAllocator::release, &allocator, std::placeholders::_1));
+            float* const tna = _tangent_buffer.get() + (index * 4);
+            tna[0] = tangent.x(); tna[1] = tangent.y(); tna[2] = tangent.z(); tna[3] = w;
 
-    _texture_buffer_size = _vertex_count * 2;
-    _texture_buffer.reset(new(allocator) float[_tangent_buffer_size], std::bind(&MemoryAllocator::release, &allocator, std::placeholders::_1));
+            float* const ta = _texture_buffer.get() + (index * 2);
+            ta[0] = texture_coords.x(); ta[1] = texture_coords.y();
+        }
+        break;
+    case VertexLayout::Interleaved:
+        {
+            PackedVertex& packed(reinterpret_cast<PackedVertex*>(_interleaved_buffer.get())[index]);
+            packed.position[0] = position.x(); packed.position[1] = position.y(); packed.position[2] = position.z();
+            packed.normal[0] = normal.x(); packed.normal[1] = normal.y(); packed.normal[2] = normal.z();
+            packed.tangent[0] = tangent.x(); packed.tangent[1] = tangent.y(); packed.tangent[2] = tangent.z(); packed.tangent[3] = w;
+            packed.texture_coords[0] = texture_coords.x(); packed.texture_coords[1] = texture_coords.y();
+        }
+        break;
+    case VertexLayout::Quantized:
+        {
+            QuantizedVertex& packed(reinterpret_cast<QuantizedVertex*>(_interleaved_buffer.get())[index]);
+            packed.position[0] = position.x(); packed.position[1] = position.y(); packed.position[2] = position.z();
+            packed.normal[0] = float_to_half(normal.x());
+            packed.normal[1] = float_to_half(normal.y());
+            packed.normal[2] = float_to_half(normal.z());
+            packed.normal[3] = 0;
+            packed.tangent[0] = float_to_half(tangent.x());
+            packed.tangent[1] = float_to_half(tangent.y());
+            packed.tangent[2] = float_to_half(tangent.z());
+            packed.tangent[3] = float_to_half(w);
+            packed.texture_coords[0] = float_to_half(texture_coords.x());
+            packed.texture_coords[1] = float_to_half(texture_coords.y());
+        }
+        break;
+    }
 }
 
-void Geometry::copy_vertices(const Vertex* const vertices, size_t vertex_count, size_t start)
+void Geometry::read_vertex(size_t index, float* const position, float* const normal, float* const tangent) const
 {
-    std::lock_guard<std::recursive_mutex> guard(_mutex);
+    assert(index < _vertex_count);
 
-    // fill the normal/tangent line buffers (for debugging)
-    float *nlb = _normal_line_buffer.get(), *tnlb = _tangent_line_buffer.get();
-    for(size_t i=0; i<_vertex_count; ++i) {
-        const Vertex& vertex(vertices[i]);
+    switch(_layout)
+    {
+    case VertexLayout::Separate:
+        std::memcpy(position, _vertex_buffer.get() + (index * 3), 3 * sizeof(float));
+        std::memcpy(normal, _normal_buffer.get() + (index * 3), 3 * sizeof(float));
+        std::memcpy(tangent, _tangent_buffer.get() + (index * 4), 3 * sizeof(float));
+        break;
+    case VertexLayout::Interleaved:
+        {
+            const PackedVertex& packed(reinterpret_cast<const PackedVertex*>(_interleaved_buffer.get())[index]);
+            std::memcpy(position, packed.position, 3 * sizeof(float));
+            std::memcpy(normal, packed.normal, 3 * sizeof(float));
+            std::memcpy(tangent, packed.tangent, 3 * sizeof(float));
+        }
+        break;
+    case VertexLayout::Quantized:
+        {
+            const QuantizedVertex& packed(reinterpret_cast<const QuantizedVertex*>(_interleaved_buffer.get())[index]);
+            std::memcpy(position, packed.position, 3 * sizeof(float));
+            for(int i=0; i<3; ++i) {
+                normal[i] = half_to_float(packed.normal[i]);
+                tangent[i] = half_to_float(packed.tangent[i]);
+            }
+        }
+        break;
+    }
+}
 
-        const size_t idx = (start * 2 * 3) + (i * 2 * 3);
-        const Position& p(vertex.position);
-        const Vector3 &n(vertex.normal), &t(vertex.tangent);
+void Geometry::build_line_buffers()
+{
+    std::lock_guard<std::recursive_mutex> guard(_mutex);
 
-        *(nlb + idx + 0) = p.x(); *(nlb + idx + 3) = p.x() + n.x();
-        *(nlb + idx + 1) = p.y(); *(nlb + idx + 4) = p.y() + n.y();
-        *(nlb + idx + 2) = p.z(); *(nlb + idx + 5) = p.z() + n.z();
+    if(!_line_buffers_dirty) {
+        return;
+    }
 
-        *(tnlb + idx + 0) = p.x(); *(tnlb + idx + 3) = p.x() + t.x();
-        *(tnlb + idx + 1) = p.y(); *(tnlb + idx + 4) = p.y() + t.y();
-        *(tnlb + idx + 2) = p.z(); *(tnlb + idx + 5) = p.z() + t.z();
+    if(!_normal_line_buffer) {
+        _normal_line_buffer.reset(new(_allocator) float[_vertex_count * 2 * 3], std::bind(&MemoryAllocator::release, &_allocator, std::placeholders::_1));
+        _tangent_line_buffer.reset(new(_allocator) float[_vertex_count * 2 * 3], std::bind(&MemoryAllocator::release, &_allocator, std::placeholders::_1));
     }
 
-    // fill the vertex buffers
-    float *va = _vertex_buffer.get(), *na = _normal_buffer.get(), *tna = _tangent_buffer.get(), *ta = _texture_buffer.get();
+    float *nlb = _normal_line_buffer.get(), *tnlb = _tangent_line_buffer.get();
     for(size_t i=0; i<_vertex_count; ++i) {
-        const Vertex& vertex(vertices[i]);
-
-        const size_t vidx = (start * 3) + (i * 3);
-        *(va + vidx + 0) = vertex.position.x();
-        *(va + vidx + 1) = vertex.position.y();
-        *(va + vidx + 2) = vertex.position.z();
-
-        const Vector3& normal(vertex.normal);
-        *(na + vidx + 0) = normal.x();
-        *(na + vidx + 1) = normal.y();
-        *(na + vidx + 2) = normal.z();
-
-        const size_t tnidx = (start * 4) + (i * 4);
-
-        // Mathematics for 3D Game Programming and Computer Graphics, section 7.8.3
-        const Vector3& tangent(vertex.tangent);
-        const Vector3& bitangent(normal ^ tangent);
-        *(tna + tnidx + 0) = tangent.x();
-        *(tna + tnidx + 1) = tangent.y();
-        *(tna + tnidx + 2) = tangent.z();
-        *(tna + tnidx + 3) = bitangent.opposite_direction(vertex.bitangent) ? -1.0f : 1.0f;
-
-        const size_t tidx = (start * 2) + (i * 2);
-        *(ta + tidx + 0) = vertex.texture_coords.x();
-        *(ta + tidx + 1) = vertex.texture_coords.y();
+        float p[3], n[3], t[3];
+        read_vertex(i, p, n, t);
+
+        const size_t idx = i * 2 * 3;
+        for(int j=0; j<3; ++j) {
+            nlb[idx + j] = p[j]; nlb[idx + 3 + j] = p[j] + n[j];
+            tnlb[idx + j] = p[j]; tnlb[idx + 3 + j] = p[j] + t[j];
+        }
     }
+    _line_buffers_dirty = false;
 }
 
-void Geometry::copy_triangles(const Triangle* const triangles, size_t triangle_count, const Vertex* const vertices, size_t vertex_count, size_t start)
+void Geometry::copy_vertices(const Vertex* const vertices, size_t vertex_count, size_t start)
 {
     std::lock_guard<std::recursive_mutex> guard(_mutex);
 
-    // fill the normal/tangent line buffers (for debugging)
-    float *nlb = _normal_line_buffer.get(), *tnlb = _tangent_line_buffer.get();
+    assert(start + vertex_count <= _vertex_count);
     for(size_t i=0; i<vertex_count; ++i) {
-        const Vertex& vertex(vertices[i]);
+        write_vertex(start + i, vertices[i]);
+    }
+    _line_buffers_dirty = true;
+}
 
-        const size_t idx = (start * 2 * 3) + i * 2 * 3;
-        const Position& p(vertex.position);
-        const Vector3 &n(vertex.normal), &t(vertex.tangent);
+void Geometry::copy_triangles(const Triangle* const triangles, size_t triangle_count, const Vertex* const vertices, size_t vertex_count, size_t start)
+{
+    std::lock_guard<std::recursive_mutex> guard(_mutex);
 
-        *(nlb + idx + 0) = p.x(); *(nlb + idx + 3) = p.x() + n.x();
-        *(nlb + idx + 1) = p.y(); *(nlb + idx + 4) = p.y() + n.y();
-        *(nlb + idx + 2) = p.z(); *(nlb + idx + 5) = p.z() + n.z();
+    // each triangle gets its own 3 vertices
+    assert(start + (triangle_count * 3) <= _vertex_count);
+    for(size_t i=0; i<triangle_count; ++i) {
+        const Triangle& triangle(triangles[i]);
+        assert(triangle.v1 >= 0 && static_cast<size_t>(triangle.v1) < vertex_count);
+        assert(triangle.v2 >= 0 && static_cast<size_t>(triangle.v2) < vertex_count);
+        assert(triangle.v3 >= 0 && static_cast<size_t>(triangle.v3) < vertex_count);
+
+        const size_t idx = start + (i * 3);
+        write_vertex(idx + 0, vertices[triangle.v1]);
+        write_vertex(idx + 1, vertices[triangle.v2]);
+        write_vertex(idx + 2, vertices[triangle.v3]);
+    }
+    _line_buffers_dirty = true;
+}
+
+void Geometry::copy_skinned(const float* const positions, const float* const normals, const float* const tangents, size_t vertex_count, size_t start)
+{
+    std::lock_guard<std::recursive_mutex> guard(_mutex);
 
-        *(tnlb + idx + 0) = p.x(); *(tnlb + idx + 3) = p.x() + t.x();
-        *(tnlb + idx + 1) = p.y(); *(tnlb + idx + 4) = p.y() + t.y();
-        *(tnlb + idx + 2) = p.z(); *(tnlb + idx + 5) = p.z() + t.z();
+    assert(start + vertex_count <= _vertex_count);
+    for(size_t i=0; i<vertex_count; ++i) {
+        const size_t index = start + i;
+        const float *p = positions + (i * 4), *n = normals + (i * 4), *t = tangents + (i * 4);
+
+        switch(_layout)
+        {
+        case VertexLayout::Separate:
+            std::memcpy(_vertex_buffer.get() + (index * 3), p, 3 * sizeof(float));
+            std::memcpy(_normal_buffer.get() + (index * 3), n, 3 * sizeof(float));
+            std::memcpy(_tangent_buffer.get() + (index * 4), t, 4 * sizeof(float));
+            break;
+        case VertexLayout::Interleaved:
+            {
+                PackedVertex& packed(reinterpret_cast<PackedVertex*>(_interleaved_buffer.get())[index]);
+                std::memcpy(packed.position, p, 3 * sizeof(float));
+                std::memcpy(packed.normal, n, 3 * sizeof(float));
+                std::memcpy(packed.tangent, t, 4 * sizeof(float));
+            }
+            break;
+        case VertexLayout::Quantized:
+            {
+                QuantizedVertex& packed(reinterpret_cast<QuantizedVertex*>(_interleaved_buffer.get())[index]);
+                std::memcpy(packed.position, p, 3 * sizeof(float));
+                for(int j=0; j<3; ++j) {
+                    packed.normal[j] = float_to_half(n[j]);
+                }
+                for(int j=0; j<4; ++j) {
+                    packed.tangent[j] = float_to_half(t[j]);
+                }
+            }
+            break;
+        }
     }
+    _line_buffers_dirty = true;
+}
 
-    // fill the vertex buffers
-    float *vb = _vertex_buffer.get(), *nb = _normal_buffer.get(), *tnb = _tangent_buffer.get(), *tb = _texture_buffer.get();
+void Geometry::set_indices(const Triangle* const triangles, size_t triangle_count)
+{
+    std::lock_guard<std::recursive_mutex> guard(_mutex);
+
+    _index_buffer_size = triangle_count * 3;
+    _index_buffer.reset(new(_allocator) uint32_t[_index_buffer_size], std::bind(&MemoryAllocator::release, &_allocator, std::placeholders::_1));
+
+    uint32_t* const indices = _index_buffer.get();
     for(size_t i=0; i<triangle_count; ++i) {
         const Triangle& triangle(triangles[i]);
-        const Vertex &v1(vertices[triangle.v1]), &v2(vertices[triangle.v2]), &v3(vertices[triangle.v3]);
-
-        const size_t idx = (start * 3) + (i * 3 * 3);
-
-        *(vb + idx + 0) = v1.position.x();
-        *(vb + idx + 1) = v1.position.y();
-        *(vb + idx + 2) = v1.position.z();
-        *(vb + idx + 3) = v2.position.x();
-        *(vb + idx + 4) = v2.position.y();
-        *(vb + idx + 5) = v2.position.z();
-        *(vb + idx + 6) = v3.position.x();
-        *(vb + idx + 7) = v3.position.y();
-        *(vb + idx + 8) = v3.position.z();
-
-        const Vector3 &n1(v1.normal), &n2(v2.normal), &n3(v3.normal);
-        *(nb + idx + 0) = n1.x();
-        *(nb + idx + 1) = n1.y();
-        *(nb + idx + 2) = n1.z();
-        *(nb + idx + 3) = n2.x();
-        *(nb + idx + 4) = n2.y();
-        *(nb + idx + 5) = n2.z();
-        *(nb + idx + 6) = n3.x();
-        *(nb + idx + 7) = n3.y();
-        *(nb + idx + 8) = n3.z();
-
-        const size_t tnidx = (start * 4) + (i * 3 * 4);
-
-        // Mathematics for 3D Game Programming and Computer Graphics, section 7.8.3
-        const Vector3 &t1(v1.tangent), &t2(v2.tangent), &t3(v3.tangent);
-        const Vector3 b1(n1 ^ t1), b2(n2 ^ t2), b3(n3 ^ t3);
-        *(tnb + tnidx + 0)  = t1.x();
-        *(tnb + tnidx + 1)  = t1.y();
-        *(tnb + tnidx + 2)  = t1.z();
-        *(tnb + tnidx + 3)  = b1.opposite_direction(v1.bitangent) ? -1.0f : 1.0f;
-        *(tnb + tnidx + 4)  = t2.x();
-        *(tnb + tnidx + 5)  = t2.y();
-        *(tnb + tnidx + 6)  = t2.z();
-        *(tnb + tnidx + 7)  = b2.opposite_direction(v2.bitangent) ? -1.0f : 1.0f;
-        *(tnb + tnidx + 8)  = t3.x();
-        *(tnb + tnidx + 9)  = t3.y();
-        *(tnb + tnidx + 10) = t3.z();
-        *(tnb + tnidx + 11) = b3.opposite_direction(v3.bitangent) ? -1.0f : 1.0f;
-
-        const size_t tidx = (start * 2) + (i * 3 * 2);
-
-        *(tb + tidx + 0) = v1.texture_coords.x();
-        *(tb + tidx + 1) = v1.texture_coords.y();
-        *(tb + tidx + 2) = v2.texture_coords.x();
-        *(tb + tidx + 3) = v2.texture_coords.y();
-        *(tb + tidx + 4) = v3.texture_coords.x();
-        *(tb + tidx + 5) = v3.texture_coords.y();
+        assert(triangle.v1 >= 0 && static_cast<size_t>(triangle.v1) < _vertex_count);
+        assert(triangle.v2 >= 0 && static_cast<size_t>(triangle.v2) < _vertex_count);
+        assert(triangle.v3 >= 0 && static_cast<size_t>(triangle.v3) < _vertex_count);
+
+        indices[(i * 3) + 0] = static_cast<uint32_t>(triangle.v1);
+        indices[(i * 3) + 1] = static_cast<uint32_t>(triangle.v2);
+        indices[(i * 3) + 2] = static_cast<uint32_t>(triangle.v3);
     }
 }
 
 std::string Geometry::str() const
 {
     std::stringstream ss;
-    ss << "Geometry vertex_count=" << _vertex_count << "\nVertices (" << _vertex_buffer_size << "):\n";
-    for(size_t i=0; i<_vertex_buffer_size; i+=3) {
-        ss << "(" << _vertex_buffer.get()[i+0]
-            << ", " << _vertex_buffer.get()[i+1]
-            << ", " << _vertex_buffer.get()[i+2] << "), ";
+    ss << "Geometry vertex_count=" << _vertex_count << "\nVertices (" << (_vertex_count * 3) << "):\n";
+    for(size_t i=0; i<_vertex_count; ++i) {
+        float p[3], n[3], t[3];
+        read_vertex(i, p, n, t);
+        ss << "(" << p[0] << ", " << p[1] << ", " << p[2] << "), ";
     }
     return ss.str();
 }
@@ -349,6 +396,7 @@ std::string Geometry::str() const
 
 #if defined WITH_UNIT_TESTS
 #include "src/test/UnitTest.h"
+#include "MeshOptimizer.h"
 
 class GeometryTest : public CppUnit::TestFixture
 {
@@ -364,6 +412,9 @@ public:
         CPPUNIT_TEST(test_vertex_create_copy);
         CPPUNIT_TEST(test_triangle_create);
         CPPUNIT_TEST(test_triangle_create_copy);
+        CPPUNIT_TEST(test_quantized);
+        CPPUNIT_TEST(test_line_buffers);
+        CPPUNIT_TEST(test_indices);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -440,6 +491,24 @@ public:
 
     void test_compute_tangents()
     {
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::System, 50 * 1024));
+
+        energonsoftware::Vertex vertices[4];
+        build_quad(vertices);
+
+        energonsoftware::Triangle triangles[2];
+        triangles[0].v1 = 0; triangles[0].v2 = 1; triangles[0].v3 = 2;
+        triangles[1].v1 = 0; triangles[1].v2 = 2; triangles[1].v3 = 3;
+
+        energonsoftware::compute_tangents(triangles, 2, vertices, 4, *allocator, true);
+        for(int i=0; i<2; ++i) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0f, triangles[i].normal.z(), 1e-4f);
+        }
+        for(int i=0; i<4; ++i) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0f, vertices[i].normal.z(), 1e-4f);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0f, vertices[i].tangent.x(), 1e-4f);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0f, vertices[i].bitangent.y(), 1e-4f);
+        }
     }
 
     void test_vertex_create()
@@ -454,6 +523,30 @@ public:
 
     void test_vertex_create_copy()
     {
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::System, 50 * 1024));
+
+        energonsoftware::Vertex vertices[4];
+        build_quad(vertices);
+
+        energonsoftware::Geometry g(vertices, 4, *allocator);
+        CPPUNIT_ASSERT(energonsoftware::VertexLayout::Separate == g.layout());
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(4), g.vertex_count());
+        CPPUNIT_ASSERT(nullptr == g.interleaved_buffer());
+        for(size_t i=0; i<4; ++i) {
+            const energonsoftware::Vertex& v(vertices[i]);
+            CPPUNIT_ASSERT_EQUAL(v.position.x(), g.vertex_buffer()[(i * 3) + 0]);
+            CPPUNIT_ASSERT_EQUAL(v.position.y(), g.vertex_buffer()[(i * 3) + 1]);
+            CPPUNIT_ASSERT_EQUAL(v.normal.z(), g.normal_buffer()[(i * 3) + 2]);
+            CPPUNIT_ASSERT_EQUAL(v.tangent.x(), g.tangent_buffer()[(i * 4) + 0]);
+            CPPUNIT_ASSERT_EQUAL(1.0f, g.tangent_buffer()[(i * 4) + 3]);
+            CPPUNIT_ASSERT_EQUAL(v.texture_coords.y(), g.texture_buffer()[(i * 2) + 1]);
+        }
+
+        // the bitangent flipped
+        vertices[2].bitangent = -vertices[2].bitangent;
+        g.copy_vertices(vertices + 2, 1, 2);
+        CPPUNIT_ASSERT_EQUAL(-1.0f, g.tangent_buffer()[(2 * 4) + 3]);
+        CPPUNIT_ASSERT_EQUAL(1.0f, g.tangent_buffer()[(1 * 4) + 3]);
     }
 
     void test_triangle_create()
@@ -469,9 +562,147 @@ public:
 
     void test_triangle_create_copy()
     {
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::System, 50 * 1024));
+
+        energonsoftware::Vertex vertices[4];
+        build_quad(vertices);
+
+        energonsoftware::Triangle triangles[2];
+        triangles[0].v1 = 0; triangles[0].v2 = 1; triangles[0].v3 = 2;
+        triangles[1].v1 = 0; triangles[1].v2 = 2; triangles[1].v3 = 3;
+
+        energonsoftware::Geometry g(triangles, 2, vertices, 4, *allocator, energonsoftware::VertexLayout::Interleaved);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(6), g.vertex_count());
+        CPPUNIT_ASSERT_EQUAL(sizeof(energonsoftware::PackedVertex), g.vertex_stride());
+        CPPUNIT_ASSERT_EQUAL(6 * sizeof(energonsoftware::PackedVertex), g.interleaved_buffer_size());
+        CPPUNIT_ASSERT(nullptr == g.vertex_buffer());
+
+        const energonsoftware::PackedVertex* const packed = reinterpret_cast<const energonsoftware::PackedVertex*>(g.interleaved_buffer());
+        const int corners[6] = { 0, 1, 2, 0, 2, 3 };
+        for(size_t i=0; i<6; ++i) {
+            const energonsoftware::Vertex& v(vertices[corners[i]]);
+            CPPUNIT_ASSERT_EQUAL(v.position.x(), packed[i].position[0]);
+            CPPUNIT_ASSERT_EQUAL(v.position.y(), packed[i].position[1]);
+            CPPUNIT_ASSERT_EQUAL(v.normal.z(), packed[i].normal[2]);
+            CPPUNIT_ASSERT_EQUAL(v.tangent.x(), packed[i].tangent[0]);
+            CPPUNIT_ASSERT_EQUAL(1.0f, packed[i].tangent[3]);
+            CPPUNIT_ASSERT_EQUAL(v.texture_coords.x(), packed[i].texture_coords[0]);
+        }
+    }
+
+    void test_quantized()
+    {
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::System, 50 * 1024));
+
+        energonsoftware::Vertex vertices[4];
+        build_quad(vertices);
+        vertices[1].normal = energonsoftware::Vector3(0.6f, 0.0f, 0.8f);
+        vertices[3].texture_coords = energonsoftware::Vector2(3.25f, -1.5f);
+
+        energonsoftware::Geometry g(vertices, 4, *allocator, energonsoftware::VertexLayout::Quantized);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(32), g.vertex_stride());
+        CPPUNIT_ASSERT_EQUAL(4 * g.vertex_stride(), g.interleaved_buffer_size());
+
+        const energonsoftware::QuantizedVertex* const packed = reinterpret_cast<const energonsoftware::QuantizedVertex*>(g.interleaved_buffer());
+        for(size_t i=0; i<4; ++i) {
+            const energonsoftware::Vertex& v(vertices[i]);
+            CPPUNIT_ASSERT_EQUAL(v.position.z(), packed[i].position[2]);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(v.normal.x(), energonsoftware::half_to_float(packed[i].normal[0]), 0.001f);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(v.normal.z(), energonsoftware::half_to_float(packed[i].normal[2]), 0.001f);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(v.tangent.x(), energonsoftware::half_to_float(packed[i].tangent[0]), 0.001f);
+            CPPUNIT_ASSERT_EQUAL(1.0f, energonsoftware::half_to_float(packed[i].tangent[3]));
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(v.texture_coords.x(), energonsoftware::half_to_float(packed[i].texture_coords[0]), 0.001f);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(v.texture_coords.y(), energonsoftware::half_to_float(packed[i].texture_coords[1]), 0.001f);
+        }
+    }
+
+    void test_line_buffers()
+    {
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::System, 50 * 1024));
+
+        energonsoftware::Vertex vertices[4];
+        build_quad(vertices);
+
+        for(energonsoftware::VertexLayout layout : { energonsoftware::VertexLayout::Separate, energonsoftware::VertexLayout::Interleaved, energonsoftware::VertexLayout::Quantized }) {
+            energonsoftware::Geometry g(vertices, 4, *allocator, layout);
+
+            const float* nlb = g.normal_line_buffer();
+            const float* tlb = g.tangent_line_buffer();
+            for(size_t i=0; i<4; ++i) {
+                const energonsoftware::Vertex& v(vertices[i]);
+                CPPUNIT_ASSERT_EQUAL(v.position.x(), nlb[(i * 6) + 0]);
+                CPPUNIT_ASSERT_EQUAL(v.position.z() + v.normal.z(), nlb[(i * 6) + 5]);
+                CPPUNIT_ASSERT_EQUAL(v.position.y(), tlb[(i * 6) + 1]);
+                CPPUNIT_ASSERT_EQUAL(v.position.x() + v.tangent.x(), tlb[(i * 6) + 3]);
+            }
+
+            // rebuilt after the vertices change
+            energonsoftware::Vertex moved(vertices[0]);
+            moved.position = energonsoftware::Position(10.0f, 0.0f, 0.0f);
+            g.copy_vertices(&moved, 1, 0);
+            CPPUNIT_ASSERT_EQUAL(10.0f, g.normal_line_buffer()[0]);
+            CPPUNIT_ASSERT_EQUAL(11.0f, g.tangent_line_buffer()[3]);
+        }
+    }
+
+    void test_indices()
+    {
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::System, 50 * 1024));
+
+        // the quad as 2 triangles with their own vertices
+        energonsoftware::Vertex quad[4], vertices[6];
+        build_quad(quad);
+        const int corners[6] = { 0, 1, 2, 0, 2, 3 };
+        for(size_t i=0; i<6; ++i) {
+            vertices[i] = quad[corners[i]];
+        }
+
+        energonsoftware::Triangle triangles[2];
+        for(int i=0; i<2; ++i) {
+            triangles[i].v1 = (i * 3) + 0;
+            triangles[i].v2 = (i * 3) + 1;
+            triangles[i].v3 = (i * 3) + 2;
+        }
+
+        const size_t vertex_count = energonsoftware::optimize_mesh(triangles, 2, vertices, 6);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(4), vertex_count);
+
+        energonsoftware::Geometry g(vertices, vertex_count, *allocator);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), g.index_buffer_size());
+
+        g.set_indices(triangles, 2);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(6), g.index_buffer_size());
+
+        // the indexed corners are still the quad's corners
+        std::vector<std::pair<float, float>> expected, actual;
+        for(size_t i=0; i<6; ++i) {
+            const energonsoftware::Vertex& v(quad[corners[i]]);
+            expected.push_back(std::make_pair(v.position.x(), v.position.y()));
+
+            const uint32_t index = g.index_buffer()[i];
+            CPPUNIT_ASSERT(index < vertex_count);
+            actual.push_back(std::make_pair(g.vertex_buffer()[(index * 3) + 0], g.vertex_buffer()[(index * 3) + 1]));
+        }
+        std::sort(expected.begin(), expected.end());
+        std::sort(actual.begin(), actual.end());
+        CPPUNIT_ASSERT(expected == actual);
     }
 
 private:
+    // a flat quad facing z with texture coordinates lined up on x and y
+    static void build_quad(energonsoftware::Vertex* const vertices)
+    {
+        const float corners[4][2] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+        for(int i=0; i<4; ++i) {
+            vertices[i].index = i;
+            vertices[i].position = energonsoftware::Position(corners[i][0], corners[i][1], 0.5f);
+            vertices[i].normal = energonsoftware::Vector3(0.0f, 0.0f, 1.0f);
+            vertices[i].tangent = energonsoftware::Vector3(1.0f, 0.0f, 0.0f);
+            vertices[i].bitangent = energonsoftware::Vector3(0.0f, 1.0f, 0.0f);
+            vertices[i].texture_coords = energonsoftware::Vector2(corners[i][0], corners[i][1]);
+        }
+    }
+
     void check_vertex_defaults(const energonsoftware::Vertex& v)
     {
         CPPUNIT_ASSERT(v.index < 0);
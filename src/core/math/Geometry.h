@@ -54,25 +54,64 @@ struct Edge
     std::string str() const;
 };
 
+// see MeshBatch::compute_tangents(),
+// large meshes should use a MeshBatch directly to weld or spread the work over a ThreadPool
 void compute_tangents(Triangle* const triangles, size_t triange_count, Vertex* const vertices, size_t vertex_count, MemoryAllocator& allocator, bool smooth=false);
 
+// how Geometry lays out its vertex data
+enum class VertexLayout
+{
+    // separate position, normal, tangent and texture coordinate buffers
+    Separate,
+
+    // one buffer of PackedVertex
+    Interleaved,
+
+    // one buffer of QuantizedVertex
+    Quantized,
+};
+
+// the interleaved vertex formats,
+// tangent w is the handedness of the bitangent (normal ^ tangent times w)
+struct PackedVertex
+{
+    float position[3];
+    float normal[3];
+    float tangent[4];
+    float texture_coords[2];
+};
+
+// half floats for everything but the position (see float_to_half()),
+// normal w is unused padding
+struct QuantizedVertex
+{
+    float position[3];
+    uint16_t normal[4];
+    uint16_t tangent[4];
+    uint16_t texture_coords[2];
+};
+
 class Geometry
 {
 public:
-    explicit Geometry(size_t vertex_count, MemoryAllocator& allocator);
-    Geometry(const Vertex* const vertices, size_t vertex_count, MemoryAllocator& allocator);
+    explicit Geometry(size_t vertex_count, MemoryAllocator& allocator, VertexLayout layout=VertexLayout::Separate);
+    Geometry(const Vertex* const vertices, size_t vertex_count, MemoryAllocator& allocator, VertexLayout layout=VertexLayout::Separate);
 
-    Geometry(size_t triangle_count, size_t vertex_count, MemoryAllocator& allocator);
-    Geometry(const Triangle* const triangles, size_t triangle_count, const Vertex* const vertices, size_t vertex_count, MemoryAllocator& allocator);
+    Geometry(size_t triangle_count, size_t vertex_count, MemoryAllocator& allocator, VertexLayout layout=VertexLayout::Separate);
+    Geometry(const Triangle* const triangles, size_t triangle_count, const Vertex* const vertices, size_t vertex_count, MemoryAllocator& allocator, VertexLayout layout=VertexLayout::Separate);
 
     virtual ~Geometry() noexcept;
 
 public:
     std::recursive_mutex& mutex() { return _mutex; }
 
+    VertexLayout layout() const { return _layout; }
+
     size_t vertex_count() const { return _vertex_count; }
 
     // NOTE: must lock before using these!
+
+    // these are only allocated for the Separate layout
     size_t vertex_buffer_size() const { return _vertex_buffer_size; }
     const float* vertex_buffer() const { return _vertex_buffer.get(); }
 
@@ -85,22 +124,51 @@ public:
     size_t texture_buffer_size() const { return _texture_buffer_size; }
     const float* texture_buffer() const { return _texture_buffer.get(); }
 
-    // for debugging
-    const float* normal_line_buffer() const { return _normal_line_buffer.get(); }
-    const float* tangent_line_buffer() const { return _tangent_line_buffer.get(); }
+    // the interleaved layouts, vertex_count() vertices of vertex_stride() bytes each
+    size_t vertex_stride() const;
+    size_t interleaved_buffer_size() const { return _interleaved_buffer_size; }
+    const unsigned char* interleaved_buffer() const { return _interleaved_buffer.get(); }
+
+    // only allocated by set_indices(), 3 indices per triangle
+    size_t index_buffer_size() const { return _index_buffer_size; }
+    const uint32_t* index_buffer() const { return _index_buffer.get(); }
+
+    // for debugging, these are built from the vertices the first time they're asked for
+    // (and again after the vertices change), 2 points (6 floats) per vertex
+    const float* normal_line_buffer();
+    const float* tangent_line_buffer();
 
     void copy_vertices(const Vertex* const vertices, size_t vertex_count, size_t start=0);
     void copy_triangles(const Triangle* const triangles, size_t triangle_count, const Vertex* const vertices, size_t vertex_count, size_t start=0);
 
+    // replaces just the positions, normals and tangents (see Skin),
+    // each is 4 floats per vertex with the tangent w being the bitangent handedness
+    void copy_skinned(const float* const positions, const float* const normals, const float* const tangents, size_t vertex_count, size_t start=0);
+
+    // indexes the triangles into the geometry's own vertices (copied with copy_vertices())
+    // rather than giving each its own like copy_triangles() does,
+    // the triangles are kept in order so run them through optimize_mesh() first
+    void set_indices(const Triangle* const triangles, size_t triangle_count);
+
     std::string str() const;
 
 private:
     void allocate_buffers(size_t vertex_count, MemoryAllocator& allocator);
-    void allocate_buffers(size_t triangle_count, size_t vertex_count, MemoryAllocator& allocator);
+
+    // writes a vertex in the current layout
+    void write_vertex(size_t index, const Vertex& vertex);
+
+    // reads a vertex back out of the current layout
+    void read_vertex(size_t index, float* const position, float* const normal, float* const tangent) const;
+
+    void build_line_buffers();
 
 private:
     std::recursive_mutex _mutex;
 
+    VertexLayout _layout;
+    MemoryAllocator& _allocator;
+
     size_t _vertex_count;
 
     size_t _vertex_buffer_size;
@@ -115,7 +183,14 @@ private:
     size_t _texture_buffer_size;
     std::shared_ptr<float> _texture_buffer;
 
+    size_t _interleaved_buffer_size;
+    std::shared_ptr<unsigned char> _interleaved_buffer;
+
+    size_t _index_buffer_size;
+    std::shared_ptr<uint32_t> _index_buffer;
+
     // debugging stuffs
+    bool _line_buffers_dirty;
     std::shared_ptr<float> _normal_line_buffer;
     std::shared_ptr<float> _tangent_line_buffer;
 
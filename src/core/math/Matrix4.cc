@@ -1,9 +1,284 @@
 #include "src/pch.h"
+#include "src/core/util/cpu_util.h"
 #include "math_util.h"
 #include "Matrix4.h"
 
 namespace energonsoftware {
 
+/*
+The inverse helpers write the inverse of m into inv and return the determinant.
+*/
+
+#if defined USE_SSE
+#define SHUFFLE_MASK(x, y, z, w) ((x) | ((y) << 2) | ((z) << 4) | ((w) << 6))
+#define SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps((a), (b), SHUFFLE_MASK(x, y, z, w))
+#define SWIZZLE(a, x, y, z, w) SHUFFLE(a, a, x, y, z, w)
+
+// 2x2 row major matrices packed into a single register
+// A * B
+static inline __m128 mat2_mul(__m128 A, __m128 B)
+{
+    return _mm_add_ps(_mm_mul_ps(A, SWIZZLE(B, 0, 3, 0, 3)), _mm_mul_ps(SWIZZLE(A, 1, 0, 3, 2), SWIZZLE(B, 2, 1, 2, 1)));
+}
+
+// adjugate(A) * B
+static inline __m128 mat2_adj_mul(__m128 A, __m128 B)
+{
+    return _mm_sub_ps(_mm_mul_ps(SWIZZLE(A, 3, 3, 0, 0), B), _mm_mul_ps(SWIZZLE(A, 1, 1, 2, 2), SWIZZLE(B, 2, 3, 0, 1)));
+}
+
+// A * adjugate(B)
+static inline __m128 mat2_mul_adj(__m128 A, __m128 B)
+{
+    return _mm_sub_ps(_mm_mul_ps(A, SWIZZLE(B, 3, 0, 3, 0)), _mm_mul_ps(SWIZZLE(A, 1, 0, 3, 2), SWIZZLE(B, 2, 1, 2, 1)));
+}
+
+static inline __m128 cross(__m128 A, __m128 B)
+{
+    return _mm_sub_ps(_mm_mul_ps(SWIZZLE(A, 1, 2, 0, 3), SWIZZLE(B, 2, 0, 1, 3)), _mm_mul_ps(SWIZZLE(A, 2, 0, 1, 3), SWIZZLE(B, 1, 2, 0, 3)));
+}
+
+// blockwise inversion, treating the matrix as four 2x2 submatrices
+//      | A B |
+//      | C D |
+// each block of the inverse (before the final adjugate) is then
+//      X = |D|A - B(D#C)   Y = |B|C - D(A#B)#
+//      Z = |C|B - A(D#C)#  W = |A|D - C(A#B)
+// where # is the adjugate, this needs no branches and very few shuffles
+static float invert_general(const float* const m, float* const inv)
+{
+    const __m128 R0 = _mm_load_ps(m + 0);
+    const __m128 R1 = _mm_load_ps(m + 4);
+    const __m128 R2 = _mm_load_ps(m + 8);
+    const __m128 R3 = _mm_load_ps(m + 12);
+
+    const __m128 A = _mm_movelh_ps(R0, R1);
+    const __m128 B = _mm_movehl_ps(R1, R0);
+    const __m128 C = _mm_movelh_ps(R2, R3);
+    const __m128 D = _mm_movehl_ps(R3, R2);
+
+    // (|A|, |B|, |C|, |D|)
+    const __m128 DETS = _mm_sub_ps(
+        _mm_mul_ps(SHUFFLE(R0, R2, 0, 2, 0, 2), SHUFFLE(R1, R3, 1, 3, 1, 3)),
+        _mm_mul_ps(SHUFFLE(R0, R2, 1, 3, 1, 3), SHUFFLE(R1, R3, 0, 2, 0, 2)));
+    const __m128 DETA = SWIZZLE(DETS, 0, 0, 0, 0);
+    const __m128 DETB = SWIZZLE(DETS, 1, 1, 1, 1);
+    const __m128 DETC = SWIZZLE(DETS, 2, 2, 2, 2);
+    const __m128 DETD = SWIZZLE(DETS, 3, 3, 3, 3);
+
+    const __m128 DC = mat2_adj_mul(D, C);
+    const __m128 AB = mat2_adj_mul(A, B);
+
+    __m128 X = _mm_sub_ps(_mm_mul_ps(DETD, A), mat2_mul(B, DC));
+    __m128 W = _mm_sub_ps(_mm_mul_ps(DETA, D), mat2_mul(C, AB));
+    __m128 Y = _mm_sub_ps(_mm_mul_ps(DETB, C), mat2_mul_adj(D, AB));
+    __m128 Z = _mm_sub_ps(_mm_mul_ps(DETC, B), mat2_mul_adj(A, DC));
+
+    // |M| = |A||D| + |B||C| - tr((A#B)(D#C))
+    __m128 TR = _mm_mul_ps(AB, SWIZZLE(DC, 0, 2, 1, 3));
+    TR = _mm_hadd_ps(TR, TR);
+    TR = _mm_hadd_ps(TR, TR);
+    const __m128 DET = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(DETA, DETD), _mm_mul_ps(DETB, DETC)), TR);
+
+    // the adjugate of each block flips the signs of the off diagonals
+    const __m128 RDET = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), DET);
+    X = _mm_mul_ps(X, RDET);
+    Y = _mm_mul_ps(Y, RDET);
+    Z = _mm_mul_ps(Z, RDET);
+    W = _mm_mul_ps(W, RDET);
+
+    // finish the adjugates while putting the blocks back into rows
+    _mm_store_ps(inv + 0, SHUFFLE(X, Y, 3, 1, 3, 1));
+    _mm_store_ps(inv + 4, SHUFFLE(X, Y, 2, 0, 2, 0));
+    _mm_store_ps(inv + 8, SHUFFLE(Z, W, 3, 1, 3, 1));
+    _mm_store_ps(inv + 12, SHUFFLE(Z, W, 2, 0, 2, 0));
+    return _mm_cvtss_f32(DET);
+}
+
+// the inverse of the upper 3x3 has the cross products
+// of its rows (over the determinant) as its columns
+static float invert_affine(const float* const m, float* const inv)
+{
+    const __m128 MASK = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+    const __m128 R0 = _mm_and_ps(_mm_load_ps(m + 0), MASK);
+    const __m128 R1 = _mm_and_ps(_mm_load_ps(m + 4), MASK);
+    const __m128 R2 = _mm_and_ps(_mm_load_ps(m + 8), MASK);
+
+    __m128 C0 = cross(R1, R2);
+    __m128 C1 = cross(R2, R0);
+    __m128 C2 = cross(R0, R1);
+
+    __m128 DET = _mm_mul_ps(R0, C0);
+    DET = _mm_hadd_ps(DET, DET);
+    DET = _mm_hadd_ps(DET, DET);
+
+    const __m128 RDET = _mm_div_ps(_mm_set1_ps(1.0f), DET);
+    C0 = _mm_mul_ps(C0, RDET);
+    C1 = _mm_mul_ps(C1, RDET);
+    C2 = _mm_mul_ps(C2, RDET);
+
+    // -(inverse * translation)
+    __m128 T = _mm_mul_ps(C0, _mm_set1_ps(m[3]));
+    T = _mm_add_ps(T, _mm_mul_ps(C1, _mm_set1_ps(m[7])));
+    T = _mm_add_ps(T, _mm_mul_ps(C2, _mm_set1_ps(m[11])));
+    T = _mm_sub_ps(_mm_setzero_ps(), T);
+
+    _MM_TRANSPOSE4_PS(C0, C1, C2, T);
+    _mm_store_ps(inv + 0, C0);
+    _mm_store_ps(inv + 4, C1);
+    _mm_store_ps(inv + 8, C2);
+    _mm_store_ps(inv + 12, _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
+    return _mm_cvtss_f32(DET);
+}
+
+#undef SWIZZLE
+#undef SHUFFLE
+#undef SHUFFLE_MASK
+#else
+static float invert_general(const float* const m, float* const inv)
+{
+    inv[0] = m[6] * m[11] * m[13] - m[7] * m[10] * m[13] + m[7] * m[9] * m[14]
+        - m[5] * m[11] * m[14] - m[6] * m[9] * m[15] + m[5] * m[10] * m[15];
+    inv[1] = m[3] * m[10] * m[13] - m[2] * m[11] * m[13] - m[3] * m[9] * m[14]
+        + m[1] * m[11] * m[14] + m[2] * m[9] * m[15] - m[1] * m[10] * m[15];
+    inv[2] = m[2] * m[7] * m[13] - m[3] * m[6] * m[13] + m[3] * m[5] * m[14]
+        - m[1] * m[7] * m[14] - m[2] * m[5] * m[15] + m[1] * m[6] * m[15];
+    inv[3] = m[3] * m[6] * m[9] - m[2] * m[7] * m[9] - m[3] * m[5] * m[10]
+        + m[1] * m[7] * m[10] + m[2] * m[5] * m[11] - m[1] * m[6] * m[11];
+    inv[4] = m[7] * m[10] * m[12] - m[6] * m[11] * m[12] - m[7] * m[8] * m[14]
+        + m[4] * m[11] * m[14] + m[6] * m[8] * m[15] - m[4] * m[10] * m[15];
+    inv[5] = m[2] * m[11] * m[12] - m[3] * m[10] * m[12] + m[3] * m[8] * m[14]
+        - m[0] * m[11] * m[14] - m[2] * m[8] * m[15] + m[0] * m[10] * m[15];
+    inv[6] = m[3] * m[6] * m[12] - m[2] * m[7] * m[12] - m[3] * m[4] * m[14]
+        + m[0] * m[7] * m[14] + m[2] * m[4] * m[15] - m[0] * m[6] * m[15];
+    inv[7] = m[2] * m[7] * m[8] - m[3] * m[6] * m[8] + m[3] * m[4] * m[10]
+        - m[0] * m[7] * m[10] - m[2] * m[4] * m[11] + m[0] * m[6] * m[11];
+    inv[8] = m[5] * m[11] * m[12] - m[7] * m[9] * m[12] + m[7] * m[8] * m[13]
+        - m[4] * m[11] * m[13] - m[5] * m[8] * m[15] + m[4] * m[9] * m[15];
+    inv[9] = m[3] * m[9] * m[12] - m[1] * m[11] * m[12] - m[3] * m[8] * m[13]
+        + m[0] * m[11] * m[13] + m[1] * m[8] * m[15] - m[0] * m[9] * m[15];
+    inv[10] = m[1] * m[7] * m[12] - m[3] * m[5] * m[12] + m[3] * m[4] * m[13]
+        - m[0] * m[7] * m[13] - m[1] * m[4] * m[15] + m[0] * m[5] * m[15];
+    inv[11] = m[3] * m[5] * m[8] - m[1] * m[7] * m[8] - m[3] * m[4] * m[9]
+        + m[0] * m[7] * m[9] + m[1] * m[4] * m[11] - m[0] * m[5] * m[11];
+    inv[12] = m[6] * m[9] * m[12] - m[5] * m[10] * m[12] - m[6] * m[8] * m[13]
+        + m[4] * m[10] * m[13] + m[5] * m[8] * m[14] - m[4] * m[9] * m[14];
+    inv[13] = m[1] * m[10] * m[12] - m[2] * m[9] * m[12] + m[2] * m[8] * m[13]
+        - m[0] * m[10] * m[13] - m[1] * m[8] * m[14] + m[0] * m[9] * m[14];
+    inv[14] = m[2] * m[5] * m[12] - m[1] * m[6] * m[12] - m[2] * m[4] * m[13]
+        + m[0] * m[6] * m[13] + m[1] * m[4] * m[14] - m[0] * m[5] * m[14];
+    inv[15] = m[1] * m[6] * m[8] - m[2] * m[5] * m[8] + m[2] * m[4] * m[9]
+        - m[0] * m[6] * m[9] - m[1] * m[4] * m[10] + m[0] * m[5] * m[10];
+
+    const float det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+    const float rdet = 1.0f / det;
+    for(int i=0; i<16; ++i) {
+        inv[i] *= rdet;
+    }
+    return det;
+}
+
+static float invert_affine(const float* const m, float* const inv)
+{
+    inv[0] = m[5] * m[10] - m[6] * m[9];
+    inv[1] = m[2] * m[9] - m[1] * m[10];
+    inv[2] = m[1] * m[6] - m[2] * m[5];
+    inv[4] = m[6] * m[8] - m[4] * m[10];
+    inv[5] = m[0] * m[10] - m[2] * m[8];
+    inv[6] = m[2] * m[4] - m[0] * m[6];
+    inv[8] = m[4] * m[9] - m[5] * m[8];
+    inv[9] = m[1] * m[8] - m[0] * m[9];
+    inv[10] = m[0] * m[5] - m[1] * m[4];
+
+    const float det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8];
+    const float rdet = 1.0f / det;
+    for(int i=0; i<11; ++i) {
+        inv[i] *= rdet;
+    }
+
+    inv[3] = -(inv[0] * m[3] + inv[1] * m[7] + inv[2] * m[11]);
+    inv[7] = -(inv[4] * m[3] + inv[5] * m[7] + inv[6] * m[11]);
+    inv[11] = -(inv[8] * m[3] + inv[9] * m[7] + inv[10] * m[11]);
+    inv[12] = inv[13] = inv[14] = 0.0f;
+    inv[15] = 1.0f;
+    return det;
+}
+#endif
+
+/*
+The transform_points kernels take the arrays as floats with a stride (in floats)
+between points and return the index of the first point they didn't transform.
+*/
+
+#if defined USE_SSE
+static size_t transform_points_sse(size_t i, const float* const m, const float* const in, float* const out, size_t stride, size_t count)
+{
+    // the columns of the matrix, with w zeroed
+    const __m128 C0 = _mm_setr_ps(m[0], m[4], m[8], 0.0f);
+    const __m128 C1 = _mm_setr_ps(m[1], m[5], m[9], 0.0f);
+    const __m128 C2 = _mm_setr_ps(m[2], m[6], m[10], 0.0f);
+    const __m128 C3 = _mm_setr_ps(m[3], m[7], m[11], 0.0f);
+
+    for(; i<count; ++i) {
+        const __m128 P = _mm_load_ps(in + (i * stride));
+        __m128 R = _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(P, P, _MM_SHUFFLE(0, 0, 0, 0)), C0), C3);
+        R = _mm_add_ps(R, _mm_mul_ps(_mm_shuffle_ps(P, P, _MM_SHUFFLE(1, 1, 1, 1)), C1));
+        R = _mm_add_ps(R, _mm_mul_ps(_mm_shuffle_ps(P, P, _MM_SHUFFLE(2, 2, 2, 2)), C2));
+        _mm_store_ps(out + (i * stride), R);
+    }
+    return i;
+}
+
+// two points at a time
+TARGET_AVX2 static size_t transform_points_avx2(size_t i, const float* const m, const float* const in, float* const out, size_t stride, size_t count)
+{
+    const __m256 C0 = _mm256_setr_ps(m[0], m[4], m[8], 0.0f, m[0], m[4], m[8], 0.0f);
+    const __m256 C1 = _mm256_setr_ps(m[1], m[5], m[9], 0.0f, m[1], m[5], m[9], 0.0f);
+    const __m256 C2 = _mm256_setr_ps(m[2], m[6], m[10], 0.0f, m[2], m[6], m[10], 0.0f);
+    const __m256 C3 = _mm256_setr_ps(m[3], m[7], m[11], 0.0f, m[3], m[7], m[11], 0.0f);
+
+    for(; i + 2 <= count; i += 2) {
+        const float* const p = in + (i * stride);
+        const __m256 P = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(p)), _mm_load_ps(p + stride), 1);
+
+        __m256 R = _mm256_fmadd_ps(_mm256_permute_ps(P, 0x00), C0, C3);
+        R = _mm256_fmadd_ps(_mm256_permute_ps(P, 0x55), C1, R);
+        R = _mm256_fmadd_ps(_mm256_permute_ps(P, 0xaa), C2, R);
+
+        float* const o = out + (i * stride);
+        _mm_store_ps(o, _mm256_castps256_ps128(R));
+        _mm_store_ps(o + stride, _mm256_extractf128_ps(R, 1));
+    }
+    return i;
+}
+#endif
+
+void Matrix4::transform_points(const Matrix4& matrix, const Point3* const in, Point3* const out, size_t count)
+{
+    if(0 == count) {
+        return;
+    }
+
+    size_t i = 0;
+#if defined USE_SSE
+    const float* const m = matrix._m;
+    const size_t stride = sizeof(Point3) / sizeof(float);
+    if(simd_level() >= SimdLevel::AVX2) {
+        i = transform_points_avx2(i, m, in[0]._value, out[0]._value, stride, count);
+    }
+    if(simd_level() >= SimdLevel::SSE3) {
+        i = transform_points_sse(i, m, in[0]._value, out[0]._value, stride, count);
+    }
+#endif
+
+    for(; i<count; ++i) {
+        const Point3& p = in[i];
+        out[i] = Point3(matrix._m[0] * p.x() + matrix._m[1] * p.y() + matrix._m[2] * p.z() + matrix._m[3],
+                        matrix._m[4] * p.x() + matrix._m[5] * p.y() + matrix._m[6] * p.z() + matrix._m[7],
+                        matrix._m[8] * p.x() + matrix._m[9] * p.y() + matrix._m[10] * p.z() + matrix._m[11]);
+    }
+}
+
 Matrix4 Matrix4::perspective(float fov, float aspect, float n, float f)
 {
     assert(aspect != 0.0f);
@@ -101,6 +376,50 @@ Matrix4& Matrix4::rotate(float angle, const Vector3& around)
     return (*this) *= matrix;
 }
 
+Matrix4 Matrix4::inverse() const
+{
+    Matrix4 m;
+    if(is_affine()) {
+        invert_affine(_m, m._m);
+    } else {
+        invert_general(_m, m._m);
+    }
+    return m;
+}
+
+bool Matrix4::inverse(Matrix4& inverse, float epsilon) const
+{
+    const bool affine = is_affine();
+
+    // |det| is at most the product of the row lengths (Hadamard's inequality)
+    // and scales the same way, so comparing against that leaves the matrix scale out of it
+    float scale = 1.0f;
+    for(int i=0; i<(affine ? 3 : 4); ++i) {
+        const float* const r = _m + (i * 4);
+        scale *= affine
+            ? std::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2])
+            : std::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + r[3] * r[3]);
+    }
+
+    Matrix4 m;
+    const float det = affine ? invert_affine(_m, m._m) : invert_general(_m, m._m);
+    if(!(std::fabs(det) > epsilon * scale)) {
+        return false;
+    }
+
+    inverse = m;
+    return true;
+}
+
+Matrix4 Matrix4::affine_inverse() const
+{
+    assert(is_affine());
+
+    Matrix4 m;
+    invert_affine(_m, m._m);
+    return m;
+}
+
 std::string Matrix4::str() const
 {
     std::stringstream ss;
@@ -141,6 +460,9 @@ public:
         CPPUNIT_TEST(test_scalar_divide);
         CPPUNIT_TEST(test_equality);
         CPPUNIT_TEST(test_inverse);
+        CPPUNIT_TEST(test_affine_inverse);
+        CPPUNIT_TEST(test_checked_inverse);
+        CPPUNIT_TEST(test_transform_points);
         CPPUNIT_TEST(test_transpose);
     CPPUNIT_TEST_SUITE_END();
 
@@ -518,6 +840,15 @@ public:
 
     void test_multiply()
     {
+        static const float MATRIX1[] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f, 16.0f };
+        static const float MATRIX2[] = { 16.0f, 15.0f, 14.0f, 13.0f, 12.0f, 11.0f, 10.0f, 9.0f, 8.0f, 7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f };
+        static const float PRODUCT[] = { 80.0f, 70.0f, 60.0f, 50.0f, 240.0f, 214.0f, 188.0f, 162.0f, 400.0f, 358.0f, 316.0f, 274.0f, 560.0f, 502.0f, 444.0f, 386.0f };
+        CPPUNIT_ASSERT_EQUAL(energonsoftware::Matrix4(PRODUCT), energonsoftware::Matrix4(MATRIX1) * energonsoftware::Matrix4(MATRIX2));
+        CPPUNIT_ASSERT_EQUAL(energonsoftware::Matrix4(MATRIX1), energonsoftware::Matrix4(MATRIX1) * energonsoftware::Matrix4());
+
+        energonsoftware::Matrix4 m1(MATRIX1);
+        m1 *= energonsoftware::Matrix4(MATRIX2);
+        CPPUNIT_ASSERT_EQUAL(energonsoftware::Matrix4(PRODUCT), m1);
     }
 
     void test_vector_multiply()
@@ -584,6 +915,111 @@ public:
 
     void test_inverse()
     {
+        static const float MATRIX[] = { 1.0f, 2.0f, 3.0f, 9.0f, 4.0f, 5.0f, 4.0f, 8.0f, 3.0f, 2.0f, 1.0f, 7.0f, 6.0f, 7.0f, 8.0f, 9.0f };
+        const energonsoftware::Matrix4 m1(MATRIX);
+        CPPUNIT_ASSERT(!m1.is_affine());
+        assert_identity(m1 * m1.inverse());
+        assert_identity(-m1 * m1);
+
+        // projections aren't affine either
+        const energonsoftware::Matrix4 m2(energonsoftware::Matrix4::perspective(76.5f, 1281.57f / 975.3f, 13.5f, 125.6f));
+        assert_identity(m2 * m2.inverse());
+
+        CPPUNIT_ASSERT(energonsoftware::Matrix4().inverse().is_identity());
+    }
+
+    void test_affine_inverse()
+    {
+        energonsoftware::Matrix4 m1;
+        m1.translate(energonsoftware::Position(123.35f, -345.35f, 312.3f));
+        m1.rotate(0.7f, energonsoftware::Vector3(1.0f, 2.0f, 3.0f));
+        m1.scale(energonsoftware::Vector3(2.0f, 3.0f, 4.0f));
+        CPPUNIT_ASSERT(m1.is_affine());
+        assert_identity(m1 * m1.affine_inverse());
+        assert_identity(m1.inverse() * m1);
+
+        // should match the general inverse
+        energonsoftware::Matrix4 m2(m1);
+        m2[15] = 1.0f + FLT_EPSILON;
+        CPPUNIT_ASSERT(!m2.is_affine());
+        const energonsoftware::Matrix4 a(m1.affine_inverse()), g(m2.inverse());
+        for(int i=0; i<16; ++i) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(g[i], a[i], 0.001f);
+        }
+    }
+
+    void test_checked_inverse()
+    {
+        static const float MATRIX[] = { 1.0f, 2.0f, 3.0f, 9.0f, 4.0f, 5.0f, 4.0f, 8.0f, 3.0f, 2.0f, 1.0f, 7.0f, 6.0f, 7.0f, 8.0f, 9.0f };
+        energonsoftware::Matrix4 inverse;
+        CPPUNIT_ASSERT(energonsoftware::Matrix4(MATRIX).inverse(inverse));
+        assert_identity(energonsoftware::Matrix4(MATRIX) * inverse);
+
+        // singular matrices leave the inverse alone
+        static const float SINGULAR[] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f, 16.0f };
+        inverse.identity();
+        CPPUNIT_ASSERT(!energonsoftware::Matrix4(SINGULAR).inverse(inverse));
+        CPPUNIT_ASSERT(inverse.is_identity());
+
+        energonsoftware::Matrix4 m1;
+        m1.scale(energonsoftware::Vector3(1.0f, 0.0f, 1.0f));
+        CPPUNIT_ASSERT(!m1.inverse(inverse));
+        CPPUNIT_ASSERT(inverse.is_identity());
+
+        // small scales aren't singular
+        m1.identity().uniform_scale(0.001f);
+        CPPUNIT_ASSERT(m1.inverse(inverse));
+        assert_identity(m1 * inverse);
+
+        // nearly parallel rows are, depending on the epsilon
+        static const float SKEWED[] = { 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.001f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+        m1 = energonsoftware::Matrix4(SKEWED);
+        CPPUNIT_ASSERT(m1.inverse(inverse));
+        CPPUNIT_ASSERT(!m1.inverse(inverse, 0.01f));
+    }
+
+    void test_transform_points()
+    {
+        energonsoftware::Matrix4 m1;
+        m1.translate(energonsoftware::Position(1.0f, 2.0f, 3.0f));
+        m1.rotate(1.2f, energonsoftware::Vector3(0.0f, 1.0f, 1.0f));
+        m1.uniform_scale(2.0f);
+
+        // odd so the wider kernels leave some behind
+        static const size_t COUNT = 13;
+        std::vector<energonsoftware::Point3> points, transformed(COUNT);
+        for(size_t i=0; i<COUNT; ++i) {
+            points.push_back(energonsoftware::Point3(i * 1.5f, i * -2.0f, 10.0f - i));
+        }
+
+        energonsoftware::Matrix4::transform_points(m1, points.data(), transformed.data(), COUNT);
+        for(size_t i=0; i<COUNT; ++i) {
+            const energonsoftware::Point3& p(points[i]);
+            for(unsigned int r=0; r<3; ++r) {
+                const float expected = m1(r, 0) * p.x() + m1(r, 1) * p.y() + m1(r, 2) * p.z() + m1(r, 3);
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, transformed[i][r], 0.001f);
+            }
+            CPPUNIT_ASSERT_EQUAL(0.0f, transformed[i].w());
+        }
+
+        // every level should agree
+        std::vector<energonsoftware::Point3> check(COUNT);
+        for(energonsoftware::SimdLevel level : energonsoftware::supported_simd_levels()) {
+            energonsoftware::set_simd_level(level);
+            energonsoftware::Matrix4::transform_points(m1, points.data(), check.data(), COUNT);
+            for(size_t i=0; i<COUNT; ++i) {
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(transformed[i].x(), check[i].x(), 0.001f);
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(transformed[i].y(), check[i].y(), 0.001f);
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(transformed[i].z(), check[i].z(), 0.001f);
+            }
+        }
+        energonsoftware::set_simd_level(energonsoftware::detected_simd_level());
+
+        // in place
+        energonsoftware::Matrix4::transform_points(m1, points.data(), points.data(), COUNT);
+        for(size_t i=0; i<COUNT; ++i) {
+            CPPUNIT_ASSERT_EQUAL(transformed[i], points[i]);
+        }
     }
 
     void test_transpose()
@@ -592,6 +1028,15 @@ public:
         static const float TRANSPOSE[] = { 1.0f, 5.0f, 9.0f, 13.0f, 2.0f, 6.0f, 10.0f, 14.0f, 3.0f, 7.0f, 11.0f, 15.0f, 4.0f, 8.0f, 12.0f, 16.0f };
         CPPUNIT_ASSERT_EQUAL(~(energonsoftware::Matrix4(MATRIX)), energonsoftware::Matrix4(TRANSPOSE));
     }
+
+private:
+    void assert_identity(const energonsoftware::Matrix4& m)
+    {
+        static const energonsoftware::Matrix4 IDENTITY;
+        for(int i=0; i<16; ++i) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(IDENTITY[i], m[i], 0.0001f);
+        }
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(Matrix4Test);
@@ -19,6 +19,11 @@ public:
     static Matrix4 frustum(float left, float right, float bottom, float top, float near=0.1f, float far=1000.0f);
     static Matrix4 infinite_frustum(float left, float right, float bottom, float top, float near=0.1f);
 
+    // transforms count points (w is taken to be 1) by the matrix,
+    // in and out may be the same array, w is 0 in the results
+    // NOTE: there is no perspective divide
+    static void transform_points(const Matrix4& matrix, const Point3* const in, Point3* const out, size_t count);
+
 public:
     Matrix4() { identity(); }
     Matrix4(const Matrix4& matrix) { std::memcpy(_m, matrix._m, 16 * sizeof(float)); }
@@ -81,6 +86,28 @@ public:
             - _m[0] * _m[6] * _m[9] * _m[15] - _m[1] * _m[4] * _m[10] * _m[15] + _m[0] * _m[5] * _m[10] * _m[15];
     }
 
+    // the bottom row is (0, 0, 0, 1), which is true
+    // of any combination of translations, rotations and scales
+    bool is_affine() const
+    {
+        return 0.0f == _m[12] && 0.0f == _m[13] && 0.0f == _m[14] && 1.0f == _m[15];
+    }
+
+    // affine matrices take the (much cheaper) affine_inverse() path
+    // NOTE: this does not verify that determinant() != 0!!!
+    Matrix4 inverse() const;
+
+    // singularity checked inverse, returns false (and leaves inverse alone)
+    // if the magnitude of the determinant isn't greater than epsilon times
+    // the product of the row lengths (just the upper 3x3 for affine matrices),
+    // so the check doesn't depend on the scale of the matrix
+    bool inverse(Matrix4& inverse, float epsilon=FLT_EPSILON) const;
+
+    // inverts the upper 3x3 and the translation separately
+    // NOTE: the matrix must be affine
+    // NOTE: this does not verify that determinant() != 0!!!
+    Matrix4 affine_inverse() const;
+
     // transpose of the inverse of
     // the upper leftmost 3x3 of this matrix
     Matrix3 normal_matrix() const
@@ -273,6 +300,21 @@ public:
     Matrix4 operator*(const Matrix4& rhs) const
     {
         Matrix4 n;
+#if defined USE_SSE
+        // each row of the result is a linear combination of the rows of rhs
+        __m128 B1 = _mm_load_ps(rhs._m + 0);
+        __m128 B2 = _mm_load_ps(rhs._m + 4);
+        __m128 B3 = _mm_load_ps(rhs._m + 8);
+        __m128 B4 = _mm_load_ps(rhs._m + 12);
+
+        for(int r=0; r<16; r += 4) {
+            __m128 R = _mm_mul_ps(_mm_set1_ps(_m[r + 0]), B1);
+            R = _mm_add_ps(R, _mm_mul_ps(_mm_set1_ps(_m[r + 1]), B2));
+            R = _mm_add_ps(R, _mm_mul_ps(_mm_set1_ps(_m[r + 2]), B3));
+            R = _mm_add_ps(R, _mm_mul_ps(_mm_set1_ps(_m[r + 3]), B4));
+            _mm_store_ps(n._m + r, R);
+        }
+#else
         n._m[0]  = _m[0]  * rhs._m[0] + _m[1]  * rhs._m[4] + _m[2]  * rhs._m[8]  + _m[3]  * rhs._m[12];
         n._m[1]  = _m[0]  * rhs._m[1] + _m[1]  * rhs._m[5] + _m[2]  * rhs._m[9]  + _m[3]  * rhs._m[13];
         n._m[2]  = _m[0]  * rhs._m[2] + _m[1]  * rhs._m[6] + _m[2]  * rhs._m[10] + _m[3]  * rhs._m[14];
@@ -289,6 +331,7 @@ public:
         n._m[13] = _m[12] * rhs._m[1] + _m[13] * rhs._m[5] + _m[14] * rhs._m[9]  + _m[15] * rhs._m[13];
         n._m[14] = _m[12] * rhs._m[2] + _m[13] * rhs._m[6] + _m[14] * rhs._m[10] + _m[15] * rhs._m[14];
         n._m[15] = _m[12] * rhs._m[3] + _m[13] * rhs._m[7] + _m[14] * rhs._m[11] + _m[15] * rhs._m[15];
+#endif
         return n;
     }
 
@@ -454,43 +497,7 @@ public:
 
     // inverse
     // NOTE: this does not verify that determinant() != 0!!!
-    Matrix4 operator-() const
-    {
-        Matrix4 m;
-        m._m[0] = _m[6] * _m[11] * _m[13] - _m[7] * _m[10] * _m[13] + _m[7] * _m[9] * _m[14]
-            - _m[5] * _m[11] * _m[14] - _m[6] * _m[9] * _m[15] + _m[5] * _m[10] * _m[15];
-        m._m[1] = _m[3] * _m[10] * _m[13] - _m[2] * _m[11] * _m[13] - _m[3] * _m[9] * _m[14]
-            + _m[1] * _m[11] * _m[14] + _m[2] * _m[9] * _m[15] - _m[1] * _m[10] * _m[15];
-        m._m[2] = _m[2] * _m[7] * _m[13] - _m[3] * _m[6] * _m[13] + _m[3] * _m[5] * _m[14]
-            - _m[1] * _m[7] * _m[14] - _m[2] * _m[5] * _m[15] + _m[1] * _m[6] * _m[15];
-        m._m[3] = _m[3] * _m[6] * _m[9] - _m[2] * _m[7] * _m[9] - _m[3] * _m[5] * _m[10]
-            + _m[1] * _m[7] * _m[10] + _m[2] * _m[5] * _m[11] - _m[1] * _m[6] * _m[11];
-        m._m[4] = _m[7] * _m[10] * _m[12] - _m[6] * _m[11] * _m[12] - _m[7] * _m[8] * _m[14]
-            + _m[4] * _m[11] * _m[14] + _m[6] * _m[8] * _m[15] - _m[4] * _m[10] * _m[15];
-        m._m[5] = _m[2] * _m[11] * _m[12] - _m[3] * _m[10] * _m[12] + _m[3] * _m[8] * _m[14]
-            - _m[0] * _m[11] * _m[14] - _m[2] * _m[8] * _m[15] + _m[0] * _m[10] * _m[15];
-        m._m[6] = _m[3] * _m[6] * _m[12] - _m[2] * _m[7] * _m[12] - _m[3] * _m[4] * _m[14]
-            + _m[0] * _m[7] * _m[14] + _m[2] * _m[4] * _m[15] - _m[0] * _m[6] * _m[15];
-        m._m[7] = _m[2] * _m[7] * _m[8] - _m[3] * _m[6] * _m[8] + _m[3] * _m[4] * _m[10]
-            - _m[0] * _m[7] * _m[10] - _m[2] * _m[4] * _m[11] + _m[0] * _m[6] * _m[11];
-        m._m[8] = _m[5] * _m[11] * _m[12] - _m[7] * _m[9] * _m[12] + _m[7] * _m[8] * _m[13]
-            - _m[4] * _m[11] * _m[13] - _m[5] * _m[8] * _m[15] + _m[4] * _m[9] * _m[15];
-        m._m[9] = _m[3] * _m[9] * _m[12] - _m[1] * _m[11] * _m[12] - _m[3] * _m[8] * _m[13]
-            + _m[0] * _m[11] * _m[13] + _m[1] * _m[8] * _m[15] - _m[0] * _m[9] * _m[15];
-        m._m[10] = _m[1] * _m[7] * _m[12] - _m[3] * _m[5] * _m[12] + _m[3] * _m[4] * _m[13]
-            - _m[0] * _m[7] * _m[13] - _m[1] * _m[4] * _m[15] + _m[0] * _m[5] * _m[15];
-        m._m[11] = _m[3] * _m[5] * _m[8] - _m[1] * _m[7] * _m[8] - _m[3] * _m[4] * _m[9]
-            + _m[0] * _m[7] * _m[9] + _m[1] * _m[4] * _m[11] - _m[0] * _m[5] * _m[11];
-        m._m[12] = _m[6] * _m[9] * _m[12] - _m[5] * _m[10] * _m[12] - _m[6] * _m[8] * _m[13]
-            + _m[4] * _m[10] * _m[13] + _m[5] * _m[8] * _m[14] - _m[4] * _m[9] * _m[14];
-        m._m[13] = _m[1] * _m[10] * _m[12] - _m[2] * _m[9] * _m[12] + _m[2] * _m[8] * _m[13]
-            - _m[0] * _m[10] * _m[13] - _m[1] * _m[8] * _m[14] + _m[0] * _m[9] * _m[14];
-        m._m[14] = _m[2] * _m[5] * _m[12] - _m[1] * _m[6] * _m[12] - _m[2] * _m[4] * _m[13]
-            + _m[0] * _m[6] * _m[13] + _m[1] * _m[4] * _m[14] - _m[0] * _m[5] * _m[14];
-        m._m[15] = _m[1] * _m[6] * _m[8] - _m[2] * _m[5] * _m[8] + _m[2] * _m[4] * _m[9]
-            - _m[0] * _m[6] * _m[9] - _m[1] * _m[4] * _m[10] + _m[0] * _m[5] * _m[10];
-        return (1.0f/determinant()) * m;
-    }
+    Matrix4 operator-() const { return inverse(); }
 
     // transposition
     Matrix4 operator~() const
@@ -0,0 +1,963 @@
+#include "src/pch.h"
+#include "src/core/thread/parallel.h"
+#include "src/core/util/cpu_util.h"
+#include "MeshBatch.h"
+
+namespace energonsoftware {
+
+// fewer triangles than this per worker isn't worth the extra set of sums
+static const size_t MIN_SLOT_TRIANGLES = 4096;
+
+// triangles are worked on in blocks of this many so their sums stay in cache
+// until they're added to the vertices (this must be a multiple of 16)
+static const size_t BLOCK_TRIANGLES = 256;
+
+static const size_t REDUCE_GRAIN = 4096;
+
+static const uint32_t NO_VERTEX = std::numeric_limits<uint32_t>::max();
+
+/*
+Face kernels (see Vector4Batch.cc).
+
+These gather the corners of each triangle through the index array
+(3 indices per triangle) and write the face's outputs into 12 arrays,
+the normalized face normal (0-2), and the normal (3-5), tangent (6-8)
+and bitangent (9-11) to add to each of the face's vertices.
+*/
+
+#if defined USE_SSE
+// SSE3
+
+// the corner of 4 triangles, indices are 3 apart
+static inline __m128 gather_sse(const float* base, const uint32_t* indices)
+{
+    return _mm_setr_ps(base[indices[0]], base[indices[3]], base[indices[6]], base[indices[9]]);
+}
+
+static inline void normalize_sse(__m128& X, __m128& Y, __m128& Z)
+{
+    const __m128 HALF = _mm_set1_ps(0.5f), THREE_HALVES = _mm_set1_ps(1.5f);
+    const __m128 L = _mm_add_ps(_mm_add_ps(_mm_mul_ps(X, X), _mm_mul_ps(Y, Y)), _mm_mul_ps(Z, Z));
+
+    __m128 S = _mm_rsqrt_ps(L);
+    S = _mm_mul_ps(S, _mm_sub_ps(THREE_HALVES, _mm_mul_ps(_mm_mul_ps(HALF, L), _mm_mul_ps(S, S))));
+    S = _mm_and_ps(S, _mm_cmpgt_ps(L, _mm_setzero_ps()));
+
+    X = _mm_mul_ps(X, S);
+    Y = _mm_mul_ps(Y, S);
+    Z = _mm_mul_ps(Z, S);
+}
+
+static size_t face_sse(size_t i, const uint32_t* indices, const float* const* position, const float* const* texture,
+    size_t count, bool smooth, float* const* out)
+{
+    const __m128 ZERO = _mm_setzero_ps(), ONE = _mm_set1_ps(1.0f);
+    for(; i + 4 <= count; i += 4) {
+        const uint32_t* const corners = indices + (i * 3);
+
+        const __m128 P0X = gather_sse(position[0], corners + 0), P0Y = gather_sse(position[1], corners + 0), P0Z = gather_sse(position[2], corners + 0);
+        const __m128 Q1X = _mm_sub_ps(gather_sse(position[0], corners + 1), P0X);
+        const __m128 Q1Y = _mm_sub_ps(gather_sse(position[1], corners + 1), P0Y);
+        const __m128 Q1Z = _mm_sub_ps(gather_sse(position[2], corners + 1), P0Z);
+        const __m128 Q2X = _mm_sub_ps(gather_sse(position[0], corners + 2), P0X);
+        const __m128 Q2Y = _mm_sub_ps(gather_sse(position[1], corners + 2), P0Y);
+        const __m128 Q2Z = _mm_sub_ps(gather_sse(position[2], corners + 2), P0Z);
+
+        const __m128 S0 = gather_sse(texture[0], corners + 0), T0 = gather_sse(texture[1], corners + 0);
+        const __m128 S1 = _mm_sub_ps(gather_sse(texture[0], corners + 1), S0), T1 = _mm_sub_ps(gather_sse(texture[1], corners + 1), T0);
+        const __m128 S2 = _mm_sub_ps(gather_sse(texture[0], corners + 2), S0), T2 = _mm_sub_ps(gather_sse(texture[1], corners + 2), T0);
+
+        // face normal
+        __m128 NX = _mm_sub_ps(_mm_mul_ps(Q1Y, Q2Z), _mm_mul_ps(Q1Z, Q2Y));
+        __m128 NY = _mm_sub_ps(_mm_mul_ps(Q1Z, Q2X), _mm_mul_ps(Q1X, Q2Z));
+        __m128 NZ = _mm_sub_ps(_mm_mul_ps(Q1X, Q2Y), _mm_mul_ps(Q1Y, Q2X));
+
+        __m128 FX = NX, FY = NY, FZ = NZ;
+        normalize_sse(FX, FY, FZ);
+        if(smooth) {
+            NX = FX; NY = FY; NZ = FZ;
+        }
+
+        // face tangent (coefficient times the texture matrix times the position matrix)
+        const __m128 D = _mm_sub_ps(_mm_mul_ps(S1, T2), _mm_mul_ps(S2, T1));
+        const __m128 C = _mm_and_ps(_mm_div_ps(ONE, D), _mm_cmpneq_ps(D, ZERO));
+
+        __m128 TX = _mm_mul_ps(C, _mm_sub_ps(_mm_mul_ps(T2, Q1X), _mm_mul_ps(T1, Q2X)));
+        __m128 TY = _mm_mul_ps(C, _mm_sub_ps(_mm_mul_ps(T2, Q1Y), _mm_mul_ps(T1, Q2Y)));
+        __m128 TZ = _mm_mul_ps(C, _mm_sub_ps(_mm_mul_ps(T2, Q1Z), _mm_mul_ps(T1, Q2Z)));
+        if(smooth) {
+            normalize_sse(TX, TY, TZ);
+        }
+
+        // Gram-Schmidt orthogonalize the tangent
+        const __m128 NT = _mm_add_ps(_mm_add_ps(_mm_mul_ps(NX, TX), _mm_mul_ps(NY, TY)), _mm_mul_ps(NZ, TZ));
+        TX = _mm_sub_ps(TX, _mm_mul_ps(NT, NX));
+        TY = _mm_sub_ps(TY, _mm_mul_ps(NT, NY));
+        TZ = _mm_sub_ps(TZ, _mm_mul_ps(NT, NZ));
+        if(smooth) {
+            normalize_sse(TX, TY, TZ);
+        }
+
+        __m128 BX = _mm_mul_ps(C, _mm_sub_ps(_mm_mul_ps(S1, Q2X), _mm_mul_ps(S2, Q1X)));
+        __m128 BY = _mm_mul_ps(C, _mm_sub_ps(_mm_mul_ps(S1, Q2Y), _mm_mul_ps(S2, Q1Y)));
+        __m128 BZ = _mm_mul_ps(C, _mm_sub_ps(_mm_mul_ps(S1, Q2Z), _mm_mul_ps(S2, Q1Z)));
+        if(smooth) {
+            normalize_sse(BX, BY, BZ);
+        }
+
+        _mm_storeu_ps(out[0] + i, FX);
+        _mm_storeu_ps(out[1] + i, FY);
+        _mm_storeu_ps(out[2] + i, FZ);
+        _mm_storeu_ps(out[3] + i, NX);
+        _mm_storeu_ps(out[4] + i, NY);
+        _mm_storeu_ps(out[5] + i, NZ);
+        _mm_storeu_ps(out[6] + i, TX);
+        _mm_storeu_ps(out[7] + i, TY);
+        _mm_storeu_ps(out[8] + i, TZ);
+        _mm_storeu_ps(out[9] + i, BX);
+        _mm_storeu_ps(out[10] + i, BY);
+        _mm_storeu_ps(out[11] + i, BZ);
+    }
+    return i;
+}
+
+// AVX2
+TARGET_AVX2 static inline void normalize_avx2(__m256& X, __m256& Y, __m256& Z)
+{
+    const __m256 HALF = _mm256_set1_ps(0.5f), THREE_HALVES = _mm256_set1_ps(1.5f);
+    const __m256 L = _mm256_fmadd_ps(Z, Z, _mm256_fmadd_ps(Y, Y, _mm256_mul_ps(X, X)));
+
+    __m256 S = _mm256_rsqrt_ps(L);
+    S = _mm256_mul_ps(S, _mm256_fnmadd_ps(_mm256_mul_ps(HALF, L), _mm256_mul_ps(S, S), THREE_HALVES));
+    S = _mm256_and_ps(S, _mm256_cmp_ps(L, _mm256_setzero_ps(), _CMP_GT_OQ));
+
+    X = _mm256_mul_ps(X, S);
+    Y = _mm256_mul_ps(Y, S);
+    Z = _mm256_mul_ps(Z, S);
+}
+
+TARGET_AVX2 static size_t face_avx2(size_t i, const uint32_t* indices, const float* const* position, const float* const* texture,
+    size_t count, bool smooth, float* const* out)
+{
+    const __m256 ZERO = _mm256_setzero_ps(), ONE = _mm256_set1_ps(1.0f);
+    const __m256i LANES = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    for(; i + 8 <= count; i += 8) {
+        const int* const corners = reinterpret_cast<const int*>(indices + (i * 3));
+        const __m256i I0 = _mm256_i32gather_epi32(corners + 0, LANES, 4);
+        const __m256i I1 = _mm256_i32gather_epi32(corners + 1, LANES, 4);
+        const __m256i I2 = _mm256_i32gather_epi32(corners + 2, LANES, 4);
+
+        const __m256 P0X = _mm256_i32gather_ps(position[0], I0, 4), P0Y = _mm256_i32gather_ps(position[1], I0, 4), P0Z = _mm256_i32gather_ps(position[2], I0, 4);
+        const __m256 Q1X = _mm256_sub_ps(_mm256_i32gather_ps(position[0], I1, 4), P0X);
+        const __m256 Q1Y = _mm256_sub_ps(_mm256_i32gather_ps(position[1], I1, 4), P0Y);
+        const __m256 Q1Z = _mm256_sub_ps(_mm256_i32gather_ps(position[2], I1, 4), P0Z);
+        const __m256 Q2X = _mm256_sub_ps(_mm256_i32gather_ps(position[0], I2, 4), P0X);
+        const __m256 Q2Y = _mm256_sub_ps(_mm256_i32gather_ps(position[1], I2, 4), P0Y);
+        const __m256 Q2Z = _mm256_sub_ps(_mm256_i32gather_ps(position[2], I2, 4), P0Z);
+
+        const __m256 S0 = _mm256_i32gather_ps(texture[0], I0, 4), T0 = _mm256_i32gather_ps(texture[1], I0, 4);
+        const __m256 S1 = _mm256_sub_ps(_mm256_i32gather_ps(texture[0], I1, 4), S0), T1 = _mm256_sub_ps(_mm256_i32gather_ps(texture[1], I1, 4), T0);
+        const __m256 S2 = _mm256_sub_ps(_mm256_i32gather_ps(texture[0], I2, 4), S0), T2 = _mm256_sub_ps(_mm256_i32gather_ps(texture[1], I2, 4), T0);
+
+        __m256 NX = _mm256_fmsub_ps(Q1Y, Q2Z, _mm256_mul_ps(Q1Z, Q2Y));
+        __m256 NY = _mm256_fmsub_ps(Q1Z, Q2X, _mm256_mul_ps(Q1X, Q2Z));
+        __m256 NZ = _mm256_fmsub_ps(Q1X, Q2Y, _mm256_mul_ps(Q1Y, Q2X));
+
+        __m256 FX = NX, FY = NY, FZ = NZ;
+        normalize_avx2(FX, FY, FZ);
+        if(smooth) {
+            NX = FX; NY = FY; NZ = FZ;
+        }
+
+        const __m256 D = _mm256_fmsub_ps(S1, T2, _mm256_mul_ps(S2, T1));
+        const __m256 C = _mm256_and_ps(_mm256_div_ps(ONE, D), _mm256_cmp_ps(D, ZERO, _CMP_NEQ_OQ));
+
+        __m256 TX = _mm256_mul_ps(C, _mm256_fmsub_ps(T2, Q1X, _mm256_mul_ps(T1, Q2X)));
+        __m256 TY = _mm256_mul_ps(C, _mm256_fmsub_ps(T2, Q1Y, _mm256_mul_ps(T1, Q2Y)));
+        __m256 TZ = _mm256_mul_ps(C, _mm256_fmsub_ps(T2, Q1Z, _mm256_mul_ps(T1, Q2Z)));
+        if(smooth) {
+            normalize_avx2(TX, TY, TZ);
+        }
+
+        const __m256 NT = _mm256_fmadd_ps(NZ, TZ, _mm256_fmadd_ps(NY, TY, _mm256_mul_ps(NX, TX)));
+        TX = _mm256_fnmadd_ps(NT, NX, TX);
+        TY = _mm256_fnmadd_ps(NT, NY, TY);
+        TZ = _mm256_fnmadd_ps(NT, NZ, TZ);
+        if(smooth) {
+            normalize_avx2(TX, TY, TZ);
+        }
+
+        __m256 BX = _mm256_mul_ps(C, _mm256_fmsub_ps(S1, Q2X, _mm256_mul_ps(S2, Q1X)));
+        __m256 BY = _mm256_mul_ps(C, _mm256_fmsub_ps(S1, Q2Y, _mm256_mul_ps(S2, Q1Y)));
+        __m256 BZ = _mm256_mul_ps(C, _mm256_fmsub_ps(S1, Q2Z, _mm256_mul_ps(S2, Q1Z)));
+        if(smooth) {
+            normalize_avx2(BX, BY, BZ);
+        }
+
+        _mm256_storeu_ps(out[0] + i, FX);
+        _mm256_storeu_ps(out[1] + i, FY);
+        _mm256_storeu_ps(out[2] + i, FZ);
+        _mm256_storeu_ps(out[3] + i, NX);
+        _mm256_storeu_ps(out[4] + i, NY);
+        _mm256_storeu_ps(out[5] + i, NZ);
+        _mm256_storeu_ps(out[6] + i, TX);
+        _mm256_storeu_ps(out[7] + i, TY);
+        _mm256_storeu_ps(out[8] + i, TZ);
+        _mm256_storeu_ps(out[9] + i, BX);
+        _mm256_storeu_ps(out[10] + i, BY);
+        _mm256_storeu_ps(out[11] + i, BZ);
+    }
+    return i;
+}
+
+// AVX-512
+TARGET_AVX512 static inline void normalize_avx512(__m512& X, __m512& Y, __m512& Z)
+{
+    const __m512 HALF = _mm512_set1_ps(0.5f), THREE_HALVES = _mm512_set1_ps(1.5f);
+    const __m512 L = _mm512_fmadd_ps(Z, Z, _mm512_fmadd_ps(Y, Y, _mm512_mul_ps(X, X)));
+
+    __m512 S = _mm512_rsqrt14_ps(L);
+    S = _mm512_mul_ps(S, _mm512_fnmadd_ps(_mm512_mul_ps(HALF, L), _mm512_mul_ps(S, S), THREE_HALVES));
+
+    const __mmask16 nonzero = _mm512_cmp_ps_mask(L, _mm512_setzero_ps(), _CMP_GT_OQ);
+    X = _mm512_maskz_mul_ps(nonzero, X, S);
+    Y = _mm512_maskz_mul_ps(nonzero, Y, S);
+    Z = _mm512_maskz_mul_ps(nonzero, Z, S);
+}
+
+TARGET_AVX512 static size_t face_avx512(size_t i, const uint32_t* indices, const float* const* position, const float* const* texture,
+    size_t count, bool smooth, float* const* out)
+{
+    const __m512 ZERO = _mm512_setzero_ps(), ONE = _mm512_set1_ps(1.0f);
+    const __m512i LANES = _mm512_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, 33, 36, 39, 42, 45);
+    for(; i + 16 <= count; i += 16) {
+        const int* const corners = reinterpret_cast<const int*>(indices + (i * 3));
+        const __m512i I0 = _mm512_i32gather_epi32(LANES, corners + 0, 4);
+        const __m512i I1 = _mm512_i32gather_epi32(LANES, corners + 1, 4);
+        const __m512i I2 = _mm512_i32gather_epi32(LANES, corners + 2, 4);
+
+        const __m512 P0X = _mm512_i32gather_ps(I0, position[0], 4), P0Y = _mm512_i32gather_ps(I0, position[1], 4), P0Z = _mm512_i32gather_ps(I0, position[2], 4);
+        const __m512 Q1X = _mm512_sub_ps(_mm512_i32gather_ps(I1, position[0], 4), P0X);
+        const __m512 Q1Y = _mm512_sub_ps(_mm512_i32gather_ps(I1, position[1], 4), P0Y);
+        const __m512 Q1Z = _mm512_sub_ps(_mm512_i32gather_ps(I1, position[2], 4), P0Z);
+        const __m512 Q2X = _mm512_sub_ps(_mm512_i32gather_ps(I2, position[0], 4), P0X);
+        const __m512 Q2Y = _mm512_sub_ps(_mm512_i32gather_ps(I2, position[1], 4), P0Y);
+        const __m512 Q2Z = _mm512_sub_ps(_mm512_i32gather_ps(I2, position[2], 4), P0Z);
+
+        const __m512 S0 = _mm512_i32gather_ps(I0, texture[0], 4), T0 = _mm512_i32gather_ps(I0, texture[1], 4);
+        const __m512 S1 = _mm512_sub_ps(_mm512_i32gather_ps(I1, texture[0], 4), S0), T1 = _mm512_sub_ps(_mm512_i32gather_ps(I1, texture[1], 4), T0);
+        const __m512 S2 = _mm512_sub_ps(_mm512_i32gather_ps(I2, texture[0], 4), S0), T2 = _mm512_sub_ps(_mm512_i32gather_ps(I2, texture[1], 4), T0);
+
+        __m512 NX = _mm512_fmsub_ps(Q1Y, Q2Z, _mm512_mul_ps(Q1Z, Q2Y));
+        __m512 NY = _mm512_fmsub_ps(Q1Z, Q2X, _mm512_mul_ps(Q1X, Q2Z));
+        __m512 NZ = _mm512_fmsub_ps(Q1X, Q2Y, _mm512_mul_ps(Q1Y, Q2X));
+
+        __m512 FX = NX, FY = NY, FZ = NZ;
+        normalize_avx512(FX, FY, FZ);
+        if(smooth) {
+            NX = FX; NY = FY; NZ = FZ;
+        }
+
+        // zero determinants are masked off rather than dividing by them
+        const __m512 D = _mm512_fmsub_ps(S1, T2, _mm512_mul_ps(S2, T1));
+        const __m512 C = _mm512_maskz_div_ps(_mm512_cmp_ps_mask(D, ZERO, _CMP_NEQ_OQ), ONE, D);
+
+        __m512 TX = _mm512_mul_ps(C, _mm512_fmsub_ps(T2, Q1X, _mm512_mul_ps(T1, Q2X)));
+        __m512 TY = _mm512_mul_ps(C, _mm512_fmsub_ps(T2, Q1Y, _mm512_mul_ps(T1, Q2Y)));
+        __m512 TZ = _mm512_mul_ps(C, _mm512_fmsub_ps(T2, Q1Z, _mm512_mul_ps(T1, Q2Z)));
+        if(smooth) {
+            normalize_avx512(TX, TY, TZ);
+        }
+
+        const __m512 NT = _mm512_fmadd_ps(NZ, TZ, _mm512_fmadd_ps(NY, TY, _mm512_mul_ps(NX, TX)));
+        TX = _mm512_fnmadd_ps(NT, NX, TX);
+        TY = _mm512_fnmadd_ps(NT, NY, TY);
+        TZ = _mm512_fnmadd_ps(NT, NZ, TZ);
+        if(smooth) {
+            normalize_avx512(TX, TY, TZ);
+        }
+
+        __m512 BX = _mm512_mul_ps(C, _mm512_fmsub_ps(S1, Q2X, _mm512_mul_ps(S2, Q1X)));
+        __m512 BY = _mm512_mul_ps(C, _mm512_fmsub_ps(S1, Q2Y, _mm512_mul_ps(S2, Q1Y)));
+        __m512 BZ = _mm512_mul_ps(C, _mm512_fmsub_ps(S1, Q2Z, _mm512_mul_ps(S2, Q1Z)));
+        if(smooth) {
+            normalize_avx512(BX, BY, BZ);
+        }
+
+        _mm512_storeu_ps(out[0] + i, FX);
+        _mm512_storeu_ps(out[1] + i, FY);
+        _mm512_storeu_ps(out[2] + i, FZ);
+        _mm512_storeu_ps(out[3] + i, NX);
+        _mm512_storeu_ps(out[4] + i, NY);
+        _mm512_storeu_ps(out[5] + i, NZ);
+        _mm512_storeu_ps(out[6] + i, TX);
+        _mm512_storeu_ps(out[7] + i, TY);
+        _mm512_storeu_ps(out[8] + i, TZ);
+        _mm512_storeu_ps(out[9] + i, BX);
+        _mm512_storeu_ps(out[10] + i, BY);
+        _mm512_storeu_ps(out[11] + i, BZ);
+    }
+    return i;
+}
+#endif
+
+// scalar versions of the face kernels
+static inline void normalize(float& x, float& y, float& z)
+{
+    const float l = (x * x) + (y * y) + (z * z);
+    if(l > 0.0f) {
+        const float s = 1.0f / std::sqrt(l);
+        x *= s;
+        y *= s;
+        z *= s;
+    }
+}
+
+static void face(size_t i, const uint32_t* indices, const float* const* position, const float* const* texture,
+    bool smooth, float* const* out)
+{
+    const uint32_t i0 = indices[(i * 3) + 0], i1 = indices[(i * 3) + 1], i2 = indices[(i * 3) + 2];
+
+    const float q1x = position[0][i1] - position[0][i0], q1y = position[1][i1] - position[1][i0], q1z = position[2][i1] - position[2][i0];
+    const float q2x = position[0][i2] - position[0][i0], q2y = position[1][i2] - position[1][i0], q2z = position[2][i2] - position[2][i0];
+
+    const float s1 = texture[0][i1] - texture[0][i0], t1 = texture[1][i1] - texture[1][i0];
+    const float s2 = texture[0][i2] - texture[0][i0], t2 = texture[1][i2] - texture[1][i0];
+
+    float nx = (q1y * q2z) - (q1z * q2y), ny = (q1z * q2x) - (q1x * q2z), nz = (q1x * q2y) - (q1y * q2x);
+
+    float fx = nx, fy = ny, fz = nz;
+    normalize(fx, fy, fz);
+    if(smooth) {
+        nx = fx; ny = fy; nz = fz;
+    }
+
+    const float d = (s1 * t2) - (s2 * t1);
+    const float c = 0.0f != d ? 1.0f / d : 0.0f;
+
+    float tx = c * ((t2 * q1x) - (t1 * q2x)), ty = c * ((t2 * q1y) - (t1 * q2y)), tz = c * ((t2 * q1z) - (t1 * q2z));
+    if(smooth) {
+        normalize(tx, ty, tz);
+    }
+
+    const float nt = (nx * tx) + (ny * ty) + (nz * tz);
+    tx -= nt * nx;
+    ty -= nt * ny;
+    tz -= nt * nz;
+    if(smooth) {
+        normalize(tx, ty, tz);
+    }
+
+    float bx = c * ((s1 * q2x) - (s2 * q1x)), by = c * ((s1 * q2y) - (s2 * q1y)), bz = c * ((s1 * q2z) - (s2 * q1z));
+    if(smooth) {
+        normalize(bx, by, bz);
+    }
+
+    const float values[12] = { fx, fy, fz, nx, ny, nz, tx, ty, tz, bx, by, bz };
+    for(size_t k=0; k<12; ++k) {
+        out[k][i] = values[k];
+    }
+}
+
+// computes the faces in [begin, end) and adds them to the sums (9 arrays, normal, tangent, bitangent)
+// of the vertices in targets (3 per triangle, the same as the indices unless the mesh is welded)
+static void sum_faces(const uint32_t* indices, const uint32_t* targets, const float* const* position, const float* const* texture,
+    size_t begin, size_t end, bool smooth, float* const* face_normals, float* const* sums)
+{
+    ALIGN(64) float block[9][BLOCK_TRIANGLES];
+
+    for(size_t first=begin; first<end; first+=BLOCK_TRIANGLES) {
+        const size_t count = std::min(BLOCK_TRIANGLES, end - first);
+        const uint32_t* const corners = indices + (first * 3);
+
+        float* const out[12] = {
+            face_normals[0] + first, face_normals[1] + first, face_normals[2] + first,
+            block[0], block[1], block[2], block[3], block[4], block[5], block[6], block[7], block[8]
+        };
+
+        size_t i = 0;
+#if defined USE_SSE
+        SIMD_DISPATCH(i, face, corners, position, texture, count, smooth, out);
+#endif
+
+        for(; i<count; ++i) {
+            face(i, corners, position, texture, smooth, out);
+        }
+
+        // the scatter has to be scalar, neighboring triangles share vertices
+        const uint32_t* const vertices = targets + (first * 3);
+        for(size_t j=0; j<count; ++j) {
+            for(size_t c=0; c<3; ++c) {
+                const uint32_t v = vertices[(j * 3) + c];
+                for(size_t k=0; k<9; ++k) {
+                    sums[k][v] += block[k][j];
+                }
+            }
+        }
+    }
+}
+
+// hash grid cells are keyed on 21 bits of each coordinate,
+// cells that alias are told apart by the distance check
+static inline uint64_t cell_key(int64_t x, int64_t y, int64_t z)
+{
+    return ((static_cast<uint64_t>(x) & 0x1fffff) << 42) | ((static_cast<uint64_t>(y) & 0x1fffff) << 21) | (static_cast<uint64_t>(z) & 0x1fffff);
+}
+
+MeshBatch::MeshBatch(MemoryAllocator* const allocator)
+    : _positions(allocator), _texture_coords(allocator), _indices(),
+        _normals(allocator), _tangents(allocator), _bitangents(allocator),
+        _face_normals(allocator)
+{
+}
+
+MeshBatch::~MeshBatch() noexcept
+{
+}
+
+size_t MeshBatch::add_vertex(const Position& position, const Vector2& texture_coords)
+{
+    _positions.push_back(position);
+    _texture_coords.push_back(Vector(texture_coords.x(), texture_coords.y(), 0.0f, 0.0f));
+    return _positions.size() - 1;
+}
+
+void MeshBatch::add_triangle(uint32_t v1, uint32_t v2, uint32_t v3)
+{
+    _indices.push_back(v1);
+    _indices.push_back(v2);
+    _indices.push_back(v3);
+}
+
+void MeshBatch::clear()
+{
+    _positions.clear();
+    _texture_coords.clear();
+    _indices.clear();
+
+    _normals.clear();
+    _tangents.clear();
+    _bitangents.clear();
+    _face_normals.clear();
+}
+
+void MeshBatch::assign(const Triangle* const triangles, size_t triangle_count, const Vertex* const vertices, size_t vertex_count)
+{
+    clear();
+
+    _positions.reserve(vertex_count);
+    _texture_coords.reserve(vertex_count);
+    for(size_t i=0; i<vertex_count; ++i) {
+        add_vertex(vertices[i].position, vertices[i].texture_coords);
+    }
+
+    _indices.reserve(triangle_count * 3);
+    for(size_t i=0; i<triangle_count; ++i) {
+        const Triangle& triangle(triangles[i]);
+        add_triangle(triangle.v1, triangle.v2, triangle.v3);
+    }
+}
+
+void MeshBatch::copy_to(Triangle* const triangles, Vertex* const vertices) const
+{
+    assert(_face_normals.size() == triangle_count());
+    assert(_normals.size() == vertex_count());
+
+    for(size_t i=0; i<triangle_count(); ++i) {
+        triangles[i].normal = Vector3(_face_normals.x()[i], _face_normals.y()[i], _face_normals.z()[i]);
+    }
+
+    for(size_t i=0; i<vertex_count(); ++i) {
+        Vertex& vertex(vertices[i]);
+        vertex.normal = Vector3(_normals.x()[i], _normals.y()[i], _normals.z()[i]);
+        vertex.tangent = Vector3(_tangents.x()[i], _tangents.y()[i], _tangents.z()[i]);
+        vertex.bitangent = Vector3(_bitangents.x()[i], _bitangents.y()[i], _bitangents.z()[i]);
+    }
+}
+
+void MeshBatch::compute_tangents(bool smooth, float weld_distance, ThreadPool* const pool)
+{
+    const size_t vcount = vertex_count(), tcount = triangle_count();
+    assert(_texture_coords.size() == vcount);
+    assert(vcount <= static_cast<size_t>(INT_MAX));     // the gathers use signed indices
+
+    _normals.clear();
+    _normals.resize(vcount);
+    _tangents.clear();
+    _tangents.resize(vcount);
+    _bitangents.clear();
+    _bitangents.resize(vcount);
+    _face_normals.clear();
+    _face_normals.resize(tcount);
+
+    // welded vertices all sum into the first vertex they were welded to
+    std::vector<uint32_t> remap, targets;
+    if(weld_distance > 0.0f) {
+        remap.resize(vcount);
+        weld(weld_distance, remap.data());
+
+        targets.resize(_indices.size());
+        for(size_t i=0; i<_indices.size(); ++i) {
+            targets[i] = remap[_indices[i]];
+        }
+    }
+
+    const uint32_t* const indices = _indices.data();
+    const uint32_t* const corners = targets.empty() ? indices : targets.data();
+    const float* const position[3] = { _positions.x(), _positions.y(), _positions.z() };
+    const float* const texture[2] = { _texture_coords.x(), _texture_coords.y() };
+    float* const face_normals[3] = { _face_normals.x(), _face_normals.y(), _face_normals.z() };
+    float* const results[9] = {
+        _normals.x(), _normals.y(), _normals.z(),
+        _tangents.x(), _tangents.y(), _tangents.z(),
+        _bitangents.x(), _bitangents.y(), _bitangents.z()
+    };
+
+    // each slot sums a fixed range of triangles into its own copy of the vertex sums,
+    // the first slot sums straight into the results
+    size_t slots = 1;
+    if(nullptr != pool) {
+        slots = std::max<size_t>(std::min(pool->size() + 1, tcount / MIN_SLOT_TRIANGLES), 1);
+    }
+    const size_t grain = std::max<size_t>((tcount + slots - 1) / slots, 1);
+    std::vector<float> partials((slots - 1) * 9 * vcount, 0.0f);
+
+    auto sum = [&](size_t begin, size_t end) {
+        const size_t slot = begin / grain;
+        float* sums[9];
+        for(size_t k=0; k<9; ++k) {
+            sums[k] = 0 == slot ? results[k] : partials.data() + ((((slot - 1) * 9) + k) * vcount);
+        }
+        sum_faces(indices, corners, position, texture, begin, end, smooth, face_normals, sums);
+    };
+
+    if(slots > 1) {
+        // deterministic chunks always line up with the slots
+        parallel_for(*pool, 0, tcount, grain, sum, ParallelMode::Deterministic);
+
+        // add the slots up in order so every run gets the same answer
+        parallel_for(*pool, 0, vcount, REDUCE_GRAIN, [&](size_t begin, size_t end) {
+            for(size_t k=0; k<9; ++k) {
+                float* const result = results[k];
+                for(size_t slot=1; slot<slots; ++slot) {
+                    const float* const partial = partials.data() + ((((slot - 1) * 9) + k) * vcount);
+                    for(size_t i=begin; i<end; ++i) {
+                        result[i] += partial[i];
+                    }
+                }
+            }
+        });
+    } else if(tcount > 0) {
+        sum(0, tcount);
+    }
+
+    _normals.normalize();
+    _tangents.normalize();
+    _bitangents.normalize();
+
+    // welded vertices share the results of the vertex they were welded to
+    // (copied after normalizing so that they match exactly)
+    for(size_t i=0; i<remap.size(); ++i) {
+        const uint32_t r = remap[i];
+        if(r != i) {
+            for(size_t k=0; k<9; ++k) {
+                results[k][i] = results[k][r];
+            }
+        }
+    }
+}
+
+size_t MeshBatch::weld(float distance, uint32_t* const remap) const
+{
+    assert(distance > 0.0f);
+
+    const float scale = 1.0f / distance, distance_squared = distance * distance;
+    const float *px = _positions.x(), *py = _positions.y(), *pz = _positions.z();
+
+    // cells are distance wide so anything close enough is in one of the 27 cells around a vertex,
+    // each cell holds the head of a list (linked through next) of the distinct vertices in it
+    std::unordered_map<uint64_t, uint32_t> cells;
+    cells.reserve(vertex_count());
+    std::vector<uint32_t> next(vertex_count(), NO_VERTEX);
+
+    size_t unique = 0;
+    for(size_t i=0; i<vertex_count(); ++i) {
+        const int64_t cx = static_cast<int64_t>(std::floor(px[i] * scale));
+        const int64_t cy = static_cast<int64_t>(std::floor(py[i] * scale));
+        const int64_t cz = static_cast<int64_t>(std::floor(pz[i] * scale));
+
+        uint32_t match = NO_VERTEX;
+        for(int64_t z=cz-1; z<=cz+1; ++z) {
+            for(int64_t y=cy-1; y<=cy+1; ++y) {
+                for(int64_t x=cx-1; x<=cx+1; ++x) {
+                    const auto it = cells.find(cell_key(x, y, z));
+                    if(it == cells.end()) {
+                        continue;
+                    }
+
+                    for(uint32_t j=it->second; NO_VERTEX != j; j=next[j]) {
+                        if(j >= match) {
+                            continue;
+                        }
+
+                        const float dx = px[i] - px[j], dy = py[i] - py[j], dz = pz[i] - pz[j];
+                        if((dx * dx) + (dy * dy) + (dz * dz) <= distance_squared) {
+                            match = j;
+                        }
+                    }
+                }
+            }
+        }
+
+        if(NO_VERTEX != match) {
+            remap[i] = match;
+            continue;
+        }
+
+        remap[i] = static_cast<uint32_t>(i);
+        ++unique;
+
+        const auto cell = cells.insert(std::make_pair(cell_key(cx, cy, cz), static_cast<uint32_t>(i)));
+        if(!cell.second) {
+            next[i] = cell.first->second;
+            cell.first->second = static_cast<uint32_t>(i);
+        }
+    }
+    return unique;
+}
+
+}
+
+#if defined WITH_UNIT_TESTS
+#include "src/test/UnitTest.h"
+#include "src/test/TestThreadPool.h"
+
+class MeshBatchTest : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(MeshBatchTest);
+        CPPUNIT_TEST(test_assign);
+        CPPUNIT_TEST(test_compute_tangents);
+        CPPUNIT_TEST(test_reference);
+        CPPUNIT_TEST(test_degenerate);
+        CPPUNIT_TEST(test_weld);
+        CPPUNIT_TEST(test_weld_tangents);
+        CPPUNIT_TEST(test_parallel);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    MeshBatchTest() : CppUnit::TestFixture() {}
+    virtual ~MeshBatchTest() noexcept {}
+
+public:
+    void tearDown() override
+    {
+        energonsoftware::set_simd_level(energonsoftware::detected_simd_level());
+    }
+
+    void test_assign()
+    {
+        energonsoftware::Vertex vertices[4];
+        for(int i=0; i<4; ++i) {
+            vertices[i].index = i;
+            vertices[i].position = energonsoftware::Position(static_cast<float>(i), 2.0f * i, 3.0f * i);
+            vertices[i].texture_coords = energonsoftware::Vector2(0.5f * i, 0.25f * i);
+        }
+
+        energonsoftware::Triangle triangles[2];
+        triangles[0].v1 = 0; triangles[0].v2 = 1; triangles[0].v3 = 2;
+        triangles[1].v1 = 0; triangles[1].v2 = 2; triangles[1].v3 = 3;
+
+        energonsoftware::MeshBatch mesh;
+        mesh.assign(triangles, 2, vertices, 4);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(4), mesh.vertex_count());
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), mesh.triangle_count());
+        for(size_t i=0; i<4; ++i) {
+            CPPUNIT_ASSERT_EQUAL(vertices[i].position, mesh.positions().get(i).xyz());
+            CPPUNIT_ASSERT_EQUAL(vertices[i].texture_coords.x(), mesh.texture_coords().x()[i]);
+            CPPUNIT_ASSERT_EQUAL(vertices[i].texture_coords.y(), mesh.texture_coords().y()[i]);
+        }
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(2), mesh.indices()[4]);
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(3), mesh.indices()[5]);
+
+        mesh.clear();
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), mesh.vertex_count());
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), mesh.triangle_count());
+    }
+
+    void test_compute_tangents()
+    {
+        // a flat quad with texture coordinates lined up on x and y
+        energonsoftware::MeshBatch mesh;
+        mesh.add_vertex(energonsoftware::Position(0.0f, 0.0f, 0.0f), energonsoftware::Vector2(0.0f, 0.0f));
+        mesh.add_vertex(energonsoftware::Position(2.0f, 0.0f, 0.0f), energonsoftware::Vector2(1.0f, 0.0f));
+        mesh.add_vertex(energonsoftware::Position(2.0f, 2.0f, 0.0f), energonsoftware::Vector2(1.0f, 1.0f));
+        mesh.add_vertex(energonsoftware::Position(0.0f, 2.0f, 0.0f), energonsoftware::Vector2(0.0f, 1.0f));
+        mesh.add_triangle(0, 1, 2);
+        mesh.add_triangle(0, 2, 3);
+
+        for(bool smooth : { false, true }) {
+            mesh.compute_tangents(smooth);
+            for(size_t i=0; i<mesh.triangle_count(); ++i) {
+                assert_vector(energonsoftware::Vector3(0.0f, 0.0f, 1.0f), mesh.face_normals().get(i));
+            }
+            for(size_t i=0; i<mesh.vertex_count(); ++i) {
+                assert_vector(energonsoftware::Vector3(0.0f, 0.0f, 1.0f), mesh.normals().get(i));
+                assert_vector(energonsoftware::Vector3(1.0f, 0.0f, 0.0f), mesh.tangents().get(i));
+                assert_vector(energonsoftware::Vector3(0.0f, 1.0f, 0.0f), mesh.bitangents().get(i));
+            }
+        }
+
+        energonsoftware::Triangle triangles[2];
+        energonsoftware::Vertex vertices[4];
+        mesh.copy_to(triangles, vertices);
+        assert_vector(energonsoftware::Vector3(0.0f, 0.0f, 1.0f), triangles[1].normal);
+        assert_vector(energonsoftware::Vector3(1.0f, 0.0f, 0.0f), vertices[2].tangent);
+    }
+
+    void test_reference()
+    {
+        energonsoftware::MeshBatch mesh;
+        build_grid(mesh, 13, 11, false);
+
+        for(bool smooth : { false, true }) {
+            std::vector<energonsoftware::Vector3> normals, tangents, bitangents, face_normals;
+            reference(mesh, smooth, normals, tangents, bitangents, face_normals);
+
+            // every kernel gets the tail of the blocks
+            for(energonsoftware::SimdLevel level : energonsoftware::supported_simd_levels()) {
+                energonsoftware::set_simd_level(level);
+                mesh.compute_tangents(smooth);
+                for(size_t i=0; i<mesh.triangle_count(); ++i) {
+                    assert_vector(face_normals[i], mesh.face_normals().get(i));
+                }
+                for(size_t i=0; i<mesh.vertex_count(); ++i) {
+                    assert_vector(normals[i], mesh.normals().get(i));
+                    assert_vector(tangents[i], mesh.tangents().get(i));
+                    assert_vector(bitangents[i], mesh.bitangents().get(i));
+                }
+            }
+        }
+    }
+
+    void test_degenerate()
+    {
+        energonsoftware::MeshBatch mesh;
+        mesh.add_vertex(energonsoftware::Position(0.0f, 0.0f, 0.0f), energonsoftware::Vector2(0.0f, 0.0f));
+        mesh.add_vertex(energonsoftware::Position(1.0f, 0.0f, 0.0f), energonsoftware::Vector2(0.0f, 0.0f));
+        mesh.add_vertex(energonsoftware::Position(0.0f, 1.0f, 0.0f), energonsoftware::Vector2(0.0f, 0.0f));
+        mesh.add_vertex(energonsoftware::Position(2.0f, 0.0f, 0.0f), energonsoftware::Vector2(1.0f, 1.0f));
+
+        // no area in texture space, then no area at all
+        mesh.add_triangle(0, 1, 2);
+        mesh.add_triangle(0, 1, 3);
+
+        for(energonsoftware::SimdLevel level : energonsoftware::supported_simd_levels()) {
+            energonsoftware::set_simd_level(level);
+
+            // enough triangles for the kernels to see them
+            energonsoftware::MeshBatch copy;
+            for(size_t i=0; i<mesh.vertex_count(); ++i) {
+                const energonsoftware::Vector uv(mesh.texture_coords().get(i));
+                copy.add_vertex(mesh.positions().get(i).xyz(), energonsoftware::Vector2(uv.x(), uv.y()));
+            }
+            for(size_t i=0; i<32; ++i) {
+                copy.add_triangle(mesh.indices()[((i % 2) * 3) + 0], mesh.indices()[((i % 2) * 3) + 1], mesh.indices()[((i % 2) * 3) + 2]);
+            }
+            copy.compute_tangents(true);
+
+            assert_vector(energonsoftware::Vector3(0.0f, 0.0f, 1.0f), copy.face_normals().get(0));
+            CPPUNIT_ASSERT(copy.face_normals().get(1).is_zero());
+
+            assert_vector(energonsoftware::Vector3(0.0f, 0.0f, 1.0f), copy.normals().get(0));
+            CPPUNIT_ASSERT(copy.normals().get(3).is_zero());
+            for(size_t i=0; i<copy.vertex_count(); ++i) {
+                CPPUNIT_ASSERT(copy.tangents().get(i).is_zero());
+                CPPUNIT_ASSERT(copy.bitangents().get(i).is_zero());
+            }
+        }
+    }
+
+    void test_weld()
+    {
+        energonsoftware::MeshBatch mesh;
+        build_grid(mesh, 8, 6, true);
+
+        // the seam column is doubled up
+        const size_t expected = 9 * 7;
+        CPPUNIT_ASSERT_EQUAL(expected + 7, mesh.vertex_count());
+
+        std::vector<uint32_t> remap(mesh.vertex_count());
+        CPPUNIT_ASSERT_EQUAL(expected, mesh.weld(0.001f, remap.data()));
+        for(size_t i=0; i<mesh.vertex_count(); ++i) {
+            CPPUNIT_ASSERT(remap[i] <= i);
+            CPPUNIT_ASSERT(mesh.positions().get(i).distance_squared(mesh.positions().get(remap[i])) <= 0.001f * 0.001f);
+            if(i < expected) {
+                CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(i), remap[i]);
+            }
+        }
+
+        // a big enough distance welds everything together
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), mesh.weld(1000.0f, remap.data()));
+
+        // and a small one nothing
+        CPPUNIT_ASSERT_EQUAL(mesh.vertex_count(), mesh.weld(1e-9f, remap.data()) + 7);
+    }
+
+    void test_weld_tangents()
+    {
+        energonsoftware::MeshBatch mesh;
+        build_grid(mesh, 8, 6, true);
+        const size_t seam = 9 * 7;
+
+        // without welding the seam's copies only see the faces on one side
+        mesh.compute_tangents(true);
+        bool split = false;
+        for(size_t i=seam; i<mesh.vertex_count(); ++i) {
+            const size_t original = (i - seam) * 9;
+            split = split || mesh.normals().get(i).distance_squared(mesh.normals().get(original)) > 1e-6f;
+        }
+        CPPUNIT_ASSERT(split);
+
+        mesh.compute_tangents(true, 0.001f);
+        for(size_t i=seam; i<mesh.vertex_count(); ++i) {
+            const size_t original = (i - seam) * 9;
+            CPPUNIT_ASSERT_EQUAL(mesh.normals().get(original), mesh.normals().get(i));
+            CPPUNIT_ASSERT_EQUAL(mesh.tangents().get(original), mesh.tangents().get(i));
+            CPPUNIT_ASSERT_EQUAL(mesh.bitangents().get(original), mesh.bitangents().get(i));
+        }
+    }
+
+    void test_parallel()
+    {
+        energonsoftware::ThreadPool pool(4);
+        pool.start(TestThreadFactory());
+
+        // enough triangles for every slot
+        energonsoftware::MeshBatch mesh;
+        build_grid(mesh, 150, 100, true);
+
+        mesh.compute_tangents(false, 0.001f);
+        std::vector<energonsoftware::Vector> normals(mesh.vertex_count()), tangents(mesh.vertex_count());
+        mesh.normals().copy_to(normals.data());
+        mesh.tangents().copy_to(tangents.data());
+
+        mesh.compute_tangents(false, 0.001f, &pool);
+        std::vector<energonsoftware::Vector> first(mesh.vertex_count());
+        mesh.tangents().copy_to(first.data());
+        for(size_t i=0; i<mesh.vertex_count(); ++i) {
+            assert_vector(normals[i], mesh.normals().get(i));
+            assert_vector(tangents[i], mesh.tangents().get(i));
+        }
+
+        // the slots are always added up the same way
+        mesh.compute_tangents(false, 0.001f, &pool);
+        for(size_t i=0; i<mesh.vertex_count(); ++i) {
+            CPPUNIT_ASSERT_EQUAL(first[i], mesh.tangents().get(i));
+        }
+
+        pool.stop();
+    }
+
+private:
+    // a bumpy (width x height) quad grid, with seam the first column is duplicated
+    // (after all the other vertices) with texture coordinates past the last column
+    static void build_grid(energonsoftware::MeshBatch& mesh, size_t width, size_t height, bool seam)
+    {
+        mesh.clear();
+        for(size_t y=0; y<=height; ++y) {
+            for(size_t x=0; x<=width; ++x) {
+                const float fx = static_cast<float>(x), fy = static_cast<float>(y);
+                mesh.add_vertex(energonsoftware::Position(fx, fy, 0.3f * std::sin(fx * 0.7f) * std::cos(fy * 0.4f)),
+                    energonsoftware::Vector2(fx * 0.1f + 0.01f * fy, fy * 0.1f));
+            }
+        }
+
+        const size_t stride = width + 1;
+        const size_t first = mesh.vertex_count();
+        if(seam) {
+            for(size_t y=0; y<=height; ++y) {
+                const energonsoftware::Vector uv(mesh.texture_coords().get(y * stride));
+                mesh.add_vertex(mesh.positions().get(y * stride).xyz(), energonsoftware::Vector2(uv.x() + 5.0f, uv.y()));
+            }
+        }
+
+        for(size_t y=0; y<height; ++y) {
+            for(size_t x=0; x<width; ++x) {
+                // the seam copies take over the first column of quads
+                const uint32_t v0 = static_cast<uint32_t>(seam && 0 == x ? first + y : (y * stride) + x);
+                const uint32_t v1 = static_cast<uint32_t>((y * stride) + x + 1);
+                const uint32_t v2 = static_cast<uint32_t>(((y + 1) * stride) + x + 1);
+                const uint32_t v3 = static_cast<uint32_t>(seam && 0 == x ? first + y + 1 : ((y + 1) * stride) + x);
+                mesh.add_triangle(v0, v1, v2);
+                mesh.add_triangle(v0, v2, v3);
+            }
+        }
+    }
+
+    // straightforward version over Vectors
+    static void reference(const energonsoftware::MeshBatch& mesh, bool smooth,
+        std::vector<energonsoftware::Vector3>& normals, std::vector<energonsoftware::Vector3>& tangents,
+        std::vector<energonsoftware::Vector3>& bitangents, std::vector<energonsoftware::Vector3>& face_normals)
+    {
+        normals.assign(mesh.vertex_count(), energonsoftware::Vector3());
+        tangents.assign(mesh.vertex_count(), energonsoftware::Vector3());
+        bitangents.assign(mesh.vertex_count(), energonsoftware::Vector3());
+        face_normals.assign(mesh.triangle_count(), energonsoftware::Vector3());
+
+        for(size_t i=0; i<mesh.triangle_count(); ++i) {
+            const uint32_t* const v = mesh.indices().data() + (i * 3);
+            const energonsoftware::Point3 p0(mesh.positions().get(v[0]).xyz()), p1(mesh.positions().get(v[1]).xyz()), p2(mesh.positions().get(v[2]).xyz());
+            const energonsoftware::Vector uv0(mesh.texture_coords().get(v[0])), uv1(mesh.texture_coords().get(v[1])), uv2(mesh.texture_coords().get(v[2]));
+
+            const energonsoftware::Vector3 q1(p1 - p0), q2(p2 - p0);
+            energonsoftware::Vector3 normal(q1 ^ q2);
+            face_normals[i] = normal / normal.length();
+            if(smooth) {
+                normal = face_normals[i];
+            }
+
+            const float s1 = uv1.x() - uv0.x(), t1 = uv1.y() - uv0.y();
+            const float s2 = uv2.x() - uv0.x(), t2 = uv2.y() - uv0.y();
+            const float coef = 1.0f / (s1 * t2 - s2 * t1);
+
+            energonsoftware::Vector3 tangent(coef * ((t2 * q1) - (t1 * q2)));
+            if(smooth) {
+                tangent /= tangent.length();
+            }
+            tangent -= (normal * tangent) * normal;
+            if(smooth) {
+                tangent /= tangent.length();
+            }
+
+            energonsoftware::Vector3 bitangent(coef * ((s1 * q2) - (s2 * q1)));
+            if(smooth) {
+                bitangent /= bitangent.length();
+            }
+
+            for(size_t c=0; c<3; ++c) {
+                normals[v[c]] += normal;
+                tangents[v[c]] += tangent;
+                bitangents[v[c]] += bitangent;
+            }
+        }
+
+        for(size_t i=0; i<mesh.vertex_count(); ++i) {
+            normals[i] /= normals[i].length();
+            tangents[i] /= tangents[i].length();
+            bitangents[i] /= bitangents[i].length();
+        }
+    }
+
+    static void assert_vector(const energonsoftware::Vector& expected, const energonsoftware::Vector& actual)
+    {
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.x(), actual.x(), 1e-4f);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.y(), actual.y(), 1e-4f);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.z(), actual.z(), 1e-4f);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.w(), actual.w(), 1e-4f);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(MeshBatchTest);
+
+#endif
@@ -0,0 +1,93 @@
+#if !defined __MESHBATCH_H__
+#define __MESHBATCH_H__
+
+#include "Geometry.h"
+#include "Vector4Batch.h"
+
+namespace energonsoftware {
+
+class ThreadPool;
+
+/*
+Structure-of-arrays mesh for offline processing (baking tangent space and the like).
+
+Positions, texture coordinates and the generated normals, tangents and bitangents
+are each kept in a Vector4Batch (texture coordinates use x and y, the generated
+vectors leave w at zero) so the per-triangle work can run several triangles
+per instruction, gathering the corners through the index array.
+Triangles are 3 indices each, in the same winding as Triangle.
+*/
+class MeshBatch
+{
+public:
+    explicit MeshBatch(MemoryAllocator* const allocator=nullptr);
+    virtual ~MeshBatch() noexcept;
+
+public:
+    size_t vertex_count() const { return _positions.size(); }
+    size_t triangle_count() const { return _indices.size() / 3; }
+
+    PointCloud& positions() { return _positions; }
+    const PointCloud& positions() const { return _positions; }
+
+    Vector4Batch& texture_coords() { return _texture_coords; }
+    const Vector4Batch& texture_coords() const { return _texture_coords; }
+
+    const std::vector<uint32_t>& indices() const { return _indices; }
+
+    // only valid after compute_tangents()
+    const Vector4Batch& normals() const { return _normals; }
+    const Vector4Batch& tangents() const { return _tangents; }
+    const Vector4Batch& bitangents() const { return _bitangents; }
+    const Vector4Batch& face_normals() const { return _face_normals; }
+
+    // returns the index of the new vertex
+    size_t add_vertex(const Position& position, const Vector2& texture_coords);
+    void add_triangle(uint32_t v1, uint32_t v2, uint32_t v3);
+
+    void clear();
+
+    // copies the positions, texture coordinates and triangles out of the array of structures
+    void assign(const Triangle* const triangles, size_t triangle_count, const Vertex* const vertices, size_t vertex_count);
+
+    // copies the computed normals, tangents and bitangents back out,
+    // the arrays must be the ones (or the same size as the ones) that were assigned
+    void copy_to(Triangle* const triangles, Vertex* const vertices) const;
+
+public:
+    // computes the vertex normals, tangents and bitangents (the normalized sum of each face's)
+    // and the face normals, smooth normalizes each face's vectors before they're summed
+    // Mathematics for 3D Game Programming and Computer Graphics, section 7.8.3
+    //
+    // vertices within weld_distance of each other (see weld()) share their sums
+    // so that seams split for texturing shade smoothly, 0 turns welding off
+    // NOTE: tangents and bitangents are welded too, so don't weld across mirrored texture seams
+    //
+    // with a pool the triangles are split across the workers, each summing into
+    // its own copy of the vertex arrays (that's 9 floats per vertex per worker)
+    // which are then added up in a fixed order, so the results don't depend on scheduling
+    //
+    // triangles with no area or with no area in texture space only add what they can
+    // (nothing, or just their normal)
+    void compute_tangents(bool smooth=false, float weld_distance=0.0f, ThreadPool* const pool=nullptr);
+
+    // maps every vertex to the first vertex within distance of it (itself if there isn't one),
+    // remap must hold at least vertex_count() indices, returns the number of distinct vertices
+    // this buckets the vertices in a hash grid so it only compares neighboring vertices
+    size_t weld(float distance, uint32_t* const remap) const;
+
+private:
+    PointCloud _positions;
+    Vector4Batch _texture_coords;
+    std::vector<uint32_t> _indices;
+
+    Vector4Batch _normals, _tangents, _bitangents;
+    Vector4Batch _face_normals;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(MeshBatch);
+};
+
+}
+
+#endif
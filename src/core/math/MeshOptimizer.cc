@@ -0,0 +1,633 @@
+#include "src/pch.h"
+#include "MeshOptimizer.h"
+
+namespace energonsoftware {
+
+// the cache size that the vertex cache optimization scores against,
+// the results are good for anything from about 16 up
+static const size_t SCORE_CACHE_SIZE = 32;
+
+// Forsyth's tuning values
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+static const uint32_t NO_TRIANGLE = std::numeric_limits<uint32_t>::max();
+
+// the bits of every attribute that has to match for vertices to be merged
+static const size_t VERTEX_KEY_SIZE = 16;
+
+static void vertex_key(const Vertex& vertex, uint32_t key[VERTEX_KEY_SIZE])
+{
+    const float values[14] = {
+        vertex.position.x(), vertex.position.y(), vertex.position.z(),
+        vertex.normal.x(), vertex.normal.y(), vertex.normal.z(),
+        vertex.tangent.x(), vertex.tangent.y(), vertex.tangent.z(),
+        vertex.bitangent.x(), vertex.bitangent.y(), vertex.bitangent.z(),
+        vertex.texture_coords.x(), vertex.texture_coords.y()
+    };
+    std::memcpy(key, values, sizeof(values));
+    key[14] = static_cast<uint32_t>(vertex.weight_start);
+    key[15] = static_cast<uint32_t>(vertex.weight_count);
+}
+
+// FNV-1a
+static uint64_t hash_key(const uint32_t key[VERTEX_KEY_SIZE])
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for(size_t i=0; i<VERTEX_KEY_SIZE; ++i) {
+        hash ^= key[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static float vertex_score(int cache_position, uint32_t live_triangles)
+{
+    // nothing left to draw with it
+    if(0 == live_triangles) {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if(cache_position >= 0) {
+        if(cache_position < 3) {
+            // the last triangle's vertices get a fixed score
+            // so that it's not just drawn again with a different winding
+            score = LAST_TRIANGLE_SCORE;
+        } else {
+            const float scale = 1.0f / (SCORE_CACHE_SIZE - 3);
+            score = std::pow(1.0f - ((cache_position - 3) * scale), CACHE_DECAY_POWER);
+        }
+    }
+
+    // boost vertices with only a few triangles left so that they get finished off
+    return score + (VALENCE_BOOST_SCALE * std::pow(static_cast<float>(live_triangles), -VALENCE_BOOST_POWER));
+}
+
+// the order to draw the triangles in (order[i] is the i'th triangle to draw)
+static void vertex_cache_order(uint32_t* const order, const uint32_t* const indices, size_t index_count, size_t vertex_count)
+{
+    const size_t triangle_count = index_count / 3;
+
+    // the triangles that use each vertex,
+    // the live ones are kept at the start of each vertex's list
+    std::vector<uint32_t> live(vertex_count, 0), offsets(vertex_count + 1, 0);
+    for(size_t i=0; i<index_count; ++i) {
+        assert(indices[i] < vertex_count);
+        ++live[indices[i]];
+    }
+    for(size_t i=0; i<vertex_count; ++i) {
+        offsets[i + 1] = offsets[i] + live[i];
+    }
+
+    std::vector<uint32_t> adjacency(index_count), cursor(offsets.begin(), offsets.end() - 1);
+    for(size_t i=0; i<index_count; ++i) {
+        adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<int> cache_position(vertex_count, -1);
+    std::vector<float> vertex_scores(vertex_count), triangle_scores(triangle_count);
+    for(size_t i=0; i<vertex_count; ++i) {
+        vertex_scores[i] = vertex_score(-1, live[i]);
+    }
+
+    uint32_t best = NO_TRIANGLE;
+    float best_score = -1.0f;
+    for(size_t i=0; i<triangle_count; ++i) {
+        const uint32_t* const triangle = indices + (i * 3);
+        triangle_scores[i] = vertex_scores[triangle[0]] + vertex_scores[triangle[1]] + vertex_scores[triangle[2]];
+        if(triangle_scores[i] > best_score) {
+            best_score = triangle_scores[i];
+            best = static_cast<uint32_t>(i);
+        }
+    }
+
+    std::vector<unsigned char> emitted(triangle_count, 0);
+    size_t next_unemitted = 0;
+
+    // one extra triangle's worth of room for the vertices that get pushed out
+    uint32_t cache[SCORE_CACHE_SIZE + 3], new_cache[SCORE_CACHE_SIZE + 3];
+    size_t cache_count = 0;
+
+    for(size_t i=0; i<triangle_count; ++i) {
+        if(NO_TRIANGLE == best) {
+            // nothing in the cache has anything left to draw so start somewhere new
+            while(emitted[next_unemitted]) {
+                ++next_unemitted;
+            }
+            best = static_cast<uint32_t>(next_unemitted);
+        }
+
+        order[i] = best;
+        emitted[best] = 1;
+
+        const uint32_t* const triangle = indices + (best * 3);
+
+        // take the triangle off of its vertices' lists
+        for(size_t j=0; j<3; ++j) {
+            const uint32_t v = triangle[j];
+            uint32_t* const list = adjacency.data() + offsets[v];
+            for(uint32_t k=0; k<live[v]; ++k) {
+                if(list[k] == best) {
+                    std::swap(list[k], list[live[v] - 1]);
+                    break;
+                }
+            }
+            --live[v];
+        }
+
+        // the triangle's vertices go to the front of the cache
+        size_t new_count = 0;
+        for(size_t j=0; j<3; ++j) {
+            new_cache[new_count++] = triangle[j];
+        }
+        for(size_t j=0; j<cache_count; ++j) {
+            const uint32_t v = cache[j];
+            if(v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                new_cache[new_count++] = v;
+            }
+        }
+
+        for(size_t j=0; j<new_count; ++j) {
+            const uint32_t v = new_cache[j];
+            cache_position[v] = j < SCORE_CACHE_SIZE ? static_cast<int>(j) : -1;
+            vertex_scores[v] = vertex_score(cache_position[v], live[v]);
+        }
+
+        // rescore everything the cache touches and find the next best triangle
+        best = NO_TRIANGLE;
+        best_score = -1.0f;
+        for(size_t j=0; j<new_count; ++j) {
+            const uint32_t v = new_cache[j];
+            const uint32_t* const list = adjacency.data() + offsets[v];
+            for(uint32_t k=0; k<live[v]; ++k) {
+                const uint32_t t = list[k];
+                const uint32_t* const other = indices + (t * 3);
+                triangle_scores[t] = vertex_scores[other[0]] + vertex_scores[other[1]] + vertex_scores[other[2]];
+                if(triangle_scores[t] > best_score) {
+                    best_score = triangle_scores[t];
+                    best = t;
+                }
+            }
+        }
+
+        cache_count = std::min(new_count, SCORE_CACHE_SIZE);
+        std::memcpy(cache, new_cache, cache_count * sizeof(uint32_t));
+    }
+}
+
+// moves each element i to permutation[i] in place,
+// permutation is left as the identity
+template<typename T>
+static void permute(T* const values, uint32_t* const permutation, size_t count)
+{
+    for(size_t i=0; i<count; ++i) {
+        while(permutation[i] != i) {
+            const uint32_t j = permutation[i];
+            std::swap(values[i], values[j]);
+            std::swap(permutation[i], permutation[j]);
+        }
+    }
+}
+
+size_t generate_vertex_remap(const Vertex* const vertices, size_t vertex_count, uint32_t* const remap)
+{
+    // each hash holds the head of a list (linked through next) of the distinct vertices with that hash
+    std::unordered_map<uint64_t, uint32_t> buckets;
+    buckets.reserve(vertex_count);
+    std::vector<uint32_t> next(vertex_count, UNUSED_VERTEX);
+
+    // the first vertex of each distinct vertex, to check for hash collisions against
+    std::vector<uint32_t> firsts;
+
+    uint32_t key[VERTEX_KEY_SIZE], other[VERTEX_KEY_SIZE];
+    for(size_t i=0; i<vertex_count; ++i) {
+        vertex_key(vertices[i], key);
+        const uint64_t hash = hash_key(key);
+
+        remap[i] = UNUSED_VERTEX;
+
+        const auto bucket = buckets.find(hash);
+        if(bucket != buckets.end()) {
+            for(uint32_t j=bucket->second; UNUSED_VERTEX != j; j=next[j]) {
+                vertex_key(vertices[j], other);
+                if(0 == std::memcmp(key, other, sizeof(key))) {
+                    remap[i] = remap[j];
+                    break;
+                }
+            }
+        }
+
+        if(UNUSED_VERTEX != remap[i]) {
+            continue;
+        }
+
+        remap[i] = static_cast<uint32_t>(firsts.size());
+        firsts.push_back(static_cast<uint32_t>(i));
+
+        if(bucket != buckets.end()) {
+            next[i] = bucket->second;
+            bucket->second = static_cast<uint32_t>(i);
+        } else {
+            buckets.insert(std::make_pair(hash, static_cast<uint32_t>(i)));
+        }
+    }
+    return firsts.size();
+}
+
+void remap_indices(uint32_t* const indices, size_t index_count, const uint32_t* const remap)
+{
+    for(size_t i=0; i<index_count; ++i) {
+        assert(UNUSED_VERTEX != remap[indices[i]]);
+        indices[i] = remap[indices[i]];
+    }
+}
+
+void optimize_vertex_cache(uint32_t* const destination, const uint32_t* const indices, size_t index_count, size_t vertex_count)
+{
+    assert(destination != indices);
+    assert(0 == index_count % 3);
+
+    std::vector<uint32_t> order(index_count / 3);
+    vertex_cache_order(order.data(), indices, index_count, vertex_count);
+
+    for(size_t i=0; i<order.size(); ++i) {
+        std::memcpy(destination + (i * 3), indices + (order[i] * 3), 3 * sizeof(uint32_t));
+    }
+}
+
+size_t optimize_vertex_fetch_remap(uint32_t* const remap, const uint32_t* const indices, size_t index_count, size_t vertex_count)
+{
+    std::fill(remap, remap + vertex_count, UNUSED_VERTEX);
+
+    uint32_t next = 0;
+    for(size_t i=0; i<index_count; ++i) {
+        const uint32_t v = indices[i];
+        assert(v < vertex_count);
+        if(UNUSED_VERTEX == remap[v]) {
+            remap[v] = next++;
+        }
+    }
+    return next;
+}
+
+float average_cache_miss_ratio(const uint32_t* const indices, size_t index_count, size_t vertex_count, size_t cache_size)
+{
+    if(index_count < 3) {
+        return 0.0f;
+    }
+
+    // a vertex is in the cache if fewer than cache_size misses have happened since it was last loaded
+    std::vector<size_t> loaded(vertex_count, 0);
+    size_t time = cache_size + 1, misses = 0;
+    for(size_t i=0; i<index_count; ++i) {
+        const uint32_t v = indices[i];
+        assert(v < vertex_count);
+        if(time - loaded[v] > cache_size) {
+            loaded[v] = time++;
+            ++misses;
+        }
+    }
+    return static_cast<float>(misses) / static_cast<float>(index_count / 3);
+}
+
+size_t build_meshlets(std::vector<Meshlet>& meshlets, std::vector<uint32_t>& meshlet_vertices, std::vector<uint8_t>& meshlet_triangles,
+    const uint32_t* const indices, size_t index_count, size_t vertex_count, size_t max_vertices, size_t max_triangles)
+{
+    assert(max_vertices >= 3 && max_vertices <= 256);
+    assert(max_triangles >= 1);
+
+    meshlets.clear();
+    meshlet_vertices.clear();
+    meshlet_triangles.clear();
+
+    // each vertex's index in the current meshlet
+    std::vector<uint32_t> local(vertex_count, UNUSED_VERTEX);
+
+    Meshlet meshlet = { 0, 0, 0, 0 };
+    for(size_t i=0; i+2<index_count; i+=3) {
+        const uint32_t* const triangle = indices + i;
+
+        size_t added = 0;
+        for(size_t j=0; j<3; ++j) {
+            assert(triangle[j] < vertex_count);
+            if(UNUSED_VERTEX == local[triangle[j]]) {
+                ++added;
+            }
+        }
+
+        if(meshlet.vertex_count + added > max_vertices || meshlet.triangle_count + 1 > max_triangles) {
+            for(uint32_t j=0; j<meshlet.vertex_count; ++j) {
+                local[meshlet_vertices[meshlet.vertex_offset + j]] = UNUSED_VERTEX;
+            }
+            meshlets.push_back(meshlet);
+
+            meshlet.vertex_offset = static_cast<uint32_t>(meshlet_vertices.size());
+            meshlet.triangle_offset = static_cast<uint32_t>(meshlet_triangles.size() / 3);
+            meshlet.vertex_count = 0;
+            meshlet.triangle_count = 0;
+        }
+
+        for(size_t j=0; j<3; ++j) {
+            const uint32_t v = triangle[j];
+            if(UNUSED_VERTEX == local[v]) {
+                local[v] = meshlet.vertex_count++;
+                meshlet_vertices.push_back(v);
+            }
+            meshlet_triangles.push_back(static_cast<uint8_t>(local[v]));
+        }
+        ++meshlet.triangle_count;
+    }
+
+    if(meshlet.triangle_count > 0) {
+        meshlets.push_back(meshlet);
+    }
+    return meshlets.size();
+}
+
+size_t optimize_mesh(Triangle* const triangles, size_t triangle_count, Vertex* const vertices, size_t vertex_count)
+{
+    std::vector<uint32_t> indices(triangle_count * 3);
+    for(size_t i=0; i<triangle_count; ++i) {
+        const Triangle& triangle(triangles[i]);
+        assert(triangle.v1 >= 0 && static_cast<size_t>(triangle.v1) < vertex_count);
+        assert(triangle.v2 >= 0 && static_cast<size_t>(triangle.v2) < vertex_count);
+        assert(triangle.v3 >= 0 && static_cast<size_t>(triangle.v3) < vertex_count);
+
+        indices[(i * 3) + 0] = static_cast<uint32_t>(triangle.v1);
+        indices[(i * 3) + 1] = static_cast<uint32_t>(triangle.v2);
+        indices[(i * 3) + 2] = static_cast<uint32_t>(triangle.v3);
+    }
+
+    // merge the duplicates
+    std::vector<uint32_t> remap(vertex_count);
+    const size_t unique = generate_vertex_remap(vertices, vertex_count, remap.data());
+    remap_indices(indices.data(), indices.size(), remap.data());
+
+    // reorder the triangles
+    std::vector<uint32_t> order(triangle_count);
+    vertex_cache_order(order.data(), indices.data(), indices.size(), unique);
+
+    std::vector<uint32_t> optimized(indices.size());
+    for(size_t i=0; i<triangle_count; ++i) {
+        std::memcpy(optimized.data() + (i * 3), indices.data() + (order[i] * 3), 3 * sizeof(uint32_t));
+    }
+
+    // and then the vertices
+    std::vector<uint32_t> fetch(unique);
+    const size_t used = optimize_vertex_fetch_remap(fetch.data(), optimized.data(), optimized.size(), unique);
+
+    // the first copy of each used vertex moves to its final place,
+    // everything else is moved past the end out of the way
+    std::vector<uint32_t> permutation(vertex_count);
+    std::vector<unsigned char> placed(unique, 0);
+    uint32_t spare = static_cast<uint32_t>(used);
+    for(size_t i=0; i<vertex_count; ++i) {
+        const uint32_t u = remap[i];
+        if(!placed[u] && UNUSED_VERTEX != fetch[u]) {
+            placed[u] = 1;
+            permutation[i] = fetch[u];
+        } else {
+            permutation[i] = spare++;
+        }
+    }
+    permute(vertices, permutation.data(), vertex_count);
+    for(size_t i=0; i<used; ++i) {
+        vertices[i].index = static_cast<int>(i);
+    }
+
+    // order[i] is where triangle i comes from, permute() wants where it goes to
+    std::vector<uint32_t> destinations(triangle_count);
+    for(size_t i=0; i<triangle_count; ++i) {
+        destinations[order[i]] = static_cast<uint32_t>(i);
+    }
+    permute(triangles, destinations.data(), triangle_count);
+    for(size_t i=0; i<triangle_count; ++i) {
+        Triangle& triangle(triangles[i]);
+        triangle.index = static_cast<int>(i);
+        triangle.v1 = static_cast<int>(fetch[optimized[(i * 3) + 0]]);
+        triangle.v2 = static_cast<int>(fetch[optimized[(i * 3) + 1]]);
+        triangle.v3 = static_cast<int>(fetch[optimized[(i * 3) + 2]]);
+    }
+    return used;
+}
+
+}
+
+#if defined WITH_UNIT_TESTS
+#include "src/test/UnitTest.h"
+
+class MeshOptimizerTest : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(MeshOptimizerTest);
+        CPPUNIT_TEST(test_vertex_remap);
+        CPPUNIT_TEST(test_vertex_cache);
+        CPPUNIT_TEST(test_vertex_fetch);
+        CPPUNIT_TEST(test_meshlets);
+        CPPUNIT_TEST(test_optimize_mesh);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    MeshOptimizerTest() : CppUnit::TestFixture() {}
+    virtual ~MeshOptimizerTest() noexcept {}
+
+public:
+    void test_vertex_remap()
+    {
+        energonsoftware::Vertex vertices[5];
+        for(int i=0; i<5; ++i) {
+            vertices[i].position = energonsoftware::Position(static_cast<float>(i % 3), 0.0f, 0.0f);
+        }
+        // same position, different weights
+        vertices[4].weight_count = 2;
+
+        uint32_t remap[5];
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(4), energonsoftware::generate_vertex_remap(vertices, 5, remap));
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(0), remap[0]);
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(1), remap[1]);
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(2), remap[2]);
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(0), remap[3]);
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(3), remap[4]);
+
+        uint32_t indices[6] = { 0, 1, 2, 3, 2, 4 };
+        energonsoftware::remap_indices(indices, 6, remap);
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(0), indices[3]);
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(3), indices[5]);
+    }
+
+    void test_vertex_cache()
+    {
+        static const size_t SIZE = 40;
+        std::vector<uint32_t> indices;
+        build_grid(SIZE, indices);
+        shuffle_triangles(indices);
+
+        const size_t vertex_count = (SIZE + 1) * (SIZE + 1);
+        const float before = energonsoftware::average_cache_miss_ratio(indices.data(), indices.size(), vertex_count);
+
+        std::vector<uint32_t> optimized(indices.size());
+        energonsoftware::optimize_vertex_cache(optimized.data(), indices.data(), indices.size(), vertex_count);
+        const float after = energonsoftware::average_cache_miss_ratio(optimized.data(), optimized.size(), vertex_count);
+
+        // a shuffled grid reuses almost nothing, an optimized one gets close to 0.5
+        CPPUNIT_ASSERT(before > 2.0f);
+        CPPUNIT_ASSERT(after < 0.8f);
+
+        // still the same triangles
+        CPPUNIT_ASSERT(sorted_triangles(indices) == sorted_triangles(optimized));
+    }
+
+    void test_vertex_fetch()
+    {
+        const uint32_t indices[6] = { 4, 2, 0, 0, 2, 5 };
+        uint32_t remap[7];
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(4), energonsoftware::optimize_vertex_fetch_remap(remap, indices, 6, 7));
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(0), remap[4]);
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(1), remap[2]);
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(2), remap[0]);
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(3), remap[5]);
+        CPPUNIT_ASSERT_EQUAL(energonsoftware::UNUSED_VERTEX, remap[1]);
+        CPPUNIT_ASSERT_EQUAL(energonsoftware::UNUSED_VERTEX, remap[6]);
+    }
+
+    void test_meshlets()
+    {
+        static const size_t SIZE = 20;
+        std::vector<uint32_t> indices;
+        build_grid(SIZE, indices);
+
+        std::vector<energonsoftware::Meshlet> meshlets;
+        std::vector<uint32_t> meshlet_vertices;
+        std::vector<uint8_t> meshlet_triangles;
+        const size_t count = energonsoftware::build_meshlets(meshlets, meshlet_vertices, meshlet_triangles,
+            indices.data(), indices.size(), (SIZE + 1) * (SIZE + 1), 32, 40);
+        CPPUNIT_ASSERT_EQUAL(meshlets.size(), count);
+        CPPUNIT_ASSERT(count >= indices.size() / 3 / 40);
+
+        // every triangle comes back out, in order
+        size_t triangle = 0;
+        for(const energonsoftware::Meshlet& meshlet : meshlets) {
+            CPPUNIT_ASSERT(meshlet.vertex_count <= 32);
+            CPPUNIT_ASSERT(meshlet.triangle_count <= 40);
+            CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(triangle), meshlet.triangle_offset);
+            for(uint32_t i=0; i<meshlet.triangle_count; ++i, ++triangle) {
+                for(size_t j=0; j<3; ++j) {
+                    const uint8_t local = meshlet_triangles[((meshlet.triangle_offset + i) * 3) + j];
+                    CPPUNIT_ASSERT(local < meshlet.vertex_count);
+                    CPPUNIT_ASSERT_EQUAL(indices[(triangle * 3) + j], meshlet_vertices[meshlet.vertex_offset + local]);
+                }
+            }
+        }
+        CPPUNIT_ASSERT_EQUAL(indices.size() / 3, triangle);
+    }
+
+    void test_optimize_mesh()
+    {
+        static const size_t SIZE = 16;
+        std::vector<uint32_t> indices;
+        build_grid(SIZE, indices);
+        shuffle_triangles(indices);
+
+        // every triangle gets its own copy of its vertices (like an unindexed export),
+        // plus a vertex nothing uses
+        const size_t triangle_count = indices.size() / 3, vertex_count = indices.size() + 1;
+        std::vector<energonsoftware::Triangle> triangles(triangle_count);
+        std::unique_ptr<energonsoftware::Vertex[]> vertices(new energonsoftware::Vertex[vertex_count]);
+        for(size_t i=0; i<indices.size(); ++i) {
+            const float x = static_cast<float>(indices[i] % (SIZE + 1)), y = static_cast<float>(indices[i] / (SIZE + 1));
+            vertices[i].position = energonsoftware::Position(x, y, 0.0f);
+            vertices[i].texture_coords = energonsoftware::Vector2(x / SIZE, y / SIZE);
+        }
+        vertices[vertex_count - 1].position = energonsoftware::Position(-1.0f, -1.0f, -1.0f);
+
+        for(size_t i=0; i<triangle_count; ++i) {
+            triangles[i].normal = energonsoftware::Vector3(static_cast<float>(i), 0.0f, 0.0f);
+            triangles[i].v1 = static_cast<int>((i * 3) + 0);
+            triangles[i].v2 = static_cast<int>((i * 3) + 1);
+            triangles[i].v3 = static_cast<int>((i * 3) + 2);
+        }
+
+        std::vector<std::vector<energonsoftware::Position>> before(triangle_count);
+        for(size_t i=0; i<triangle_count; ++i) {
+            before[i] = corners(triangles[i], vertices.get());
+        }
+
+        const size_t used = energonsoftware::optimize_mesh(triangles.data(), triangle_count, vertices.get(), vertex_count);
+        CPPUNIT_ASSERT_EQUAL((SIZE + 1) * (SIZE + 1), used);
+
+        std::vector<uint32_t> optimized;
+        uint32_t last = 0;
+        for(size_t i=0; i<triangle_count; ++i) {
+            const energonsoftware::Triangle& triangle(triangles[i]);
+            CPPUNIT_ASSERT_EQUAL(static_cast<int>(i), triangle.index);
+
+            // the triangles keep their data and their corners
+            const size_t original = static_cast<size_t>(triangle.normal.x());
+            CPPUNIT_ASSERT(before[original] == corners(triangle, vertices.get()));
+
+            for(int v : { triangle.v1, triangle.v2, triangle.v3 }) {
+                CPPUNIT_ASSERT(static_cast<size_t>(v) < used);
+
+                // vertices are first used in order
+                CPPUNIT_ASSERT(static_cast<uint32_t>(v) <= last);
+                last = std::max(last, static_cast<uint32_t>(v) + 1);
+
+                optimized.push_back(static_cast<uint32_t>(v));
+            }
+        }
+        for(size_t i=0; i<used; ++i) {
+            CPPUNIT_ASSERT_EQUAL(static_cast<int>(i), vertices[i].index);
+        }
+        CPPUNIT_ASSERT(energonsoftware::average_cache_miss_ratio(optimized.data(), optimized.size(), used) < 0.8f);
+    }
+
+private:
+    // (size x size) quads, (size + 1) x (size + 1) vertices
+    static void build_grid(size_t size, std::vector<uint32_t>& indices)
+    {
+        indices.clear();
+        for(size_t y=0; y<size; ++y) {
+            for(size_t x=0; x<size; ++x) {
+                const uint32_t v0 = static_cast<uint32_t>((y * (size + 1)) + x), v1 = v0 + 1;
+                const uint32_t v2 = static_cast<uint32_t>(v0 + size + 1), v3 = v2 + 1;
+                indices.insert(indices.end(), { v0, v1, v3, v0, v3, v2 });
+            }
+        }
+    }
+
+    static void shuffle_triangles(std::vector<uint32_t>& indices)
+    {
+        // a fixed shuffle so failures are repeatable
+        uint32_t state = 12345;
+        for(size_t i=(indices.size() / 3) - 1; i>0; --i) {
+            state = (state * 1103515245) + 12345;
+            const size_t j = (state >> 8) % (i + 1);
+            for(size_t k=0; k<3; ++k) {
+                std::swap(indices[(i * 3) + k], indices[(j * 3) + k]);
+            }
+        }
+    }
+
+    static std::vector<std::array<uint32_t, 3>> sorted_triangles(const std::vector<uint32_t>& indices)
+    {
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for(size_t i=0; i<indices.size(); i+=3) {
+            std::array<uint32_t, 3> triangle = {{ indices[i], indices[i + 1], indices[i + 2] }};
+            triangles.push_back(triangle);
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+
+    static std::vector<energonsoftware::Position> corners(const energonsoftware::Triangle& triangle, const energonsoftware::Vertex* const vertices)
+    {
+        return { vertices[triangle.v1].position, vertices[triangle.v2].position, vertices[triangle.v3].position };
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(MeshOptimizerTest);
+
+#endif
@@ -0,0 +1,68 @@
+#if !defined __MESHOPTIMIZER_H__
+#define __MESHOPTIMIZER_H__
+
+#include "Geometry.h"
+
+namespace energonsoftware {
+
+/*
+Offline mesh optimization.
+
+These work on index buffers (3 indices per triangle) and remap tables
+(old vertex index to new, see remap_indices()) so they can be applied
+to any vertex format, optimize_mesh() runs the whole pipeline over
+Triangle and Vertex arrays.
+*/
+
+// a vertex that's been dropped from a remap table
+static const uint32_t UNUSED_VERTEX = std::numeric_limits<uint32_t>::max();
+
+// maps every vertex to the first vertex that's bitwise identical to it
+// (every attribute, including the weights), with the distinct vertices numbered in order,
+// remap must hold at least vertex_count indices, returns the number of distinct vertices
+size_t generate_vertex_remap(const Vertex* const vertices, size_t vertex_count, uint32_t* const remap);
+
+void remap_indices(uint32_t* const indices, size_t index_count, const uint32_t* const remap);
+
+// reorders the triangles so that vertices are reused while they're still
+// in the post-transform vertex cache (Tom Forsyth's linear-speed vertex cache optimization,
+// https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html)
+// this doesn't depend on the actual cache size, destination must not be indices
+void optimize_vertex_cache(uint32_t* const destination, const uint32_t* const indices, size_t index_count, size_t vertex_count);
+
+// numbers the vertices in the order the indices first use them so that
+// vertex fetches walk forward through memory, unused vertices are mapped to UNUSED_VERTEX
+// remap must hold at least vertex_count indices, returns the number of used vertices
+size_t optimize_vertex_fetch_remap(uint32_t* const remap, const uint32_t* const indices, size_t index_count, size_t vertex_count);
+
+// the average number of vertices transformed per triangle with a FIFO cache of the given size,
+// this is 3 without any reuse and around 0.5-0.7 for a well optimized regular mesh
+float average_cache_miss_ratio(const uint32_t* const indices, size_t index_count, size_t vertex_count, size_t cache_size=16);
+
+// a small cluster of triangles, its vertices are
+// meshlet_vertices[vertex_offset, vertex_offset + vertex_count)
+// and its triangles are 3 (local) indices into those in
+// meshlet_triangles[triangle_offset * 3, (triangle_offset + triangle_count) * 3)
+struct Meshlet
+{
+    uint32_t vertex_offset;
+    uint32_t triangle_offset;
+    uint32_t vertex_count;
+    uint32_t triangle_count;
+};
+
+// splits the triangles (in order, so run optimize_vertex_cache() first)
+// into meshlets of at most max_vertices (up to 256) vertices and max_triangles triangles
+// returns the number of meshlets
+size_t build_meshlets(std::vector<Meshlet>& meshlets, std::vector<uint32_t>& meshlet_vertices, std::vector<uint8_t>& meshlet_triangles,
+    const uint32_t* const indices, size_t index_count, size_t vertex_count, size_t max_vertices=64, size_t max_triangles=124);
+
+// removes duplicate vertices, reorders the triangles for the vertex cache
+// and then reorders the vertices for fetching, in place,
+// Vertex::index and Triangle::index are renumbered and unused vertices are dropped,
+// returns the new number of vertices (the triangle count doesn't change)
+size_t optimize_mesh(Triangle* const triangles, size_t triangle_count, Vertex* const vertices, size_t vertex_count);
+
+}
+
+#endif
@@ -0,0 +1,451 @@
+#include "src/pch.h"
+#include "Quantization.h"
+
+namespace energonsoftware {
+
+static uint32_t max_value(unsigned int bits)
+{
+    return static_cast<uint32_t>((static_cast<uint64_t>(1) << bits) - 1);
+}
+
+// v in [minimum, minimum + (step * max)] to a step count, clamped
+static uint32_t quantize_value(float v, float minimum, float step, uint32_t max)
+{
+    if(step <= 0.0f) {
+        return 0;
+    }
+
+    const double q = std::floor(((static_cast<double>(v) - minimum) / step) + 0.5);
+    return q <= 0.0 ? 0 : (q >= max ? max : static_cast<uint32_t>(q));
+}
+
+static float dequantize_value(uint32_t q, float minimum, float step)
+{
+    return static_cast<float>(minimum + (static_cast<double>(q) * step));
+}
+
+// signed deltas are interleaved (0, -1, 1, -2, 2, ...) so small changes either way have small codes
+static uint64_t zigzag(uint32_t value, uint32_t baseline)
+{
+    const int64_t delta = static_cast<int64_t>(value) - static_cast<int64_t>(baseline);
+    return delta >= 0 ? static_cast<uint64_t>(delta) << 1 : (static_cast<uint64_t>(-delta) << 1) - 1;
+}
+
+static uint32_t unzigzag(uint64_t code, uint32_t baseline)
+{
+    const int64_t delta = (code & 1) ? -static_cast<int64_t>((code + 1) >> 1) : static_cast<int64_t>(code >> 1);
+    return static_cast<uint32_t>(static_cast<int64_t>(baseline) + delta);
+}
+
+PositionQuantizer::PositionQuantizer(const Position& minimum, const Position& maximum, unsigned int bits)
+    : _minimum(minimum), _maximum(maximum), _bits(bits), _delta_bits(std::max(bits / 2, 1U))
+{
+    assert(bits > 0 && bits <= 32);
+
+    const double steps = max_value(bits);
+    _step[0] = static_cast<float>((static_cast<double>(maximum.x()) - minimum.x()) / steps);
+    _step[1] = static_cast<float>((static_cast<double>(maximum.y()) - minimum.y()) / steps);
+    _step[2] = static_cast<float>((static_cast<double>(maximum.z()) - minimum.z()) / steps);
+}
+
+PositionQuantizer::~PositionQuantizer() noexcept
+{
+}
+
+float PositionQuantizer::precision() const
+{
+    return 0.5f * std::max(std::max(_step[0], _step[1]), _step[2]);
+}
+
+QuantizedPosition PositionQuantizer::quantize(const Position& position) const
+{
+    const uint32_t max = max_value(_bits);
+
+    QuantizedPosition quantized;
+    quantized.values[0] = quantize_value(position.x(), _minimum.x(), _step[0], max);
+    quantized.values[1] = quantize_value(position.y(), _minimum.y(), _step[1], max);
+    quantized.values[2] = quantize_value(position.z(), _minimum.z(), _step[2], max);
+    return quantized;
+}
+
+Position PositionQuantizer::dequantize(const QuantizedPosition& position) const
+{
+    return Position(dequantize_value(position.values[0], _minimum.x(), _step[0]),
+        dequantize_value(position.values[1], _minimum.y(), _step[1]),
+        dequantize_value(position.values[2], _minimum.z(), _step[2]));
+}
+
+void PositionQuantizer::pack(BinaryPacker& packer, const QuantizedPosition& position, const std::string& name) const throw(PackerError)
+{
+    packer.pack_bits(position.values[0], _bits, name + "_x");
+    packer.pack_bits(position.values[1], _bits, name + "_y");
+    packer.pack_bits(position.values[2], _bits, name + "_z");
+}
+
+void PositionQuantizer::unpack(BinaryUnpacker& unpacker, QuantizedPosition& position, const std::string& name) const throw(PackerError)
+{
+    unpacker.unpack_bits(position.values[0], _bits, name + "_x");
+    unpacker.unpack_bits(position.values[1], _bits, name + "_y");
+    unpacker.unpack_bits(position.values[2], _bits, name + "_z");
+}
+
+// each component is prefixed with 0 (unchanged), 10 (small change) or 11 (the full value)
+void PositionQuantizer::pack_delta(BinaryPacker& packer, const QuantizedPosition& position, const QuantizedPosition& baseline, const std::string& name) const throw(PackerError)
+{
+    if(position == baseline) {
+        packer.pack_bits(0, 1, name + "_changed");
+        return;
+    }
+    packer.pack_bits(1, 1, name + "_changed");
+
+    const uint64_t small = static_cast<uint64_t>(1) << _delta_bits;
+    for(int i=0; i<3; ++i) {
+        if(position.values[i] == baseline.values[i]) {
+            packer.pack_bits(0, 1, name + "_delta");
+            continue;
+        }
+
+        const uint64_t code = zigzag(position.values[i], baseline.values[i]);
+        if(_delta_bits < _bits && code < small) {
+            packer.pack_bits(2, 2, name + "_delta");
+            packer.pack_bits(static_cast<uint32_t>(code), _delta_bits, name + "_delta");
+        } else {
+            packer.pack_bits(3, 2, name + "_delta");
+            packer.pack_bits(position.values[i], _bits, name + "_delta");
+        }
+    }
+}
+
+void PositionQuantizer::unpack_delta(BinaryUnpacker& unpacker, QuantizedPosition& position, const QuantizedPosition& baseline, const std::string& name) const throw(PackerError)
+{
+    position = baseline;
+
+    uint32_t flag;
+    unpacker.unpack_bits(flag, 1, name + "_changed");
+    if(0 == flag) {
+        return;
+    }
+
+    for(int i=0; i<3; ++i) {
+        unpacker.unpack_bits(flag, 1, name + "_delta");
+        if(0 == flag) {
+            continue;
+        }
+
+        unpacker.unpack_bits(flag, 1, name + "_delta");
+        if(0 == flag) {
+            uint32_t code;
+            unpacker.unpack_bits(code, _delta_bits, name + "_delta");
+            position.values[i] = unzigzag(code, baseline.values[i]);
+        } else {
+            unpacker.unpack_bits(position.values[i], _bits, name + "_delta");
+        }
+    }
+}
+
+QuaternionQuantizer::QuaternionQuantizer(unsigned int bits)
+    : _bits(bits), _step(static_cast<float>(M_SQRT2 / max_value(bits)))
+{
+    assert(bits > 0 && bits <= 24);
+}
+
+QuaternionQuantizer::~QuaternionQuantizer() noexcept
+{
+}
+
+float QuaternionQuantizer::precision() const
+{
+    return 0.5f * _step;
+}
+
+QuantizedOrientation QuaternionQuantizer::quantize(const Quaternion& orientation) const
+{
+    QuantizedOrientation quantized;
+    quantized.largest = 0;
+    for(int i=1; i<4; ++i) {
+        if(std::fabs(orientation[i]) > std::fabs(orientation[quantized.largest])) {
+            quantized.largest = i;
+        }
+    }
+
+    const float sign = orientation[quantized.largest] < 0.0f ? -1.0f : 1.0f;
+    const uint32_t max = max_value(_bits);
+    for(int i=0, j=0; i<4; ++i) {
+        if(static_cast<uint32_t>(i) != quantized.largest) {
+            quantized.values[j++] = quantize_value(sign * orientation[i], static_cast<float>(-M_SQRT1_2), _step, max);
+        }
+    }
+    return quantized;
+}
+
+Quaternion QuaternionQuantizer::dequantize(const QuantizedOrientation& orientation) const
+{
+    Quaternion dequantized;
+
+    float length_squared = 0.0f;
+    for(int i=0, j=0; i<4; ++i) {
+        if(static_cast<uint32_t>(i) != orientation.largest) {
+            const float v = dequantize_value(orientation.values[j++], static_cast<float>(-M_SQRT1_2), _step);
+            dequantized[i] = v;
+            length_squared += v * v;
+        }
+    }
+    dequantized[orientation.largest] = std::sqrt(std::max(1.0f - length_squared, 0.0f));
+    return dequantized;
+}
+
+void QuaternionQuantizer::pack(BinaryPacker& packer, const QuantizedOrientation& orientation, const std::string& name) const throw(PackerError)
+{
+    packer.pack_bits(orientation.largest, 2, name + "_largest");
+    packer.pack_bits(orientation.values[0], _bits, name + "_a");
+    packer.pack_bits(orientation.values[1], _bits, name + "_b");
+    packer.pack_bits(orientation.values[2], _bits, name + "_c");
+}
+
+void QuaternionQuantizer::unpack(BinaryUnpacker& unpacker, QuantizedOrientation& orientation, const std::string& name) const throw(PackerError)
+{
+    unpacker.unpack_bits(orientation.largest, 2, name + "_largest");
+    unpacker.unpack_bits(orientation.values[0], _bits, name + "_a");
+    unpacker.unpack_bits(orientation.values[1], _bits, name + "_b");
+    unpacker.unpack_bits(orientation.values[2], _bits, name + "_c");
+}
+
+void QuaternionQuantizer::pack_delta(BinaryPacker& packer, const QuantizedOrientation& orientation, const QuantizedOrientation& baseline, const std::string& name) const throw(PackerError)
+{
+    if(orientation == baseline) {
+        packer.pack_bits(0, 1, name + "_changed");
+        return;
+    }
+
+    packer.pack_bits(1, 1, name + "_changed");
+    pack(packer, orientation, name);
+}
+
+void QuaternionQuantizer::unpack_delta(BinaryUnpacker& unpacker, QuantizedOrientation& orientation, const QuantizedOrientation& baseline, const std::string& name) const throw(PackerError)
+{
+    uint32_t changed;
+    unpacker.unpack_bits(changed, 1, name + "_changed");
+    if(0 == changed) {
+        orientation = baseline;
+        return;
+    }
+    unpack(unpacker, orientation, name);
+}
+
+}
+
+#if defined WITH_UNIT_TESTS
+#include <random>
+#include "src/test/UnitTest.h"
+
+class QuantizationTest : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(QuantizationTest);
+        CPPUNIT_TEST(test_position);
+        CPPUNIT_TEST(test_position_delta);
+        CPPUNIT_TEST(test_orientation);
+        CPPUNIT_TEST(test_orientation_delta);
+        CPPUNIT_TEST(test_snapshot);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    QuantizationTest() : CppUnit::TestFixture() {}
+    virtual ~QuantizationTest() noexcept {}
+
+public:
+    void test_position()
+    {
+        const energonsoftware::PositionQuantizer quantizer(energonsoftware::Position(-512.0f, -16.0f, -512.0f), energonsoftware::Position(512.0f, 240.0f, 512.0f), 16);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(1024.0 / 65535.0 / 2.0, quantizer.precision(), 1e-7);
+
+        std::default_random_engine random(1234);
+        std::uniform_real_distribution<float> xz(-512.0f, 512.0f), y(-16.0f, 240.0f);
+
+        energonsoftware::BinaryPacker packer;
+        std::vector<energonsoftware::Position> positions;
+        for(int i=0; i<100; ++i) {
+            positions.push_back(energonsoftware::Position(xz(random), y(random), xz(random)));
+
+            const energonsoftware::Position& position(positions.back());
+            const energonsoftware::Position p(quantizer.dequantize(quantizer.quantize(position)));
+            CPPUNIT_ASSERT(std::fabs(p.x() - position.x()) <= quantizer.precision() * 1.001f);
+            CPPUNIT_ASSERT(std::fabs(p.y() - position.y()) <= quantizer.precision() * 1.001f);
+            CPPUNIT_ASSERT(std::fabs(p.z() - position.z()) <= quantizer.precision() * 1.001f);
+
+            // a dequantized position quantizes back to the same value
+            CPPUNIT_ASSERT(quantizer.quantize(position) == quantizer.quantize(p));
+
+            quantizer.pack(packer, quantizer.quantize(position), "position");
+        }
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(600), packer.buffer().length());
+
+        energonsoftware::BinaryUnpacker unpacker(packer.buffer());
+        for(const energonsoftware::Position& position : positions) {
+            energonsoftware::QuantizedPosition q;
+            quantizer.unpack(unpacker, q, "position");
+            CPPUNIT_ASSERT(quantizer.quantize(position) == q);
+        }
+
+        // out of bounds positions are clamped
+        const energonsoftware::QuantizedPosition q(quantizer.quantize(energonsoftware::Position(-1000.0f, 1000.0f, 0.0f)));
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(0), q.values[0]);
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(65535), q.values[1]);
+        CPPUNIT_ASSERT_EQUAL(-512.0f, quantizer.dequantize(q).x());
+        CPPUNIT_ASSERT_EQUAL(240.0f, quantizer.dequantize(q).y());
+    }
+
+    void test_position_delta()
+    {
+        const energonsoftware::PositionQuantizer quantizer(energonsoftware::Position(-512.0f, -512.0f, -512.0f), energonsoftware::Position(512.0f, 512.0f, 512.0f), 16);
+
+        energonsoftware::QuantizedPosition baseline;
+        baseline.values[0] = 30000;
+        baseline.values[1] = 10;
+        baseline.values[2] = 65535;
+
+        energonsoftware::QuantizedPosition small(baseline);
+        small.values[0] += 127;
+        small.values[2] -= 128;
+
+        energonsoftware::QuantizedPosition large(baseline);
+        large.values[1] = 65535;
+        large.values[2] = 0;
+
+        energonsoftware::BinaryPacker packer;
+        quantizer.pack_delta(packer, baseline, baseline, "unchanged");
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), packer.buffer().length());
+
+        // 1 + (2 + 8) + 1 + (2 + 8) bits
+        packer.reset();
+        quantizer.pack_delta(packer, small, baseline, "small");
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(3), packer.buffer().length());
+
+        packer.reset();
+        quantizer.pack_delta(packer, baseline, baseline, "unchanged");
+        quantizer.pack_delta(packer, small, baseline, "small");
+        quantizer.pack_delta(packer, large, baseline, "large");
+        quantizer.pack_delta(packer, baseline, large, "back");
+
+        energonsoftware::BinaryUnpacker unpacker(packer.buffer());
+        energonsoftware::QuantizedPosition q;
+        quantizer.unpack_delta(unpacker, q, baseline, "unchanged");
+        CPPUNIT_ASSERT(baseline == q);
+        quantizer.unpack_delta(unpacker, q, baseline, "small");
+        CPPUNIT_ASSERT(small == q);
+        quantizer.unpack_delta(unpacker, q, baseline, "large");
+        CPPUNIT_ASSERT(large == q);
+        quantizer.unpack_delta(unpacker, q, large, "back");
+        CPPUNIT_ASSERT(baseline == q);
+    }
+
+    void test_orientation()
+    {
+        const energonsoftware::QuaternionQuantizer quantizer;
+
+        std::default_random_engine random(1234);
+        std::uniform_real_distribution<float> angle(-static_cast<float>(M_PI), static_cast<float>(M_PI)), axis(-1.0f, 1.0f);
+
+        energonsoftware::BinaryPacker packer;
+        std::vector<energonsoftware::Quaternion> orientations;
+        for(int i=0; i<100; ++i) {
+            orientations.push_back(energonsoftware::Quaternion::new_axis(angle(random), energonsoftware::Vector3(axis(random), axis(random), axis(random))).normalized());
+
+            const energonsoftware::Quaternion& orientation(orientations.back());
+            const energonsoftware::Quaternion q(quantizer.dequantize(quantizer.quantize(orientation)));
+
+            // q and -q are the same rotation
+            const float sign = (orientation ^ q) < 0.0f ? -1.0f : 1.0f;
+            for(int j=0; j<4; ++j) {
+                CPPUNIT_ASSERT(std::fabs((sign * q[j]) - orientation[j]) <= quantizer.precision() * 4.0f);
+            }
+            CPPUNIT_ASSERT(quantizer.quantize(orientation) == quantizer.quantize(-orientation));
+
+            quantizer.pack(packer, quantizer.quantize(orientation), "orientation");
+        }
+
+        // 29 bits each
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(363), packer.buffer().length());
+
+        energonsoftware::BinaryUnpacker unpacker(packer.buffer());
+        for(const energonsoftware::Quaternion& orientation : orientations) {
+            energonsoftware::QuantizedOrientation q;
+            quantizer.unpack(unpacker, q, "orientation");
+            CPPUNIT_ASSERT(quantizer.quantize(orientation) == q);
+        }
+
+        const energonsoftware::Quaternion identity(quantizer.dequantize(quantizer.quantize(energonsoftware::Quaternion())));
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0f, identity.scalar(), 1e-5f);
+    }
+
+    void test_orientation_delta()
+    {
+        const energonsoftware::QuaternionQuantizer quantizer(12);
+        const energonsoftware::QuantizedOrientation baseline(quantizer.quantize(energonsoftware::Quaternion::new_axis(0.5f, energonsoftware::Vector3(0.0f, 1.0f, 0.0f))));
+        const energonsoftware::QuantizedOrientation changed(quantizer.quantize(energonsoftware::Quaternion::new_axis(0.6f, energonsoftware::Vector3(0.0f, 1.0f, 0.0f))));
+        CPPUNIT_ASSERT(baseline != changed);
+
+        energonsoftware::BinaryPacker packer;
+        quantizer.pack_delta(packer, baseline, baseline, "unchanged");
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), packer.buffer().length());
+        quantizer.pack_delta(packer, changed, baseline, "changed");
+
+        // 1 + 1 + 2 + 36 bits
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(5), packer.buffer().length());
+
+        energonsoftware::BinaryUnpacker unpacker(packer.buffer());
+        energonsoftware::QuantizedOrientation q;
+        quantizer.unpack_delta(unpacker, q, baseline, "unchanged");
+        CPPUNIT_ASSERT(baseline == q);
+        quantizer.unpack_delta(unpacker, q, baseline, "changed");
+        CPPUNIT_ASSERT(changed == q);
+    }
+
+    // entity snapshots mixing regular fields with the bit packed ones
+    void test_snapshot()
+    {
+        const energonsoftware::PositionQuantizer positions(energonsoftware::Position(-512.0f, -512.0f, -512.0f), energonsoftware::Position(512.0f, 512.0f, 512.0f), 16);
+        const energonsoftware::QuaternionQuantizer orientations;
+
+        energonsoftware::BinaryPacker full, quantized;
+        for(uint32_t i=0; i<64; ++i) {
+            const energonsoftware::Position position(i * 2.0f, 1.0f, i * -3.0f);
+            const energonsoftware::Quaternion orientation(energonsoftware::Quaternion::new_axis(i * 0.1f, energonsoftware::Vector3(0.0f, 1.0f, 0.0f)));
+
+            full.pack(i, "id");
+            full.pack(position.x(), "x");
+            full.pack(position.y(), "y");
+            full.pack(position.z(), "z");
+            for(int j=0; j<4; ++j) {
+                full.pack(orientation[j], "orientation");
+            }
+
+            quantized.pack(i, "id");
+            positions.pack(quantized, positions.quantize(position), "position");
+            orientations.pack(quantized, orientations.quantize(orientation), "orientation");
+        }
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(64 * 32), full.buffer().length());
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(64 * 14), quantized.buffer().length());
+
+        energonsoftware::BinaryUnpacker unpacker(quantized.buffer());
+        for(uint32_t i=0; i<64; ++i) {
+            const energonsoftware::Position position(i * 2.0f, 1.0f, i * -3.0f);
+
+            uint32_t id;
+            unpacker.unpack(id, "id");
+            CPPUNIT_ASSERT_EQUAL(i, id);
+
+            energonsoftware::QuantizedPosition p;
+            positions.unpack(unpacker, p, "position");
+            CPPUNIT_ASSERT(positions.quantize(position) == p);
+
+            energonsoftware::QuantizedOrientation o;
+            orientations.unpack(unpacker, o, "orientation");
+            CPPUNIT_ASSERT(orientations.quantize(energonsoftware::Quaternion::new_axis(i * 0.1f, energonsoftware::Vector3(0.0f, 1.0f, 0.0f))) == o);
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(QuantizationTest);
+
+#endif
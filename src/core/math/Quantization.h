@@ -0,0 +1,116 @@
+#if !defined __QUANTIZATION_H__
+#define __QUANTIZATION_H__
+
+#include "Quaternion.h"
+#include "Vector.h"
+#include "src/core/util/BinaryPacker.h"
+
+namespace energonsoftware {
+
+/*
+Quantized positions and orientations for network replication.
+
+Snapshots should hold the quantized values rather than the originals
+so that both ends agree exactly on what a delta is against, the deltas
+are packed against a baseline snapshot the receiver has already acked.
+
+Everything is packed with BinaryPacker::pack_bits() so consecutive
+fields share bytes, a position in 16 bits per component and an orientation
+in 9 bits per component packs in 77 bits rather than the 224 bits
+it takes as floats.
+*/
+
+struct QuantizedPosition
+{
+    uint32_t values[3];
+
+    bool operator==(const QuantizedPosition& rhs) const { return values[0] == rhs.values[0] && values[1] == rhs.values[1] && values[2] == rhs.values[2]; }
+    bool operator!=(const QuantizedPosition& rhs) const { return !((*this) == rhs); }
+};
+
+// smallest three encoding, the index of the largest component
+// and the other three components in (x, y, z, w) order
+struct QuantizedOrientation
+{
+    uint32_t largest;
+    uint32_t values[3];
+
+    bool operator==(const QuantizedOrientation& rhs) const { return largest == rhs.largest && values[0] == rhs.values[0] && values[1] == rhs.values[1] && values[2] == rhs.values[2]; }
+    bool operator!=(const QuantizedOrientation& rhs) const { return !((*this) == rhs); }
+};
+
+// fixed point positions inside a bounding box
+class PositionQuantizer
+{
+public:
+    // bits is per component (1 - 32), positions outside of the bounds are clamped
+    PositionQuantizer(const Position& minimum, const Position& maximum, unsigned int bits);
+    virtual ~PositionQuantizer() noexcept;
+
+public:
+    const Position& minimum() const { return _minimum; }
+    const Position& maximum() const { return _maximum; }
+    unsigned int bits() const { return _bits; }
+
+    // the largest error a component can pick up going through a quantize() / dequantize() round trip
+    float precision() const;
+
+    QuantizedPosition quantize(const Position& position) const;
+    Position dequantize(const QuantizedPosition& position) const;
+
+    void pack(BinaryPacker& packer, const QuantizedPosition& position, const std::string& name) const throw(PackerError);
+    void unpack(BinaryUnpacker& unpacker, QuantizedPosition& position, const std::string& name) const throw(PackerError);
+
+    // unchanged components pack in 1 bit and small changes (bits / 2 with the sign)
+    // in 2 bits plus the change, an unchanged position packs in 1 bit
+    void pack_delta(BinaryPacker& packer, const QuantizedPosition& position, const QuantizedPosition& baseline, const std::string& name) const throw(PackerError);
+    void unpack_delta(BinaryUnpacker& unpacker, QuantizedPosition& position, const QuantizedPosition& baseline, const std::string& name) const throw(PackerError);
+
+private:
+    Position _minimum, _maximum;
+    unsigned int _bits;
+    unsigned int _delta_bits;
+
+    // the size of a quantization step on each axis
+    float _step[3];
+
+private:
+    PositionQuantizer() = delete;
+};
+
+// unit quaternions with the smallest three encoding, the largest component is dropped
+// (and rebuilt from the unit length) and the other three, which are all in [-1/sqrt(2), 1/sqrt(2)],
+// are quantized, since q and -q are the same rotation the largest component is always made positive
+class QuaternionQuantizer
+{
+public:
+    // bits is per component (1 - 24), the orientation packs in 2 + (3 * bits) bits
+    explicit QuaternionQuantizer(unsigned int bits=9);
+    virtual ~QuaternionQuantizer() noexcept;
+
+public:
+    unsigned int bits() const { return _bits; }
+
+    // the largest error one of the three quantized components can pick up going through
+    // a quantize() / dequantize() round trip, the rebuilt component can be off by a few times this
+    float precision() const;
+
+    // orientation must be normalized
+    QuantizedOrientation quantize(const Quaternion& orientation) const;
+    Quaternion dequantize(const QuantizedOrientation& orientation) const;
+
+    void pack(BinaryPacker& packer, const QuantizedOrientation& orientation, const std::string& name) const throw(PackerError);
+    void unpack(BinaryUnpacker& unpacker, QuantizedOrientation& orientation, const std::string& name) const throw(PackerError);
+
+    // an unchanged orientation packs in 1 bit, anything else is packed in full
+    void pack_delta(BinaryPacker& packer, const QuantizedOrientation& orientation, const QuantizedOrientation& baseline, const std::string& name) const throw(PackerError);
+    void unpack_delta(BinaryUnpacker& unpacker, QuantizedOrientation& orientation, const QuantizedOrientation& baseline, const std::string& name) const throw(PackerError);
+
+private:
+    unsigned int _bits;
+    float _step;
+};
+
+}
+
+#endif
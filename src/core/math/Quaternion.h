@@ -126,6 +126,7 @@ public:
     Quaternion operator~() const { return Quaternion(_scalar, -_vector); }
 
 public:
+    friend class QuaternionBatch;
     friend bool operator==(float lhs, const Quaternion& rhs) { return lhs == rhs.length(); }
     friend bool operator!=(float lhs, const Quaternion& rhs) { return !(lhs == rhs); }
 
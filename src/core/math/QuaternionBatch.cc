@@ -0,0 +1,862 @@
+#include "src/pch.h"
+#include "src/core/util/cpu_util.h"
+#include "QuaternionBatch.h"
+
+namespace energonsoftware {
+
+/*
+Kernels (see Vector4Batch.cc).
+
+The vector part of each quaternion is in x, y and z and the scalar is in w.
+*/
+
+#if defined USE_SSE
+// SSE3
+
+// r = a * b
+static inline void product_sse(__m128 AX, __m128 AY, __m128 AZ, __m128 AW, __m128 BX, __m128 BY, __m128 BZ, __m128 BW,
+    __m128& RX, __m128& RY, __m128& RZ, __m128& RW)
+{
+    RX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(AW, BX), _mm_mul_ps(BW, AX)), _mm_sub_ps(_mm_mul_ps(AY, BZ), _mm_mul_ps(AZ, BY)));
+    RY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(AW, BY), _mm_mul_ps(BW, AY)), _mm_sub_ps(_mm_mul_ps(AZ, BX), _mm_mul_ps(AX, BZ)));
+    RZ = _mm_add_ps(_mm_add_ps(_mm_mul_ps(AW, BZ), _mm_mul_ps(BW, AZ)), _mm_sub_ps(_mm_mul_ps(AX, BY), _mm_mul_ps(AY, BX)));
+    RW = _mm_sub_ps(_mm_mul_ps(AW, BW), _mm_add_ps(_mm_add_ps(_mm_mul_ps(AX, BX), _mm_mul_ps(AY, BY)), _mm_mul_ps(AZ, BZ)));
+}
+
+static size_t multiply_sse(size_t i, float* x, float* y, float* z, float* w, size_t count, const float* q)
+{
+    const __m128 QX = _mm_set1_ps(q[0]), QY = _mm_set1_ps(q[1]), QZ = _mm_set1_ps(q[2]), QW = _mm_set1_ps(q[3]);
+    for(; i + 4 <= count; i += 4) {
+        __m128 RX, RY, RZ, RW;
+        product_sse(_mm_load_ps(x + i), _mm_load_ps(y + i), _mm_load_ps(z + i), _mm_load_ps(w + i), QX, QY, QZ, QW, RX, RY, RZ, RW);
+        _mm_store_ps(x + i, RX);
+        _mm_store_ps(y + i, RY);
+        _mm_store_ps(z + i, RZ);
+        _mm_store_ps(w + i, RW);
+    }
+    return i;
+}
+
+static size_t multiply_sse(size_t i, float* x, float* y, float* z, float* w, size_t count,
+    const float* qx, const float* qy, const float* qz, const float* qw)
+{
+    for(; i + 4 <= count; i += 4) {
+        __m128 RX, RY, RZ, RW;
+        product_sse(_mm_load_ps(x + i), _mm_load_ps(y + i), _mm_load_ps(z + i), _mm_load_ps(w + i),
+            _mm_load_ps(qx + i), _mm_load_ps(qy + i), _mm_load_ps(qz + i), _mm_load_ps(qw + i), RX, RY, RZ, RW);
+        _mm_store_ps(x + i, RX);
+        _mm_store_ps(y + i, RY);
+        _mm_store_ps(z + i, RZ);
+        _mm_store_ps(w + i, RW);
+    }
+    return i;
+}
+
+static size_t nlerp_sse(size_t i, const float* ax, const float* ay, const float* az, const float* aw,
+    const float* bx, const float* by, const float* bz, const float* bw, size_t count, float t,
+    float* ox, float* oy, float* oz, float* ow)
+{
+    const __m128 WA = _mm_set1_ps(1.0f - t), T = _mm_set1_ps(t), SIGN = _mm_set1_ps(-0.0f);
+    const __m128 HALF = _mm_set1_ps(0.5f), THREE_HALVES = _mm_set1_ps(1.5f);
+    for(; i + 4 <= count; i += 4) {
+        const __m128 AX = _mm_load_ps(ax + i), AY = _mm_load_ps(ay + i), AZ = _mm_load_ps(az + i), AW = _mm_load_ps(aw + i);
+        const __m128 BX = _mm_load_ps(bx + i), BY = _mm_load_ps(by + i), BZ = _mm_load_ps(bz + i), BW = _mm_load_ps(bw + i);
+
+        // flipping the sign of t for negative dot-products takes the shorter path
+        __m128 D = _mm_add_ps(_mm_mul_ps(AX, BX), _mm_mul_ps(AY, BY));
+        D = _mm_add_ps(D, _mm_add_ps(_mm_mul_ps(AZ, BZ), _mm_mul_ps(AW, BW)));
+        const __m128 WB = _mm_xor_ps(T, _mm_and_ps(D, SIGN));
+
+        const __m128 RX = _mm_add_ps(_mm_mul_ps(WA, AX), _mm_mul_ps(WB, BX));
+        const __m128 RY = _mm_add_ps(_mm_mul_ps(WA, AY), _mm_mul_ps(WB, BY));
+        const __m128 RZ = _mm_add_ps(_mm_mul_ps(WA, AZ), _mm_mul_ps(WB, BZ));
+        const __m128 RW = _mm_add_ps(_mm_mul_ps(WA, AW), _mm_mul_ps(WB, BW));
+
+        // the result can't be zero length since the endpoints are in the same hemisphere
+        __m128 L = _mm_add_ps(_mm_mul_ps(RX, RX), _mm_mul_ps(RY, RY));
+        L = _mm_add_ps(L, _mm_add_ps(_mm_mul_ps(RZ, RZ), _mm_mul_ps(RW, RW)));
+        __m128 S = _mm_rsqrt_ps(L);
+        S = _mm_mul_ps(S, _mm_sub_ps(THREE_HALVES, _mm_mul_ps(_mm_mul_ps(HALF, L), _mm_mul_ps(S, S))));
+
+        _mm_store_ps(ox + i, _mm_mul_ps(RX, S));
+        _mm_store_ps(oy + i, _mm_mul_ps(RY, S));
+        _mm_store_ps(oz + i, _mm_mul_ps(RZ, S));
+        _mm_store_ps(ow + i, _mm_mul_ps(RW, S));
+    }
+    return i;
+}
+
+static size_t blend_sse(size_t i, const float* ax, const float* ay, const float* az, const float* aw,
+    const float* bx, const float* by, const float* bz, const float* bw, size_t count, const float* wa, const float* wb,
+    float* ox, float* oy, float* oz, float* ow)
+{
+    for(; i + 4 <= count; i += 4) {
+        const __m128 WA = _mm_loadu_ps(wa + i), WB = _mm_loadu_ps(wb + i);
+        const __m128 RX = _mm_add_ps(_mm_mul_ps(WA, _mm_load_ps(ax + i)), _mm_mul_ps(WB, _mm_load_ps(bx + i)));
+        const __m128 RY = _mm_add_ps(_mm_mul_ps(WA, _mm_load_ps(ay + i)), _mm_mul_ps(WB, _mm_load_ps(by + i)));
+        const __m128 RZ = _mm_add_ps(_mm_mul_ps(WA, _mm_load_ps(az + i)), _mm_mul_ps(WB, _mm_load_ps(bz + i)));
+        const __m128 RW = _mm_add_ps(_mm_mul_ps(WA, _mm_load_ps(aw + i)), _mm_mul_ps(WB, _mm_load_ps(bw + i)));
+        _mm_store_ps(ox + i, RX);
+        _mm_store_ps(oy + i, RY);
+        _mm_store_ps(oz + i, RZ);
+        _mm_store_ps(ow + i, RW);
+    }
+    return i;
+}
+
+static size_t rotate_sse(size_t i, const float* qx, const float* qy, const float* qz, const float* qw, size_t count,
+    float* x, float* y, float* z)
+{
+    const __m128 TWO = _mm_set1_ps(2.0f);
+    for(; i + 4 <= count; i += 4) {
+        const __m128 UX = _mm_load_ps(qx + i), UY = _mm_load_ps(qy + i), UZ = _mm_load_ps(qz + i), S = _mm_load_ps(qw + i);
+        const __m128 X = _mm_load_ps(x + i), Y = _mm_load_ps(y + i), Z = _mm_load_ps(z + i);
+
+        const __m128 TX = _mm_mul_ps(TWO, _mm_sub_ps(_mm_mul_ps(UY, Z), _mm_mul_ps(UZ, Y)));
+        const __m128 TY = _mm_mul_ps(TWO, _mm_sub_ps(_mm_mul_ps(UZ, X), _mm_mul_ps(UX, Z)));
+        const __m128 TZ = _mm_mul_ps(TWO, _mm_sub_ps(_mm_mul_ps(UX, Y), _mm_mul_ps(UY, X)));
+
+        _mm_store_ps(x + i, _mm_add_ps(_mm_add_ps(X, _mm_mul_ps(S, TX)), _mm_sub_ps(_mm_mul_ps(UY, TZ), _mm_mul_ps(UZ, TY))));
+        _mm_store_ps(y + i, _mm_add_ps(_mm_add_ps(Y, _mm_mul_ps(S, TY)), _mm_sub_ps(_mm_mul_ps(UZ, TX), _mm_mul_ps(UX, TZ))));
+        _mm_store_ps(z + i, _mm_add_ps(_mm_add_ps(Z, _mm_mul_ps(S, TZ)), _mm_sub_ps(_mm_mul_ps(UX, TY), _mm_mul_ps(UY, TX))));
+    }
+    return i;
+}
+
+static size_t integrate_sse(size_t i, float* x, float* y, float* z, float* w, size_t count,
+    const float* vx, const float* vy, const float* vz, float h)
+{
+    const __m128 H = _mm_set1_ps(h), ZERO = _mm_setzero_ps();
+    for(; i + 4 <= count; i += 4) {
+        const __m128 X = _mm_load_ps(x + i), Y = _mm_load_ps(y + i), Z = _mm_load_ps(z + i), W = _mm_load_ps(w + i);
+
+        __m128 RX, RY, RZ, RW;
+        product_sse(_mm_load_ps(vx + i), _mm_load_ps(vy + i), _mm_load_ps(vz + i), ZERO, X, Y, Z, W, RX, RY, RZ, RW);
+
+        _mm_store_ps(x + i, _mm_add_ps(X, _mm_mul_ps(H, RX)));
+        _mm_store_ps(y + i, _mm_add_ps(Y, _mm_mul_ps(H, RY)));
+        _mm_store_ps(z + i, _mm_add_ps(Z, _mm_mul_ps(H, RZ)));
+        _mm_store_ps(w + i, _mm_add_ps(W, _mm_mul_ps(H, RW)));
+    }
+    return i;
+}
+
+// AVX2
+TARGET_AVX2 static inline void product_avx2(__m256 AX, __m256 AY, __m256 AZ, __m256 AW, __m256 BX, __m256 BY, __m256 BZ, __m256 BW,
+    __m256& RX, __m256& RY, __m256& RZ, __m256& RW)
+{
+    RX = _mm256_fmadd_ps(AW, BX, _mm256_fmadd_ps(BW, AX, _mm256_fmsub_ps(AY, BZ, _mm256_mul_ps(AZ, BY))));
+    RY = _mm256_fmadd_ps(AW, BY, _mm256_fmadd_ps(BW, AY, _mm256_fmsub_ps(AZ, BX, _mm256_mul_ps(AX, BZ))));
+    RZ = _mm256_fmadd_ps(AW, BZ, _mm256_fmadd_ps(BW, AZ, _mm256_fmsub_ps(AX, BY, _mm256_mul_ps(AY, BX))));
+    RW = _mm256_fmsub_ps(AW, BW, _mm256_fmadd_ps(AX, BX, _mm256_fmadd_ps(AY, BY, _mm256_mul_ps(AZ, BZ))));
+}
+
+TARGET_AVX2 static size_t multiply_avx2(size_t i, float* x, float* y, float* z, float* w, size_t count, const float* q)
+{
+    const __m256 QX = _mm256_set1_ps(q[0]), QY = _mm256_set1_ps(q[1]), QZ = _mm256_set1_ps(q[2]), QW = _mm256_set1_ps(q[3]);
+    for(; i + 8 <= count; i += 8) {
+        __m256 RX, RY, RZ, RW;
+        product_avx2(_mm256_load_ps(x + i), _mm256_load_ps(y + i), _mm256_load_ps(z + i), _mm256_load_ps(w + i), QX, QY, QZ, QW, RX, RY, RZ, RW);
+        _mm256_store_ps(x + i, RX);
+        _mm256_store_ps(y + i, RY);
+        _mm256_store_ps(z + i, RZ);
+        _mm256_store_ps(w + i, RW);
+    }
+    return i;
+}
+
+TARGET_AVX2 static size_t multiply_avx2(size_t i, float* x, float* y, float* z, float* w, size_t count,
+    const float* qx, const float* qy, const float* qz, const float* qw)
+{
+    for(; i + 8 <= count; i += 8) {
+        __m256 RX, RY, RZ, RW;
+        product_avx2(_mm256_load_ps(x + i), _mm256_load_ps(y + i), _mm256_load_ps(z + i), _mm256_load_ps(w + i),
+            _mm256_load_ps(qx + i), _mm256_load_ps(qy + i), _mm256_load_ps(qz + i), _mm256_load_ps(qw + i), RX, RY, RZ, RW);
+        _mm256_store_ps(x + i, RX);
+        _mm256_store_ps(y + i, RY);
+        _mm256_store_ps(z + i, RZ);
+        _mm256_store_ps(w + i, RW);
+    }
+    return i;
+}
+
+TARGET_AVX2 static size_t nlerp_avx2(size_t i, const float* ax, const float* ay, const float* az, const float* aw,
+    const float* bx, const float* by, const float* bz, const float* bw, size_t count, float t,
+    float* ox, float* oy, float* oz, float* ow)
+{
+    const __m256 WA = _mm256_set1_ps(1.0f - t), T = _mm256_set1_ps(t), SIGN = _mm256_set1_ps(-0.0f);
+    const __m256 HALF = _mm256_set1_ps(0.5f), THREE_HALVES = _mm256_set1_ps(1.5f);
+    for(; i + 8 <= count; i += 8) {
+        const __m256 AX = _mm256_load_ps(ax + i), AY = _mm256_load_ps(ay + i), AZ = _mm256_load_ps(az + i), AW = _mm256_load_ps(aw + i);
+        const __m256 BX = _mm256_load_ps(bx + i), BY = _mm256_load_ps(by + i), BZ = _mm256_load_ps(bz + i), BW = _mm256_load_ps(bw + i);
+
+        __m256 D = _mm256_mul_ps(AX, BX);
+        D = _mm256_fmadd_ps(AY, BY, D);
+        D = _mm256_fmadd_ps(AZ, BZ, D);
+        D = _mm256_fmadd_ps(AW, BW, D);
+        const __m256 WB = _mm256_xor_ps(T, _mm256_and_ps(D, SIGN));
+
+        const __m256 RX = _mm256_fmadd_ps(WA, AX, _mm256_mul_ps(WB, BX));
+        const __m256 RY = _mm256_fmadd_ps(WA, AY, _mm256_mul_ps(WB, BY));
+        const __m256 RZ = _mm256_fmadd_ps(WA, AZ, _mm256_mul_ps(WB, BZ));
+        const __m256 RW = _mm256_fmadd_ps(WA, AW, _mm256_mul_ps(WB, BW));
+
+        __m256 L = _mm256_mul_ps(RX, RX);
+        L = _mm256_fmadd_ps(RY, RY, L);
+        L = _mm256_fmadd_ps(RZ, RZ, L);
+        L = _mm256_fmadd_ps(RW, RW, L);
+        __m256 S = _mm256_rsqrt_ps(L);
+        S = _mm256_mul_ps(S, _mm256_fnmadd_ps(_mm256_mul_ps(HALF, L), _mm256_mul_ps(S, S), THREE_HALVES));
+
+        _mm256_store_ps(ox + i, _mm256_mul_ps(RX, S));
+        _mm256_store_ps(oy + i, _mm256_mul_ps(RY, S));
+        _mm256_store_ps(oz + i, _mm256_mul_ps(RZ, S));
+        _mm256_store_ps(ow + i, _mm256_mul_ps(RW, S));
+    }
+    return i;
+}
+
+TARGET_AVX2 static size_t blend_avx2(size_t i, const float* ax, const float* ay, const float* az, const float* aw,
+    const float* bx, const float* by, const float* bz, const float* bw, size_t count, const float* wa, const float* wb,
+    float* ox, float* oy, float* oz, float* ow)
+{
+    for(; i + 8 <= count; i += 8) {
+        const __m256 WA = _mm256_loadu_ps(wa + i), WB = _mm256_loadu_ps(wb + i);
+        const __m256 RX = _mm256_fmadd_ps(WA, _mm256_load_ps(ax + i), _mm256_mul_ps(WB, _mm256_load_ps(bx + i)));
+        const __m256 RY = _mm256_fmadd_ps(WA, _mm256_load_ps(ay + i), _mm256_mul_ps(WB, _mm256_load_ps(by + i)));
+        const __m256 RZ = _mm256_fmadd_ps(WA, _mm256_load_ps(az + i), _mm256_mul_ps(WB, _mm256_load_ps(bz + i)));
+        const __m256 RW = _mm256_fmadd_ps(WA, _mm256_load_ps(aw + i), _mm256_mul_ps(WB, _mm256_load_ps(bw + i)));
+        _mm256_store_ps(ox + i, RX);
+        _mm256_store_ps(oy + i, RY);
+        _mm256_store_ps(oz + i, RZ);
+        _mm256_store_ps(ow + i, RW);
+    }
+    return i;
+}
+
+TARGET_AVX2 static size_t rotate_avx2(size_t i, const float* qx, const float* qy, const float* qz, const float* qw, size_t count,
+    float* x, float* y, float* z)
+{
+    const __m256 TWO = _mm256_set1_ps(2.0f);
+    for(; i + 8 <= count; i += 8) {
+        const __m256 UX = _mm256_load_ps(qx + i), UY = _mm256_load_ps(qy + i), UZ = _mm256_load_ps(qz + i), S = _mm256_load_ps(qw + i);
+        const __m256 X = _mm256_load_ps(x + i), Y = _mm256_load_ps(y + i), Z = _mm256_load_ps(z + i);
+
+        const __m256 TX = _mm256_mul_ps(TWO, _mm256_fmsub_ps(UY, Z, _mm256_mul_ps(UZ, Y)));
+        const __m256 TY = _mm256_mul_ps(TWO, _mm256_fmsub_ps(UZ, X, _mm256_mul_ps(UX, Z)));
+        const __m256 TZ = _mm256_mul_ps(TWO, _mm256_fmsub_ps(UX, Y, _mm256_mul_ps(UY, X)));
+
+        _mm256_store_ps(x + i, _mm256_fmadd_ps(S, TX, _mm256_add_ps(X, _mm256_fmsub_ps(UY, TZ, _mm256_mul_ps(UZ, TY)))));
+        _mm256_store_ps(y + i, _mm256_fmadd_ps(S, TY, _mm256_add_ps(Y, _mm256_fmsub_ps(UZ, TX, _mm256_mul_ps(UX, TZ)))));
+        _mm256_store_ps(z + i, _mm256_fmadd_ps(S, TZ, _mm256_add_ps(Z, _mm256_fmsub_ps(UX, TY, _mm256_mul_ps(UY, TX)))));
+    }
+    return i;
+}
+
+TARGET_AVX2 static size_t integrate_avx2(size_t i, float* x, float* y, float* z, float* w, size_t count,
+    const float* vx, const float* vy, const float* vz, float h)
+{
+    const __m256 H = _mm256_set1_ps(h), ZERO = _mm256_setzero_ps();
+    for(; i + 8 <= count; i += 8) {
+        const __m256 X = _mm256_load_ps(x + i), Y = _mm256_load_ps(y + i), Z = _mm256_load_ps(z + i), W = _mm256_load_ps(w + i);
+
+        __m256 RX, RY, RZ, RW;
+        product_avx2(_mm256_load_ps(vx + i), _mm256_load_ps(vy + i), _mm256_load_ps(vz + i), ZERO, X, Y, Z, W, RX, RY, RZ, RW);
+
+        _mm256_store_ps(x + i, _mm256_fmadd_ps(H, RX, X));
+        _mm256_store_ps(y + i, _mm256_fmadd_ps(H, RY, Y));
+        _mm256_store_ps(z + i, _mm256_fmadd_ps(H, RZ, Z));
+        _mm256_store_ps(w + i, _mm256_fmadd_ps(H, RW, W));
+    }
+    return i;
+}
+
+// AVX-512
+TARGET_AVX512 static inline void product_avx512(__m512 AX, __m512 AY, __m512 AZ, __m512 AW, __m512 BX, __m512 BY, __m512 BZ, __m512 BW,
+    __m512& RX, __m512& RY, __m512& RZ, __m512& RW)
+{
+    RX = _mm512_fmadd_ps(AW, BX, _mm512_fmadd_ps(BW, AX, _mm512_fmsub_ps(AY, BZ, _mm512_mul_ps(AZ, BY))));
+    RY = _mm512_fmadd_ps(AW, BY, _mm512_fmadd_ps(BW, AY, _mm512_fmsub_ps(AZ, BX, _mm512_mul_ps(AX, BZ))));
+    RZ = _mm512_fmadd_ps(AW, BZ, _mm512_fmadd_ps(BW, AZ, _mm512_fmsub_ps(AX, BY, _mm512_mul_ps(AY, BX))));
+    RW = _mm512_fmsub_ps(AW, BW, _mm512_fmadd_ps(AX, BX, _mm512_fmadd_ps(AY, BY, _mm512_mul_ps(AZ, BZ))));
+}
+
+TARGET_AVX512 static size_t multiply_avx512(size_t i, float* x, float* y, float* z, float* w, size_t count, const float* q)
+{
+    const __m512 QX = _mm512_set1_ps(q[0]), QY = _mm512_set1_ps(q[1]), QZ = _mm512_set1_ps(q[2]), QW = _mm512_set1_ps(q[3]);
+    for(; i + 16 <= count; i += 16) {
+        __m512 RX, RY, RZ, RW;
+        product_avx512(_mm512_load_ps(x + i), _mm512_load_ps(y + i), _mm512_load_ps(z + i), _mm512_load_ps(w + i), QX, QY, QZ, QW, RX, RY, RZ, RW);
+        _mm512_store_ps(x + i, RX);
+        _mm512_store_ps(y + i, RY);
+        _mm512_store_ps(z + i, RZ);
+        _mm512_store_ps(w + i, RW);
+    }
+    return i;
+}
+
+TARGET_AVX512 static size_t multiply_avx512(size_t i, float* x, float* y, float* z, float* w, size_t count,
+    const float* qx, const float* qy, const float* qz, const float* qw)
+{
+    for(; i + 16 <= count; i += 16) {
+        __m512 RX, RY, RZ, RW;
+        product_avx512(_mm512_load_ps(x + i), _mm512_load_ps(y + i), _mm512_load_ps(z + i), _mm512_load_ps(w + i),
+            _mm512_load_ps(qx + i), _mm512_load_ps(qy + i), _mm512_load_ps(qz + i), _mm512_load_ps(qw + i), RX, RY, RZ, RW);
+        _mm512_store_ps(x + i, RX);
+        _mm512_store_ps(y + i, RY);
+        _mm512_store_ps(z + i, RZ);
+        _mm512_store_ps(w + i, RW);
+    }
+    return i;
+}
+
+TARGET_AVX512 static size_t nlerp_avx512(size_t i, const float* ax, const float* ay, const float* az, const float* aw,
+    const float* bx, const float* by, const float* bz, const float* bw, size_t count, float t,
+    float* ox, float* oy, float* oz, float* ow)
+{
+    const __m512 WA = _mm512_set1_ps(1.0f - t), T = _mm512_set1_ps(t), NT = _mm512_set1_ps(-t), ZERO = _mm512_setzero_ps();
+    const __m512 HALF = _mm512_set1_ps(0.5f), THREE_HALVES = _mm512_set1_ps(1.5f);
+    for(; i + 16 <= count; i += 16) {
+        const __m512 AX = _mm512_load_ps(ax + i), AY = _mm512_load_ps(ay + i), AZ = _mm512_load_ps(az + i), AW = _mm512_load_ps(aw + i);
+        const __m512 BX = _mm512_load_ps(bx + i), BY = _mm512_load_ps(by + i), BZ = _mm512_load_ps(bz + i), BW = _mm512_load_ps(bw + i);
+
+        __m512 D = _mm512_mul_ps(AX, BX);
+        D = _mm512_fmadd_ps(AY, BY, D);
+        D = _mm512_fmadd_ps(AZ, BZ, D);
+        D = _mm512_fmadd_ps(AW, BW, D);
+
+        // AVX-512F has no float xor, so blend in -t instead
+        const __m512 WB = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(D, ZERO, _CMP_LT_OQ), T, NT);
+
+        const __m512 RX = _mm512_fmadd_ps(WA, AX, _mm512_mul_ps(WB, BX));
+        const __m512 RY = _mm512_fmadd_ps(WA, AY, _mm512_mul_ps(WB, BY));
+        const __m512 RZ = _mm512_fmadd_ps(WA, AZ, _mm512_mul_ps(WB, BZ));
+        const __m512 RW = _mm512_fmadd_ps(WA, AW, _mm512_mul_ps(WB, BW));
+
+        __m512 L = _mm512_mul_ps(RX, RX);
+        L = _mm512_fmadd_ps(RY, RY, L);
+        L = _mm512_fmadd_ps(RZ, RZ, L);
+        L = _mm512_fmadd_ps(RW, RW, L);
+        __m512 S = _mm512_rsqrt14_ps(L);
+        S = _mm512_mul_ps(S, _mm512_fnmadd_ps(_mm512_mul_ps(HALF, L), _mm512_mul_ps(S, S), THREE_HALVES));
+
+        _mm512_store_ps(ox + i, _mm512_mul_ps(RX, S));
+        _mm512_store_ps(oy + i, _mm512_mul_ps(RY, S));
+        _mm512_store_ps(oz + i, _mm512_mul_ps(RZ, S));
+        _mm512_store_ps(ow + i, _mm512_mul_ps(RW, S));
+    }
+    return i;
+}
+
+TARGET_AVX512 static size_t blend_avx512(size_t i, const float* ax, const float* ay, const float* az, const float* aw,
+    const float* bx, const float* by, const float* bz, const float* bw, size_t count, const float* wa, const float* wb,
+    float* ox, float* oy, float* oz, float* ow)
+{
+    for(; i + 16 <= count; i += 16) {
+        const __m512 WA = _mm512_loadu_ps(wa + i), WB = _mm512_loadu_ps(wb + i);
+        const __m512 RX = _mm512_fmadd_ps(WA, _mm512_load_ps(ax + i), _mm512_mul_ps(WB, _mm512_load_ps(bx + i)));
+        const __m512 RY = _mm512_fmadd_ps(WA, _mm512_load_ps(ay + i), _mm512_mul_ps(WB, _mm512_load_ps(by + i)));
+        const __m512 RZ = _mm512_fmadd_ps(WA, _mm512_load_ps(az + i), _mm512_mul_ps(WB, _mm512_load_ps(bz + i)));
+        const __m512 RW = _mm512_fmadd_ps(WA, _mm512_load_ps(aw + i), _mm512_mul_ps(WB, _mm512_load_ps(bw + i)));
+        _mm512_store_ps(ox + i, RX);
+        _mm512_store_ps(oy + i, RY);
+        _mm512_store_ps(oz + i, RZ);
+        _mm512_store_ps(ow + i, RW);
+    }
+    return i;
+}
+
+TARGET_AVX512 static size_t rotate_avx512(size_t i, const float* qx, const float* qy, const float* qz, const float* qw, size_t count,
+    float* x, float* y, float* z)
+{
+    const __m512 TWO = _mm512_set1_ps(2.0f);
+    for(; i + 16 <= count; i += 16) {
+        const __m512 UX = _mm512_load_ps(qx + i), UY = _mm512_load_ps(qy + i), UZ = _mm512_load_ps(qz + i), S = _mm512_load_ps(qw + i);
+        const __m512 X = _mm512_load_ps(x + i), Y = _mm512_load_ps(y + i), Z = _mm512_load_ps(z + i);
+
+        const __m512 TX = _mm512_mul_ps(TWO, _mm512_fmsub_ps(UY, Z, _mm512_mul_ps(UZ, Y)));
+        const __m512 TY = _mm512_mul_ps(TWO, _mm512_fmsub_ps(UZ, X, _mm512_mul_ps(UX, Z)));
+        const __m512 TZ = _mm512_mul_ps(TWO, _mm512_fmsub_ps(UX, Y, _mm512_mul_ps(UY, X)));
+
+        _mm512_store_ps(x + i, _mm512_fmadd_ps(S, TX, _mm512_add_ps(X, _mm512_fmsub_ps(UY, TZ, _mm512_mul_ps(UZ, TY)))));
+        _mm512_store_ps(y + i, _mm512_fmadd_ps(S, TY, _mm512_add_ps(Y, _mm512_fmsub_ps(UZ, TX, _mm512_mul_ps(UX, TZ)))));
+        _mm512_store_ps(z + i, _mm512_fmadd_ps(S, TZ, _mm512_add_ps(Z, _mm512_fmsub_ps(UX, TY, _mm512_mul_ps(UY, TX)))));
+    }
+    return i;
+}
+
+TARGET_AVX512 static size_t integrate_avx512(size_t i, float* x, float* y, float* z, float* w, size_t count,
+    const float* vx, const float* vy, const float* vz, float h)
+{
+    const __m512 H = _mm512_set1_ps(h), ZERO = _mm512_setzero_ps();
+    for(; i + 16 <= count; i += 16) {
+        const __m512 X = _mm512_load_ps(x + i), Y = _mm512_load_ps(y + i), Z = _mm512_load_ps(z + i), W = _mm512_load_ps(w + i);
+
+        __m512 RX, RY, RZ, RW;
+        product_avx512(_mm512_load_ps(vx + i), _mm512_load_ps(vy + i), _mm512_load_ps(vz + i), ZERO, X, Y, Z, W, RX, RY, RZ, RW);
+
+        _mm512_store_ps(x + i, _mm512_fmadd_ps(H, RX, X));
+        _mm512_store_ps(y + i, _mm512_fmadd_ps(H, RY, Y));
+        _mm512_store_ps(z + i, _mm512_fmadd_ps(H, RZ, Z));
+        _mm512_store_ps(w + i, _mm512_fmadd_ps(H, RW, W));
+    }
+    return i;
+}
+#endif
+
+// scalar version of the product kernels
+static inline void product(float ax, float ay, float az, float aw, float bx, float by, float bz, float bw,
+    float& rx, float& ry, float& rz, float& rw)
+{
+    rx = (aw * bx) + (bw * ax) + ((ay * bz) - (az * by));
+    ry = (aw * by) + (bw * ay) + ((az * bx) - (ax * bz));
+    rz = (aw * bz) + (bw * az) + ((ax * by) - (ay * bx));
+    rw = (aw * bw) - ((ax * bx) + (ay * by) + (az * bz));
+}
+
+void QuaternionBatch::conjugate()
+{
+    float* const qx = x();
+    float* const qy = y();
+    float* const qz = z();
+    for(size_t i=0; i<size(); ++i) {
+        qx[i] = -qx[i];
+        qy[i] = -qy[i];
+        qz[i] = -qz[i];
+    }
+}
+
+void QuaternionBatch::multiply(const Quaternion& rhs)
+{
+    float* const qx = x();
+    float* const qy = y();
+    float* const qz = z();
+    float* const qw = w();
+    const float q[4] = { rhs._vector.x(), rhs._vector.y(), rhs._vector.z(), rhs._scalar };
+
+    size_t i = 0;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, multiply, qx, qy, qz, qw, size(), q);
+#endif
+
+    for(; i<size(); ++i) {
+        product(qx[i], qy[i], qz[i], qw[i], q[0], q[1], q[2], q[3], qx[i], qy[i], qz[i], qw[i]);
+    }
+}
+
+void QuaternionBatch::multiply(const QuaternionBatch& rhs)
+{
+    assert(rhs.size() == size());
+
+    float* const qx = x();
+    float* const qy = y();
+    float* const qz = z();
+    float* const qw = w();
+
+    size_t i = 0;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, multiply, qx, qy, qz, qw, size(), rhs.x(), rhs.y(), rhs.z(), rhs.w());
+#endif
+
+    for(; i<size(); ++i) {
+        product(qx[i], qy[i], qz[i], qw[i], rhs.x()[i], rhs.y()[i], rhs.z()[i], rhs.w()[i], qx[i], qy[i], qz[i], qw[i]);
+    }
+}
+
+void QuaternionBatch::nlerp(const QuaternionBatch& from, const QuaternionBatch& to, float t)
+{
+    assert(from.size() == to.size());
+
+    const size_t count = from.size();
+    resize(count);
+
+    size_t i = 0;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, nlerp, from.x(), from.y(), from.z(), from.w(), to.x(), to.y(), to.z(), to.w(), count, t, x(), y(), z(), w());
+#endif
+
+    for(; i<count; ++i) {
+        const Quaternion a(from.get(i)), b(to.get(i));
+        const float wb = (a ^ b) < 0.0f ? -t : t;
+
+        // normalized() is only approximate
+        const Quaternion q((1.0f - t) * a + wb * b);
+        set(i, q / q.length());
+    }
+}
+
+void QuaternionBatch::slerp(const QuaternionBatch& from, const QuaternionBatch& to, float t)
+{
+    assert(from.size() == to.size());
+
+    const size_t count = from.size();
+
+    // the trig has to be done per quaternion, but it only
+    // produces the weights so the rest is still done in bulk
+    std::vector<float> wa(count), wb(count);
+    from.dot(to, wb.data());
+    for(size_t i=0; i<count; ++i) {
+        float d = wb[i];
+        const float sign = d < 0.0f ? -1.0f : 1.0f;
+        d *= sign;
+
+        // nearly parallel quaternions would divide by ~0,
+        // but lerping is just as good that close together
+        if(d > 0.9995f) {
+            wa[i] = 1.0f - t;
+            wb[i] = sign * t;
+        } else {
+            const float angle = std::acos(d);
+            const float rsin = 1.0f / std::sin(angle);
+            wa[i] = std::sin((1.0f - t) * angle) * rsin;
+            wb[i] = sign * std::sin(t * angle) * rsin;
+        }
+    }
+
+    resize(count);
+
+    size_t i = 0;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, blend, from.x(), from.y(), from.z(), from.w(), to.x(), to.y(), to.z(), to.w(), count,
+        wa.data(), wb.data(), x(), y(), z(), w());
+#endif
+
+    for(; i<count; ++i) {
+        set(i, wa[i] * from.get(i) + wb[i] * to.get(i));
+    }
+
+    normalize();
+}
+
+void QuaternionBatch::rotate(Vector4Batch& vectors) const
+{
+    assert(vectors.size() == size());
+
+    // v' = v + s * t + u x t where t = 2 * (u x v)
+    // (see Vector4Batch::rotate())
+    float* const vx = vectors.x();
+    float* const vy = vectors.y();
+    float* const vz = vectors.z();
+
+    size_t i = 0;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, rotate, x(), y(), z(), w(), size(), vx, vy, vz);
+#endif
+
+    for(; i<size(); ++i) {
+        const float ux = x()[i], uy = y()[i], uz = z()[i], s = w()[i];
+        const float px = vx[i], py = vy[i], pz = vz[i];
+
+        const float tx = 2.0f * ((uy * pz) - (uz * py));
+        const float ty = 2.0f * ((uz * px) - (ux * pz));
+        const float tz = 2.0f * ((ux * py) - (uy * px));
+
+        vx[i] = px + (s * tx) + ((uy * tz) - (uz * ty));
+        vy[i] = py + (s * ty) + ((uz * tx) - (ux * tz));
+        vz[i] = pz + (s * tz) + ((ux * ty) - (uy * tx));
+    }
+}
+
+void QuaternionBatch::integrate(const Vector4Batch& angular_velocity, float dt)
+{
+    assert(angular_velocity.size() == size());
+
+    // q' = q + (dt / 2) * w * q, which drifts off of unit length,
+    // so it has to be renormalized afterwards
+    float* const qx = x();
+    float* const qy = y();
+    float* const qz = z();
+    float* const qw = w();
+    const float* const vx = angular_velocity.x();
+    const float* const vy = angular_velocity.y();
+    const float* const vz = angular_velocity.z();
+    const float h = 0.5f * dt;
+
+    size_t i = 0;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, integrate, qx, qy, qz, qw, size(), vx, vy, vz, h);
+#endif
+
+    for(; i<size(); ++i) {
+        float rx, ry, rz, rw;
+        product(vx[i], vy[i], vz[i], 0.0f, qx[i], qy[i], qz[i], qw[i], rx, ry, rz, rw);
+        qx[i] += h * rx;
+        qy[i] += h * ry;
+        qz[i] += h * rz;
+        qw[i] += h * rw;
+    }
+
+    normalize();
+}
+
+}
+
+#if defined WITH_UNIT_TESTS
+#include "src/test/UnitTest.h"
+
+class QuaternionBatchTest : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(QuaternionBatchTest);
+        CPPUNIT_TEST(test_storage);
+        CPPUNIT_TEST(test_conjugate);
+        CPPUNIT_TEST(test_multiply);
+        CPPUNIT_TEST(test_nlerp);
+        CPPUNIT_TEST(test_slerp);
+        CPPUNIT_TEST(test_rotate);
+        CPPUNIT_TEST(test_integrate);
+        CPPUNIT_TEST(test_dispatch);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    // enough to leave a tail for every kernel width
+    static const size_t COUNT = 37;
+
+public:
+    QuaternionBatchTest() : CppUnit::TestFixture() {}
+    virtual ~QuaternionBatchTest() noexcept {}
+
+public:
+    void setUp() override
+    {
+        energonsoftware::set_simd_level(energonsoftware::detected_simd_level());
+    }
+
+    void tearDown() override
+    {
+        energonsoftware::set_simd_level(energonsoftware::detected_simd_level());
+    }
+
+    void test_storage()
+    {
+        energonsoftware::QuaternionBatch batch;
+        CPPUNIT_ASSERT(batch.empty());
+
+        const energonsoftware::Quaternion q(energonsoftware::Quaternion::new_axis(0.5f, energonsoftware::Vector3(1.0f, 2.0f, 3.0f)));
+        batch.push_back(energonsoftware::Quaternion());
+        batch.push_back(q);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), batch.size());
+        CPPUNIT_ASSERT(energonsoftware::Quaternion() == batch.get(0));
+        CPPUNIT_ASSERT(q == batch.get(1));
+
+        // the scalar lives in w
+        CPPUNIT_ASSERT_EQUAL(1.0f, batch.w()[0]);
+        CPPUNIT_ASSERT_EQUAL(q.scalar(), batch.w()[1]);
+
+        batch.set(0, q);
+        CPPUNIT_ASSERT(q == batch.get(0));
+    }
+
+    void test_conjugate()
+    {
+        energonsoftware::QuaternionBatch batch;
+        fill(batch, 0.0f);
+        batch.conjugate();
+        for(size_t i=0; i<COUNT; ++i) {
+            CPPUNIT_ASSERT(~quaternion(i, 0.0f) == batch.get(i));
+        }
+    }
+
+    void test_multiply()
+    {
+        const energonsoftware::Quaternion q(energonsoftware::Quaternion::new_axis(1.1f, energonsoftware::Vector3(-1.0f, 0.5f, 2.0f)));
+
+        energonsoftware::QuaternionBatch batch;
+        fill(batch, 0.0f);
+        batch.multiply(q);
+        for(size_t i=0; i<COUNT; ++i) {
+            assert_equal(quaternion(i, 0.0f) * q, batch.get(i), 0.0001f);
+        }
+
+        energonsoftware::QuaternionBatch lhs, rhs;
+        fill(lhs, 0.0f);
+        fill(rhs, 1.0f);
+        lhs.multiply(rhs);
+        for(size_t i=0; i<COUNT; ++i) {
+            assert_equal(quaternion(i, 0.0f) * quaternion(i, 1.0f), lhs.get(i), 0.0001f);
+        }
+    }
+
+    void test_nlerp()
+    {
+        energonsoftware::QuaternionBatch from, to, result;
+        fill(from, 0.0f);
+        fill(to, 1.0f);
+
+        // the ends are the inputs
+        result.nlerp(from, to, 0.0f);
+        for(size_t i=0; i<COUNT; ++i) {
+            assert_equal(from.get(i), result.get(i), 0.0001f);
+        }
+
+        result.nlerp(from, to, 0.3f);
+        CPPUNIT_ASSERT_EQUAL(COUNT, result.size());
+        for(size_t i=0; i<COUNT; ++i) {
+            const energonsoftware::Quaternion a(from.get(i)), b(to.get(i));
+            const energonsoftware::Quaternion expected(((a ^ b) < 0.0f ? 0.7f * a - 0.3f * b : 0.7f * a + 0.3f * b).normalized());
+            assert_equal(expected, result.get(i), 0.001f);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0f, result.get(i).length(), 0.0001f);
+        }
+
+        // going the long way around should get flipped
+        to.resize(0);
+        for(size_t i=0; i<COUNT; ++i) {
+            to.push_back(-from.get(i));
+        }
+        result.nlerp(from, to, 0.5f);
+        for(size_t i=0; i<COUNT; ++i) {
+            assert_equal(from.get(i), result.get(i), 0.0001f);
+        }
+    }
+
+    void test_slerp()
+    {
+        energonsoftware::QuaternionBatch from, to, result;
+        fill(from, 0.0f);
+        fill(to, 1.0f);
+
+        result.slerp(from, to, 0.25f);
+        for(size_t i=0; i<COUNT; ++i) {
+            const energonsoftware::Quaternion expected(from.get(i).slerp(to.get(i), 0.25));
+            assert_equal(expected, result.get(i), 0.001f);
+        }
+
+        // the angle should be split evenly
+        result.slerp(from, to, 0.5f);
+        for(size_t i=0; i<COUNT; ++i) {
+            const float a = std::fabs(from.get(i) ^ result.get(i)), b = std::fabs(result.get(i) ^ to.get(i));
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(a, b, 0.001f);
+        }
+
+        // in place
+        from.slerp(from, to, 1.0f);
+        for(size_t i=0; i<COUNT; ++i) {
+            const energonsoftware::Quaternion& b(to.get(i));
+            assert_equal((from.get(i) ^ b) < 0.0f ? -b : b, from.get(i), 0.001f);
+        }
+    }
+
+    void test_rotate()
+    {
+        energonsoftware::QuaternionBatch batch;
+        fill(batch, 0.0f);
+
+        energonsoftware::Vector4Batch vectors;
+        for(size_t i=0; i<COUNT; ++i) {
+            vectors.push_back(energonsoftware::Vector(i * 0.5f, 3.0f - i, 1.0f, 1.0f));
+        }
+
+        batch.rotate(vectors);
+        for(size_t i=0; i<COUNT; ++i) {
+            const energonsoftware::Vector3 expected(batch.get(i) * energonsoftware::Vector3(i * 0.5f, 3.0f - i, 1.0f));
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.x(), vectors.x()[i], 0.001f);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.y(), vectors.y()[i], 0.001f);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.z(), vectors.z()[i], 0.001f);
+            CPPUNIT_ASSERT_EQUAL(1.0f, vectors.w()[i]);
+        }
+    }
+
+    void test_integrate()
+    {
+        // spinning at i radians per second around z for 1 second
+        energonsoftware::QuaternionBatch batch;
+        energonsoftware::Vector4Batch velocity;
+        for(size_t i=0; i<COUNT; ++i) {
+            batch.push_back(energonsoftware::Quaternion());
+            velocity.push_back(energonsoftware::Vector(0.0f, 0.0f, i * 0.1f));
+        }
+
+        for(int step=0; step<1000; ++step) {
+            batch.integrate(velocity, 0.001f);
+        }
+
+        for(size_t i=0; i<COUNT; ++i) {
+            const energonsoftware::Quaternion q(batch.get(i));
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0f, q.length(), 0.0001f);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(std::cos(i * 0.05f), q.scalar(), 0.001f);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(std::sin(i * 0.05f), q.vector().z(), 0.001f);
+        }
+    }
+
+    void test_dispatch()
+    {
+        // every level should agree with the scalar code
+        energonsoftware::set_simd_level(energonsoftware::SimdLevel::None);
+        energonsoftware::QuaternionBatch expected[4];
+        energonsoftware::Vector4Batch expected_rotated;
+        run_all(expected, expected_rotated);
+
+        for(energonsoftware::SimdLevel level : energonsoftware::supported_simd_levels()) {
+            energonsoftware::set_simd_level(level);
+
+            energonsoftware::QuaternionBatch actual[4];
+            energonsoftware::Vector4Batch actual_rotated;
+            run_all(actual, actual_rotated);
+            for(int j=0; j<4; ++j) {
+                for(size_t i=0; i<COUNT; ++i) {
+                    assert_equal(expected[j].get(i), actual[j].get(i), 0.001f);
+                }
+            }
+
+            for(size_t i=0; i<COUNT; ++i) {
+                const energonsoftware::Vector e(expected_rotated.get(i)), a(actual_rotated.get(i));
+                for(int k=0; k<4; ++k) {
+                    CPPUNIT_ASSERT_DOUBLES_EQUAL(e[k], a[k], 0.001f);
+                }
+            }
+        }
+    }
+
+private:
+    static void fill(energonsoftware::QuaternionBatch& batch, float offset)
+    {
+        for(size_t i=0; i<COUNT; ++i) {
+            batch.push_back(quaternion(i, offset));
+        }
+    }
+
+    // new_axis() is only approximately normalized
+    static energonsoftware::Quaternion quaternion(size_t i, float offset)
+    {
+        const energonsoftware::Quaternion q(energonsoftware::Quaternion::new_axis(0.3f * i + offset, energonsoftware::Vector3(1.0f + offset, i * 0.25f, 2.0f - i)));
+        return q / q.length();
+    }
+
+    void run_all(energonsoftware::QuaternionBatch (&results)[4], energonsoftware::Vector4Batch& rotated)
+    {
+        energonsoftware::QuaternionBatch from, to;
+        fill(from, 0.0f);
+        fill(to, 2.0f);
+
+        fill(results[0], 0.0f);
+        results[0].multiply(to);
+
+        results[1].nlerp(from, to, 0.4f);
+        results[2].slerp(from, to, 0.4f);
+
+        energonsoftware::Vector4Batch velocity;
+        for(size_t i=0; i<COUNT; ++i) {
+            velocity.push_back(energonsoftware::Vector(1.0f, i * 0.1f, -2.0f));
+        }
+        fill(results[3], 1.0f);
+        results[3].integrate(velocity, 0.01f);
+
+        for(size_t i=0; i<COUNT; ++i) {
+            rotated.push_back(energonsoftware::Vector(i * 0.5f, 3.0f - i, 1.0f, 1.0f));
+        }
+        from.rotate(rotated);
+    }
+
+    void assert_equal(const energonsoftware::Quaternion& expected, const energonsoftware::Quaternion& actual, float tolerance)
+    {
+        for(int i=0; i<4; ++i) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected[i], actual[i], tolerance);
+        }
+    }
+};
+
+const size_t QuaternionBatchTest::COUNT;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(QuaternionBatchTest);
+
+#endif
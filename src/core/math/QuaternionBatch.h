@@ -0,0 +1,68 @@
+#if !defined __QUATERNIONBATCH_H__
+#define __QUATERNIONBATCH_H__
+
+#include "Quaternion.h"
+#include "Vector4Batch.h"
+
+namespace energonsoftware {
+
+/*
+Structure-of-arrays collection of quaternions.
+
+The vector part is kept in x, y and z and the scalar in w, so the
+inherited normalize() normalizes the quaternions and the inherited
+dot() gives the quaternion dot-products. The quaternion operations are
+dispatched at runtime the same as the Vector4Batch operations.
+
+Unless noted otherwise the operations assume the quaternions are normalized.
+*/
+class QuaternionBatch : public Vector4Batch
+{
+public:
+    explicit QuaternionBatch(MemoryAllocator* const allocator=nullptr) : Vector4Batch(allocator) {}
+    virtual ~QuaternionBatch() noexcept {}
+
+public:
+    Quaternion get(size_t index) const
+    {
+        assert(index < size());
+        return Quaternion(w()[index], x()[index], y()[index], z()[index]);
+    }
+
+    void set(size_t index, const Quaternion& quaternion)
+    {
+        Vector4Batch::set(index, Vector(quaternion._vector, quaternion._scalar));
+    }
+
+    void push_back(const Quaternion& quaternion)
+    {
+        Vector4Batch::push_back(Vector(quaternion._vector, quaternion._scalar));
+    }
+
+    void conjugate();
+
+    // per quaternion products, (*this)[i] = (*this)[i] * rhs
+    // NOTE: these do *not* normalize the quaternions
+    void multiply(const Quaternion& rhs);
+    void multiply(const QuaternionBatch& rhs);
+
+    // interpolates between each pair of quaternions, along the shortest path,
+    // and stores the (normalized) results in this batch
+    // t must be in [0, 1]
+    void nlerp(const QuaternionBatch& from, const QuaternionBatch& to, float t);
+    void slerp(const QuaternionBatch& from, const QuaternionBatch& to, float t);
+
+    // rotates the 3-dimensional part of each vector by the matching quaternion
+    void rotate(Vector4Batch& vectors) const;
+
+    // advances each orientation by the matching (world space)
+    // angular velocity, in radians per second, over dt seconds
+    void integrate(const Vector4Batch& angular_velocity, float dt);
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(QuaternionBatch);
+};
+
+}
+
+#endif
@@ -0,0 +1,630 @@
+#include "src/pch.h"
+#include "src/core/thread/parallel.h"
+#include "src/core/util/cpu_util.h"
+#include "Skin.h"
+
+namespace energonsoftware {
+
+static_assert(64 == sizeof(SkinWeight), "SkinWeight should be a cache line");
+
+// vertices are skinned into blocks of this many on the stack before they're copied out
+static const size_t BLOCK_VERTICES = 128;
+
+// fewer vertices than this isn't worth handing to another thread
+static const size_t SKIN_GRAIN = 2048;
+
+/*
+Skinning kernels.
+
+The palette is passed as the columns of each joint's matrix
+(the matrices are row major and transform column vectors), 16 floats per joint,
+with the last column being the translation. Every column's w is 0
+so positions come out with a w of 0 and normals and tangents aren't translated.
+
+Each kernel skins vertices [i, end) and writes them to the outputs
+starting at (i - begin), returning the index of the first vertex it didn't get to
+(see SIMD_DISPATCH in cpu_util.h). A vertex is one pass through its weights
+whatever the register width, so the widest kernel the CPU supports skins the whole range.
+*/
+
+static void matrix_columns(const Matrix4* const palette, size_t joint_count, std::vector<float>& columns)
+{
+    columns.resize(joint_count * 16);
+    for(size_t i=0; i<joint_count; ++i) {
+        const float* const m = palette[i].array();
+        float* const c = columns.data() + (i * 16);
+        for(size_t j=0; j<4; ++j) {
+            c[(j * 4) + 0] = m[j + 0];
+            c[(j * 4) + 1] = m[j + 4];
+            c[(j * 4) + 2] = m[j + 8];
+            c[(j * 4) + 3] = 0.0f;
+        }
+    }
+}
+
+static void pose_columns(const Quaternion* const orientations, const Position* const positions, size_t joint_count, std::vector<float>& columns)
+{
+    columns.resize(joint_count * 16);
+    for(size_t i=0; i<joint_count; ++i) {
+        // the rotated axes are the columns of the rotation
+        const Vector3 axes[3] = { orientations[i] * Vector::XAXIS, orientations[i] * Vector::YAXIS, orientations[i] * Vector::ZAXIS };
+
+        float* const c = columns.data() + (i * 16);
+        for(size_t j=0; j<3; ++j) {
+            c[(j * 4) + 0] = axes[j].x();
+            c[(j * 4) + 1] = axes[j].y();
+            c[(j * 4) + 2] = axes[j].z();
+            c[(j * 4) + 3] = 0.0f;
+        }
+        c[12] = positions[i].x();
+        c[13] = positions[i].y();
+        c[14] = positions[i].z();
+        c[15] = 0.0f;
+    }
+}
+
+#if defined USE_SSE
+// SSE3
+
+static inline __m128 normalize_sse(const __m128 V)
+{
+    __m128 D = _mm_mul_ps(V, V);
+    D = _mm_hadd_ps(D, D);
+    D = _mm_hadd_ps(D, D);
+
+    // zero vectors (no normal or tangent) stay zero
+    const __m128 L = _mm_sqrt_ps(D);
+    return _mm_and_ps(_mm_div_ps(V, L), _mm_cmpgt_ps(L, _mm_setzero_ps()));
+}
+
+static size_t skin_sse(size_t i, size_t end, const SkinWeight* const weights, const uint32_t* const offsets, const float* const handedness,
+    const float* const columns, size_t begin, float* const positions, float* const normals, float* const tangents)
+{
+    for(; i<end; ++i) {
+        __m128 P = _mm_setzero_ps(), N = _mm_setzero_ps(), T = _mm_setzero_ps();
+        for(uint32_t j=offsets[i]; j<offsets[i + 1]; ++j) {
+            const SkinWeight& weight(weights[j]);
+            const float* const c = columns + (weight.joint * 16);
+            const __m128 C0 = _mm_loadu_ps(c + 0), C1 = _mm_loadu_ps(c + 4), C2 = _mm_loadu_ps(c + 8), C3 = _mm_loadu_ps(c + 12);
+            const __m128 W = _mm_set1_ps(weight.weight);
+
+            const __m128 WP = _mm_loadu_ps(weight.position);
+            __m128 R = _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(WP, WP, _MM_SHUFFLE(0, 0, 0, 0)), C0), C3);
+            R = _mm_add_ps(R, _mm_mul_ps(_mm_shuffle_ps(WP, WP, _MM_SHUFFLE(1, 1, 1, 1)), C1));
+            R = _mm_add_ps(R, _mm_mul_ps(_mm_shuffle_ps(WP, WP, _MM_SHUFFLE(2, 2, 2, 2)), C2));
+            P = _mm_add_ps(P, _mm_mul_ps(W, R));
+
+            const __m128 WN = _mm_loadu_ps(weight.normal);
+            R = _mm_mul_ps(_mm_shuffle_ps(WN, WN, _MM_SHUFFLE(0, 0, 0, 0)), C0);
+            R = _mm_add_ps(R, _mm_mul_ps(_mm_shuffle_ps(WN, WN, _MM_SHUFFLE(1, 1, 1, 1)), C1));
+            R = _mm_add_ps(R, _mm_mul_ps(_mm_shuffle_ps(WN, WN, _MM_SHUFFLE(2, 2, 2, 2)), C2));
+            N = _mm_add_ps(N, _mm_mul_ps(W, R));
+
+            const __m128 WT = _mm_loadu_ps(weight.tangent);
+            R = _mm_mul_ps(_mm_shuffle_ps(WT, WT, _MM_SHUFFLE(0, 0, 0, 0)), C0);
+            R = _mm_add_ps(R, _mm_mul_ps(_mm_shuffle_ps(WT, WT, _MM_SHUFFLE(1, 1, 1, 1)), C1));
+            R = _mm_add_ps(R, _mm_mul_ps(_mm_shuffle_ps(WT, WT, _MM_SHUFFLE(2, 2, 2, 2)), C2));
+            T = _mm_add_ps(T, _mm_mul_ps(W, R));
+        }
+
+        const size_t o = (i - begin) * 4;
+        _mm_storeu_ps(positions + o, P);
+        _mm_storeu_ps(normals + o, normalize_sse(N));
+        _mm_storeu_ps(tangents + o, normalize_sse(T));
+        tangents[o + 3] = handedness[i];
+    }
+    return i;
+}
+
+// the position and normal are transformed together, one in each lane
+TARGET_AVX2 static size_t skin_avx2(size_t i, size_t end, const SkinWeight* const weights, const uint32_t* const offsets, const float* const handedness,
+    const float* const columns, size_t begin, float* const positions, float* const normals, float* const tangents)
+{
+    for(; i<end; ++i) {
+        __m256 PN = _mm256_setzero_ps();
+        __m128 T = _mm_setzero_ps();
+        for(uint32_t j=offsets[i]; j<offsets[i + 1]; ++j) {
+            const SkinWeight& weight(weights[j]);
+            const float* const c = columns + (weight.joint * 16);
+            const __m128 C0 = _mm_loadu_ps(c + 0), C1 = _mm_loadu_ps(c + 4), C2 = _mm_loadu_ps(c + 8), C3 = _mm_loadu_ps(c + 12);
+            const __m256 C00 = _mm256_insertf128_ps(_mm256_castps128_ps256(C0), C0, 1);
+            const __m256 C11 = _mm256_insertf128_ps(_mm256_castps128_ps256(C1), C1, 1);
+            const __m256 C22 = _mm256_insertf128_ps(_mm256_castps128_ps256(C2), C2, 1);
+
+            // only the position is translated
+            const __m256 C30 = _mm256_insertf128_ps(_mm256_castps128_ps256(C3), _mm_setzero_ps(), 1);
+
+            // position and normal are next to each other
+            const __m256 V = _mm256_loadu_ps(weight.position);
+            __m256 R = _mm256_fmadd_ps(_mm256_permute_ps(V, 0x00), C00, C30);
+            R = _mm256_fmadd_ps(_mm256_permute_ps(V, 0x55), C11, R);
+            R = _mm256_fmadd_ps(_mm256_permute_ps(V, 0xaa), C22, R);
+            PN = _mm256_fmadd_ps(_mm256_set1_ps(weight.weight), R, PN);
+
+            const __m128 WT = _mm_loadu_ps(weight.tangent);
+            __m128 RT = _mm_mul_ps(_mm_permute_ps(WT, 0x00), C0);
+            RT = _mm_fmadd_ps(_mm_permute_ps(WT, 0x55), C1, RT);
+            RT = _mm_fmadd_ps(_mm_permute_ps(WT, 0xaa), C2, RT);
+            T = _mm_fmadd_ps(_mm_set1_ps(weight.weight), RT, T);
+        }
+
+        const size_t o = (i - begin) * 4;
+        _mm_storeu_ps(positions + o, _mm256_castps256_ps128(PN));
+        _mm_storeu_ps(normals + o, normalize_sse(_mm256_extractf128_ps(PN, 1)));
+        _mm_storeu_ps(tangents + o, normalize_sse(T));
+        tangents[o + 3] = handedness[i];
+    }
+    return i;
+}
+
+// a SkinWeight is one register, the position, normal and tangent are transformed together
+TARGET_AVX512 static size_t skin_avx512(size_t i, size_t end, const SkinWeight* const weights, const uint32_t* const offsets, const float* const handedness,
+    const float* const columns, size_t begin, float* const positions, float* const normals, float* const tangents)
+{
+    for(; i<end; ++i) {
+        __m512 PNT = _mm512_setzero_ps();
+        for(uint32_t j=offsets[i]; j<offsets[i + 1]; ++j) {
+            const SkinWeight& weight(weights[j]);
+            const float* const c = columns + (weight.joint * 16);
+            const __m512 C0 = _mm512_broadcast_f32x4(_mm_loadu_ps(c + 0));
+            const __m512 C1 = _mm512_broadcast_f32x4(_mm_loadu_ps(c + 4));
+            const __m512 C2 = _mm512_broadcast_f32x4(_mm_loadu_ps(c + 8));
+
+            // only the position is translated
+            const __m512 C3 = _mm512_maskz_broadcast_f32x4(0x000f, _mm_loadu_ps(c + 12));
+
+            // the weight and joint are masked off so they don't end up in the math
+            const __m512 V = _mm512_maskz_loadu_ps(0x0fff, weight.position);
+            __m512 R = _mm512_fmadd_ps(_mm512_permute_ps(V, 0x00), C0, C3);
+            R = _mm512_fmadd_ps(_mm512_permute_ps(V, 0x55), C1, R);
+            R = _mm512_fmadd_ps(_mm512_permute_ps(V, 0xaa), C2, R);
+            PNT = _mm512_fmadd_ps(_mm512_set1_ps(weight.weight), R, PNT);
+        }
+
+        const size_t o = (i - begin) * 4;
+        _mm_storeu_ps(positions + o, _mm512_extractf32x4_ps(PNT, 0));
+        _mm_storeu_ps(normals + o, normalize_sse(_mm512_extractf32x4_ps(PNT, 1)));
+        _mm_storeu_ps(tangents + o, normalize_sse(_mm512_extractf32x4_ps(PNT, 2)));
+        tangents[o + 3] = handedness[i];
+    }
+    return i;
+}
+#endif
+
+static void normalize(float* const v)
+{
+    const float length = std::sqrt((v[0] * v[0]) + (v[1] * v[1]) + (v[2] * v[2]));
+    if(length > 0.0f) {
+        v[0] /= length;
+        v[1] /= length;
+        v[2] /= length;
+    }
+}
+
+Skin::Skin(const Vertex* const vertices, size_t vertex_count, const Weight* const weights, size_t weight_count)
+    : _weights(), _offsets(vertex_count + 1, 0), _handedness(vertex_count, 1.0f), _joint_count(0)
+{
+    for(size_t i=0; i<vertex_count; ++i) {
+        const Vertex& vertex(vertices[i]);
+        assert(vertex.weight_start >= 0 && vertex.weight_count >= 0);
+        assert(static_cast<size_t>(vertex.weight_start + vertex.weight_count) <= weight_count);
+        _offsets[i + 1] = _offsets[i] + vertex.weight_count;
+
+        const Vector3 bitangent(vertex.normal ^ vertex.tangent);
+        _handedness[i] = bitangent.opposite_direction(vertex.bitangent) ? -1.0f : 1.0f;
+    }
+
+    _weights.resize(_offsets[vertex_count]);
+    for(size_t i=0; i<vertex_count; ++i) {
+        const Vertex& vertex(vertices[i]);
+        for(int j=0; j<vertex.weight_count; ++j) {
+            const Weight& weight(weights[vertex.weight_start + j]);
+            assert(weight.joint >= 0);
+
+            SkinWeight& skin(_weights[_offsets[i] + j]);
+            std::memset(&skin, 0, sizeof(SkinWeight));
+            skin.position[0] = weight.position.x(); skin.position[1] = weight.position.y(); skin.position[2] = weight.position.z();
+            skin.normal[0] = weight.normal.x(); skin.normal[1] = weight.normal.y(); skin.normal[2] = weight.normal.z();
+            skin.tangent[0] = weight.tangent.x(); skin.tangent[1] = weight.tangent.y(); skin.tangent[2] = weight.tangent.z();
+            skin.weight = weight.weight;
+            skin.joint = static_cast<uint32_t>(weight.joint);
+
+            _joint_count = std::max(_joint_count, static_cast<size_t>(weight.joint) + 1);
+        }
+    }
+}
+
+Skin::~Skin() noexcept
+{
+}
+
+void Skin::skin(const Matrix4* const palette, size_t joint_count, Geometry& geometry, ThreadPool* const pool, size_t start) const
+{
+    assert(joint_count >= _joint_count);
+
+    std::vector<float> columns;
+    matrix_columns(palette, joint_count, columns);
+    skin_geometry(columns.data(), geometry, pool, start);
+}
+
+void Skin::skin(const Quaternion* const orientations, const Position* const positions, size_t joint_count,
+    Geometry& geometry, ThreadPool* const pool, size_t start) const
+{
+    assert(joint_count >= _joint_count);
+
+    std::vector<float> columns;
+    pose_columns(orientations, positions, joint_count, columns);
+    skin_geometry(columns.data(), geometry, pool, start);
+}
+
+void Skin::skin(const Matrix4* const palette, size_t joint_count, float* const positions, float* const normals, float* const tangents,
+    ThreadPool* const pool) const
+{
+    assert(joint_count >= _joint_count);
+
+    std::vector<float> columns;
+    matrix_columns(palette, joint_count, columns);
+
+    auto skin_range = [&](size_t begin, size_t end) {
+        skin_block(columns.data(), begin, end, positions + (begin * 4), normals + (begin * 4), tangents + (begin * 4));
+    };
+
+    if(nullptr != pool && vertex_count() > SKIN_GRAIN) {
+        parallel_for(*pool, 0, vertex_count(), SKIN_GRAIN, skin_range);
+    } else {
+        skin_range(0, vertex_count());
+    }
+}
+
+void Skin::skin_geometry(const float* const columns, Geometry& geometry, ThreadPool* const pool, size_t start) const
+{
+    assert(start + vertex_count() <= geometry.vertex_count());
+
+    // each block is copied out as it's finished so it's still in cache
+    auto skin_range = [&](size_t begin, size_t end) {
+        float positions[BLOCK_VERTICES * 4], normals[BLOCK_VERTICES * 4], tangents[BLOCK_VERTICES * 4];
+        for(size_t i=begin; i<end; i+=BLOCK_VERTICES) {
+            const size_t count = std::min(BLOCK_VERTICES, end - i);
+            skin_block(columns, i, i + count, positions, normals, tangents);
+            geometry.copy_skinned(positions, normals, tangents, count, start + i);
+        }
+    };
+
+    if(nullptr != pool && vertex_count() > SKIN_GRAIN) {
+        parallel_for(*pool, 0, vertex_count(), SKIN_GRAIN, skin_range);
+    } else {
+        skin_range(0, vertex_count());
+    }
+}
+
+void Skin::skin_block(const float* const columns, size_t begin, size_t end, float* const positions, float* const normals, float* const tangents) const
+{
+    const SkinWeight* const weights = _weights.data();
+    const uint32_t* const offsets = _offsets.data();
+    const float* const handedness = _handedness.data();
+
+    size_t i = begin;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, skin, end, weights, offsets, handedness, columns, begin, positions, normals, tangents);
+#endif
+
+    for(; i<end; ++i) {
+        float* const p = positions + ((i - begin) * 4);
+        float* const n = normals + ((i - begin) * 4);
+        float* const t = tangents + ((i - begin) * 4);
+        std::fill(p, p + 4, 0.0f);
+        std::fill(n, n + 4, 0.0f);
+        std::fill(t, t + 4, 0.0f);
+
+        for(uint32_t j=offsets[i]; j<offsets[i + 1]; ++j) {
+            const SkinWeight& weight(weights[j]);
+            const float* const c = columns + (weight.joint * 16);
+            for(size_t k=0; k<3; ++k) {
+                p[k] += weight.weight * ((c[k] * weight.position[0]) + (c[4 + k] * weight.position[1]) + (c[8 + k] * weight.position[2]) + c[12 + k]);
+                n[k] += weight.weight * ((c[k] * weight.normal[0]) + (c[4 + k] * weight.normal[1]) + (c[8 + k] * weight.normal[2]));
+                t[k] += weight.weight * ((c[k] * weight.tangent[0]) + (c[4 + k] * weight.tangent[1]) + (c[8 + k] * weight.tangent[2]));
+            }
+        }
+
+        normalize(n);
+        normalize(t);
+        t[3] = handedness[i];
+    }
+}
+
+}
+
+#if defined WITH_UNIT_TESTS
+#include "src/test/UnitTest.h"
+#include "src/test/TestThreadPool.h"
+
+class SkinTest : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(SkinTest);
+        CPPUNIT_TEST(test_bind_pose);
+        CPPUNIT_TEST(test_reference);
+        CPPUNIT_TEST(test_pose);
+        CPPUNIT_TEST(test_geometry);
+        CPPUNIT_TEST(test_parallel);
+    CPPUNIT_TEST_SUITE_END();
+
+private:
+    // a strip of vertices along x, each weighted between 2 of 3 joints
+    struct Model
+    {
+        std::vector<energonsoftware::Vertex> vertices;
+        std::vector<energonsoftware::Weight> weights;
+
+        Model() : vertices(), weights() {}
+    };
+
+public:
+    SkinTest() : CppUnit::TestFixture() {}
+    virtual ~SkinTest() noexcept {}
+
+public:
+    void tearDown() override
+    {
+        energonsoftware::set_simd_level(energonsoftware::detected_simd_level());
+    }
+
+    void test_bind_pose()
+    {
+        Model model;
+        build_model(model, 10);
+
+        energonsoftware::Skin skin(model.vertices.data(), model.vertices.size(), model.weights.data(), model.weights.size());
+        CPPUNIT_ASSERT_EQUAL(model.vertices.size(), skin.vertex_count());
+        CPPUNIT_ASSERT_EQUAL(model.weights.size(), skin.weight_count());
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(3), skin.joint_count());
+
+        // the joints are at their bind positions
+        const energonsoftware::Matrix4 palette[3] = { translation(0.0f), translation(1.0f), translation(2.0f) };
+        for(energonsoftware::SimdLevel level : energonsoftware::supported_simd_levels()) {
+            energonsoftware::set_simd_level(level);
+
+            Outputs outputs(skin.vertex_count());
+            skin.skin(palette, 3, outputs.positions.data(), outputs.normals.data(), outputs.tangents.data());
+            for(size_t i=0; i<skin.vertex_count(); ++i) {
+                const energonsoftware::Vertex& vertex(model.vertices[i]);
+                assert_vector(vertex.position, outputs.position(i));
+                assert_vector(vertex.normal, outputs.normal(i));
+                assert_vector(vertex.tangent, outputs.tangent(i));
+                CPPUNIT_ASSERT_EQUAL(1.0f, outputs.tangents[(i * 4) + 3]);
+            }
+        }
+    }
+
+    void test_reference()
+    {
+        Model model;
+        build_model(model, 37);
+        energonsoftware::Skin skin(model.vertices.data(), model.vertices.size(), model.weights.data(), model.weights.size());
+
+        energonsoftware::Matrix4 palette[3];
+        build_palette(palette);
+
+        // straight off of the Weights
+        for(energonsoftware::SimdLevel level : energonsoftware::supported_simd_levels()) {
+            energonsoftware::set_simd_level(level);
+
+            Outputs outputs(skin.vertex_count());
+            skin.skin(palette, 3, outputs.positions.data(), outputs.normals.data(), outputs.tangents.data());
+            for(size_t i=0; i<skin.vertex_count(); ++i) {
+                const energonsoftware::Vertex& vertex(model.vertices[i]);
+
+                energonsoftware::Vector3 position, normal, tangent;
+                for(int j=0; j<vertex.weight_count; ++j) {
+                    const energonsoftware::Weight& weight(model.weights[vertex.weight_start + j]);
+                    const energonsoftware::Matrix4& m(palette[weight.joint]);
+                    position += weight.weight * transform(m, weight.position, 1.0f);
+                    normal += weight.weight * transform(m, weight.normal, 0.0f);
+                    tangent += weight.weight * transform(m, weight.tangent, 0.0f);
+                }
+
+                assert_vector(position, outputs.position(i));
+                assert_vector(normal / normal.length(), outputs.normal(i));
+                assert_vector(tangent / tangent.length(), outputs.tangent(i));
+            }
+        }
+    }
+
+    void test_pose()
+    {
+        Model model;
+        build_model(model, 12);
+        energonsoftware::Skin skin(model.vertices.data(), model.vertices.size(), model.weights.data(), model.weights.size());
+
+        const energonsoftware::Quaternion orientations[3] = {
+            energonsoftware::Quaternion::new_axis(0.0f, energonsoftware::Vector::ZAXIS),
+            energonsoftware::Quaternion::new_axis(0.5f, energonsoftware::Vector::ZAXIS),
+            energonsoftware::Quaternion::new_axis(-0.75f, energonsoftware::Vector::YAXIS),
+        };
+        const energonsoftware::Position positions[3] = {
+            energonsoftware::Position(0.0f, 0.0f, 0.0f),
+            energonsoftware::Position(1.0f, 0.5f, 0.0f),
+            energonsoftware::Position(2.0f, 1.0f, -1.0f),
+        };
+
+        // the same pose as matrices built from the quaternions
+        energonsoftware::Matrix4 palette[3];
+        for(size_t i=0; i<3; ++i) {
+            const energonsoftware::Vector3 x(orientations[i] * energonsoftware::Vector::XAXIS);
+            const energonsoftware::Vector3 y(orientations[i] * energonsoftware::Vector::YAXIS);
+            const energonsoftware::Vector3 z(orientations[i] * energonsoftware::Vector::ZAXIS);
+            palette[i] = energonsoftware::Matrix4({
+                x.x(), y.x(), z.x(), positions[i].x(),
+                x.y(), y.y(), z.y(), positions[i].y(),
+                x.z(), y.z(), z.z(), positions[i].z(),
+                0.0f, 0.0f, 0.0f, 1.0f
+            });
+        }
+
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::System, 50 * 1024));
+        energonsoftware::Geometry g(skin.vertex_count(), *allocator);
+        skin.skin(orientations, positions, 3, g);
+
+        Outputs outputs(skin.vertex_count());
+        skin.skin(palette, 3, outputs.positions.data(), outputs.normals.data(), outputs.tangents.data());
+        for(size_t i=0; i<skin.vertex_count(); ++i) {
+            const float* const p = g.vertex_buffer() + (i * 3);
+            assert_vector(outputs.position(i), energonsoftware::Vector3(p[0], p[1], p[2]));
+        }
+    }
+
+    void test_geometry()
+    {
+        Model model;
+        build_model(model, 300);
+        energonsoftware::Skin skin(model.vertices.data(), model.vertices.size(), model.weights.data(), model.weights.size());
+
+        energonsoftware::Matrix4 palette[3];
+        build_palette(palette);
+
+        Outputs outputs(skin.vertex_count());
+        skin.skin(palette, 3, outputs.positions.data(), outputs.normals.data(), outputs.tangents.data());
+
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::System, 256 * 1024));
+        for(energonsoftware::VertexLayout layout : { energonsoftware::VertexLayout::Separate, energonsoftware::VertexLayout::Interleaved }) {
+            // after a couple of other vertices
+            energonsoftware::Geometry skinned(skin.vertex_count() + 2, *allocator, layout);
+            skin.skin(palette, 3, skinned, nullptr, 2);
+
+            for(size_t i=0; i<skin.vertex_count(); ++i) {
+                const float *p = nullptr, *n = nullptr, *t = nullptr;
+                if(energonsoftware::VertexLayout::Separate == layout) {
+                    p = skinned.vertex_buffer() + ((i + 2) * 3);
+                    n = skinned.normal_buffer() + ((i + 2) * 3);
+                    t = skinned.tangent_buffer() + ((i + 2) * 4);
+                } else {
+                    const energonsoftware::PackedVertex& packed(reinterpret_cast<const energonsoftware::PackedVertex*>(skinned.interleaved_buffer())[i + 2]);
+                    p = packed.position;
+                    n = packed.normal;
+                    t = packed.tangent;
+                }
+
+                for(size_t k=0; k<3; ++k) {
+                    CPPUNIT_ASSERT_EQUAL(outputs.positions[(i * 4) + k], p[k]);
+                    CPPUNIT_ASSERT_EQUAL(outputs.normals[(i * 4) + k], n[k]);
+                    CPPUNIT_ASSERT_EQUAL(outputs.tangents[(i * 4) + k], t[k]);
+                }
+                CPPUNIT_ASSERT_EQUAL(1.0f, t[3]);
+            }
+        }
+    }
+
+    void test_parallel()
+    {
+        energonsoftware::ThreadPool pool(4);
+        pool.start(TestThreadFactory());
+
+        Model model;
+        build_model(model, 20000);
+        energonsoftware::Skin skin(model.vertices.data(), model.vertices.size(), model.weights.data(), model.weights.size());
+
+        energonsoftware::Matrix4 palette[3];
+        build_palette(palette);
+
+        Outputs serial(skin.vertex_count()), parallel(skin.vertex_count());
+        skin.skin(palette, 3, serial.positions.data(), serial.normals.data(), serial.tangents.data());
+        skin.skin(palette, 3, parallel.positions.data(), parallel.normals.data(), parallel.tangents.data(), &pool);
+
+        // every vertex is skinned the same way no matter which thread does it
+        CPPUNIT_ASSERT(serial.positions == parallel.positions);
+        CPPUNIT_ASSERT(serial.normals == parallel.normals);
+        CPPUNIT_ASSERT(serial.tangents == parallel.tangents);
+
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::System, 1024 * 1024));
+        energonsoftware::Geometry g(skin.vertex_count(), *allocator);
+        skin.skin(palette, 3, g, &pool);
+        for(size_t i=0; i<skin.vertex_count(); i+=97) {
+            CPPUNIT_ASSERT_EQUAL(serial.positions[(i * 4) + 1], g.vertex_buffer()[(i * 3) + 1]);
+        }
+
+        pool.stop();
+    }
+
+private:
+    struct Outputs
+    {
+        std::vector<float> positions, normals, tangents;
+
+        explicit Outputs(size_t count) : positions(count * 4), normals(count * 4), tangents(count * 4) {}
+
+        energonsoftware::Vector3 position(size_t i) const { return energonsoftware::Vector3(positions[i * 4], positions[(i * 4) + 1], positions[(i * 4) + 2]); }
+        energonsoftware::Vector3 normal(size_t i) const { return energonsoftware::Vector3(normals[i * 4], normals[(i * 4) + 1], normals[(i * 4) + 2]); }
+        energonsoftware::Vector3 tangent(size_t i) const { return energonsoftware::Vector3(tangents[i * 4], tangents[(i * 4) + 1], tangents[(i * 4) + 2]); }
+    };
+
+    static energonsoftware::Matrix4 translation(float x)
+    {
+        energonsoftware::Matrix4 m;
+        m[3] = x;
+        return m;
+    }
+
+    static energonsoftware::Vector3 transform(const energonsoftware::Matrix4& m, const energonsoftware::Vector3& v, float w)
+    {
+        return energonsoftware::Vector3(
+            (m[0] * v.x()) + (m[1] * v.y()) + (m[2] * v.z()) + (m[3] * w),
+            (m[4] * v.x()) + (m[5] * v.y()) + (m[6] * v.z()) + (m[7] * w),
+            (m[8] * v.x()) + (m[9] * v.y()) + (m[10] * v.z()) + (m[11] * w));
+    }
+
+    static void build_palette(energonsoftware::Matrix4* const palette)
+    {
+        palette[0] = translation(0.0f);
+        palette[1] = translation(1.0f);
+        palette[1].rotate(0.5f, energonsoftware::Vector::ZAXIS);
+        palette[2] = translation(2.5f);
+        palette[2].rotate(-0.75f, energonsoftware::Vector::YAXIS);
+    }
+
+    // the joints sit at x = 0, 1 and 2 and each vertex is
+    // weighted between the two joints nearest to it
+    static void build_model(Model& model, size_t count)
+    {
+        model.vertices.resize(count);
+        model.weights.clear();
+        for(size_t i=0; i<count; ++i) {
+            const float x = (2.0f * i) / std::max<size_t>(count - 1, 1);
+
+            energonsoftware::Vertex& vertex(model.vertices[i]);
+            vertex.index = static_cast<int>(i);
+            vertex.position = energonsoftware::Position(x, 0.25f * (i % 3), 0.1f);
+            vertex.normal = energonsoftware::Vector3(0.0f, 0.6f, 0.8f);
+            vertex.tangent = energonsoftware::Vector3(1.0f, 0.0f, 0.0f);
+            vertex.bitangent = vertex.normal ^ vertex.tangent;
+            vertex.weight_start = static_cast<int>(model.weights.size());
+
+            const int joint = std::min(static_cast<int>(x), 1);
+            const float blend = std::min(x - joint, 1.0f);
+            for(int j=0; j<2; ++j) {
+                energonsoftware::Weight weight;
+                weight.index = static_cast<int>(model.weights.size());
+                weight.joint = joint + j;
+                weight.weight = 0 == j ? 1.0f - blend : blend;
+
+                // in the joint's space
+                weight.position = vertex.position - energonsoftware::Position(static_cast<float>(weight.joint), 0.0f, 0.0f);
+                weight.normal = vertex.normal;
+                weight.tangent = vertex.tangent;
+                weight.bitangent = vertex.bitangent;
+                model.weights.push_back(weight);
+            }
+            vertex.weight_count = 2;
+        }
+    }
+
+    void assert_vector(const energonsoftware::Vector3& expected, const energonsoftware::Vector3& actual)
+    {
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.x(), actual.x(), 0.0001f);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.y(), actual.y(), 0.0001f);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.z(), actual.z(), 0.0001f);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(SkinTest);
+
+#endif
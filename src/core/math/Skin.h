@@ -0,0 +1,85 @@
+#if !defined __SKIN_H__
+#define __SKIN_H__
+
+#include "Geometry.h"
+#include "Matrix4.h"
+#include "Quaternion.h"
+
+namespace energonsoftware {
+
+class ThreadPool;
+
+// a Weight flattened out for Skin, sized so that the vectors can be loaded directly
+struct SkinWeight
+{
+    float position[4];
+    float normal[4];
+    float tangent[4];
+    float weight;
+    uint32_t joint;
+    uint32_t padding[2];
+};
+
+/*
+CPU skinning.
+
+Each vertex is the weighted sum of its Weights (Vertex::weight_start and
+Vertex::weight_count index the weight array) with each Weight's position,
+normal and tangent being in the space of its joint (the MD5 convention),
+so the joint palette is just each joint's current (model space) transform.
+Normals and tangents are renormalized after they're summed.
+
+A Skin flattens the weights out in vertex order when it's built so that
+skinning a vertex walks through its weights in memory order.
+*/
+class Skin
+{
+public:
+    Skin(const Vertex* const vertices, size_t vertex_count, const Weight* const weights, size_t weight_count);
+    virtual ~Skin() noexcept;
+
+public:
+    size_t vertex_count() const { return _offsets.size() - 1; }
+    size_t weight_count() const { return _weights.size(); }
+
+    // the palette needs at least this many joints
+    size_t joint_count() const { return _joint_count; }
+
+    // skins every vertex into geometry, starting at geometry vertex start,
+    // the palette is a model space transform for each joint
+    // NOTE: the normals are rotated by the palette as is, so it shouldn't scale
+    void skin(const Matrix4* const palette, size_t joint_count, Geometry& geometry, ThreadPool* const pool=nullptr, size_t start=0) const;
+
+    // the palette as a (normalized) orientation and a position for each joint
+    void skin(const Quaternion* const orientations, const Position* const positions, size_t joint_count,
+        Geometry& geometry, ThreadPool* const pool=nullptr, size_t start=0) const;
+
+    // skins into plain arrays of 4 floats per vertex (positions w is 0,
+    // tangents w is the bitangent handedness) for callers that don't need a Geometry
+    void skin(const Matrix4* const palette, size_t joint_count, float* const positions, float* const normals, float* const tangents,
+        ThreadPool* const pool=nullptr) const;
+
+private:
+    // columns is 16 floats per joint, the joint matrix's columns (see Skin.cc)
+    void skin_geometry(const float* const columns, Geometry& geometry, ThreadPool* const pool, size_t start) const;
+    void skin_block(const float* const columns, size_t begin, size_t end, float* const positions, float* const normals, float* const tangents) const;
+
+private:
+    std::vector<SkinWeight> _weights;
+
+    // vertex i's weights are [_offsets[i], _offsets[i + 1])
+    std::vector<uint32_t> _offsets;
+
+    // the bitangent handedness of each vertex, this doesn't change with the pose
+    std::vector<float> _handedness;
+
+    size_t _joint_count;
+
+private:
+    Skin() = delete;
+    DISALLOW_COPY_AND_ASSIGN(Skin);
+};
+
+}
+
+#endif
@@ -1,6 +1,7 @@
 #if !defined __VECTOR_H__
 #define __VECTOR_H__
 
+#include "fast_math.h"
 #include "math_util.h"
 
 namespace energonsoftware {
@@ -173,6 +174,12 @@ public:
     Vector& normalize() { return (*this) *= invsqrt(length_squared()); }
     Vector normalized() const { return (*this) * invsqrt(length_squared()); }
 
+    // the plain versions above use the raw rsqrt estimate (about 12 bits),
+    // these let the call site pick (see fast_math.h)
+    float length(Precision precision) const { return sqrt_p(length_squared(), precision); }
+    Vector& normalize(Precision precision) { return (*this) *= rsqrt_p(length_squared(), precision); }
+    Vector normalized(Precision precision) const { return (*this) * rsqrt_p(length_squared(), precision); }
+
     // TODO: this probably should use an epsilon
     bool perpendicular(const Vector& rhs) const { return (*this) * rhs == 0.0f; }
 
@@ -190,6 +197,7 @@ public:
     }
 
     float distance(const Vector& other) const { return (other - (*this)).length(); }
+    float distance(const Vector& other, Precision precision) const { return (other - (*this)).length(precision); }
     float distance_squared(const Vector& other) const { return (other - (*this)).length_squared(); }
 
     // angle wrt the x/y plane
@@ -0,0 +1,1115 @@
+#include "src/pch.h"
+#include "src/core/util/cpu_util.h"
+#include "Vector4Batch.h"
+
+namespace energonsoftware {
+
+/*
+Kernels.
+
+Each kernel takes the index to start at and handles as many whole registers
+as it can from there, returning the index of the first vector it didn't get to
+(see SIMD_DISPATCH in cpu_util.h).
+*/
+
+#if defined USE_SSE
+// SSE3
+static size_t dot_sse(size_t i, const float* x, const float* y, const float* z, const float* w, size_t count, const float* v, float* out)
+{
+    const __m128 VX = _mm_set1_ps(v[0]), VY = _mm_set1_ps(v[1]), VZ = _mm_set1_ps(v[2]), VW = _mm_set1_ps(v[3]);
+    for(; i + 4 <= count; i += 4) {
+        __m128 R = _mm_mul_ps(_mm_load_ps(x + i), VX);
+        R = _mm_add_ps(R, _mm_mul_ps(_mm_load_ps(y + i), VY));
+        R = _mm_add_ps(R, _mm_mul_ps(_mm_load_ps(z + i), VZ));
+        R = _mm_add_ps(R, _mm_mul_ps(_mm_load_ps(w + i), VW));
+        _mm_storeu_ps(out + i, R);
+    }
+    return i;
+}
+
+static size_t dot_sse(size_t i, const float* x, const float* y, const float* z, const float* w, size_t count,
+    const float* rx, const float* ry, const float* rz, const float* rw, float* out)
+{
+    for(; i + 4 <= count; i += 4) {
+        __m128 R = _mm_mul_ps(_mm_load_ps(x + i), _mm_load_ps(rx + i));
+        R = _mm_add_ps(R, _mm_mul_ps(_mm_load_ps(y + i), _mm_load_ps(ry + i)));
+        R = _mm_add_ps(R, _mm_mul_ps(_mm_load_ps(z + i), _mm_load_ps(rz + i)));
+        R = _mm_add_ps(R, _mm_mul_ps(_mm_load_ps(w + i), _mm_load_ps(rw + i)));
+        _mm_storeu_ps(out + i, R);
+    }
+    return i;
+}
+
+static size_t sqrt_sse(size_t i, float* values, size_t count)
+{
+    for(; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(values + i, _mm_sqrt_ps(_mm_loadu_ps(values + i)));
+    }
+    return i;
+}
+
+static size_t normalize_sse(size_t i, float* x, float* y, float* z, float* w, size_t count)
+{
+    const __m128 ZERO = _mm_setzero_ps(), HALF = _mm_set1_ps(0.5f), THREE_HALVES = _mm_set1_ps(1.5f);
+    for(; i + 4 <= count; i += 4) {
+        const __m128 X = _mm_load_ps(x + i), Y = _mm_load_ps(y + i), Z = _mm_load_ps(z + i), W = _mm_load_ps(w + i);
+        __m128 L = _mm_add_ps(_mm_mul_ps(X, X), _mm_mul_ps(Y, Y));
+        L = _mm_add_ps(L, _mm_add_ps(_mm_mul_ps(Z, Z), _mm_mul_ps(W, W)));
+
+        // rsqrt is only good to about 12 bits,
+        // one Newton-Raphson step gets that up to about 22
+        __m128 S = _mm_rsqrt_ps(L);
+        S = _mm_mul_ps(S, _mm_sub_ps(THREE_HALVES, _mm_mul_ps(_mm_mul_ps(HALF, L), _mm_mul_ps(S, S))));
+
+        // zero length vectors get a scale of 0 rather than NaN (leaving them at zero)
+        S = _mm_and_ps(S, _mm_cmpgt_ps(L, ZERO));
+
+        _mm_store_ps(x + i, _mm_mul_ps(X, S));
+        _mm_store_ps(y + i, _mm_mul_ps(Y, S));
+        _mm_store_ps(z + i, _mm_mul_ps(Z, S));
+        _mm_store_ps(w + i, _mm_mul_ps(W, S));
+    }
+    return i;
+}
+
+static size_t distance_squared_sse(size_t i, const float* x, const float* y, const float* z, size_t count, const float* p, float* out)
+{
+    const __m128 PX = _mm_set1_ps(p[0]), PY = _mm_set1_ps(p[1]), PZ = _mm_set1_ps(p[2]);
+    for(; i + 4 <= count; i += 4) {
+        const __m128 DX = _mm_sub_ps(_mm_load_ps(x + i), PX);
+        const __m128 DY = _mm_sub_ps(_mm_load_ps(y + i), PY);
+        const __m128 DZ = _mm_sub_ps(_mm_load_ps(z + i), PZ);
+        const __m128 R = _mm_add_ps(_mm_mul_ps(DX, DX), _mm_mul_ps(DY, DY));
+        _mm_storeu_ps(out + i, _mm_add_ps(R, _mm_mul_ps(DZ, DZ)));
+    }
+    return i;
+}
+
+static size_t transform_sse(size_t i, const float* x, const float* y, const float* z, const float* w, size_t count,
+    const float* m, float* ox, float* oy, float* oz, float* ow)
+{
+    // splat the matrix once rather than per vector
+    __m128 M[16];
+    for(int j=0; j<16; ++j) {
+        M[j] = _mm_set1_ps(m[j]);
+    }
+
+    float* const out[4] = { ox, oy, oz, ow };
+    for(; i + 4 <= count; i += 4) {
+        const __m128 X = _mm_load_ps(x + i), Y = _mm_load_ps(y + i), Z = _mm_load_ps(z + i), W = _mm_load_ps(w + i);
+
+        // the output may be the input, so read everything before writing
+        __m128 R[4];
+        for(int r=0; r<4; ++r) {
+            R[r] = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(M[(r * 4) + 0], X), _mm_mul_ps(M[(r * 4) + 1], Y)),
+                _mm_add_ps(_mm_mul_ps(M[(r * 4) + 2], Z), _mm_mul_ps(M[(r * 4) + 3], W)));
+        }
+        for(int r=0; r<4; ++r) {
+            _mm_store_ps(out[r] + i, R[r]);
+        }
+    }
+    return i;
+}
+
+static size_t rotate_sse(size_t i, float* x, float* y, float* z, size_t count, const float* u, float s)
+{
+    const __m128 UX = _mm_set1_ps(u[0]), UY = _mm_set1_ps(u[1]), UZ = _mm_set1_ps(u[2]);
+    const __m128 S = _mm_set1_ps(s), TWO = _mm_set1_ps(2.0f);
+    for(; i + 4 <= count; i += 4) {
+        const __m128 X = _mm_load_ps(x + i), Y = _mm_load_ps(y + i), Z = _mm_load_ps(z + i);
+
+        const __m128 TX = _mm_mul_ps(TWO, _mm_sub_ps(_mm_mul_ps(UY, Z), _mm_mul_ps(UZ, Y)));
+        const __m128 TY = _mm_mul_ps(TWO, _mm_sub_ps(_mm_mul_ps(UZ, X), _mm_mul_ps(UX, Z)));
+        const __m128 TZ = _mm_mul_ps(TWO, _mm_sub_ps(_mm_mul_ps(UX, Y), _mm_mul_ps(UY, X)));
+
+        _mm_store_ps(x + i, _mm_add_ps(_mm_add_ps(X, _mm_mul_ps(S, TX)), _mm_sub_ps(_mm_mul_ps(UY, TZ), _mm_mul_ps(UZ, TY))));
+        _mm_store_ps(y + i, _mm_add_ps(_mm_add_ps(Y, _mm_mul_ps(S, TY)), _mm_sub_ps(_mm_mul_ps(UZ, TX), _mm_mul_ps(UX, TZ))));
+        _mm_store_ps(z + i, _mm_add_ps(_mm_add_ps(Z, _mm_mul_ps(S, TZ)), _mm_sub_ps(_mm_mul_ps(UX, TY), _mm_mul_ps(UY, TX))));
+    }
+    return i;
+}
+
+static void store_mask(int bits, size_t count, unsigned char* out)
+{
+    for(size_t j=0; j<count; ++j) {
+        out[j] = (bits >> j) & 1;
+    }
+}
+
+static size_t inside_sphere_sse(size_t i, const float* x, const float* y, const float* z, size_t count,
+    const float* center, float radius_squared, unsigned char* out)
+{
+    const __m128 CX = _mm_set1_ps(center[0]), CY = _mm_set1_ps(center[1]), CZ = _mm_set1_ps(center[2]);
+    const __m128 R2 = _mm_set1_ps(radius_squared);
+    for(; i + 4 <= count; i += 4) {
+        const __m128 DX = _mm_sub_ps(_mm_load_ps(x + i), CX);
+        const __m128 DY = _mm_sub_ps(_mm_load_ps(y + i), CY);
+        const __m128 DZ = _mm_sub_ps(_mm_load_ps(z + i), CZ);
+        const __m128 D = _mm_add_ps(_mm_add_ps(_mm_mul_ps(DX, DX), _mm_mul_ps(DY, DY)), _mm_mul_ps(DZ, DZ));
+        store_mask(_mm_movemask_ps(_mm_cmple_ps(D, R2)), 4, out + i);
+    }
+    return i;
+}
+
+static size_t inside_box_sse(size_t i, const float* x, const float* y, const float* z, size_t count,
+    const float* minimum, const float* maximum, unsigned char* out)
+{
+    const __m128 MINX = _mm_set1_ps(minimum[0]), MINY = _mm_set1_ps(minimum[1]), MINZ = _mm_set1_ps(minimum[2]);
+    const __m128 MAXX = _mm_set1_ps(maximum[0]), MAXY = _mm_set1_ps(maximum[1]), MAXZ = _mm_set1_ps(maximum[2]);
+    for(; i + 4 <= count; i += 4) {
+        const __m128 X = _mm_load_ps(x + i), Y = _mm_load_ps(y + i), Z = _mm_load_ps(z + i);
+        __m128 M = _mm_and_ps(_mm_cmpge_ps(X, MINX), _mm_cmple_ps(X, MAXX));
+        M = _mm_and_ps(M, _mm_and_ps(_mm_cmpge_ps(Y, MINY), _mm_cmple_ps(Y, MAXY)));
+        M = _mm_and_ps(M, _mm_and_ps(_mm_cmpge_ps(Z, MINZ), _mm_cmple_ps(Z, MAXZ)));
+        store_mask(_mm_movemask_ps(M), 4, out + i);
+    }
+    return i;
+}
+
+// AVX2
+TARGET_AVX2 static size_t dot_avx2(size_t i, const float* x, const float* y, const float* z, const float* w, size_t count, const float* v, float* out)
+{
+    const __m256 VX = _mm256_set1_ps(v[0]), VY = _mm256_set1_ps(v[1]), VZ = _mm256_set1_ps(v[2]), VW = _mm256_set1_ps(v[3]);
+    for(; i + 8 <= count; i += 8) {
+        __m256 R = _mm256_mul_ps(_mm256_load_ps(x + i), VX);
+        R = _mm256_fmadd_ps(_mm256_load_ps(y + i), VY, R);
+        R = _mm256_fmadd_ps(_mm256_load_ps(z + i), VZ, R);
+        R = _mm256_fmadd_ps(_mm256_load_ps(w + i), VW, R);
+        _mm256_storeu_ps(out + i, R);
+    }
+    return i;
+}
+
+TARGET_AVX2 static size_t dot_avx2(size_t i, const float* x, const float* y, const float* z, const float* w, size_t count,
+    const float* rx, const float* ry, const float* rz, const float* rw, float* out)
+{
+    for(; i + 8 <= count; i += 8) {
+        __m256 R = _mm256_mul_ps(_mm256_load_ps(x + i), _mm256_load_ps(rx + i));
+        R = _mm256_fmadd_ps(_mm256_load_ps(y + i), _mm256_load_ps(ry + i), R);
+        R = _mm256_fmadd_ps(_mm256_load_ps(z + i), _mm256_load_ps(rz + i), R);
+        R = _mm256_fmadd_ps(_mm256_load_ps(w + i), _mm256_load_ps(rw + i), R);
+        _mm256_storeu_ps(out + i, R);
+    }
+    return i;
+}
+
+TARGET_AVX2 static size_t sqrt_avx2(size_t i, float* values, size_t count)
+{
+    for(; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(values + i, _mm256_sqrt_ps(_mm256_loadu_ps(values + i)));
+    }
+    return i;
+}
+
+TARGET_AVX2 static size_t normalize_avx2(size_t i, float* x, float* y, float* z, float* w, size_t count)
+{
+    const __m256 ZERO = _mm256_setzero_ps(), HALF = _mm256_set1_ps(0.5f), THREE_HALVES = _mm256_set1_ps(1.5f);
+    for(; i + 8 <= count; i += 8) {
+        const __m256 X = _mm256_load_ps(x + i), Y = _mm256_load_ps(y + i), Z = _mm256_load_ps(z + i), W = _mm256_load_ps(w + i);
+        __m256 L = _mm256_mul_ps(X, X);
+        L = _mm256_fmadd_ps(Y, Y, L);
+        L = _mm256_fmadd_ps(Z, Z, L);
+        L = _mm256_fmadd_ps(W, W, L);
+
+        __m256 S = _mm256_rsqrt_ps(L);
+        S = _mm256_mul_ps(S, _mm256_fnmadd_ps(_mm256_mul_ps(HALF, L), _mm256_mul_ps(S, S), THREE_HALVES));
+        S = _mm256_and_ps(S, _mm256_cmp_ps(L, ZERO, _CMP_GT_OQ));
+
+        _mm256_store_ps(x + i, _mm256_mul_ps(X, S));
+        _mm256_store_ps(y + i, _mm256_mul_ps(Y, S));
+        _mm256_store_ps(z + i, _mm256_mul_ps(Z, S));
+        _mm256_store_ps(w + i, _mm256_mul_ps(W, S));
+    }
+    return i;
+}
+
+TARGET_AVX2 static size_t distance_squared_avx2(size_t i, const float* x, const float* y, const float* z, size_t count, const float* p, float* out)
+{
+    const __m256 PX = _mm256_set1_ps(p[0]), PY = _mm256_set1_ps(p[1]), PZ = _mm256_set1_ps(p[2]);
+    for(; i + 8 <= count; i += 8) {
+        const __m256 DX = _mm256_sub_ps(_mm256_load_ps(x + i), PX);
+        const __m256 DY = _mm256_sub_ps(_mm256_load_ps(y + i), PY);
+        const __m256 DZ = _mm256_sub_ps(_mm256_load_ps(z + i), PZ);
+        _mm256_storeu_ps(out + i, _mm256_fmadd_ps(DZ, DZ, _mm256_fmadd_ps(DY, DY, _mm256_mul_ps(DX, DX))));
+    }
+    return i;
+}
+
+TARGET_AVX2 static size_t transform_avx2(size_t i, const float* x, const float* y, const float* z, const float* w, size_t count,
+    const float* m, float* ox, float* oy, float* oz, float* ow)
+{
+    __m256 M[16];
+    for(int j=0; j<16; ++j) {
+        M[j] = _mm256_set1_ps(m[j]);
+    }
+
+    float* const out[4] = { ox, oy, oz, ow };
+    for(; i + 8 <= count; i += 8) {
+        const __m256 X = _mm256_load_ps(x + i), Y = _mm256_load_ps(y + i), Z = _mm256_load_ps(z + i), W = _mm256_load_ps(w + i);
+
+        __m256 R[4];
+        for(int r=0; r<4; ++r) {
+            R[r] = _mm256_mul_ps(M[(r * 4) + 0], X);
+            R[r] = _mm256_fmadd_ps(M[(r * 4) + 1], Y, R[r]);
+            R[r] = _mm256_fmadd_ps(M[(r * 4) + 2], Z, R[r]);
+            R[r] = _mm256_fmadd_ps(M[(r * 4) + 3], W, R[r]);
+        }
+        for(int r=0; r<4; ++r) {
+            _mm256_store_ps(out[r] + i, R[r]);
+        }
+    }
+    return i;
+}
+
+TARGET_AVX2 static size_t rotate_avx2(size_t i, float* x, float* y, float* z, size_t count, const float* u, float s)
+{
+    const __m256 UX = _mm256_set1_ps(u[0]), UY = _mm256_set1_ps(u[1]), UZ = _mm256_set1_ps(u[2]);
+    const __m256 S = _mm256_set1_ps(s), TWO = _mm256_set1_ps(2.0f);
+    for(; i + 8 <= count; i += 8) {
+        const __m256 X = _mm256_load_ps(x + i), Y = _mm256_load_ps(y + i), Z = _mm256_load_ps(z + i);
+
+        const __m256 TX = _mm256_mul_ps(TWO, _mm256_fmsub_ps(UY, Z, _mm256_mul_ps(UZ, Y)));
+        const __m256 TY = _mm256_mul_ps(TWO, _mm256_fmsub_ps(UZ, X, _mm256_mul_ps(UX, Z)));
+        const __m256 TZ = _mm256_mul_ps(TWO, _mm256_fmsub_ps(UX, Y, _mm256_mul_ps(UY, X)));
+
+        _mm256_store_ps(x + i, _mm256_add_ps(_mm256_fmadd_ps(S, TX, X), _mm256_fmsub_ps(UY, TZ, _mm256_mul_ps(UZ, TY))));
+        _mm256_store_ps(y + i, _mm256_add_ps(_mm256_fmadd_ps(S, TY, Y), _mm256_fmsub_ps(UZ, TX, _mm256_mul_ps(UX, TZ))));
+        _mm256_store_ps(z + i, _mm256_add_ps(_mm256_fmadd_ps(S, TZ, Z), _mm256_fmsub_ps(UX, TY, _mm256_mul_ps(UY, TX))));
+    }
+    return i;
+}
+
+TARGET_AVX2 static size_t inside_sphere_avx2(size_t i, const float* x, const float* y, const float* z, size_t count,
+    const float* center, float radius_squared, unsigned char* out)
+{
+    const __m256 CX = _mm256_set1_ps(center[0]), CY = _mm256_set1_ps(center[1]), CZ = _mm256_set1_ps(center[2]);
+    const __m256 R2 = _mm256_set1_ps(radius_squared);
+    for(; i + 8 <= count; i += 8) {
+        const __m256 DX = _mm256_sub_ps(_mm256_load_ps(x + i), CX);
+        const __m256 DY = _mm256_sub_ps(_mm256_load_ps(y + i), CY);
+        const __m256 DZ = _mm256_sub_ps(_mm256_load_ps(z + i), CZ);
+        const __m256 D = _mm256_fmadd_ps(DZ, DZ, _mm256_fmadd_ps(DY, DY, _mm256_mul_ps(DX, DX)));
+        store_mask(_mm256_movemask_ps(_mm256_cmp_ps(D, R2, _CMP_LE_OQ)), 8, out + i);
+    }
+    return i;
+}
+
+TARGET_AVX2 static size_t inside_box_avx2(size_t i, const float* x, const float* y, const float* z, size_t count,
+    const float* minimum, const float* maximum, unsigned char* out)
+{
+    const __m256 MINX = _mm256_set1_ps(minimum[0]), MINY = _mm256_set1_ps(minimum[1]), MINZ = _mm256_set1_ps(minimum[2]);
+    const __m256 MAXX = _mm256_set1_ps(maximum[0]), MAXY = _mm256_set1_ps(maximum[1]), MAXZ = _mm256_set1_ps(maximum[2]);
+    for(; i + 8 <= count; i += 8) {
+        const __m256 X = _mm256_load_ps(x + i), Y = _mm256_load_ps(y + i), Z = _mm256_load_ps(z + i);
+        __m256 M = _mm256_and_ps(_mm256_cmp_ps(X, MINX, _CMP_GE_OQ), _mm256_cmp_ps(X, MAXX, _CMP_LE_OQ));
+        M = _mm256_and_ps(M, _mm256_and_ps(_mm256_cmp_ps(Y, MINY, _CMP_GE_OQ), _mm256_cmp_ps(Y, MAXY, _CMP_LE_OQ)));
+        M = _mm256_and_ps(M, _mm256_and_ps(_mm256_cmp_ps(Z, MINZ, _CMP_GE_OQ), _mm256_cmp_ps(Z, MAXZ, _CMP_LE_OQ)));
+        store_mask(_mm256_movemask_ps(M), 8, out + i);
+    }
+    return i;
+}
+
+// AVX-512
+TARGET_AVX512 static size_t dot_avx512(size_t i, const float* x, const float* y, const float* z, const float* w, size_t count, const float* v, float* out)
+{
+    const __m512 VX = _mm512_set1_ps(v[0]), VY = _mm512_set1_ps(v[1]), VZ = _mm512_set1_ps(v[2]), VW = _mm512_set1_ps(v[3]);
+    for(; i + 16 <= count; i += 16) {
+        __m512 R = _mm512_mul_ps(_mm512_load_ps(x + i), VX);
+        R = _mm512_fmadd_ps(_mm512_load_ps(y + i), VY, R);
+        R = _mm512_fmadd_ps(_mm512_load_ps(z + i), VZ, R);
+        R = _mm512_fmadd_ps(_mm512_load_ps(w + i), VW, R);
+        _mm512_storeu_ps(out + i, R);
+    }
+    return i;
+}
+
+TARGET_AVX512 static size_t dot_avx512(size_t i, const float* x, const float* y, const float* z, const float* w, size_t count,
+    const float* rx, const float* ry, const float* rz, const float* rw, float* out)
+{
+    for(; i + 16 <= count; i += 16) {
+        __m512 R = _mm512_mul_ps(_mm512_load_ps(x + i), _mm512_load_ps(rx + i));
+        R = _mm512_fmadd_ps(_mm512_load_ps(y + i), _mm512_load_ps(ry + i), R);
+        R = _mm512_fmadd_ps(_mm512_load_ps(z + i), _mm512_load_ps(rz + i), R);
+        R = _mm512_fmadd_ps(_mm512_load_ps(w + i), _mm512_load_ps(rw + i), R);
+        _mm512_storeu_ps(out + i, R);
+    }
+    return i;
+}
+
+TARGET_AVX512 static size_t sqrt_avx512(size_t i, float* values, size_t count)
+{
+    for(; i + 16 <= count; i += 16) {
+        _mm512_storeu_ps(values + i, _mm512_sqrt_ps(_mm512_loadu_ps(values + i)));
+    }
+    return i;
+}
+
+TARGET_AVX512 static size_t normalize_avx512(size_t i, float* x, float* y, float* z, float* w, size_t count)
+{
+    const __m512 ZERO = _mm512_setzero_ps(), HALF = _mm512_set1_ps(0.5f), THREE_HALVES = _mm512_set1_ps(1.5f);
+    for(; i + 16 <= count; i += 16) {
+        const __m512 X = _mm512_load_ps(x + i), Y = _mm512_load_ps(y + i), Z = _mm512_load_ps(z + i), W = _mm512_load_ps(w + i);
+        __m512 L = _mm512_mul_ps(X, X);
+        L = _mm512_fmadd_ps(Y, Y, L);
+        L = _mm512_fmadd_ps(Z, Z, L);
+        L = _mm512_fmadd_ps(W, W, L);
+
+        // rsqrt14 is good to 14 bits, the Newton-Raphson step takes it the rest of the way
+        __m512 S = _mm512_rsqrt14_ps(L);
+        S = _mm512_mul_ps(S, _mm512_fnmadd_ps(_mm512_mul_ps(HALF, L), _mm512_mul_ps(S, S), THREE_HALVES));
+
+        // zero length vectors are masked off (leaving them at zero)
+        const __mmask16 nonzero = _mm512_cmp_ps_mask(L, ZERO, _CMP_GT_OQ);
+        _mm512_store_ps(x + i, _mm512_maskz_mul_ps(nonzero, X, S));
+        _mm512_store_ps(y + i, _mm512_maskz_mul_ps(nonzero, Y, S));
+        _mm512_store_ps(z + i, _mm512_maskz_mul_ps(nonzero, Z, S));
+        _mm512_store_ps(w + i, _mm512_maskz_mul_ps(nonzero, W, S));
+    }
+    return i;
+}
+
+TARGET_AVX512 static size_t distance_squared_avx512(size_t i, const float* x, const float* y, const float* z, size_t count, const float* p, float* out)
+{
+    const __m512 PX = _mm512_set1_ps(p[0]), PY = _mm512_set1_ps(p[1]), PZ = _mm512_set1_ps(p[2]);
+    for(; i + 16 <= count; i += 16) {
+        const __m512 DX = _mm512_sub_ps(_mm512_load_ps(x + i), PX);
+        const __m512 DY = _mm512_sub_ps(_mm512_load_ps(y + i), PY);
+        const __m512 DZ = _mm512_sub_ps(_mm512_load_ps(z + i), PZ);
+        _mm512_storeu_ps(out + i, _mm512_fmadd_ps(DZ, DZ, _mm512_fmadd_ps(DY, DY, _mm512_mul_ps(DX, DX))));
+    }
+    return i;
+}
+
+TARGET_AVX512 static size_t transform_avx512(size_t i, const float* x, const float* y, const float* z, const float* w, size_t count,
+    const float* m, float* ox, float* oy, float* oz, float* ow)
+{
+    __m512 M[16];
+    for(int j=0; j<16; ++j) {
+        M[j] = _mm512_set1_ps(m[j]);
+    }
+
+    float* const out[4] = { ox, oy, oz, ow };
+    for(; i + 16 <= count; i += 16) {
+        const __m512 X = _mm512_load_ps(x + i), Y = _mm512_load_ps(y + i), Z = _mm512_load_ps(z + i), W = _mm512_load_ps(w + i);
+
+        __m512 R[4];
+        for(int r=0; r<4; ++r) {
+            R[r] = _mm512_mul_ps(M[(r * 4) + 0], X);
+            R[r] = _mm512_fmadd_ps(M[(r * 4) + 1], Y, R[r]);
+            R[r] = _mm512_fmadd_ps(M[(r * 4) + 2], Z, R[r]);
+            R[r] = _mm512_fmadd_ps(M[(r * 4) + 3], W, R[r]);
+        }
+        for(int r=0; r<4; ++r) {
+            _mm512_store_ps(out[r] + i, R[r]);
+        }
+    }
+    return i;
+}
+
+TARGET_AVX512 static size_t rotate_avx512(size_t i, float* x, float* y, float* z, size_t count, const float* u, float s)
+{
+    const __m512 UX = _mm512_set1_ps(u[0]), UY = _mm512_set1_ps(u[1]), UZ = _mm512_set1_ps(u[2]);
+    const __m512 S = _mm512_set1_ps(s), TWO = _mm512_set1_ps(2.0f);
+    for(; i + 16 <= count; i += 16) {
+        const __m512 X = _mm512_load_ps(x + i), Y = _mm512_load_ps(y + i), Z = _mm512_load_ps(z + i);
+
+        const __m512 TX = _mm512_mul_ps(TWO, _mm512_fmsub_ps(UY, Z, _mm512_mul_ps(UZ, Y)));
+        const __m512 TY = _mm512_mul_ps(TWO, _mm512_fmsub_ps(UZ, X, _mm512_mul_ps(UX, Z)));
+        const __m512 TZ = _mm512_mul_ps(TWO, _mm512_fmsub_ps(UX, Y, _mm512_mul_ps(UY, X)));
+
+        _mm512_store_ps(x + i, _mm512_add_ps(_mm512_fmadd_ps(S, TX, X), _mm512_fmsub_ps(UY, TZ, _mm512_mul_ps(UZ, TY))));
+        _mm512_store_ps(y + i, _mm512_add_ps(_mm512_fmadd_ps(S, TY, Y), _mm512_fmsub_ps(UZ, TX, _mm512_mul_ps(UX, TZ))));
+        _mm512_store_ps(z + i, _mm512_add_ps(_mm512_fmadd_ps(S, TZ, Z), _mm512_fmsub_ps(UX, TY, _mm512_mul_ps(UY, TX))));
+    }
+    return i;
+}
+
+TARGET_AVX512 static size_t inside_sphere_avx512(size_t i, const float* x, const float* y, const float* z, size_t count,
+    const float* center, float radius_squared, unsigned char* out)
+{
+    const __m512 CX = _mm512_set1_ps(center[0]), CY = _mm512_set1_ps(center[1]), CZ = _mm512_set1_ps(center[2]);
+    const __m512 R2 = _mm512_set1_ps(radius_squared);
+    for(; i + 16 <= count; i += 16) {
+        const __m512 DX = _mm512_sub_ps(_mm512_load_ps(x + i), CX);
+        const __m512 DY = _mm512_sub_ps(_mm512_load_ps(y + i), CY);
+        const __m512 DZ = _mm512_sub_ps(_mm512_load_ps(z + i), CZ);
+        const __m512 D = _mm512_fmadd_ps(DZ, DZ, _mm512_fmadd_ps(DY, DY, _mm512_mul_ps(DX, DX)));
+        store_mask(_mm512_cmp_ps_mask(D, R2, _CMP_LE_OQ), 16, out + i);
+    }
+    return i;
+}
+
+TARGET_AVX512 static size_t inside_box_avx512(size_t i, const float* x, const float* y, const float* z, size_t count,
+    const float* minimum, const float* maximum, unsigned char* out)
+{
+    const __m512 MINX = _mm512_set1_ps(minimum[0]), MINY = _mm512_set1_ps(minimum[1]), MINZ = _mm512_set1_ps(minimum[2]);
+    const __m512 MAXX = _mm512_set1_ps(maximum[0]), MAXY = _mm512_set1_ps(maximum[1]), MAXZ = _mm512_set1_ps(maximum[2]);
+    for(; i + 16 <= count; i += 16) {
+        const __m512 X = _mm512_load_ps(x + i), Y = _mm512_load_ps(y + i), Z = _mm512_load_ps(z + i);
+
+        // the compares chain through the mask so only points inside on every axis stay set
+        __mmask16 M = _mm512_cmp_ps_mask(X, MINX, _CMP_GE_OQ);
+        M = _mm512_mask_cmp_ps_mask(M, X, MAXX, _CMP_LE_OQ);
+        M = _mm512_mask_cmp_ps_mask(M, Y, MINY, _CMP_GE_OQ);
+        M = _mm512_mask_cmp_ps_mask(M, Y, MAXY, _CMP_LE_OQ);
+        M = _mm512_mask_cmp_ps_mask(M, Z, MINZ, _CMP_GE_OQ);
+        M = _mm512_mask_cmp_ps_mask(M, Z, MAXZ, _CMP_LE_OQ);
+        store_mask(M, 16, out + i);
+    }
+    return i;
+}
+#endif
+
+const size_t Vector4Batch::ALIGNMENT;
+const size_t Vector4Batch::PADDING;
+
+Vector4Batch::Vector4Batch(MemoryAllocator* const allocator)
+    : _allocator(allocator), _memory(nullptr), _x(nullptr), _y(nullptr), _z(nullptr), _w(nullptr), _size(0), _capacity(0)
+{
+}
+
+Vector4Batch::~Vector4Batch() noexcept
+{
+    release_memory();
+}
+
+void Vector4Batch::reserve(size_t count)
+{
+    if(count <= _capacity) {
+        return;
+    }
+
+    const size_t capacity = ((count + PADDING - 1) / PADDING) * PADDING;
+    const size_t bytes = 4 * capacity * sizeof(float);
+
+    unsigned char* memory = nullptr;
+    float* data = nullptr;
+    if(nullptr != _allocator) {
+        memory = reinterpret_cast<unsigned char*>(_allocator->allocate_aligned(bytes, ALIGNMENT));
+        data = reinterpret_cast<float*>(memory);
+    } else {
+        // new[] doesn't do over-aligned allocations, so line the arrays up ourselves
+        memory = new unsigned char[bytes + ALIGNMENT];
+        data = reinterpret_cast<float*>((reinterpret_cast<size_t>(memory) + ALIGNMENT - 1) & ~(ALIGNMENT - 1));
+    }
+    std::memset(data, 0, bytes);
+
+    if(_size > 0) {
+        std::memcpy(data + (0 * capacity), _x, _size * sizeof(float));
+        std::memcpy(data + (1 * capacity), _y, _size * sizeof(float));
+        std::memcpy(data + (2 * capacity), _z, _size * sizeof(float));
+        std::memcpy(data + (3 * capacity), _w, _size * sizeof(float));
+    }
+    release_memory();
+
+    _memory = memory;
+    _x = data + (0 * capacity);
+    _y = data + (1 * capacity);
+    _z = data + (2 * capacity);
+    _w = data + (3 * capacity);
+    _capacity = capacity;
+}
+
+void Vector4Batch::resize(size_t count)
+{
+    reserve(count);
+
+    // zero anything we drop so that growing again gives zero vectors
+    if(count < _size) {
+        const size_t bytes = (_size - count) * sizeof(float);
+        std::memset(_x + count, 0, bytes);
+        std::memset(_y + count, 0, bytes);
+        std::memset(_z + count, 0, bytes);
+        std::memset(_w + count, 0, bytes);
+    }
+    _size = count;
+}
+
+void Vector4Batch::clear()
+{
+    resize(0);
+}
+
+void Vector4Batch::assign(const Vector* const vectors, size_t count)
+{
+    clear();
+    resize(count);
+    for(size_t i=0; i<count; ++i) {
+        set(i, vectors[i]);
+    }
+}
+
+void Vector4Batch::copy_to(Vector* const vectors) const
+{
+    for(size_t i=0; i<_size; ++i) {
+        vectors[i] = get(i);
+    }
+}
+
+void Vector4Batch::dot(const Vector& v, float* const out) const
+{
+    size_t i = 0;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, dot, _x, _y, _z, _w, _size, v.array(), out);
+#endif
+
+    for(; i<_size; ++i) {
+        out[i] = (_x[i] * v.x()) + (_y[i] * v.y()) + (_z[i] * v.z()) + (_w[i] * v.w());
+    }
+}
+
+void Vector4Batch::dot(const Vector4Batch& rhs, float* const out) const
+{
+    assert(rhs._size == _size);
+
+    size_t i = 0;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, dot, _x, _y, _z, _w, _size, rhs._x, rhs._y, rhs._z, rhs._w, out);
+#endif
+
+    for(; i<_size; ++i) {
+        out[i] = (_x[i] * rhs._x[i]) + (_y[i] * rhs._y[i]) + (_z[i] * rhs._z[i]) + (_w[i] * rhs._w[i]);
+    }
+}
+
+void Vector4Batch::length_squared(float* const out) const
+{
+    dot(*this, out);
+}
+
+void Vector4Batch::length(float* const out) const
+{
+    length_squared(out);
+
+    size_t i = 0;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, sqrt, out, _size);
+#endif
+
+    for(; i<_size; ++i) {
+        out[i] = std::sqrt(out[i]);
+    }
+}
+
+void Vector4Batch::normalize()
+{
+    size_t i = 0;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, normalize, _x, _y, _z, _w, _size);
+#endif
+
+    for(; i<_size; ++i) {
+        const float l = (_x[i] * _x[i]) + (_y[i] * _y[i]) + (_z[i] * _z[i]) + (_w[i] * _w[i]);
+        if(l > 0.0f) {
+            const float s = 1.0f / std::sqrt(l);
+            _x[i] *= s;
+            _y[i] *= s;
+            _z[i] *= s;
+            _w[i] *= s;
+        }
+    }
+}
+
+void Vector4Batch::distance_squared(const Point3& point, float* const out) const
+{
+    size_t i = 0;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, distance_squared, _x, _y, _z, _size, point.array(), out);
+#endif
+
+    for(; i<_size; ++i) {
+        const float dx = _x[i] - point.x();
+        const float dy = _y[i] - point.y();
+        const float dz = _z[i] - point.z();
+        out[i] = (dx * dx) + (dy * dy) + (dz * dz);
+    }
+}
+
+void Vector4Batch::transform(const Matrix4& matrix)
+{
+    transform(matrix, *this);
+}
+
+void Vector4Batch::transform(const Matrix4& matrix, Vector4Batch& out) const
+{
+    // out may be this batch, so each vector is read completely before it's written
+    out.resize(_size);
+
+    const float* const m = matrix.array();
+
+    size_t i = 0;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, transform, _x, _y, _z, _w, _size, m, out._x, out._y, out._z, out._w);
+#endif
+
+    for(; i<_size; ++i) {
+        const float x = _x[i], y = _y[i], z = _z[i], w = _w[i];
+        out._x[i] = (m[0] * x) + (m[1] * y) + (m[2] * z) + (m[3] * w);
+        out._y[i] = (m[4] * x) + (m[5] * y) + (m[6] * z) + (m[7] * w);
+        out._z[i] = (m[8] * x) + (m[9] * y) + (m[10] * z) + (m[11] * w);
+        out._w[i] = (m[12] * x) + (m[13] * y) + (m[14] * z) + (m[15] * w);
+    }
+}
+
+void Vector4Batch::rotate(const Quaternion& quaternion)
+{
+    // v' = v + s * t + u x t where t = 2 * (u x v)
+    // which is q * v * ~q without building the intermediate quaternions
+    const Vector3& u = quaternion.vector();
+    const float s = quaternion.scalar();
+
+    size_t i = 0;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, rotate, _x, _y, _z, _size, u.array(), s);
+#endif
+
+    for(; i<_size; ++i) {
+        const float x = _x[i], y = _y[i], z = _z[i];
+
+        const float tx = 2.0f * ((u.y() * z) - (u.z() * y));
+        const float ty = 2.0f * ((u.z() * x) - (u.x() * z));
+        const float tz = 2.0f * ((u.x() * y) - (u.y() * x));
+
+        _x[i] = x + (s * tx) + ((u.y() * tz) - (u.z() * ty));
+        _y[i] = y + (s * ty) + ((u.z() * tx) - (u.x() * tz));
+        _z[i] = z + (s * tz) + ((u.x() * ty) - (u.y() * tx));
+    }
+}
+
+void Vector4Batch::release_memory()
+{
+    if(nullptr == _memory) {
+        return;
+    }
+
+    if(nullptr != _allocator) {
+        _allocator->release_aligned(_memory, ALIGNMENT);
+    } else {
+        delete[] _memory;
+    }
+    _memory = nullptr;
+}
+
+void PointCloud::bounds(Point3& minimum, Point3& maximum) const
+{
+    assert(!empty());
+
+    float mins[3] = { x()[0], y()[0], z()[0] };
+    float maxs[3] = { x()[0], y()[0], z()[0] };
+
+    size_t i = 0;
+#if defined USE_SSE
+    if(size() >= 4) {
+        __m128 MINX = _mm_load_ps(x()), MAXX = MINX;
+        __m128 MINY = _mm_load_ps(y()), MAXY = MINY;
+        __m128 MINZ = _mm_load_ps(z()), MAXZ = MINZ;
+        for(i=4; i + 4 <= size(); i += 4) {
+            const __m128 X = _mm_load_ps(x() + i);
+            const __m128 Y = _mm_load_ps(y() + i);
+            const __m128 Z = _mm_load_ps(z() + i);
+            MINX = _mm_min_ps(MINX, X); MAXX = _mm_max_ps(MAXX, X);
+            MINY = _mm_min_ps(MINY, Y); MAXY = _mm_max_ps(MAXY, Y);
+            MINZ = _mm_min_ps(MINZ, Z); MAXZ = _mm_max_ps(MAXZ, Z);
+        }
+
+        // only reduce the lanes once at the end
+        ALIGN(16) float lanes[6][4];
+        _mm_store_ps(lanes[0], MINX); _mm_store_ps(lanes[1], MAXX);
+        _mm_store_ps(lanes[2], MINY); _mm_store_ps(lanes[3], MAXY);
+        _mm_store_ps(lanes[4], MINZ); _mm_store_ps(lanes[5], MAXZ);
+        for(int j=0; j<4; ++j) {
+            for(int k=0; k<3; ++k) {
+                mins[k] = std::min(mins[k], lanes[k * 2][j]);
+                maxs[k] = std::max(maxs[k], lanes[(k * 2) + 1][j]);
+            }
+        }
+    }
+#endif
+
+    for(; i<size(); ++i) {
+        mins[0] = std::min(mins[0], x()[i]); maxs[0] = std::max(maxs[0], x()[i]);
+        mins[1] = std::min(mins[1], y()[i]); maxs[1] = std::max(maxs[1], y()[i]);
+        mins[2] = std::min(mins[2], z()[i]); maxs[2] = std::max(maxs[2], z()[i]);
+    }
+
+    minimum = Point3(mins[0], mins[1], mins[2]);
+    maximum = Point3(maxs[0], maxs[1], maxs[2]);
+}
+
+Point3 PointCloud::centroid() const
+{
+    if(empty()) {
+        return Point3();
+    }
+
+    double sx = 0.0, sy = 0.0, sz = 0.0;
+    for(size_t i=0; i<size(); ++i) {
+        sx += x()[i];
+        sy += y()[i];
+        sz += z()[i];
+    }
+    return Point3(static_cast<float>(sx / size()), static_cast<float>(sy / size()), static_cast<float>(sz / size()));
+}
+
+size_t PointCloud::nearest(const Point3& point) const
+{
+    assert(!empty());
+
+    std::vector<float> distances(size());
+    distance_squared(point, distances.data());
+    return static_cast<size_t>(std::min_element(distances.begin(), distances.end()) - distances.begin());
+}
+
+size_t PointCloud::inside_sphere(const Point3& center, float radius, unsigned char* const out) const
+{
+    const float radius_squared = radius * radius;
+
+    size_t i = 0;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, inside_sphere, x(), y(), z(), size(), center.array(), radius_squared, out);
+#endif
+
+    for(; i<size(); ++i) {
+        const float dx = x()[i] - center.x();
+        const float dy = y()[i] - center.y();
+        const float dz = z()[i] - center.z();
+        out[i] = (dx * dx) + (dy * dy) + (dz * dz) <= radius_squared ? 1 : 0;
+    }
+    return static_cast<size_t>(std::count(out, out + size(), 1));
+}
+
+size_t PointCloud::inside_box(const Point3& minimum, const Point3& maximum, unsigned char* const out) const
+{
+    size_t i = 0;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, inside_box, x(), y(), z(), size(), minimum.array(), maximum.array(), out);
+#endif
+
+    for(; i<size(); ++i) {
+        out[i] = x()[i] >= minimum.x() && x()[i] <= maximum.x()
+            && y()[i] >= minimum.y() && y()[i] <= maximum.y()
+            && z()[i] >= minimum.z() && z()[i] <= maximum.z() ? 1 : 0;
+    }
+    return static_cast<size_t>(std::count(out, out + size(), 1));
+}
+
+}
+
+#if defined WITH_UNIT_TESTS
+#include "src/test/UnitTest.h"
+
+class Vector4BatchTest : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(Vector4BatchTest);
+        CPPUNIT_TEST(test_storage);
+        CPPUNIT_TEST(test_allocator);
+        CPPUNIT_TEST(test_dot);
+        CPPUNIT_TEST(test_length);
+        CPPUNIT_TEST(test_normalize);
+        CPPUNIT_TEST(test_distance);
+        CPPUNIT_TEST(test_transform);
+        CPPUNIT_TEST(test_rotate);
+        CPPUNIT_TEST(test_point_cloud);
+        CPPUNIT_TEST(test_dispatch);
+    CPPUNIT_TEST_SUITE_END();
+
+private:
+    // an odd count so that the scalar tail gets exercised
+    static const size_t COUNT = 13;
+
+public:
+    Vector4BatchTest() : CppUnit::TestFixture(), _vectors() {}
+    virtual ~Vector4BatchTest() noexcept {}
+
+public:
+    void setUp() override
+    {
+        energonsoftware::set_simd_level(energonsoftware::detected_simd_level());
+
+        _vectors.clear();
+        for(size_t i=0; i<COUNT; ++i) {
+            const float f = static_cast<float>(i);
+            _vectors.push_back(energonsoftware::Vector(f - 6.0f, 2.0f * f, 0.5f - f, i % 2 ? 1.0f : 0.0f));
+        }
+    }
+
+    void tearDown() override
+    {
+        energonsoftware::set_simd_level(energonsoftware::detected_simd_level());
+    }
+
+    void test_storage()
+    {
+        energonsoftware::Vector4Batch batch;
+        CPPUNIT_ASSERT(batch.empty());
+
+        for(const energonsoftware::Vector& v : _vectors) {
+            batch.push_back(v);
+        }
+        CPPUNIT_ASSERT_EQUAL(COUNT, batch.size());
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), batch.capacity() % energonsoftware::Vector4Batch::PADDING);
+        check_aligned(batch);
+
+        for(size_t i=0; i<COUNT; ++i) {
+            CPPUNIT_ASSERT_EQUAL(_vectors[i], batch.get(i));
+        }
+
+        // shrinking and growing gives zero vectors
+        batch.resize(2);
+        batch.resize(4);
+        CPPUNIT_ASSERT_EQUAL(_vectors[1], batch.get(1));
+        CPPUNIT_ASSERT_EQUAL(energonsoftware::Vector::ZERO, batch.get(3));
+
+        std::vector<energonsoftware::Vector> out(COUNT);
+        batch.assign(_vectors.data(), COUNT);
+        batch.copy_to(out.data());
+        CPPUNIT_ASSERT(_vectors == out);
+
+        batch.clear();
+        CPPUNIT_ASSERT(batch.empty());
+    }
+
+    void test_allocator()
+    {
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(
+            energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::System, 64 * 1024));
+        {
+            energonsoftware::Vector4Batch batch(allocator.get());
+            batch.assign(_vectors.data(), COUNT);
+            batch.reserve(1000);
+            check_aligned(batch);
+            CPPUNIT_ASSERT_EQUAL(_vectors[COUNT - 1], batch.get(COUNT - 1));
+            CPPUNIT_ASSERT_EQUAL(1U, allocator->allocation_count());
+        }
+        CPPUNIT_ASSERT_EQUAL(0U, allocator->allocation_count());
+    }
+
+    void test_dot()
+    {
+        energonsoftware::Vector4Batch batch, other;
+        batch.assign(_vectors.data(), COUNT);
+        other.assign(_vectors.data(), COUNT);
+        other.rotate(energonsoftware::Quaternion::new_axis(1.0f, energonsoftware::Vector::YAXIS));
+
+        const energonsoftware::Vector v(1.0f, -2.0f, 3.0f, 4.0f);
+        std::vector<float> out(COUNT);
+        batch.dot(v, out.data());
+        for(size_t i=0; i<COUNT; ++i) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(_vectors[i] * v, out[i], 0.0001f);
+        }
+
+        batch.dot(other, out.data());
+        for(size_t i=0; i<COUNT; ++i) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(_vectors[i] * other.get(i), out[i], 0.001f);
+        }
+    }
+
+    void test_length()
+    {
+        energonsoftware::Vector4Batch batch;
+        batch.assign(_vectors.data(), COUNT);
+
+        std::vector<float> out(COUNT);
+        batch.length_squared(out.data());
+        for(size_t i=0; i<COUNT; ++i) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(_vectors[i].length_squared(), out[i], 0.0001f);
+        }
+
+        batch.length(out.data());
+        for(size_t i=0; i<COUNT; ++i) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(_vectors[i].length(), out[i], 0.0001f);
+        }
+    }
+
+    void test_normalize()
+    {
+        energonsoftware::Vector4Batch batch;
+        batch.assign(_vectors.data(), COUNT);
+        batch.set(5, energonsoftware::Vector::ZERO);
+        batch.normalize();
+
+        std::vector<float> out(COUNT);
+        batch.length(out.data());
+        for(size_t i=0; i<COUNT; ++i) {
+            if(5 == i) {
+                CPPUNIT_ASSERT_EQUAL(energonsoftware::Vector::ZERO, batch.get(i));
+                continue;
+            }
+
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0f, out[i], 0.00001f);
+            const energonsoftware::Vector expected(_vectors[i] / _vectors[i].length());
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.x(), batch.get(i).x(), 0.00001f);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.y(), batch.get(i).y(), 0.00001f);
+        }
+    }
+
+    void test_distance()
+    {
+        energonsoftware::Vector4Batch batch;
+        batch.assign(_vectors.data(), COUNT);
+
+        const energonsoftware::Point3 point(1.0f, 2.0f, 3.0f);
+        std::vector<float> out(COUNT);
+        batch.distance_squared(point, out.data());
+        for(size_t i=0; i<COUNT; ++i) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(_vectors[i].xyz().distance_squared(point), out[i], 0.0001f);
+        }
+    }
+
+    void test_transform()
+    {
+        energonsoftware::Matrix4 matrix;
+        matrix.translate(energonsoftware::Position(1.0f, 2.0f, 3.0f));
+        matrix.rotate(0.5f, energonsoftware::Vector::ZAXIS);
+        matrix.uniform_scale(2.0f);
+
+        energonsoftware::Vector4Batch batch, out;
+        batch.assign(_vectors.data(), COUNT);
+        batch.transform(matrix, out);
+        CPPUNIT_ASSERT_EQUAL(COUNT, out.size());
+        for(size_t i=0; i<COUNT; ++i) {
+            for(int r=0; r<4; ++r) {
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(matrix.row(r) * _vectors[i], out.get(i)[r], 0.0001f);
+            }
+        }
+
+        // in place
+        batch.transform(matrix);
+        for(size_t i=0; i<COUNT; ++i) {
+            CPPUNIT_ASSERT_EQUAL(out.get(i), batch.get(i));
+        }
+    }
+
+    void test_rotate()
+    {
+        const energonsoftware::Quaternion q(energonsoftware::Quaternion::new_axis(1.2f, energonsoftware::Vector3(1.0f, 1.0f, 0.0f)));
+
+        energonsoftware::Vector4Batch batch;
+        batch.assign(_vectors.data(), COUNT);
+        batch.rotate(q);
+        for(size_t i=0; i<COUNT; ++i) {
+            // new_axis() normalizes with the (12 bit) rsqrt estimate
+            // and q * v * ~q scales by the length of q, so this is only close
+            const energonsoftware::Vector3 expected(q * _vectors[i].xyz());
+            const energonsoftware::Vector actual(batch.get(i));
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.x(), actual.x(), 0.01f);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.y(), actual.y(), 0.01f);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.z(), actual.z(), 0.01f);
+            CPPUNIT_ASSERT_EQUAL(_vectors[i].w(), actual.w());
+        }
+    }
+
+    void test_point_cloud()
+    {
+        energonsoftware::PointCloud cloud;
+        for(const energonsoftware::Vector& v : _vectors) {
+            cloud.push_back(v.xyz());
+        }
+        CPPUNIT_ASSERT_EQUAL(1.0f, cloud.get(0).w());
+
+        energonsoftware::Point3 minimum, maximum;
+        cloud.bounds(minimum, maximum);
+        CPPUNIT_ASSERT_EQUAL(energonsoftware::Point3(-6.0f, 0.0f, -11.5f), minimum);
+        CPPUNIT_ASSERT_EQUAL(energonsoftware::Point3(6.0f, 24.0f, 0.5f), maximum);
+
+        const energonsoftware::Point3 centroid(cloud.centroid());
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(0.0f, centroid.x(), 0.0001f);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(12.0f, centroid.y(), 0.0001f);
+
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(7), cloud.nearest(energonsoftware::Point3(1.1f, 13.9f, -6.4f)));
+
+        std::vector<unsigned char> inside(COUNT);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(3), cloud.inside_sphere(energonsoftware::Point3(1.0f, 14.0f, -6.5f), 2.5f, inside.data()));
+        CPPUNIT_ASSERT_EQUAL(static_cast<unsigned char>(1), inside[6]);
+        CPPUNIT_ASSERT_EQUAL(static_cast<unsigned char>(0), inside[9]);
+
+        CPPUNIT_ASSERT_EQUAL(COUNT, cloud.inside_box(minimum, maximum, inside.data()));
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), cloud.inside_box(energonsoftware::Point3(-6.0f, 0.0f, -1.0f),
+            energonsoftware::Point3(-4.0f, 2.0f, 1.0f), inside.data()));
+    }
+
+    void test_dispatch()
+    {
+        // enough vectors that every kernel width and the scalar tail get used
+        static const size_t DISPATCH_COUNT = 16 + 8 + 4 + 3;
+
+        energonsoftware::PointCloud expected, actual;
+        for(size_t i=0; i<DISPATCH_COUNT; ++i) {
+            const float f = static_cast<float>(i);
+            expected.push_back(energonsoftware::Point3(std::sin(f) * 10.0f, std::cos(f) * 5.0f, f - 15.0f));
+        }
+
+        energonsoftware::Matrix4 matrix;
+        matrix.translate(energonsoftware::Position(1.0f, 2.0f, 3.0f));
+        matrix.rotate(0.5f, energonsoftware::Vector::YAXIS);
+        const energonsoftware::Quaternion q(energonsoftware::Quaternion::new_axis(0.7f, energonsoftware::Vector3(0.0f, 1.0f, 1.0f)));
+        const energonsoftware::Point3 point(1.0f, 1.0f, 1.0f);
+
+        // the scalar results
+        std::vector<float> distances(DISPATCH_COUNT), lengths(DISPATCH_COUNT);
+        std::vector<unsigned char> sphere(DISPATCH_COUNT), box(DISPATCH_COUNT);
+        energonsoftware::set_simd_level(energonsoftware::SimdLevel::None);
+        expected.distance_squared(point, distances.data());
+        const size_t sphere_count = expected.inside_sphere(point, 8.0f, sphere.data());
+        const size_t box_count = expected.inside_box(energonsoftware::Point3(-5.0f, -5.0f, -5.0f), energonsoftware::Point3(5.0f, 5.0f, 5.0f), box.data());
+        expected.transform(matrix);
+        expected.rotate(q);
+        expected.normalize();
+        expected.length(lengths.data());
+
+        for(energonsoftware::SimdLevel level : energonsoftware::supported_simd_levels()) {
+            energonsoftware::set_simd_level(level);
+            const std::string name(energonsoftware::simd_level_name(level));
+
+            actual.clear();
+            for(size_t i=0; i<DISPATCH_COUNT; ++i) {
+                const float f = static_cast<float>(i);
+                actual.push_back(energonsoftware::Point3(std::sin(f) * 10.0f, std::cos(f) * 5.0f, f - 15.0f));
+            }
+
+            std::vector<float> out(DISPATCH_COUNT);
+            std::vector<unsigned char> flags(DISPATCH_COUNT);
+            actual.distance_squared(point, out.data());
+            for(size_t i=0; i<DISPATCH_COUNT; ++i) {
+                CPPUNIT_ASSERT_MESSAGE(name, std::fabs(distances[i] - out[i]) < 0.001f);
+            }
+
+            CPPUNIT_ASSERT_EQUAL_MESSAGE(name, sphere_count, actual.inside_sphere(point, 8.0f, flags.data()));
+            CPPUNIT_ASSERT_MESSAGE(name, sphere == flags);
+            CPPUNIT_ASSERT_EQUAL_MESSAGE(name, box_count,
+                actual.inside_box(energonsoftware::Point3(-5.0f, -5.0f, -5.0f), energonsoftware::Point3(5.0f, 5.0f, 5.0f), flags.data()));
+            CPPUNIT_ASSERT_MESSAGE(name, box == flags);
+
+            actual.transform(matrix);
+            actual.rotate(q);
+            actual.normalize();
+            actual.length(out.data());
+            for(size_t i=0; i<DISPATCH_COUNT; ++i) {
+                CPPUNIT_ASSERT_MESSAGE(name, std::fabs(lengths[i] - out[i]) < 0.0001f);
+                for(int c=0; c<4; ++c) {
+                    CPPUNIT_ASSERT_MESSAGE(name, std::fabs(expected.get(i)[c] - actual.get(i)[c]) < 0.0001f);
+                }
+            }
+        }
+    }
+
+private:
+    void check_aligned(const energonsoftware::Vector4Batch& batch)
+    {
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), reinterpret_cast<size_t>(batch.x()) % energonsoftware::Vector4Batch::ALIGNMENT);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), reinterpret_cast<size_t>(batch.y()) % energonsoftware::Vector4Batch::ALIGNMENT);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), reinterpret_cast<size_t>(batch.z()) % energonsoftware::Vector4Batch::ALIGNMENT);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), reinterpret_cast<size_t>(batch.w()) % energonsoftware::Vector4Batch::ALIGNMENT);
+    }
+
+private:
+    std::vector<energonsoftware::Vector> _vectors;
+};
+
+const size_t Vector4BatchTest::COUNT;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Vector4BatchTest);
+
+#endif
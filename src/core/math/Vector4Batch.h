@@ -0,0 +1,161 @@
+#if !defined __VECTOR4BATCH_H__
+#define __VECTOR4BATCH_H__
+
+#include "Matrix4.h"
+#include "Quaternion.h"
+#include "Vector.h"
+
+namespace energonsoftware {
+
+/*
+Structure-of-arrays collection of 4-dimensional vectors.
+
+Each component is kept in its own array so the batch operations can
+work on several vectors per instruction without any horizontal adds or
+shuffles, which is a lot faster than looping over Vectors once there are
+more than a handful of them. The operations are dispatched at runtime on
+what the CPU supports (see cpu_util.h), 4 vectors at a time with SSE,
+8 with AVX2 and 16 with AVX-512.
+
+The component arrays are aligned on ALIGNMENT and the capacity is kept
+to a multiple of PADDING so that every array stays aligned.
+
+Operations that produce a scalar per vector write into an array
+of at least size() floats.
+*/
+class Vector4Batch
+{
+public:
+    // enough for AVX-512 loads
+    static const size_t ALIGNMENT = 64;
+    static const size_t PADDING = 16;
+
+public:
+    explicit Vector4Batch(MemoryAllocator* const allocator=nullptr);
+    virtual ~Vector4Batch() noexcept;
+
+public:
+    size_t size() const { return _size; }
+    size_t capacity() const { return _capacity; }
+    bool empty() const { return 0 == _size; }
+
+    // the component arrays, these are only valid until the batch grows
+    float* x() { return _x; }
+    const float* x() const { return _x; }
+
+    float* y() { return _y; }
+    const float* y() const { return _y; }
+
+    float* z() { return _z; }
+    const float* z() const { return _z; }
+
+    float* w() { return _w; }
+    const float* w() const { return _w; }
+
+    Vector get(size_t index) const
+    {
+        assert(index < _size);
+        return Vector(_x[index], _y[index], _z[index], _w[index]);
+    }
+
+    void set(size_t index, const Vector& v)
+    {
+        assert(index < _size);
+        _x[index] = v.x();
+        _y[index] = v.y();
+        _z[index] = v.z();
+        _w[index] = v.w();
+    }
+
+    void push_back(const Vector& v)
+    {
+        if(_size == _capacity) {
+            reserve(std::max<size_t>(_capacity * 2, PADDING));
+        }
+        ++_size;
+        set(_size - 1, v);
+    }
+
+    void reserve(size_t count);
+
+    // new vectors are zero
+    void resize(size_t count);
+
+    void clear();
+
+    // copies the vectors out of (or into) an array of structures
+    void assign(const Vector* const vectors, size_t count);
+    void copy_to(Vector* const vectors) const;
+
+public:
+    // per vector dot-products (using all 4 components)
+    void dot(const Vector& v, float* const out) const;
+    void dot(const Vector4Batch& rhs, float* const out) const;
+
+    void length_squared(float* const out) const;
+    void length(float* const out) const;
+
+    // zero length vectors are left alone
+    void normalize();
+
+    // squared distance from each (3-dimensional) point to the given point
+    void distance_squared(const Point3& point, float* const out) const;
+
+    // multiplies each vector by the matrix (matrix * vector)
+    void transform(const Matrix4& matrix);
+    void transform(const Matrix4& matrix, Vector4Batch& out) const;
+
+    // rotates the 3-dimensional part of each vector, w is left alone
+    // NOTE: the quaternion must be normalized
+    void rotate(const Quaternion& quaternion);
+
+private:
+    void release_memory();
+
+private:
+    MemoryAllocator* _allocator;
+
+    // the start of the allocation (heap allocations are aligned by hand)
+    unsigned char* _memory;
+
+    float *_x, *_y, *_z, *_w;
+    size_t _size, _capacity;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(Vector4Batch);
+};
+
+/*
+A batch of 3-dimensional points (w is always 1).
+*/
+class PointCloud : public Vector4Batch
+{
+public:
+    explicit PointCloud(MemoryAllocator* const allocator=nullptr) : Vector4Batch(allocator) {}
+    virtual ~PointCloud() noexcept {}
+
+public:
+    void push_back(const Point3& point) { Vector4Batch::push_back(point.homogeneous_position()); }
+
+    // axis-aligned bounds of the points
+    // NOTE: the cloud must not be empty
+    void bounds(Point3& minimum, Point3& maximum) const;
+
+    Point3 centroid() const;
+
+    // index of the point closest to the given point
+    // NOTE: the cloud must not be empty
+    size_t nearest(const Point3& point) const;
+
+    // flags (with 1 or 0) which points are inside (or on) the sphere or box,
+    // returns how many are, out must hold at least size() flags
+    size_t inside_sphere(const Point3& center, float radius, unsigned char* const out) const;
+    size_t inside_box(const Point3& minimum, const Point3& maximum, unsigned char* const out) const;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(PointCloud);
+};
+
+}
+
+#endif
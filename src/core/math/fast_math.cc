@@ -0,0 +1,786 @@
+#include "src/pch.h"
+#include "src/core/util/cpu_util.h"
+#include "fast_math.h"
+
+namespace energonsoftware {
+
+/*
+Kernels (see SIMD_DISPATCH in cpu_util.h).
+
+These are the scalar versions in fast_math.h a register at a time,
+the AVX2 and AVX-512 versions use FMA for the polynomials.
+*/
+
+#if defined USE_SSE
+// SSE3
+
+static inline __m128 select_sse(const __m128 mask, const __m128 a, const __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128 rsqrt_sse(const __m128 X)
+{
+    const __m128 Y = _mm_rsqrt_ps(X);
+    return _mm_mul_ps(Y, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), X), Y), Y)));
+}
+
+static inline __m128 sin_polynomial_sse(const __m128 R)
+{
+    const __m128 S = _mm_mul_ps(R, R);
+    __m128 P = _mm_set1_ps(2.6083159809786593541503e-06f);
+    P = _mm_sub_ps(_mm_mul_ps(P, S), _mm_set1_ps(0.0001981069071916863322258f));
+    P = _mm_add_ps(_mm_mul_ps(P, S), _mm_set1_ps(0.00833307858556509017944336f));
+    P = _mm_sub_ps(_mm_mul_ps(P, S), _mm_set1_ps(0.166666597127914428710938f));
+    return _mm_add_ps(R, _mm_mul_ps(_mm_mul_ps(R, S), P));
+}
+
+static inline __m128 sin_sse(const __m128 X)
+{
+    const __m128i QI = _mm_cvtps_epi32(_mm_mul_ps(X, _mm_set1_ps(0.318309886183790671538f)));
+    const __m128 Q = _mm_cvtepi32_ps(QI);
+
+    __m128 R = _mm_sub_ps(X, _mm_mul_ps(Q, _mm_set1_ps(3.140625f)));
+    R = _mm_sub_ps(R, _mm_mul_ps(Q, _mm_set1_ps(0.0009670257568359375f)));
+    R = _mm_sub_ps(R, _mm_mul_ps(Q, _mm_set1_ps(6.2771141529083251953e-07f)));
+    R = _mm_sub_ps(R, _mm_mul_ps(Q, _mm_set1_ps(1.2154201256553420762e-10f)));
+
+    // odd multiples of pi flip the sign
+    return _mm_xor_ps(sin_polynomial_sse(R), _mm_castsi128_ps(_mm_slli_epi32(QI, 31)));
+}
+
+static inline __m128 cos_sse(const __m128 X)
+{
+    const __m128i QI = _mm_cvtps_epi32(_mm_sub_ps(_mm_mul_ps(X, _mm_set1_ps(0.318309886183790671538f)), _mm_set1_ps(0.5f)));
+    const __m128i QO = _mm_add_epi32(_mm_slli_epi32(QI, 1), _mm_set1_epi32(1));
+    const __m128 Q = _mm_cvtepi32_ps(QO);
+
+    __m128 R = _mm_sub_ps(X, _mm_mul_ps(Q, _mm_set1_ps(1.5703125f)));
+    R = _mm_sub_ps(R, _mm_mul_ps(Q, _mm_set1_ps(0.00048351287841796875f)));
+    R = _mm_sub_ps(R, _mm_mul_ps(Q, _mm_set1_ps(3.1385570764541625977e-07f)));
+    R = _mm_sub_ps(R, _mm_mul_ps(Q, _mm_set1_ps(6.0771006282767103812e-11f)));
+
+    // flipped unless bit 1 of the odd multiple is set
+    return _mm_xor_ps(sin_polynomial_sse(R), _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(QO, _mm_set1_epi32(2)), 30)));
+}
+
+static inline __m128 atan2_sse(const __m128 Y, const __m128 X)
+{
+    const __m128 ZERO = _mm_setzero_ps(), ABS = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 AY = _mm_and_ps(Y, ABS), AX = _mm_and_ps(X, ABS);
+    const __m128 MX = _mm_max_ps(AY, AX), MN = _mm_min_ps(AY, AX);
+    const __m128 A = _mm_and_ps(_mm_div_ps(MN, MX), _mm_cmpgt_ps(MX, ZERO));
+
+    const __m128 S = _mm_mul_ps(A, A);
+    __m128 P = _mm_set1_ps(-0.01172120f);
+    P = _mm_add_ps(_mm_mul_ps(P, S), _mm_set1_ps(0.05265332f));
+    P = _mm_sub_ps(_mm_mul_ps(P, S), _mm_set1_ps(0.11643287f));
+    P = _mm_add_ps(_mm_mul_ps(P, S), _mm_set1_ps(0.19354346f));
+    P = _mm_sub_ps(_mm_mul_ps(P, S), _mm_set1_ps(0.33262347f));
+    P = _mm_add_ps(_mm_mul_ps(P, S), _mm_set1_ps(0.99997726f));
+    __m128 R = _mm_mul_ps(A, P);
+
+    R = select_sse(_mm_cmpgt_ps(AY, AX), _mm_sub_ps(_mm_set1_ps(static_cast<float>(M_PI_2)), R), R);
+    R = select_sse(_mm_cmplt_ps(X, ZERO), _mm_sub_ps(_mm_set1_ps(static_cast<float>(M_PI)), R), R);
+    return _mm_xor_ps(R, _mm_and_ps(_mm_cmplt_ps(Y, ZERO), _mm_set1_ps(-0.0f)));
+}
+
+static inline __m128 exp_sse(__m128 X)
+{
+    X = _mm_min_ps(_mm_max_ps(X, _mm_set1_ps(-87.3365447505531f)), _mm_set1_ps(88.3762626647949f));
+
+    const __m128i NI = _mm_cvtps_epi32(_mm_mul_ps(X, _mm_set1_ps(1.44269504088896340736f)));
+    const __m128 N = _mm_cvtepi32_ps(NI);
+    __m128 F = _mm_sub_ps(X, _mm_mul_ps(N, _mm_set1_ps(0.693359375f)));
+    F = _mm_sub_ps(F, _mm_mul_ps(N, _mm_set1_ps(-2.12194440e-4f)));
+
+    __m128 P = _mm_set1_ps(1.9875691500e-4f);
+    P = _mm_add_ps(_mm_mul_ps(P, F), _mm_set1_ps(1.3981999507e-3f));
+    P = _mm_add_ps(_mm_mul_ps(P, F), _mm_set1_ps(8.3334519073e-3f));
+    P = _mm_add_ps(_mm_mul_ps(P, F), _mm_set1_ps(4.1665795894e-2f));
+    P = _mm_add_ps(_mm_mul_ps(P, F), _mm_set1_ps(1.6666665459e-1f));
+    P = _mm_add_ps(_mm_mul_ps(P, F), _mm_set1_ps(5.0000001201e-1f));
+    const __m128 E = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(P, F), F), F), _mm_set1_ps(1.0f));
+
+    const __m128 SCALE = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(NI, _mm_set1_epi32(127)), 23));
+    return _mm_mul_ps(E, SCALE);
+}
+
+static size_t rsqrt_sse(size_t i, const float* x, float* out, size_t count)
+{
+    for(; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(out + i, rsqrt_sse(_mm_loadu_ps(x + i)));
+    }
+    return i;
+}
+
+static size_t sqrt_sse(size_t i, const float* x, float* out, size_t count)
+{
+    for(; i + 4 <= count; i += 4) {
+        const __m128 X = _mm_loadu_ps(x + i);
+        _mm_storeu_ps(out + i, _mm_and_ps(_mm_mul_ps(X, rsqrt_sse(X)), _mm_cmpgt_ps(X, _mm_setzero_ps())));
+    }
+    return i;
+}
+
+static size_t sin_sse(size_t i, const float* x, float* out, size_t count)
+{
+    for(; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(out + i, sin_sse(_mm_loadu_ps(x + i)));
+    }
+    return i;
+}
+
+static size_t cos_sse(size_t i, const float* x, float* out, size_t count)
+{
+    for(; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(out + i, cos_sse(_mm_loadu_ps(x + i)));
+    }
+    return i;
+}
+
+static size_t atan2_sse(size_t i, const float* y, const float* x, float* out, size_t count)
+{
+    for(; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(out + i, atan2_sse(_mm_loadu_ps(y + i), _mm_loadu_ps(x + i)));
+    }
+    return i;
+}
+
+static size_t exp_sse(size_t i, const float* x, float* out, size_t count)
+{
+    for(; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(out + i, exp_sse(_mm_loadu_ps(x + i)));
+    }
+    return i;
+}
+
+// AVX2
+
+TARGET_AVX2 static inline __m256 rsqrt_avx2(const __m256 X)
+{
+    const __m256 Y = _mm256_rsqrt_ps(X);
+    return _mm256_mul_ps(Y, _mm256_fnmadd_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), X), Y), Y, _mm256_set1_ps(1.5f)));
+}
+
+TARGET_AVX2 static inline __m256 sin_polynomial_avx2(const __m256 R)
+{
+    const __m256 S = _mm256_mul_ps(R, R);
+    __m256 P = _mm256_set1_ps(2.6083159809786593541503e-06f);
+    P = _mm256_fmsub_ps(P, S, _mm256_set1_ps(0.0001981069071916863322258f));
+    P = _mm256_fmadd_ps(P, S, _mm256_set1_ps(0.00833307858556509017944336f));
+    P = _mm256_fmsub_ps(P, S, _mm256_set1_ps(0.166666597127914428710938f));
+    return _mm256_fmadd_ps(_mm256_mul_ps(R, S), P, R);
+}
+
+TARGET_AVX2 static inline __m256 sin_avx2(const __m256 X)
+{
+    const __m256i QI = _mm256_cvtps_epi32(_mm256_mul_ps(X, _mm256_set1_ps(0.318309886183790671538f)));
+    const __m256 Q = _mm256_cvtepi32_ps(QI);
+
+    __m256 R = _mm256_fnmadd_ps(Q, _mm256_set1_ps(3.140625f), X);
+    R = _mm256_fnmadd_ps(Q, _mm256_set1_ps(0.0009670257568359375f), R);
+    R = _mm256_fnmadd_ps(Q, _mm256_set1_ps(6.2771141529083251953e-07f), R);
+    R = _mm256_fnmadd_ps(Q, _mm256_set1_ps(1.2154201256553420762e-10f), R);
+
+    return _mm256_xor_ps(sin_polynomial_avx2(R), _mm256_castsi256_ps(_mm256_slli_epi32(QI, 31)));
+}
+
+TARGET_AVX2 static inline __m256 cos_avx2(const __m256 X)
+{
+    const __m256i QI = _mm256_cvtps_epi32(_mm256_fmsub_ps(X, _mm256_set1_ps(0.318309886183790671538f), _mm256_set1_ps(0.5f)));
+    const __m256i QO = _mm256_add_epi32(_mm256_slli_epi32(QI, 1), _mm256_set1_epi32(1));
+    const __m256 Q = _mm256_cvtepi32_ps(QO);
+
+    __m256 R = _mm256_fnmadd_ps(Q, _mm256_set1_ps(1.5703125f), X);
+    R = _mm256_fnmadd_ps(Q, _mm256_set1_ps(0.00048351287841796875f), R);
+    R = _mm256_fnmadd_ps(Q, _mm256_set1_ps(3.1385570764541625977e-07f), R);
+    R = _mm256_fnmadd_ps(Q, _mm256_set1_ps(6.0771006282767103812e-11f), R);
+
+    return _mm256_xor_ps(sin_polynomial_avx2(R), _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_andnot_si256(QO, _mm256_set1_epi32(2)), 30)));
+}
+
+TARGET_AVX2 static inline __m256 atan2_avx2(const __m256 Y, const __m256 X)
+{
+    const __m256 ZERO = _mm256_setzero_ps(), ABS = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256 AY = _mm256_and_ps(Y, ABS), AX = _mm256_and_ps(X, ABS);
+    const __m256 MX = _mm256_max_ps(AY, AX), MN = _mm256_min_ps(AY, AX);
+    const __m256 A = _mm256_and_ps(_mm256_div_ps(MN, MX), _mm256_cmp_ps(MX, ZERO, _CMP_GT_OQ));
+
+    const __m256 S = _mm256_mul_ps(A, A);
+    __m256 P = _mm256_set1_ps(-0.01172120f);
+    P = _mm256_fmadd_ps(P, S, _mm256_set1_ps(0.05265332f));
+    P = _mm256_fmsub_ps(P, S, _mm256_set1_ps(0.11643287f));
+    P = _mm256_fmadd_ps(P, S, _mm256_set1_ps(0.19354346f));
+    P = _mm256_fmsub_ps(P, S, _mm256_set1_ps(0.33262347f));
+    P = _mm256_fmadd_ps(P, S, _mm256_set1_ps(0.99997726f));
+    __m256 R = _mm256_mul_ps(A, P);
+
+    R = _mm256_blendv_ps(R, _mm256_sub_ps(_mm256_set1_ps(static_cast<float>(M_PI_2)), R), _mm256_cmp_ps(AY, AX, _CMP_GT_OQ));
+    R = _mm256_blendv_ps(R, _mm256_sub_ps(_mm256_set1_ps(static_cast<float>(M_PI)), R), _mm256_cmp_ps(X, ZERO, _CMP_LT_OQ));
+    return _mm256_xor_ps(R, _mm256_and_ps(_mm256_cmp_ps(Y, ZERO, _CMP_LT_OQ), _mm256_set1_ps(-0.0f)));
+}
+
+TARGET_AVX2 static inline __m256 exp_avx2(__m256 X)
+{
+    X = _mm256_min_ps(_mm256_max_ps(X, _mm256_set1_ps(-87.3365447505531f)), _mm256_set1_ps(88.3762626647949f));
+
+    const __m256i NI = _mm256_cvtps_epi32(_mm256_mul_ps(X, _mm256_set1_ps(1.44269504088896340736f)));
+    const __m256 N = _mm256_cvtepi32_ps(NI);
+    __m256 F = _mm256_fnmadd_ps(N, _mm256_set1_ps(0.693359375f), X);
+    F = _mm256_fnmadd_ps(N, _mm256_set1_ps(-2.12194440e-4f), F);
+
+    __m256 P = _mm256_set1_ps(1.9875691500e-4f);
+    P = _mm256_fmadd_ps(P, F, _mm256_set1_ps(1.3981999507e-3f));
+    P = _mm256_fmadd_ps(P, F, _mm256_set1_ps(8.3334519073e-3f));
+    P = _mm256_fmadd_ps(P, F, _mm256_set1_ps(4.1665795894e-2f));
+    P = _mm256_fmadd_ps(P, F, _mm256_set1_ps(1.6666665459e-1f));
+    P = _mm256_fmadd_ps(P, F, _mm256_set1_ps(5.0000001201e-1f));
+    const __m256 E = _mm256_add_ps(_mm256_fmadd_ps(_mm256_mul_ps(P, F), F, F), _mm256_set1_ps(1.0f));
+
+    const __m256 SCALE = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(NI, _mm256_set1_epi32(127)), 23));
+    return _mm256_mul_ps(E, SCALE);
+}
+
+TARGET_AVX2 static size_t rsqrt_avx2(size_t i, const float* x, float* out, size_t count)
+{
+    for(; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(out + i, rsqrt_avx2(_mm256_loadu_ps(x + i)));
+    }
+    return i;
+}
+
+TARGET_AVX2 static size_t sqrt_avx2(size_t i, const float* x, float* out, size_t count)
+{
+    for(; i + 8 <= count; i += 8) {
+        const __m256 X = _mm256_loadu_ps(x + i);
+        _mm256_storeu_ps(out + i, _mm256_and_ps(_mm256_mul_ps(X, rsqrt_avx2(X)), _mm256_cmp_ps(X, _mm256_setzero_ps(), _CMP_GT_OQ)));
+    }
+    return i;
+}
+
+TARGET_AVX2 static size_t sin_avx2(size_t i, const float* x, float* out, size_t count)
+{
+    for(; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(out + i, sin_avx2(_mm256_loadu_ps(x + i)));
+    }
+    return i;
+}
+
+TARGET_AVX2 static size_t cos_avx2(size_t i, const float* x, float* out, size_t count)
+{
+    for(; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(out + i, cos_avx2(_mm256_loadu_ps(x + i)));
+    }
+    return i;
+}
+
+TARGET_AVX2 static size_t atan2_avx2(size_t i, const float* y, const float* x, float* out, size_t count)
+{
+    for(; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(out + i, atan2_avx2(_mm256_loadu_ps(y + i), _mm256_loadu_ps(x + i)));
+    }
+    return i;
+}
+
+TARGET_AVX2 static size_t exp_avx2(size_t i, const float* x, float* out, size_t count)
+{
+    for(; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(out + i, exp_avx2(_mm256_loadu_ps(x + i)));
+    }
+    return i;
+}
+
+// AVX-512
+
+TARGET_AVX512 static inline __m512 rsqrt_avx512(const __m512 X)
+{
+    // the estimate is good to 14 bits here
+    const __m512 Y = _mm512_rsqrt14_ps(X);
+    return _mm512_mul_ps(Y, _mm512_fnmadd_ps(_mm512_mul_ps(_mm512_mul_ps(_mm512_set1_ps(0.5f), X), Y), Y, _mm512_set1_ps(1.5f)));
+}
+
+TARGET_AVX512 static inline __m512 sin_polynomial_avx512(const __m512 R)
+{
+    const __m512 S = _mm512_mul_ps(R, R);
+    __m512 P = _mm512_set1_ps(2.6083159809786593541503e-06f);
+    P = _mm512_fmsub_ps(P, S, _mm512_set1_ps(0.0001981069071916863322258f));
+    P = _mm512_fmadd_ps(P, S, _mm512_set1_ps(0.00833307858556509017944336f));
+    P = _mm512_fmsub_ps(P, S, _mm512_set1_ps(0.166666597127914428710938f));
+    return _mm512_fmadd_ps(_mm512_mul_ps(R, S), P, R);
+}
+
+TARGET_AVX512 static inline __m512 sin_avx512(const __m512 X)
+{
+    const __m512i QI = _mm512_cvtps_epi32(_mm512_mul_ps(X, _mm512_set1_ps(0.318309886183790671538f)));
+    const __m512 Q = _mm512_cvtepi32_ps(QI);
+
+    __m512 R = _mm512_fnmadd_ps(Q, _mm512_set1_ps(3.140625f), X);
+    R = _mm512_fnmadd_ps(Q, _mm512_set1_ps(0.0009670257568359375f), R);
+    R = _mm512_fnmadd_ps(Q, _mm512_set1_ps(6.2771141529083251953e-07f), R);
+    R = _mm512_fnmadd_ps(Q, _mm512_set1_ps(1.2154201256553420762e-10f), R);
+
+    return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(sin_polynomial_avx512(R)), _mm512_slli_epi32(QI, 31)));
+}
+
+TARGET_AVX512 static inline __m512 cos_avx512(const __m512 X)
+{
+    const __m512i QI = _mm512_cvtps_epi32(_mm512_fmsub_ps(X, _mm512_set1_ps(0.318309886183790671538f), _mm512_set1_ps(0.5f)));
+    const __m512i QO = _mm512_add_epi32(_mm512_slli_epi32(QI, 1), _mm512_set1_epi32(1));
+    const __m512 Q = _mm512_cvtepi32_ps(QO);
+
+    __m512 R = _mm512_fnmadd_ps(Q, _mm512_set1_ps(1.5703125f), X);
+    R = _mm512_fnmadd_ps(Q, _mm512_set1_ps(0.00048351287841796875f), R);
+    R = _mm512_fnmadd_ps(Q, _mm512_set1_ps(3.1385570764541625977e-07f), R);
+    R = _mm512_fnmadd_ps(Q, _mm512_set1_ps(6.0771006282767103812e-11f), R);
+
+    const __m512i SIGN = _mm512_slli_epi32(_mm512_andnot_si512(QO, _mm512_set1_epi32(2)), 30);
+    return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(sin_polynomial_avx512(R)), SIGN));
+}
+
+TARGET_AVX512 static inline __m512 atan2_avx512(const __m512 Y, const __m512 X)
+{
+    const __m512 ZERO = _mm512_setzero_ps();
+    const __m512 AY = _mm512_abs_ps(Y), AX = _mm512_abs_ps(X);
+    const __m512 MX = _mm512_max_ps(AY, AX), MN = _mm512_min_ps(AY, AX);
+    const __m512 A = _mm512_maskz_div_ps(_mm512_cmp_ps_mask(MX, ZERO, _CMP_GT_OQ), MN, MX);
+
+    const __m512 S = _mm512_mul_ps(A, A);
+    __m512 P = _mm512_set1_ps(-0.01172120f);
+    P = _mm512_fmadd_ps(P, S, _mm512_set1_ps(0.05265332f));
+    P = _mm512_fmsub_ps(P, S, _mm512_set1_ps(0.11643287f));
+    P = _mm512_fmadd_ps(P, S, _mm512_set1_ps(0.19354346f));
+    P = _mm512_fmsub_ps(P, S, _mm512_set1_ps(0.33262347f));
+    P = _mm512_fmadd_ps(P, S, _mm512_set1_ps(0.99997726f));
+    __m512 R = _mm512_mul_ps(A, P);
+
+    R = _mm512_mask_sub_ps(R, _mm512_cmp_ps_mask(AY, AX, _CMP_GT_OQ), _mm512_set1_ps(static_cast<float>(M_PI_2)), R);
+    R = _mm512_mask_sub_ps(R, _mm512_cmp_ps_mask(X, ZERO, _CMP_LT_OQ), _mm512_set1_ps(static_cast<float>(M_PI)), R);
+    return _mm512_mask_sub_ps(R, _mm512_cmp_ps_mask(Y, ZERO, _CMP_LT_OQ), ZERO, R);
+}
+
+TARGET_AVX512 static inline __m512 exp_avx512(__m512 X)
+{
+    X = _mm512_min_ps(_mm512_max_ps(X, _mm512_set1_ps(-87.3365447505531f)), _mm512_set1_ps(88.3762626647949f));
+
+    const __m512i NI = _mm512_cvtps_epi32(_mm512_mul_ps(X, _mm512_set1_ps(1.44269504088896340736f)));
+    const __m512 N = _mm512_cvtepi32_ps(NI);
+    __m512 F = _mm512_fnmadd_ps(N, _mm512_set1_ps(0.693359375f), X);
+    F = _mm512_fnmadd_ps(N, _mm512_set1_ps(-2.12194440e-4f), F);
+
+    __m512 P = _mm512_set1_ps(1.9875691500e-4f);
+    P = _mm512_fmadd_ps(P, F, _mm512_set1_ps(1.3981999507e-3f));
+    P = _mm512_fmadd_ps(P, F, _mm512_set1_ps(8.3334519073e-3f));
+    P = _mm512_fmadd_ps(P, F, _mm512_set1_ps(4.1665795894e-2f));
+    P = _mm512_fmadd_ps(P, F, _mm512_set1_ps(1.6666665459e-1f));
+    P = _mm512_fmadd_ps(P, F, _mm512_set1_ps(5.0000001201e-1f));
+    const __m512 E = _mm512_add_ps(_mm512_fmadd_ps(_mm512_mul_ps(P, F), F, F), _mm512_set1_ps(1.0f));
+
+    const __m512 SCALE = _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_add_epi32(NI, _mm512_set1_epi32(127)), 23));
+    return _mm512_mul_ps(E, SCALE);
+}
+
+TARGET_AVX512 static size_t rsqrt_avx512(size_t i, const float* x, float* out, size_t count)
+{
+    for(; i + 16 <= count; i += 16) {
+        _mm512_storeu_ps(out + i, rsqrt_avx512(_mm512_loadu_ps(x + i)));
+    }
+    return i;
+}
+
+TARGET_AVX512 static size_t sqrt_avx512(size_t i, const float* x, float* out, size_t count)
+{
+    for(; i + 16 <= count; i += 16) {
+        const __m512 X = _mm512_loadu_ps(x + i);
+        _mm512_storeu_ps(out + i, _mm512_maskz_mul_ps(_mm512_cmp_ps_mask(X, _mm512_setzero_ps(), _CMP_GT_OQ), X, rsqrt_avx512(X)));
+    }
+    return i;
+}
+
+TARGET_AVX512 static size_t sin_avx512(size_t i, const float* x, float* out, size_t count)
+{
+    for(; i + 16 <= count; i += 16) {
+        _mm512_storeu_ps(out + i, sin_avx512(_mm512_loadu_ps(x + i)));
+    }
+    return i;
+}
+
+TARGET_AVX512 static size_t cos_avx512(size_t i, const float* x, float* out, size_t count)
+{
+    for(; i + 16 <= count; i += 16) {
+        _mm512_storeu_ps(out + i, cos_avx512(_mm512_loadu_ps(x + i)));
+    }
+    return i;
+}
+
+TARGET_AVX512 static size_t atan2_avx512(size_t i, const float* y, const float* x, float* out, size_t count)
+{
+    for(; i + 16 <= count; i += 16) {
+        _mm512_storeu_ps(out + i, atan2_avx512(_mm512_loadu_ps(y + i), _mm512_loadu_ps(x + i)));
+    }
+    return i;
+}
+
+TARGET_AVX512 static size_t exp_avx512(size_t i, const float* x, float* out, size_t count)
+{
+    for(; i + 16 <= count; i += 16) {
+        _mm512_storeu_ps(out + i, exp_avx512(_mm512_loadu_ps(x + i)));
+    }
+    return i;
+}
+#endif
+
+void fast_rsqrt(const float* const x, float* const out, size_t count)
+{
+    size_t i = 0;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, rsqrt, x, out, count);
+#endif
+    for(; i<count; ++i) {
+        out[i] = fast_rsqrt(x[i]);
+    }
+}
+
+void fast_sqrt(const float* const x, float* const out, size_t count)
+{
+    size_t i = 0;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, sqrt, x, out, count);
+#endif
+    for(; i<count; ++i) {
+        out[i] = fast_sqrt(x[i]);
+    }
+}
+
+void fast_sin(const float* const x, float* const out, size_t count)
+{
+    size_t i = 0;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, sin, x, out, count);
+#endif
+    for(; i<count; ++i) {
+        out[i] = fast_sin(x[i]);
+    }
+}
+
+void fast_cos(const float* const x, float* const out, size_t count)
+{
+    size_t i = 0;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, cos, x, out, count);
+#endif
+    for(; i<count; ++i) {
+        out[i] = fast_cos(x[i]);
+    }
+}
+
+void fast_atan2(const float* const y, const float* const x, float* const out, size_t count)
+{
+    size_t i = 0;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, atan2, y, x, out, count);
+#endif
+    for(; i<count; ++i) {
+        out[i] = fast_atan2(y[i], x[i]);
+    }
+}
+
+void fast_exp(const float* const x, float* const out, size_t count)
+{
+    size_t i = 0;
+#if defined USE_SSE
+    SIMD_DISPATCH(i, exp, x, out, count);
+#endif
+    for(; i<count; ++i) {
+        out[i] = fast_exp(x[i]);
+    }
+}
+
+}
+
+#if defined WITH_UNIT_TESTS
+#include "src/test/UnitTest.h"
+#include "Vector.h"
+
+class FastMathTest : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(FastMathTest);
+        CPPUNIT_TEST(test_rsqrt);
+        CPPUNIT_TEST(test_sin_cos);
+        CPPUNIT_TEST(test_atan2);
+        CPPUNIT_TEST(test_exp);
+        CPPUNIT_TEST(test_precision);
+        CPPUNIT_TEST(test_benchmark);
+    CPPUNIT_TEST_SUITE_END();
+
+private:
+    static energonsoftware::Logger& logger;
+
+    // enough values to cover every kernel plus a scalar tail
+    static const size_t COUNT = 100003;
+
+public:
+    FastMathTest() : CppUnit::TestFixture() {}
+    virtual ~FastMathTest() noexcept {}
+
+public:
+    void tearDown() override
+    {
+        energonsoftware::set_simd_level(energonsoftware::detected_simd_level());
+    }
+
+    void test_rsqrt()
+    {
+        // across a lot of exponents
+        std::vector<float> x(COUNT);
+        for(size_t i=0; i<COUNT; ++i) {
+            x[i] = std::pow(10.0f, -20.0f + (40.0f * i) / COUNT);
+        }
+
+        check_relative(x, [](float v) { return energonsoftware::fast_rsqrt(v); },
+            [](const float* in, float* out, size_t count) { energonsoftware::fast_rsqrt(in, out, count); },
+            [](double v) { return 1.0 / std::sqrt(v); }, 5e-7);
+        check_relative(x, [](float v) { return energonsoftware::fast_sqrt(v); },
+            [](const float* in, float* out, size_t count) { energonsoftware::fast_sqrt(in, out, count); },
+            [](double v) { return std::sqrt(v); }, 5e-7);
+
+        CPPUNIT_ASSERT_EQUAL(0.0f, energonsoftware::fast_sqrt(0.0f));
+        const float zeros[17] = { 0.0f };
+        float out[17];
+        for(energonsoftware::SimdLevel level : energonsoftware::supported_simd_levels()) {
+            energonsoftware::set_simd_level(level);
+            energonsoftware::fast_sqrt(zeros, out, 17);
+            for(size_t i=0; i<17; ++i) {
+                CPPUNIT_ASSERT_EQUAL(0.0f, out[i]);
+            }
+        }
+    }
+
+    void test_sin_cos()
+    {
+        std::vector<float> x(COUNT);
+        for(size_t i=0; i<COUNT; ++i) {
+            x[i] = -1000.0f + (2000.0f * i) / COUNT;
+        }
+
+        check_absolute(x, [](float v) { return energonsoftware::fast_sin(v); },
+            [](const float* in, float* out, size_t count) { energonsoftware::fast_sin(in, out, count); },
+            [](double v) { return std::sin(v); }, 5e-7);
+        check_absolute(x, [](float v) { return energonsoftware::fast_cos(v); },
+            [](const float* in, float* out, size_t count) { energonsoftware::fast_cos(in, out, count); },
+            [](double v) { return std::cos(v); }, 5e-7);
+
+        // and out to the edge of the range
+        for(size_t i=0; i<COUNT; ++i) {
+            x[i] = -30000.0f + (60000.0f * i) / COUNT;
+        }
+        check_absolute(x, [](float v) { return energonsoftware::fast_sin(v); },
+            [](const float* in, float* out, size_t count) { energonsoftware::fast_sin(in, out, count); },
+            [](double v) { return std::sin(v); }, 5e-7);
+        check_absolute(x, [](float v) { return energonsoftware::fast_cos(v); },
+            [](const float* in, float* out, size_t count) { energonsoftware::fast_cos(in, out, count); },
+            [](double v) { return std::cos(v); }, 5e-7);
+
+        CPPUNIT_ASSERT_EQUAL(0.0f, energonsoftware::fast_sin(0.0f));
+        CPPUNIT_ASSERT_EQUAL(1.0f, energonsoftware::fast_cos(0.0f));
+    }
+
+    void test_atan2()
+    {
+        // around the circle at a few radii, plus the axes
+        std::vector<float> y, x;
+        for(size_t i=0; i<COUNT / 4; ++i) {
+            const double angle = (2.0 * M_PI * i) / (COUNT / 4);
+            for(double radius : { 0.001, 1.0, 37.5, 1.0e6 }) {
+                y.push_back(static_cast<float>(radius * std::sin(angle)));
+                x.push_back(static_cast<float>(radius * std::cos(angle)));
+            }
+        }
+        for(float v : { 1.0f, -1.0f }) {
+            y.push_back(v); x.push_back(0.0f);
+            y.push_back(0.0f); x.push_back(v);
+        }
+
+        std::vector<float> out(x.size());
+        for(energonsoftware::SimdLevel level : energonsoftware::supported_simd_levels()) {
+            energonsoftware::set_simd_level(level);
+            energonsoftware::fast_atan2(y.data(), x.data(), out.data(), x.size());
+
+            double worst = 0.0;
+            for(size_t i=0; i<x.size(); ++i) {
+                const double expected = std::atan2(static_cast<double>(y[i]), static_cast<double>(x[i]));
+                worst = std::max(worst, angle_error(expected, energonsoftware::fast_atan2(y[i], x[i])));
+                worst = std::max(worst, angle_error(expected, out[i]));
+            }
+            CPPUNIT_ASSERT(worst < 2e-6);
+        }
+
+        CPPUNIT_ASSERT_EQUAL(0.0f, energonsoftware::fast_atan2(0.0f, 0.0f));
+    }
+
+    void test_exp()
+    {
+        std::vector<float> x(COUNT);
+        for(size_t i=0; i<COUNT; ++i) {
+            x[i] = -87.0f + (175.0f * i) / COUNT;
+        }
+
+        check_relative(x, [](float v) { return energonsoftware::fast_exp(v); },
+            [](const float* in, float* out, size_t count) { energonsoftware::fast_exp(in, out, count); },
+            [](double v) { return std::exp(v); }, 5e-7);
+
+        // clamped rather than overflowing
+        CPPUNIT_ASSERT(std::isfinite(energonsoftware::fast_exp(1000.0f)));
+        CPPUNIT_ASSERT(energonsoftware::fast_exp(-1000.0f) > 0.0f);
+    }
+
+    void test_precision()
+    {
+        CPPUNIT_ASSERT_EQUAL(std::sin(0.5f), energonsoftware::sin_p(0.5f, energonsoftware::Precision::Exact));
+        CPPUNIT_ASSERT_EQUAL(energonsoftware::fast_sin(0.5f), energonsoftware::sin_p(0.5f, energonsoftware::Precision::Fast));
+        CPPUNIT_ASSERT_EQUAL(std::atan2(1.0f, 2.0f), energonsoftware::atan2_p(1.0f, 2.0f, energonsoftware::Precision::Exact));
+        CPPUNIT_ASSERT_EQUAL(energonsoftware::fast_exp(2.0f), energonsoftware::exp_p(2.0f, energonsoftware::Precision::Fast));
+
+        const energonsoftware::Vector3 v(3.0f, 4.0f, 12.0f);
+        CPPUNIT_ASSERT_EQUAL(13.0f, v.length(energonsoftware::Precision::Exact));
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(13.0f, v.length(energonsoftware::Precision::Fast), 13.0f * 5e-7f);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0f, v.normalized(energonsoftware::Precision::Fast).length(), 1e-6f);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0f, v.normalized(energonsoftware::Precision::Exact).length(), 1e-6f);
+    }
+
+    // not really a test, this logs the worst error (relative or absolute, as documented)
+    // and the time for the fast versions against std:: at each level
+    void test_benchmark()
+    {
+        std::vector<float> x(COUNT), y(COUNT), out(COUNT);
+        for(size_t i=0; i<COUNT; ++i) {
+            x[i] = 0.001f + (100.0f * i) / COUNT;
+            y[i] = 50.0f - x[i];
+        }
+
+        benchmark("rsqrt", true, x, out, [](float v) { return 1.0f / std::sqrt(v); },
+            [&]() { energonsoftware::fast_rsqrt(x.data(), out.data(), COUNT); });
+        benchmark("sin", false, x, out, [](float v) { return std::sin(v); },
+            [&]() { energonsoftware::fast_sin(x.data(), out.data(), COUNT); });
+        benchmark("cos", false, x, out, [](float v) { return std::cos(v); },
+            [&]() { energonsoftware::fast_cos(x.data(), out.data(), COUNT); });
+        benchmark("exp", true, x, out, [](float v) { return std::exp(v - 50.0f); },
+            [&]() {
+                for(size_t i=0; i<COUNT; ++i) {
+                    out[i] = x[i] - 50.0f;
+                }
+                energonsoftware::fast_exp(out.data(), out.data(), COUNT);
+            });
+
+        // atan2 takes 2 inputs
+        std::vector<float> expected(COUNT);
+        const double exact = time([&]() {
+            for(size_t i=0; i<COUNT; ++i) {
+                expected[i] = std::atan2(y[i], x[i]);
+            }
+        });
+        for(energonsoftware::SimdLevel level : energonsoftware::supported_simd_levels()) {
+            energonsoftware::set_simd_level(level);
+            const double fast = time([&]() { energonsoftware::fast_atan2(y.data(), x.data(), out.data(), COUNT); });
+            log_result("atan2", level, worst_absolute(expected, out), exact, fast);
+        }
+    }
+
+private:
+    static double angle_error(double expected, float actual)
+    {
+        // pi and -pi are the same angle
+        const double error = std::fabs(expected - actual);
+        return std::min(error, std::fabs(error - (2.0 * M_PI)));
+    }
+
+    template<typename S, typename A, typename E>
+    void check_relative(const std::vector<float>& x, const S& scalar, const A& array, const E& exact, double bound)
+    {
+        std::vector<float> out(x.size());
+        for(energonsoftware::SimdLevel level : energonsoftware::supported_simd_levels()) {
+            energonsoftware::set_simd_level(level);
+            array(x.data(), out.data(), x.size());
+
+            double worst = 0.0;
+            for(size_t i=0; i<x.size(); ++i) {
+                const double expected = exact(static_cast<double>(x[i]));
+                worst = std::max(worst, std::fabs((scalar(x[i]) - expected) / expected));
+                worst = std::max(worst, std::fabs((out[i] - expected) / expected));
+            }
+            CPPUNIT_ASSERT(worst < bound);
+        }
+    }
+
+    template<typename S, typename A, typename E>
+    void check_absolute(const std::vector<float>& x, const S& scalar, const A& array, const E& exact, double bound)
+    {
+        std::vector<float> out(x.size());
+        for(energonsoftware::SimdLevel level : energonsoftware::supported_simd_levels()) {
+            energonsoftware::set_simd_level(level);
+            array(x.data(), out.data(), x.size());
+
+            double worst = 0.0;
+            for(size_t i=0; i<x.size(); ++i) {
+                const double expected = exact(static_cast<double>(x[i]));
+                worst = std::max(worst, std::fabs(scalar(x[i]) - expected));
+                worst = std::max(worst, std::fabs(out[i] - expected));
+            }
+            CPPUNIT_ASSERT(worst < bound);
+        }
+    }
+
+    template<typename F>
+    static double time(const F& f)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    static double worst_absolute(const std::vector<float>& expected, const std::vector<float>& actual)
+    {
+        double worst = 0.0;
+        for(size_t i=0; i<expected.size(); ++i) {
+            worst = std::max(worst, static_cast<double>(std::fabs(expected[i] - actual[i])));
+        }
+        return worst;
+    }
+
+    template<typename E, typename F>
+    void benchmark(const char* const name, bool relative, const std::vector<float>& x, std::vector<float>& out, const E& exact, const F& fast)
+    {
+        std::vector<float> expected(x.size());
+        const double exact_time = time([&]() {
+            for(size_t i=0; i<x.size(); ++i) {
+                expected[i] = exact(x[i]);
+            }
+        });
+
+        for(energonsoftware::SimdLevel level : energonsoftware::supported_simd_levels()) {
+            energonsoftware::set_simd_level(level);
+            const double fast_time = time(fast);
+
+            double worst = 0.0;
+            for(size_t i=0; i<x.size(); ++i) {
+                const double error = std::fabs(static_cast<double>(out[i]) - expected[i]);
+                worst = std::max(worst, relative ? error / std::fabs(expected[i]) : error);
+            }
+            log_result(name, level, worst, exact_time, fast_time);
+        }
+    }
+
+    void log_result(const char* const name, energonsoftware::SimdLevel level, double error, double exact, double fast)
+    {
+        LOG_INFO(name << " (" << energonsoftware::simd_level_name(level) << "): worst error " << error
+            << ", std:: " << exact << "us, fast " << fast << "us (" << (exact / std::max(fast, 0.001)) << "x)\n");
+    }
+};
+
+const size_t FastMathTest::COUNT;
+energonsoftware::Logger& FastMathTest::logger(energonsoftware::Logger::instance("energonsoftware.core.math.FastMathTest"));
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FastMathTest);
+
+#endif
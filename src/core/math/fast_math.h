@@ -0,0 +1,157 @@
+#if !defined __FASTMATH_H__
+#define __FASTMATH_H__
+
+#include <cmath>
+#include "math_util.h"
+
+namespace energonsoftware {
+
+/*
+Approximate math.
+
+The worst case errors noted on each function are measured against the
+double precision std:: functions (see FastMathTest), relative for rsqrt,
+sqrt and exp and absolute for sin, cos and atan2.
+
+The array versions run SSE3, AVX2 or AVX-512 kernels picked at runtime (see cpu_util.h),
+they may not match the scalar versions bit for bit but they're within the same bounds.
+Builds without SSE fall back to the exact functions for rsqrt and sqrt.
+
+Call sites that need to pick a precision (or switch between them for testing)
+can use the _p versions that take a Precision, Exact goes straight to std::.
+*/
+
+enum class Precision
+{
+    Exact,
+    Fast
+};
+
+// 1 / sqrt(x), x must be > 0
+// rsqrt estimate plus one Newton-Raphson step, relative error < 5e-7
+inline float fast_rsqrt(float x)
+{
+#if defined USE_SSE
+    const float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+    return y * (1.5f - (0.5f * x * y * y));
+#else
+    return 1.0f / std::sqrt(x);
+#endif
+}
+
+// x must be >= 0, relative error < 5e-7
+inline float fast_sqrt(float x)
+{
+    return x > 0.0f ? x * fast_rsqrt(x) : 0.0f;
+}
+
+// sin(r) for r in [-pi/2, pi/2], a degree 9 polynomial
+inline float sin_polynomial(float r)
+{
+    const float s = r * r;
+    float p = 2.6083159809786593541503e-06f;
+    p = (p * s) - 0.0001981069071916863322258f;
+    p = (p * s) + 0.00833307858556509017944336f;
+    p = (p * s) - 0.166666597127914428710938f;
+    return r + (r * s * p);
+}
+
+// reduced to [-pi/2, pi/2] around the nearest multiple of pi
+// (good for |x| < 30000), absolute error < 5e-7
+inline float fast_sin(float x)
+{
+    const float q = static_cast<float>(std::lrint(x * 0.318309886183790671538f));
+
+    // pi split up so that q * each part is exact
+    float r = x - (q * 3.140625f);
+    r -= q * 0.0009670257568359375f;
+    r -= q * 6.2771141529083251953e-07f;
+    r -= q * 1.2154201256553420762e-10f;
+
+    r = sin_polynomial(r);
+    return (static_cast<long>(q) & 1) ? -r : r;
+}
+
+// reduced to [-pi/2, pi/2] around the nearest odd multiple of pi/2
+// (good for |x| < 30000), absolute error < 5e-7
+inline float fast_cos(float x)
+{
+    const float q = static_cast<float>((2 * std::lrint((x * 0.318309886183790671538f) - 0.5f)) + 1);
+
+    float r = x - (q * 1.5703125f);
+    r -= q * 0.00048351287841796875f;
+    r -= q * 3.1385570764541625977e-07f;
+    r -= q * 6.0771006282767103812e-11f;
+
+    r = sin_polynomial(r);
+    return (static_cast<long>(q) & 2) ? r : -r;
+}
+
+// atan of the smaller over the larger of |y| and |x| with a degree 11 polynomial,
+// moved into the right quadrant, absolute error < 2e-6, fast_atan2(0, 0) is 0
+inline float fast_atan2(float y, float x)
+{
+    const float ay = std::fabs(y), ax = std::fabs(x);
+    const float mx = std::max(ay, ax), mn = std::min(ay, ax);
+    const float a = mx > 0.0f ? mn / mx : 0.0f;
+
+    const float s = a * a;
+    float p = -0.01172120f;
+    p = (p * s) + 0.05265332f;
+    p = (p * s) - 0.11643287f;
+    p = (p * s) + 0.19354346f;
+    p = (p * s) - 0.33262347f;
+    p = (p * s) + 0.99997726f;
+    float r = a * p;
+
+    if(ay > ax) {
+        r = static_cast<float>(M_PI_2) - r;
+    }
+    if(x < 0.0f) {
+        r = static_cast<float>(M_PI) - r;
+    }
+    return y < 0.0f ? -r : r;
+}
+
+// 2^n * e^f with f in [-ln(2)/2, ln(2)/2] and a degree 5 polynomial for e^f,
+// x is clamped to [-87.3, 88.3] (so the result stays a normal float), relative error < 5e-7
+inline float fast_exp(float x)
+{
+    x = std::min(std::max(x, -87.3365447505531f), 88.3762626647949f);
+
+    const float n = static_cast<float>(std::lrint(x * 1.44269504088896340736f));
+    float f = x - (n * 0.693359375f);
+    f -= n * -2.12194440e-4f;
+
+    float p = 1.9875691500e-4f;
+    p = (p * f) + 1.3981999507e-3f;
+    p = (p * f) + 8.3334519073e-3f;
+    p = (p * f) + 4.1665795894e-2f;
+    p = (p * f) + 1.6666665459e-1f;
+    p = (p * f) + 5.0000001201e-1f;
+    const float e = (p * f * f) + f + 1.0f;
+
+    const uint32_t bits = static_cast<uint32_t>(static_cast<int32_t>(n) + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return e * scale;
+}
+
+inline float rsqrt_p(float x, Precision precision) { return Precision::Fast == precision ? fast_rsqrt(x) : 1.0f / std::sqrt(x); }
+inline float sqrt_p(float x, Precision precision) { return Precision::Fast == precision ? fast_sqrt(x) : std::sqrt(x); }
+inline float sin_p(float x, Precision precision) { return Precision::Fast == precision ? fast_sin(x) : std::sin(x); }
+inline float cos_p(float x, Precision precision) { return Precision::Fast == precision ? fast_cos(x) : std::cos(x); }
+inline float atan2_p(float y, float x, Precision precision) { return Precision::Fast == precision ? fast_atan2(y, x) : std::atan2(y, x); }
+inline float exp_p(float x, Precision precision) { return Precision::Fast == precision ? fast_exp(x) : std::exp(x); }
+
+// array versions, out may be the same array as the input
+void fast_rsqrt(const float* const x, float* const out, size_t count);
+void fast_sqrt(const float* const x, float* const out, size_t count);
+void fast_sin(const float* const x, float* const out, size_t count);
+void fast_cos(const float* const x, float* const out, size_t count);
+void fast_atan2(const float* const y, const float* const x, float* const out, size_t count);
+void fast_exp(const float* const x, float* const out, size_t count);
+
+}
+
+#endif
@@ -18,6 +18,7 @@ public:
         CPPUNIT_TEST(test_ilog2);
         CPPUNIT_TEST(test_power_of_2);
         CPPUNIT_TEST(test_invsqrt);
+        CPPUNIT_TEST(test_half);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -91,6 +92,31 @@ public:
         CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0f / std::sqrt(1234.0f), energonsoftware::invsqrt(1234.0f), 0.0001);
         CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0f / std::sqrt(5000.0f), energonsoftware::invsqrt(5000.0f), 0.0001);
     }
+
+    void test_half()
+    {
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(0x0000), energonsoftware::float_to_half(0.0f));
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(0x3c00), energonsoftware::float_to_half(1.0f));
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(0xc000), energonsoftware::float_to_half(-2.0f));
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(0x7bff), energonsoftware::float_to_half(65504.0f));
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(0x7c00), energonsoftware::float_to_half(100000.0f));
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(0x0001), energonsoftware::float_to_half(std::pow(2.0f, -24.0f)));
+
+        // halfway between 1 and the next half rounds to even
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(0x3c00), energonsoftware::float_to_half(1.0f + std::pow(2.0f, -11.0f)));
+
+        // every finite half survives the round trip
+        for(uint32_t h=0; h<0x10000; ++h) {
+            if((h & 0x7c00) == 0x7c00) {
+                continue;
+            }
+            CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(h), energonsoftware::float_to_half(energonsoftware::half_to_float(static_cast<uint16_t>(h))));
+        }
+
+        CPPUNIT_ASSERT(std::isinf(energonsoftware::half_to_float(0x7c00)));
+        CPPUNIT_ASSERT(std::isnan(energonsoftware::half_to_float(energonsoftware::float_to_half(std::numeric_limits<float>::quiet_NaN()))));
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(0.333f, energonsoftware::half_to_float(energonsoftware::float_to_half(0.333f)), 0.0002);
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(MathTest);
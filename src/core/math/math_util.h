@@ -96,6 +96,67 @@ inline unsigned int power_of_2(unsigned int i)
     return i + 1;
 }
 
+// converts to and from IEEE 754 half precision floats (rounding to nearest even),
+// values too big for a half become infinity
+// http://fgiesen.wordpress.com/2012/03/28/half-to-float-done-quic/
+inline uint16_t float_to_half(float f)
+{
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+
+    const uint32_t sign = x & 0x80000000;
+    x ^= sign;
+
+    uint32_t h = 0;
+    if(x >= (127 + 16) << 23) {
+        // infinity or NaN (which stays a NaN)
+        h = x > (255 << 23) ? 0x7e00 : 0x7c00;
+    } else if(x < (113 << 23)) {
+        // subnormal or zero, adding the magic number lines
+        // the mantissa up at the bottom and does the rounding
+        static const uint32_t DENORMAL_MAGIC = ((127 - 15) + (23 - 10) + 1) << 23;
+        float magic, value;
+        std::memcpy(&magic, &DENORMAL_MAGIC, sizeof(magic));
+        std::memcpy(&value, &x, sizeof(value));
+        value += magic;
+        std::memcpy(&x, &value, sizeof(x));
+        h = x - DENORMAL_MAGIC;
+    } else {
+        // rebias the exponent and round
+        const uint32_t odd = (x >> 13) & 1;
+        x += (static_cast<uint32_t>(15 - 127) << 23) + 0xfff + odd;
+        h = x >> 13;
+    }
+    return static_cast<uint16_t>(h | (sign >> 16));
+}
+
+inline float half_to_float(uint16_t h)
+{
+    static const uint32_t SHIFTED_EXPONENT = 0x7c00 << 13;
+
+    uint32_t x = (h & 0x7fff) << 13;
+    const uint32_t exponent = x & SHIFTED_EXPONENT;
+    x += (127 - 15) << 23;
+
+    float f;
+    if(SHIFTED_EXPONENT == exponent) {
+        // infinity or NaN
+        x += (128 - 16) << 23;
+        std::memcpy(&f, &x, sizeof(f));
+    } else if(0 == exponent) {
+        // zero or subnormal, renormalize
+        static const uint32_t MAGIC = 113 << 23;
+        float magic;
+        std::memcpy(&magic, &MAGIC, sizeof(magic));
+        x += 1 << 23;
+        std::memcpy(&f, &x, sizeof(f));
+        f -= magic;
+    } else {
+        std::memcpy(&f, &x, sizeof(f));
+    }
+    return (h & 0x8000) ? -f : f;
+}
+
 inline float invsqrt(float x)
 {
 #if defined USE_SSE
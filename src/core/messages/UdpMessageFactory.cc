@@ -8,9 +8,9 @@ namespace energonsoftware {
 
 Logger& UdpMessageFactory::logger(Logger::instance("energonsoftware.core.messages.UdpMessageFactory"));
 
-UdpMessageFactory::FactoryMessage::FactoryMessage(unsigned int packetid, unsigned int chunkcount, unsigned int ttl, std::shared_ptr<ClientSocket> socket)
+UdpMessageFactory::FactoryMessage::FactoryMessage(unsigned int packetid, unsigned int chunkcount, unsigned int ttl, std::shared_ptr<ClientSocket> socket, MemoryAllocator* const allocator)
     : _packetid(packetid), _chunkcount(chunkcount), _ttl(ttl), _socket(socket),
-        _chunks(), _last_chunk_time(0.0), _message(), _len(0)
+        _chunks(0, ChunkMap::hasher(), ChunkMap::key_equal(), ChunkMap::allocator_type(allocator)), _last_chunk_time(0.0), _message(), _len(0)
 {
 }
 
@@ -48,8 +48,8 @@ void UdpMessageFactory::FactoryMessage::set(unsigned int k, UdpMessage::UdpMessa
     _last_chunk_time = get_time();
 }
 
-UdpMessageFactory::UdpMessageFactory()
-    : _messages()
+UdpMessageFactory::UdpMessageFactory(MemoryAllocator* const allocator)
+    : _allocator(allocator), _messages(0, FactoryMessageMap::hasher(), FactoryMessageMap::key_equal(), FactoryMessageMap::allocator_type(allocator))
 {
 }
 
@@ -74,11 +74,12 @@ bool UdpMessageFactory::append(UdpMessage::UdpMessageChunk& chunk, std::shared_p
     // TODO: validate all of this shit before blindly saving it
 
     // create or find the message to append to
-    std::shared_ptr<FactoryMessage> message(new FactoryMessage(packetid, chunkcount, ttl, socket));
-    if(_messages.find(packetid) != _messages.end()) {
-        message = _messages[packetid];
+    FactoryMessageMap::iterator it = _messages.find(packetid);
+    if(it == _messages.end()) {
+        it = _messages.emplace(packetid, std::allocate_shared<FactoryMessage>(StlAllocator<FactoryMessage>(_allocator),
+            packetid, chunkcount, ttl, socket, _allocator)).first;
     }
-    _messages[message->packetid()] = message;
+    std::shared_ptr<FactoryMessage> message(it->second);
 
     // yeah you done fucked up buddy
     if(message->complete()) {
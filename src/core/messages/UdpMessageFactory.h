@@ -2,6 +2,7 @@
 #define __UDPMESSAGEFACTORY_H__
 
 #include "src/core/network/Socket.h"
+#include "src/core/util/StlAllocator.h"
 #include "UdpMessage.h"
 
 namespace energonsoftware {
@@ -17,7 +18,7 @@ public:
     class FactoryMessage
     {
     public:
-        FactoryMessage(unsigned int packetid, unsigned int chunkcount, unsigned int ttl, std::shared_ptr<ClientSocket> socket);
+        FactoryMessage(unsigned int packetid, unsigned int chunkcount, unsigned int ttl, std::shared_ptr<ClientSocket> socket, MemoryAllocator* const allocator=nullptr);
         virtual ~FactoryMessage() noexcept {}
 
     public:
@@ -36,13 +37,17 @@ public:
 
         void set(unsigned int k, UdpMessage::UdpMessageChunk& v);
 
+    private:
+        typedef std::unordered_map<unsigned int, UdpMessage::UdpMessageChunk, std::hash<unsigned int>, std::equal_to<unsigned int>,
+            StlAllocator<std::pair<const unsigned int, UdpMessage::UdpMessageChunk>>> ChunkMap;
+
     private:
         unsigned int _packetid;
         unsigned int _chunkcount;
         unsigned int _ttl;
         std::shared_ptr<ClientSocket> _socket;
 
-        std::unordered_map<unsigned int, UdpMessage::UdpMessageChunk> _chunks;
+        ChunkMap _chunks;
         double _last_chunk_time;
 
         std::shared_ptr<Socket::BufferType> _message;
@@ -54,10 +59,12 @@ public:
     };
 
 private:
-    typedef std::unordered_map<unsigned int, std::shared_ptr<FactoryMessage> > FactoryMessageMap;
+    typedef std::unordered_map<unsigned int, std::shared_ptr<FactoryMessage>, std::hash<unsigned int>, std::equal_to<unsigned int>,
+        StlAllocator<std::pair<const unsigned int, std::shared_ptr<FactoryMessage>>>> FactoryMessageMap;
 
 public:
-    UdpMessageFactory();
+    // messages and their chunks are allocated from allocator (or the heap if there isn't one)
+    explicit UdpMessageFactory(MemoryAllocator* const allocator=nullptr);
     virtual ~UdpMessageFactory() noexcept {}
 
 public:
@@ -73,6 +80,7 @@ public:
     FactoryMessage& get(unsigned int k) throw(std::out_of_range) { return *(_messages.at(k)); }
 
 private:
+    MemoryAllocator* _allocator;
     FactoryMessageMap _messages;
 
 private:
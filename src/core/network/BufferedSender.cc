@@ -61,16 +61,22 @@ bool BufferedSender::current_buffer_encoded() const
     return _current ? _current->encode() : false;
 }
 
-std::shared_ptr<BufferedMessage> BufferedSender::current_message()
+BufferedMessage* BufferedSender::current_message()
 {
     pop_buffer();
-    return _current;
+    return _current.get();
 }
 
 void BufferedSender::buffer(BufferedMessage* message)
 {
     if(!message) return;
-    _buffer.push(std::shared_ptr<BufferedMessage>(message));
+    _buffer.push(PoolHandle<BufferedMessage>::adopt(message));
+}
+
+void BufferedSender::buffer(PoolHandle<BufferedMessage>&& message)
+{
+    if(!message) return;
+    _buffer.push(std::move(message));
 }
 
 unsigned long BufferedSender::next_packet_id()
@@ -105,14 +111,19 @@ void BufferedSender::clear_current()
     _current.reset();
 }
 
+PoolHandle<BufferedMessage> BufferedSender::take_current()
+{
+    return std::move(_current);
+}
+
 void BufferedSender::pop_buffer()
 {
     if(_current && _current->finished()) {
         clear_current();
     }
 
-    if(nullptr == _current) {
-        _current = _buffer.front();
+    if(!_current) {
+        _current = std::move(_buffer.front());
         _buffer.pop();
         _current->reset();
 
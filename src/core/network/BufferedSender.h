@@ -2,6 +2,7 @@
 #define __BUFFEREDSENDER_H__
 
 #include "src/core/messages/BufferedMessage.h"
+#include "src/core/util/ObjectPool.h"
 #include "Socket.h"
 
 namespace energonsoftware {
@@ -43,17 +44,19 @@ public:
     virtual ~BufferedSender() noexcept;
 
 public:
-    bool buffer_empty() const { return (nullptr == _current || _current->finished()) && _buffer.empty(); }
+    bool buffer_empty() const { return (!_current || _current->finished()) && _buffer.empty(); }
 
     void reset_buffer();
     const Socket::BufferType* current_buffer();
     size_t current_buffer_len() const;
     bool current_buffer_encoded() const;
 
-    std::shared_ptr<BufferedMessage> current_message();
+    // this is only valid until the current message is cleared
+    BufferedMessage* current_message();
 
     // message should have been allocated with new
     void buffer(BufferedMessage* message);
+    void buffer(PoolHandle<BufferedMessage>&& message);
 
     unsigned long next_packet_id();
 
@@ -63,12 +66,15 @@ protected:
     void clear_buffer();
     void clear_current();
 
+    // takes ownership of the current message
+    PoolHandle<BufferedMessage> take_current();
+
 private:
     void pop_buffer();
 
 private:
-    std::queue<std::shared_ptr<BufferedMessage> > _buffer;
-    std::shared_ptr<BufferedMessage> _current;
+    std::queue<PoolHandle<BufferedMessage>> _buffer;
+    PoolHandle<BufferedMessage> _current;
     unsigned long _packet_count;
 
 private:
@@ -135,6 +135,30 @@ bool HttpSession::send_from_file(const boost::filesystem::path& filename, const
     return send_ok(replace_vars(content, values));
 }
 
+bool HttpSession::send_memory_stats()
+{
+    std::map<std::string, MemoryAllocator::Stats> stats;
+    MemoryAllocator::tag_stats(stats);
+
+    std::stringstream scratch;
+    scratch << "<html><body><table>"
+        << "<tr><th>Tag</th><th>Live allocations</th><th>Live bytes</th><th>Peak bytes</th>"
+        << "<th>Reserved bytes</th><th>Total bytes</th><th>Allocations</th><th>Allocations/s</th></tr>";
+    for(const auto& s : stats) {
+        scratch << "<tr><td>" << (s.first.empty() ? "(untagged)" : s.first) << "</td>"
+            << "<td>" << s.second.count << "</td>"
+            << "<td>" << s.second.bytes << "</td>"
+            << "<td>" << s.second.peak_bytes << "</td>"
+            << "<td>" << s.second.used << "</td>"
+            << "<td>" << s.second.total << "</td>"
+            << "<td>" << s.second.total_count << "</td>"
+            << "<td>" << s.second.allocation_rate() << "</td></tr>";
+    }
+    scratch << "</table></body></html>";
+
+    return send_ok(scratch.str());
+}
+
 bool HttpSession::on_handle_request(const std::string& command, const std::string& path)
 {
     if(strcasecmp(command.c_str(), "GET"))
@@ -142,6 +166,8 @@ bool HttpSession::on_handle_request(const std::string& command, const std::strin
 
     if(path == "/") {
         return send_ok("<html><body>This is the default HttpHandler page</body></html>");
+    } else if(path == "/memory") {
+        return send_memory_stats();
     }
     return send_not_found();
 }
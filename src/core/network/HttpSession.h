@@ -44,6 +44,9 @@ protected:
     // sends a file to the client, replacing variables with values from the values dictionary
     bool send_from_file(const boost::filesystem::path& path, const std::unordered_map<std::string, std::string>& values);
 
+    // sends a table of the memory allocator stats
+    bool send_memory_stats();
+
 protected:
     // override these
     virtual bool on_handle_request(const std::string& command, const std::string& path);
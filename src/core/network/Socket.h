@@ -1,6 +1,7 @@
 #if !defined __SOCKET_H__
 #define __SOCKET_H__
 
+#include "src/core/util/StlAllocator.h"
 #include "network_util.h"
 
 struct hostent;
@@ -32,6 +33,9 @@ public:
 
     typedef std::array<BufferType, MAX_BUFFER * 10> Buffer;
 
+    // received data waiting to be handled
+    typedef std::vector<BufferType, StlAllocator<BufferType>> ReadBuffer;
+
 public:
     // returns the last error value
     static int last_socket_error();
@@ -6,9 +6,9 @@ namespace energonsoftware {
 
 Logger& TcpClient::logger(Logger::instance("energonsoftware.core.network.TcpClient"));
 
-TcpClient::TcpClient()
+TcpClient::TcpClient(MemoryAllocator* const allocator)
     : BufferedSender(), _socket(), _host(), _port(0), _connected(false),
-        _read_buffer()
+        _read_buffer(Socket::ReadBuffer::allocator_type(allocator))
 {
 }
 
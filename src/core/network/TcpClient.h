@@ -12,7 +12,8 @@ private:
     static Logger& logger;
 
 public:
-    TcpClient();
+    // the read buffer is allocated from allocator (or the heap if there isn't one)
+    explicit TcpClient(MemoryAllocator* const allocator=nullptr);
     virtual ~TcpClient() noexcept;
 
 public:
@@ -42,8 +43,8 @@ public:
     bool send(const std::string& message);
 
 protected:
-    std::vector<Socket::BufferType>& read_buffer() { return _read_buffer; }
-    const std::vector<Socket::BufferType>& read_buffer() const { return _read_buffer; }
+    Socket::ReadBuffer& read_buffer() { return _read_buffer; }
+    const Socket::ReadBuffer& read_buffer() const { return _read_buffer; }
 
 protected:
     // override these
@@ -61,7 +62,7 @@ private:
     std::string _host;
     unsigned short _port;
     bool _connected;
-    std::vector<Socket::BufferType> _read_buffer;
+    Socket::ReadBuffer _read_buffer;
 
 private:
     DISALLOW_COPY_AND_ASSIGN(TcpClient);
@@ -7,9 +7,9 @@ namespace energonsoftware {
 
 Logger& TcpSession::logger(Logger::instance("energonsoftware.core.network.TcpSession"));
 
-TcpSession::TcpSession(ClientSocket& socket, TcpServer& server, unsigned long sessionid)
+TcpSession::TcpSession(ClientSocket& socket, TcpServer& server, unsigned long sessionid, MemoryAllocator* const allocator)
     : BufferedSender(), _socket(socket), _server(server), _sessionid(sessionid), _connected(true),
-        _read_buffer()
+        _read_buffer(Socket::ReadBuffer::allocator_type(allocator))
 {
 }
 
@@ -14,7 +14,8 @@ private:
     static Logger& logger;
 
 public:
-    TcpSession(ClientSocket& socket, TcpServer& server, unsigned long sessionid);
+    // the read buffer is allocated from allocator (or the heap if there isn't one)
+    TcpSession(ClientSocket& socket, TcpServer& server, unsigned long sessionid, MemoryAllocator* const allocator=nullptr);
     virtual ~TcpSession() noexcept;
 
 public:
@@ -22,8 +23,8 @@ public:
     bool connected() const { return _connected; }
     bool encrypted() const { return _socket.encrypted(); }
 
-    std::vector<Socket::BufferType>& read_buffer() { return _read_buffer; }
-    const std::vector<Socket::BufferType>& read_buffer() const { return _read_buffer; }
+    Socket::ReadBuffer& read_buffer() { return _read_buffer; }
+    const Socket::ReadBuffer& read_buffer() const { return _read_buffer; }
 
     TcpServer& server() { return _server; }
     const TcpServer& server() const { return _server; }
@@ -60,7 +61,7 @@ private:
     TcpServer& _server;
     unsigned long _sessionid;
     bool _connected;
-    std::vector<Socket::BufferType> _read_buffer;
+    Socket::ReadBuffer _read_buffer;
 
 public:
     friend bool operator==(unsigned long lhs, const TcpSession& rhs) { return lhs == rhs._sessionid; }
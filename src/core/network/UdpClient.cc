@@ -9,12 +9,14 @@ Logger& UdpClient::logger(Logger::instance("energonsoftware.core.network.UdpClie
 
 UdpClient::UdpClient()
     : BufferedSender(), mtu(512), _host(), _port(0), _connected(false),
-        _socket(), _packet_count(0), _message_factory()
+        _socket(), _packet_count(0), _message_factory(), _message_pool()
 {
 }
 
 UdpClient::~UdpClient() noexcept
 {
+    // buffered messages have to go back to the pool before it goes away
+    reset_buffer();
 }
 
 bool UdpClient::connect(const std::string& host, unsigned int port)
@@ -104,7 +106,7 @@ bool UdpClient::send(const std::string& message)
 void UdpClient::buffer(BufferedMessage* message, int ttl)
 {
     message->reset();
-    BufferedSender::buffer(new UdpMessage(reinterpret_cast<const Socket::BufferType*>(message->start()), message->full_len(), next_packet_id(), mtu, message->encode(), ttl));
+    BufferedSender::buffer(_message_pool.make(reinterpret_cast<const Socket::BufferType*>(message->start()), message->full_len(), next_packet_id(), mtu, message->encode(), ttl));
 }
 
 void UdpClient::read_data()
@@ -165,7 +167,7 @@ bool UdpClient::send_packet(const UdpMessage& packet)
 void UdpClient::write_data()
 {
     while(connected() && !buffer_empty()) {
-        std::shared_ptr<UdpMessage> message(std::dynamic_pointer_cast<UdpMessage, BufferedMessage>(current_message()));
+        UdpMessage* message = dynamic_cast<UdpMessage*>(current_message());
         if(!message) {
             LOG_CRITICAL("UdpClient attempting to send non-UdpMessage!\n");
             return;
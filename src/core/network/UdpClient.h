@@ -1,6 +1,7 @@
 #if !defined __UDPCLIENT_H__
 #define __UDPCLIENT_H__
 
+#include "src/core/messages/UdpMessage.h"
 #include "src/core/messages/UdpMessageFactory.h"
 #include "BufferedSender.h"
 #include "Socket.h"
@@ -67,6 +68,9 @@ private:
     unsigned long _packet_count;
     UdpMessageFactory _message_factory;
 
+    // buffered messages come out of here
+    ObjectPool<UdpMessage> _message_pool;
+
 private:
     DISALLOW_COPY_AND_ASSIGN(UdpClient);
 };
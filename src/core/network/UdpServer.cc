@@ -30,12 +30,15 @@ Logger& UdpServer::logger(Logger::instance("energonsoftware.core.network.UdpServ
 
 UdpServer::UdpServer()
     : _socket(), _port(0), _mtu(512), _running(false), _packet_count(0),
-        _ack_packets(), _message_factory()
+        _message_pool(), _ack_packets(), _message_factory()
 {
 }
 
 UdpServer::~UdpServer() noexcept
 {
+    // buffered messages have to go back to the pool before it goes away
+    _ack_packets.clear();
+    reset_buffer();
 }
 
 bool UdpServer::restart(unsigned short port, size_t mtu)
@@ -89,7 +92,7 @@ void UdpServer::quit()
 void UdpServer::buffer(BufferedMessage* message, std::shared_ptr<ClientSocket> socket, int ttl, bool ack, unsigned int resend_time)
 {
     message->reset();
-    BufferedSender::buffer(new UdpServerMessage(reinterpret_cast<const Socket::BufferType*>(message->start()), message->full_len(), next_packet_id(),
+    BufferedSender::buffer(_message_pool.make(reinterpret_cast<const Socket::BufferType*>(message->start()), message->full_len(), next_packet_id(),
         _mtu, ttl, socket, resend_time, message->encode(), ack));
 }
 
@@ -197,7 +200,7 @@ void UdpServer::write_data()
 
     // send any packets we have buffered
     while(running() && !buffer_empty()) {
-        std::shared_ptr<UdpServerMessage> message(std::dynamic_pointer_cast<UdpServerMessage, BufferedMessage>(current_message()));
+        UdpServerMessage* message = dynamic_cast<UdpServerMessage*>(current_message());
         if(!message) {
             LOG_CRITICAL("UdpServer attempting to send non-UdpMessage!\n");
             return;
@@ -205,10 +208,11 @@ void UdpServer::write_data()
 
         //LOG_DEBUG("Popped packet; " << message->start() << "\n");
         if(send_packet(*message, *(message->socket()))) {
-            clear_current();
             if(message->ack() && message->has_seqid()) {
                 message->resent();
-                _ack_packets[message->seqid()] = message;
+                _ack_packets[message->seqid()] = take_current().static_cast_to<UdpServerMessage>();
+            } else {
+                clear_current();
             }
         } else {
             LOG_ERROR("Client closed connection!\n");
@@ -41,7 +41,7 @@ private:
     };
 
 private:
-    typedef std::unordered_map<unsigned long, std::shared_ptr<UdpServerMessage> > AckPacketMap;
+    typedef std::unordered_map<unsigned long, PoolHandle<UdpServerMessage>> AckPacketMap;
 
 private:
     static Logger& logger;
@@ -93,6 +93,9 @@ private:
     size_t _mtu;
     bool _running;
     unsigned long _packet_count;
+
+    // buffered messages come out of here
+    ObjectPool<UdpServerMessage> _message_pool;
     AckPacketMap _ack_packets;
     std::shared_ptr<UdpMessageFactory> _message_factory;
 
@@ -67,9 +67,15 @@ void Transform::scale(float scale)
 
 void Transform::transform(Matrix4& matrix) const
 {
-    matrix.translate(_position);
-    matrix *= _orientation.matrix();
-    matrix.uniform_scale(_scale);
+    // build translate * rotate * scale directly
+    // so that it only takes a single multiply
+    Matrix4 model(_orientation.matrix());
+    model *= _scale;
+    model[3] = _position.x();
+    model[7] = _position.y();
+    model[11] = _position.z();
+    model[15] = 1.0f;
+    matrix *= model;
 }
 
 std::string Transform::str() const
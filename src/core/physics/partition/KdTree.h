@@ -41,6 +41,7 @@ public:
 
 protected:
     template<typename Y, typename V> friend class PartitionFactory;
+    template<typename Y> friend class ObjectPool;
 
     KdTree(MemoryAllocator* const allocator, const std::list<std::shared_ptr<T>>& data, const B& container, std::list<std::shared_ptr<T>>& pruned, unsigned int depth)
         : TreePartition<T, B>(allocator, data, container, pruned, depth)
@@ -52,6 +53,11 @@ protected:
     {
     }
 
+    KdTree(MemoryAllocator* const allocator, const typename TreePartition<T, B>::NodePool& pool, const std::list<std::shared_ptr<T>>& data, unsigned int depth)
+        : TreePartition<T, B>(allocator, pool, data, depth)
+    {
+    }
+
 public:
     virtual size_t dimensions() const final { return Dim; }
 
@@ -71,16 +77,8 @@ private:
         TreePartition<T, B>::_data.clear();
         TreePartition<T, B>::_data.push_back(data[median]);
 
-        // subtrees always calculate their container
-        std::list<std::shared_ptr<T>> subtree(data.begin(), data.begin() + median);
-        TreePartition<T, B>::_subtrees.push_back(std::shared_ptr<TreePartition<T, B>>(
-            new(16, *allocator) KdTree<T, B, Dim>(allocator, subtree, TreePartition<T, B>::depth() - 1),
-            MemoryAllocator_delete_aligned<KdTree<T, B, Dim>, 16>(allocator)));
-
-        subtree = std::list<std::shared_ptr<T>>(data.begin() + median + 1, data.end());
-        TreePartition<T, B>::_subtrees.push_back(std::shared_ptr<TreePartition<T, B>>(
-            new(16, *allocator) KdTree<T, B, Dim>(allocator, subtree, TreePartition<T, B>::depth() - 1),
-            MemoryAllocator_delete_aligned<KdTree<T, B, Dim>, 16>(allocator)));
+        TreePartition<T, B>::template add_subtree<KdTree<T, B, Dim>>(allocator, std::list<std::shared_ptr<T>>(data.begin(), data.begin() + median));
+        TreePartition<T, B>::template add_subtree<KdTree<T, B, Dim>>(allocator, std::list<std::shared_ptr<T>>(data.begin() + median + 1, data.end()));
     }
 
 private:
@@ -15,6 +15,7 @@ public:
 
 private:
     template<typename Y, typename V> friend class PartitionFactory;
+    template<typename Y> friend class ObjectPool;
 
     Octree(MemoryAllocator* const allocator, const std::list<std::shared_ptr<T>>& data, const B& container, std::list<std::shared_ptr<T>>& pruned, unsigned int depth)
         : TreePartition<T, B>(allocator, data, container, pruned, depth)
@@ -26,11 +27,16 @@ private:
     {
     }
 
+    Octree(MemoryAllocator* const allocator, const typename TreePartition<T, B>::NodePool& pool, const std::list<std::shared_ptr<T>>& data, unsigned int depth)
+        : TreePartition<T, B>(allocator, pool, data, depth)
+    {
+    }
+
 private:
     virtual void on_build_subtrees(MemoryAllocator* const allocator) override
     {
         std::vector<std::list<std::shared_ptr<T>>> su(8);
-        for(typename std::list<std::shared_ptr<T>>::const_iterator it=TreePartition<T, B>::_data.begin();
+        for(typename Partition<T, B>::DataList::const_iterator it=TreePartition<T, B>::_data.begin();
             it != TreePartition<T, B>::_data.end(); ++it)
         {
             std::shared_ptr<T> obj(*it);
@@ -45,12 +51,9 @@ private:
         // only leaves hold data
         TreePartition<T, B>::_data.clear();
 
-        // subtrees should always calculate their container
         for(typename std::vector<std::list<std::shared_ptr<T>>>::const_iterator it=su.begin(); it != su.end(); ++it) {
             if(it->size() > 0) {
-                TreePartition<T, B>::_subtrees.push_back(std::shared_ptr<TreePartition<T, B>>(
-                    new(16, *allocator) Octree(allocator, *it, TreePartition<T, B>::depth() - 1),
-                    energonsoftware::MemoryAllocator_delete_aligned<Octree<T, B>, 16>(allocator)));
+                TreePartition<T, B>::template add_subtree<Octree<T, B>>(allocator, *it);
             }
         }
     }
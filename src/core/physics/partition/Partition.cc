@@ -63,7 +63,10 @@ public:
 public:
     void setUp() override
     {
-        _allocator = energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::System, 100 * 1024 * 1024);
+        // the partitions are only used from the test thread,
+        // and the nodes sit on (transparent) huge pages
+        _allocator = energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::Mapped, 100 * 1024 * 1024,
+            "PartitionTest", energonsoftware::MemoryAllocator::Threading::SingleOwner);
 
         _partition_types.push_back("flat");
         _partition_types.push_back("tree");
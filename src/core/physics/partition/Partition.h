@@ -3,6 +3,7 @@
 
 #include "src/core/math/Vector.h"
 #include "src/core/physics/BoundingVolume.h"
+#include "src/core/util/StlAllocator.h"
 
 namespace energonsoftware {
 
@@ -25,6 +26,10 @@ class Partition
 private:
     static Logger& logger;
 
+public:
+    // the objects held by a node, allocated from the partition's allocator
+    typedef std::list<std::shared_ptr<T>, StlAllocator<std::shared_ptr<T>>> DataList;
+
 public:
     virtual ~Partition() noexcept
     {
@@ -33,8 +38,8 @@ public:
 protected:
     template<typename Y, typename V> friend class PartitionFactory;
 
-    Partition(const std::list<std::shared_ptr<T>>& data, const B& container, std::list<std::shared_ptr<T>>& pruned)
-        : _data(), _size(0), _center_of_mass(), _container(container)
+    Partition(MemoryAllocator* const allocator, const std::list<std::shared_ptr<T>>& data, const B& container, std::list<std::shared_ptr<T>>& pruned)
+        : _data(typename DataList::allocator_type(allocator)), _size(0), _center_of_mass(), _container(container)
     {
         for(auto obj : data) {
             if(appendable(obj, _container, pruned)) {
@@ -51,8 +56,8 @@ protected:
         }
     }
 
-    explicit Partition(const std::list<std::shared_ptr<T>>& data)
-        : _data(data), _size(data.size()), _center_of_mass(), _container()
+    Partition(MemoryAllocator* const allocator, const std::list<std::shared_ptr<T>>& data)
+        : _data(data.begin(), data.end(), typename DataList::allocator_type(allocator)), _size(data.size()), _center_of_mass(), _container()
     {
         // find the center of mass
         if(_size > 0) {
@@ -87,7 +92,7 @@ public:
     // override this to traverse the partition
     virtual void traverse(std::list<std::shared_ptr<T>>& nodes) const
     {
-        nodes = _data;
+        nodes.assign(_data.begin(), _data.end());
     }
 
 private:
@@ -167,7 +172,7 @@ protected:
     }
 
 protected:
-    std::list<std::shared_ptr<T>> _data;
+    DataList _data;
     size_t _size;
 
 private:
@@ -30,7 +30,7 @@ public:
             return std::shared_ptr<Partition<T, B>>(new(16, *allocator) TreePartition<T, B>(allocator, data, container, pruned, depth),
                 MemoryAllocator_delete_aligned<TreePartition<T, B>, 16>(allocator));
         } else if("flat" == scratch) {
-            return std::shared_ptr<Partition<T, B>>(new(16, *allocator) Partition<T, B>(data, container, pruned),
+            return std::shared_ptr<Partition<T, B>>(new(16, *allocator) Partition<T, B>(allocator, data, container, pruned),
                 MemoryAllocator_delete_aligned<Partition<T, B>, 16>(allocator));
         }
         throw PartitionError("Unknown partition type: " + type);
@@ -58,7 +58,7 @@ public:
             return std::shared_ptr<Partition<T, B>>(new(16, *allocator) TreePartition<T, B>(allocator, data, depth),
                 energonsoftware::MemoryAllocator_delete_aligned<TreePartition<T, B>, 16>(allocator));
         } else if("flat" == scratch) {
-            return std::shared_ptr<Partition<T, B>>(new(16, *allocator) Partition<T, B>(data),
+            return std::shared_ptr<Partition<T, B>>(new(16, *allocator) Partition<T, B>(allocator, data),
                 energonsoftware::MemoryAllocator_delete_aligned<Partition<T, B>, 16>(allocator));
         }
         throw PartitionError("Unknown partition type: " + type);
@@ -16,6 +16,7 @@ public:
 
 private:
     template<typename Y, typename V> friend class PartitionFactory;
+    template<typename Y> friend class ObjectPool;
 
     SphereTree(MemoryAllocator* const allocator, const std::list<std::shared_ptr<T>>& data, const B& container, std::list<std::shared_ptr<T>>& pruned, unsigned int depth)
         : TreePartition<T, B>(allocator, data, container, pruned, depth)
@@ -27,6 +28,11 @@ private:
     {
     }
 
+    SphereTree(MemoryAllocator* const allocator, const typename TreePartition<T, B>::NodePool& pool, const std::list<std::shared_ptr<T>>& data, unsigned int depth)
+        : TreePartition<T, B>(allocator, pool, data, depth)
+    {
+    }
+
 private:
     virtual void on_build_subtrees(MemoryAllocator* const allocator) override
     {
@@ -38,7 +44,7 @@ private:
         norm = norm.length() == 0 ? Vector::random() : norm.normalized();
 
         // partition the objects
-        for(typename std::list<std::shared_ptr<T>>::const_iterator it=TreePartition<T, B>::_data.begin();
+        for(typename Partition<T, B>::DataList::const_iterator it=TreePartition<T, B>::_data.begin();
             it != TreePartition<T, B>::_data.end(); ++it)
         {
             std::shared_ptr<T> obj(*it);
@@ -54,17 +60,12 @@ private:
         // only leaves hold data
         TreePartition<T, B>::_data.clear();
 
-        // subtrees should always calculate their container
         if(left.size() > 0) {
-            TreePartition<T, B>::_subtrees.push_back(std::shared_ptr<TreePartition<T, B>>(
-                new(16, *allocator) SphereTree(allocator, left, TreePartition<T, B>::depth() - 1),
-                MemoryAllocator_delete_aligned<SphereTree<T, B>, 16>(allocator)));
+            TreePartition<T, B>::template add_subtree<SphereTree<T, B>>(allocator, left);
         }
 
         if(right.size() > 0) {
-            TreePartition<T, B>::_subtrees.push_back(std::shared_ptr<TreePartition<T, B>>(
-                new(16, *allocator) SphereTree(allocator, right, TreePartition<T, B>::depth() - 1),
-                MemoryAllocator_delete_aligned<SphereTree<T, B>, 16>(allocator)));
+            TreePartition<T, B>::template add_subtree<SphereTree<T, B>>(allocator, right);
         }
     }
 
@@ -1,6 +1,7 @@
 #if !defined __TREEPARTITION_H__
 #define __TREEPARTITION_H__
 
+#include "src/core/util/ObjectPool.h"
 #include "Partition.h"
 
 namespace energonsoftware {
@@ -11,7 +12,7 @@ template<typename T, typename B>
 class TreePartition : public Partition<T, B>
 {
 public:
-    typedef std::shared_ptr<TreePartition<T, B>> Subtree;
+    typedef PoolHandle<TreePartition<T, B>> Subtree;
     typedef std::list<Subtree> Subtrees;
 
 public:
@@ -21,9 +22,13 @@ public:
 
 protected:
     template<typename Y, typename V> friend class PartitionFactory;
+    template<typename Y> friend class ObjectPool;
+
+    // every node in a tree comes out of the root's pool
+    typedef std::shared_ptr<BaseObjectPool> NodePool;
 
     TreePartition(MemoryAllocator* const allocator, const std::list<std::shared_ptr<T>>& data, const B& container, std::list<std::shared_ptr<T>>& pruned, unsigned int depth)
-        : Partition<T, B>(data, container, pruned), _subtrees(), _depth(depth), _count(0)
+        : Partition<T, B>(allocator, data, container, pruned), _pool(), _subtrees(), _depth(depth), _count(0)
     {
         if(_depth >= 1 && Partition<T, B>::size() > 1) {
             // TODO: virtual call from constructor!
@@ -33,7 +38,12 @@ protected:
     }
 
     TreePartition(MemoryAllocator* const allocator, const std::list<std::shared_ptr<T>>& data, unsigned int depth)
-        : Partition<T, B>(data), _subtrees(), _depth(depth), _count(0)
+        : TreePartition(allocator, NodePool(), data, depth)
+    {
+    }
+
+    TreePartition(MemoryAllocator* const allocator, const NodePool& pool, const std::list<std::shared_ptr<T>>& data, unsigned int depth)
+        : Partition<T, B>(allocator, data), _pool(pool), _subtrees(), _depth(depth), _count(0)
     {
         if(_depth >= 1 && Partition<T, B>::size() > 1) {
             // TODO: virtual call from constructor!
@@ -56,7 +66,7 @@ public:
         }
 
         // visit ourself
-        for(typename std::list<std::shared_ptr<T>>::const_iterator it=TreePartition<T, B>::_data.begin();
+        for(typename Partition<T, B>::DataList::const_iterator it=TreePartition<T, B>::_data.begin();
             it != TreePartition<T, B>::_data.end(); ++it)
         {
             std::shared_ptr<T> obj(*it);
@@ -142,11 +152,24 @@ protected:
         return 0;
     }
 
+    // builds a subtree out of the tree's node pool
+    // subtrees always calculate their container
+    template<typename N>
+    void add_subtree(MemoryAllocator* const allocator, const std::list<std::shared_ptr<T>>& data)
+    {
+        if(!_pool) {
+            _pool.reset(new ObjectPool<N>(allocator));
+        }
+
+        ObjectPool<N>& pool(static_cast<ObjectPool<N>&>(*_pool));
+        _subtrees.push_back(pool.make(allocator, _pool, data, depth() - 1));
+    }
+
     // override this
     virtual void on_build_subtrees(MemoryAllocator* const allocator)
     {
         std::deque<std::shared_ptr<T>> data;
-        for(typename std::list<std::shared_ptr<T>>::const_iterator it=TreePartition<T, B>::_data.begin();
+        for(typename Partition<T, B>::DataList::const_iterator it=TreePartition<T, B>::_data.begin();
             it != TreePartition<T, B>::_data.end(); ++it)
         {
             std::shared_ptr<T> obj(*it);
@@ -161,16 +184,14 @@ protected:
         // split everything else in 'half'
         unsigned int median = data.size() >> 1;
 
-        // subtrees always calculate their container
-        std::list<std::shared_ptr<T>> subtree(data.begin(), data.begin() + median);
-        _subtrees.push_back(std::shared_ptr<TreePartition<T, B>>(new(16, *allocator) TreePartition(allocator, subtree, depth() - 1),
-            MemoryAllocator_delete_aligned<TreePartition<T, B>, 16>(allocator)));
-
-        subtree = std::list<std::shared_ptr<T>>(data.begin() + median, data.end());
-        _subtrees.push_back(std::shared_ptr<TreePartition<T, B>>(new(16, *allocator) TreePartition(allocator, subtree, depth() - 1),
-            MemoryAllocator_delete_aligned<TreePartition<T, B>, 16>(allocator)));
+        add_subtree<TreePartition<T, B>>(allocator, std::list<std::shared_ptr<T>>(data.begin(), data.begin() + median));
+        add_subtree<TreePartition<T, B>>(allocator, std::list<std::shared_ptr<T>>(data.begin() + median, data.end()));
     }
 
+private:
+    // this has to outlive the subtrees
+    NodePool _pool;
+
 protected:
     Subtrees _subtrees;
 
@@ -4,18 +4,19 @@
 #include "BaseJob.h"
 #include "BaseThread.h"
 #include "ThreadPool.h"
+#include "thread_util.h"
 
 namespace energonsoftware {
 
 Logger& BaseThread::logger(Logger::instance("energonsoftware.core.thread.BaseThread"));
 
 BaseThread::BaseThread(ThreadPool* pool)
-    : _pool(pool), _name(), _quit(false), _thread(), _own_thread(false)
+    : _pool(pool), _name(), _quit(false), _start_mutex(), _thread(), _own_thread(false)
 {
 }
 
 BaseThread::BaseThread(const std::string& name)
-    : _pool(nullptr), _name(name), _quit(false), _thread(), _own_thread(false)
+    : _pool(nullptr), _name(name), _quit(false), _start_mutex(), _thread(), _own_thread(false)
 {
 }
 
@@ -26,7 +27,7 @@ BaseThread::~BaseThread() noexcept
 
 std::string BaseThread::name() const
 {
-    if(_pool) {
+    if(_pool && _name.empty()) {
         // name is the threadid when we're part of a pool
         //return to_string(pthread_self());
 
@@ -43,6 +44,8 @@ void BaseThread::start()
     _quit = false;
     _own_thread = true;
 
+    // run() waits on this until _thread is valid
+    std::lock_guard<std::mutex> guard(_start_mutex);
     _thread.reset(new std::thread(&BaseThread::run, this));
 }
 
@@ -59,12 +62,6 @@ void BaseThread::stop()
     }
 }
 
-std::shared_ptr<std::thread> BaseThread::release()
-{
-    _own_thread = false;
-    return _thread;
-}
-
 std::string BaseThread::str() const
 {
     std::stringstream ss;
@@ -80,7 +77,7 @@ std::string BaseThread::str() const
         << "Has thread: " << to_string(static_cast<bool>(_thread)) << "\n"
         << "Owns thread: " << to_string(_own_thread) << "\n"
         << "Has pool: " << to_string(_pool != nullptr) << "\n"
-        << "Should quit: " << to_string(_quit);
+        << "Should quit: " << to_string(should_quit());
     return ss.str();
 }
 
@@ -88,7 +85,13 @@ void BaseThread::run()
 {
     // NOTE: must use _name here because _thread isn't valid yet
     LOG_DEBUG("Waiting for thread '" << _name << "' to start...\n");
-    while(!_thread) {}
+    {
+        std::lock_guard<std::mutex> guard(_start_mutex);
+    }
+
+    if(!_name.empty()) {
+        set_thread_name(_name);
+    }
 
     LOG_DEBUG("Running thread '" << name() << "'\n");
     //LOG_DEBUG(str() << "\n");
@@ -96,19 +99,16 @@ void BaseThread::run()
     while(!should_quit()) {
         try {
             if(pool()) {
-                std::unique_lock<std::recursive_mutex> guard(*(pool()), std::try_to_lock);
-                if(guard.owns_lock()) {
-                    if(pool()->has_work()) {
-                        std::shared_ptr<BaseJob> job(pool()->pop_work());
-                        job->process_work();
-                    }
+                std::shared_ptr<BaseJob> job(pool()->wait_work(*this));
+                if(job) {
+                    job->process_work();
                 }
             } else {
-               on_run();
-            }
+                on_run();
 
-            std::this_thread::sleep_for(std::chrono::microseconds(thread_sleep_time()));
-            //std::this_thread::yield();
+                std::this_thread::sleep_for(std::chrono::microseconds(thread_sleep_time()));
+                //std::this_thread::yield();
+            }
         } catch(const std::exception& e) {
             LOG_CRITICAL("Thread '" << name() << "' caught unhandled exception: " << e.what() << "\n");
 
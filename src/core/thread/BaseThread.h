@@ -18,8 +18,12 @@ public:
     virtual ~BaseThread() noexcept;
 
 public:
+    // pooled threads are named after their thread id unless they're given a name
     virtual std::string name() const final;
 
+    // the name is passed on to the OS when the thread starts
+    virtual void set_name(const std::string& name) final { _name = name; }
+
     virtual void start() final;
 
     virtual void quit() final { _quit = true; }
@@ -29,19 +33,14 @@ public:
 
     virtual bool should_quit() const final { return _quit; }
 
-    // releases ownership of the thread (used by the thread pool)
-    virtual std::shared_ptr<std::thread> release() final;
-
     std::string str() const;
 
 protected:
-    // NOTE: be *extremely* careful when locking this
-    // as a deadlock situation exists when the pool is stopped.
-    // Use a unique_lock with try_lock() rather than a lock_guard to be safe
     virtual ThreadPool* pool() final { return _pool; }
     virtual const ThreadPool* pool() const final { return _pool; }
 
     // for non-pooled threads
+    // pooled threads sleep in the pool until there's work to do
     virtual void on_run() {}
 
 private:
@@ -50,8 +49,9 @@ private:
 private:
     ThreadPool* _pool;
     std::string _name;
-    bool _quit;
+    std::atomic<bool> _quit;
 
+    std::mutex _start_mutex;
     std::shared_ptr<std::thread> _thread;
     bool _own_thread;
 
@@ -0,0 +1,243 @@
+#include "src/pch.h"
+#include "src/core/common.h"
+#include "Task.h"
+
+namespace energonsoftware {
+
+FunctionJob::FunctionJob(std::function<void()> function, int priority)
+    : BaseJob(priority), _function(function)
+{
+}
+
+FunctionJob::~FunctionJob() noexcept
+{
+}
+
+void FunctionJob::on_process_work()
+{
+    _function();
+}
+
+TaskState::TaskState()
+    : _mutex(), _completed(), _ready(false), _error(), _callbacks()
+{
+}
+
+TaskState::~TaskState() noexcept
+{
+}
+
+void TaskState::wait(ThreadPool* pool)
+{
+    while(!ready()) {
+        // help out rather than tying up a thread
+        if(nullptr != pool) {
+            std::shared_ptr<BaseJob> job(pool->pop_work());
+            if(job) {
+                job->process_work();
+                continue;
+            }
+        }
+
+        // NOTE: this has to wake up every so often because the work
+        // we're waiting on may be pushed after we find the pool empty
+        std::unique_lock<std::mutex> lock(_mutex);
+        _completed.wait_for(lock, std::chrono::microseconds(thread_sleep_time()), [this]() { return ready(); });
+    }
+}
+
+void TaskState::on_complete(std::function<void()> callback)
+{
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        if(!ready()) {
+            _callbacks.push_back(callback);
+            return;
+        }
+    }
+    callback();
+}
+
+void TaskState::complete(std::exception_ptr error)
+{
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+
+        _error = error;
+        _ready.store(true, std::memory_order_release);
+        callbacks.swap(_callbacks);
+    }
+    _completed.notify_all();
+
+    for(const auto& callback : callbacks) {
+        callback();
+    }
+}
+
+Future<void> when_all(ThreadPool& pool, const std::vector<std::shared_ptr<TaskState>>& tasks)
+{
+    return submit_after(pool, tasks, []() {});
+}
+
+void wait_all(ThreadPool& pool, const std::vector<std::shared_ptr<TaskState>>& tasks)
+{
+    for(const auto& task : tasks) {
+        task->wait(&pool);
+    }
+}
+
+}
+
+#if defined WITH_UNIT_TESTS
+#include "src/test/UnitTest.h"
+#include "src/core/text/string_util.h"
+#include "src/test/TestThreadPool.h"
+
+class TaskTest : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(TaskTest);
+        CPPUNIT_TEST(test_submit);
+        CPPUNIT_TEST(test_exception);
+        CPPUNIT_TEST(test_then);
+        CPPUNIT_TEST(test_dependencies);
+        CPPUNIT_TEST(test_wait_all);
+        CPPUNIT_TEST(test_nested);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    TaskTest() : CppUnit::TestFixture(), _pool(2) {}
+    virtual ~TaskTest() noexcept {}
+
+public:
+    void setUp() override
+    {
+        _pool.start(TestThreadFactory());
+    }
+
+    void tearDown() override
+    {
+        _pool.stop();
+    }
+
+    void test_submit()
+    {
+        energonsoftware::Future<int> future(energonsoftware::submit(_pool, []() { return 42; }));
+        CPPUNIT_ASSERT(future.valid());
+        CPPUNIT_ASSERT_EQUAL(42, future.get());
+        CPPUNIT_ASSERT(future.ready());
+
+        std::atomic<bool> ran(false);
+        energonsoftware::submit(_pool, [&ran]() { ran = true; }).get();
+        CPPUNIT_ASSERT(ran.load());
+    }
+
+    void test_exception()
+    {
+        energonsoftware::Future<int> future(energonsoftware::submit(_pool, []() -> int { throw std::runtime_error("failed"); }));
+        CPPUNIT_ASSERT_THROW(future.get(), std::runtime_error);
+
+        // continuations of failed tasks are skipped
+        std::atomic<bool> ran(false);
+        energonsoftware::Future<void> next(future.then([&ran](int value) { ran = true; }));
+        CPPUNIT_ASSERT_THROW(next.get(), std::runtime_error);
+        CPPUNIT_ASSERT(!ran.load());
+    }
+
+    void test_then()
+    {
+        energonsoftware::Future<std::string> future(energonsoftware::submit(_pool, []() { return 20; })
+            .then([](int value) { return value + 1; })
+            .then([](int value) { return value * 2; })
+            .then([](int value) { return energonsoftware::to_string(value); }));
+        CPPUNIT_ASSERT_EQUAL(std::string("42"), future.get());
+
+        // continuations of completed tasks are scheduled right away
+        energonsoftware::Future<int> done(energonsoftware::submit(_pool, []() { return 1; }));
+        done.wait();
+        CPPUNIT_ASSERT_EQUAL(2, done.then([](int value) { return value + 1; }).get());
+    }
+
+    void test_dependencies()
+    {
+        // diamond: a -> (b, c) -> d
+        std::mutex mutex;
+        std::vector<std::string> order;
+        auto record = [&mutex, &order](const std::string& name) {
+            std::lock_guard<std::mutex> guard(mutex);
+            order.push_back(name);
+        };
+
+        energonsoftware::Future<void> a(energonsoftware::submit(_pool, [record]() { record("a"); }));
+        energonsoftware::Future<void> b(energonsoftware::submit_after(_pool, { a.state() }, [record]() { record("b"); }));
+        energonsoftware::Future<void> c(energonsoftware::submit_after(_pool, { a.state() }, [record]() { record("c"); }));
+        energonsoftware::Future<int> d(energonsoftware::submit_after(_pool, { b.state(), c.state() }, [record]() { record("d"); return 4; }));
+
+        CPPUNIT_ASSERT_EQUAL(4, d.get());
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(4), order.size());
+        CPPUNIT_ASSERT_EQUAL(std::string("a"), order.front());
+        CPPUNIT_ASSERT_EQUAL(std::string("d"), order.back());
+
+        // no dependencies runs right away
+        CPPUNIT_ASSERT_EQUAL(5, energonsoftware::submit_after(_pool, {}, []() { return 5; }).get());
+
+        // failed dependencies skip the task
+        energonsoftware::Future<void> failed(energonsoftware::submit(_pool, []() { throw std::runtime_error("failed"); }));
+        energonsoftware::Future<void> skipped(energonsoftware::submit_after(_pool, { a.state(), failed.state() }, [record]() { record("skipped"); }));
+        CPPUNIT_ASSERT_THROW(skipped.get(), std::runtime_error);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(4), order.size());
+    }
+
+    void test_wait_all()
+    {
+        static const int COUNT = 100;
+
+        // with no threads the waiting thread does all of the work
+        energonsoftware::ThreadPool pool(0);
+
+        std::atomic<int> count(0);
+        std::vector<std::shared_ptr<energonsoftware::TaskState>> tasks;
+        for(int i=0; i<COUNT; ++i) {
+            tasks.push_back(energonsoftware::submit(pool, [&count]() { ++count; }).state());
+        }
+        CPPUNIT_ASSERT_EQUAL(0, count.load());
+
+        energonsoftware::Future<void> all(energonsoftware::when_all(pool, tasks));
+        CPPUNIT_ASSERT(!all.ready());
+
+        energonsoftware::wait_all(pool, tasks);
+        CPPUNIT_ASSERT_EQUAL(COUNT, count.load());
+
+        all.wait();
+        CPPUNIT_ASSERT(all.ready());
+    }
+
+    void test_nested()
+    {
+        // tasks waiting on their own sub-tasks would deadlock
+        // a single thread pool if waiting didn't help out
+        energonsoftware::ThreadPool pool(1);
+        pool.start(TestThreadFactory());
+
+        std::function<int(int)> sum = [&pool, &sum](int depth) -> int {
+            if(0 == depth) {
+                return 1;
+            }
+
+            energonsoftware::Future<int> left(energonsoftware::submit(pool, [&sum, depth]() { return sum(depth - 1); }));
+            energonsoftware::Future<int> right(energonsoftware::submit(pool, [&sum, depth]() { return sum(depth - 1); }));
+            return left.get() + right.get();
+        };
+
+        CPPUNIT_ASSERT_EQUAL(256, energonsoftware::submit(pool, [&sum]() { return sum(8); }).get());
+        pool.stop();
+    }
+
+private:
+    energonsoftware::ThreadPool _pool;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TaskTest);
+
+#endif
@@ -0,0 +1,246 @@
+#if !defined __TASK_H__
+#define __TASK_H__
+
+#include <condition_variable>
+#include <exception>
+#include <boost/optional.hpp>
+#include "BaseJob.h"
+#include "ThreadPool.h"
+
+namespace energonsoftware {
+
+// runs a function as a pool job
+class FunctionJob : public BaseJob
+{
+public:
+    explicit FunctionJob(std::function<void()> function, int priority=0);
+    virtual ~FunctionJob() noexcept;
+
+protected:
+    virtual void on_process_work() override;
+
+private:
+    std::function<void()> _function;
+};
+
+// completion state shared by a task and its futures
+class TaskState
+{
+public:
+    TaskState();
+    virtual ~TaskState() noexcept;
+
+public:
+    bool ready() const { return _ready.load(std::memory_order_acquire); }
+
+    // the exception the task threw (only valid once the task is ready)
+    std::exception_ptr error() const { return _error; }
+
+    // waits for the task to complete, running other work from the pool while it waits
+    // NOTE: pool may be nullptr to just block
+    void wait(ThreadPool* pool);
+
+    // callbacks are run by the thread that completes the task
+    // (or right away if the task is already complete)
+    void on_complete(std::function<void()> callback);
+
+    void complete(std::exception_ptr error=std::exception_ptr());
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _completed;
+    std::atomic<bool> _ready;
+    std::exception_ptr _error;
+    std::vector<std::function<void()>> _callbacks;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(TaskState);
+};
+
+template<typename T>
+class FutureState : public TaskState
+{
+public:
+    typedef const T& result_type;
+
+    template<typename F>
+    static auto call(F& f, const FutureState<T>& state) -> decltype(f(std::declval<const T&>()))
+    {
+        return f(*state._value);
+    }
+
+public:
+    FutureState() : TaskState(), _value() {}
+    virtual ~FutureState() noexcept {}
+
+public:
+    result_type value() const { return *_value; }
+
+    template<typename F>
+    void run(F& f) { _value = f(); }
+
+private:
+    boost::optional<T> _value;
+};
+
+template<>
+class FutureState<void> : public TaskState
+{
+public:
+    typedef void result_type;
+
+    template<typename F>
+    static auto call(F& f, const FutureState<void>& state) -> decltype(f())
+    {
+        return f();
+    }
+
+public:
+    FutureState() : TaskState() {}
+    virtual ~FutureState() noexcept {}
+
+public:
+    void value() const {}
+
+    template<typename F>
+    void run(F& f) { f(); }
+};
+
+template<typename T>
+class Future;
+
+// runs the function on the pool (or right away if there isn't a pool)
+// and completes the state with its result
+template<typename T, typename F>
+void schedule(ThreadPool* pool, int priority, std::shared_ptr<FutureState<T>> state, F f)
+{
+    auto work = [state, f]() mutable {
+        try {
+            state->run(f);
+        } catch(...) {
+            state->complete(std::current_exception());
+            return;
+        }
+        state->complete();
+    };
+
+    if(nullptr == pool) {
+        work();
+    } else {
+        pool->push_work(std::shared_ptr<BaseJob>(new FunctionJob(work, priority)));
+    }
+}
+
+template<typename T>
+class Future final
+{
+public:
+    typedef typename FutureState<T>::result_type result_type;
+
+public:
+    Future() : _pool(nullptr), _state() {}
+    Future(ThreadPool* pool, std::shared_ptr<FutureState<T>> state) : _pool(pool), _state(state) {}
+    ~Future() noexcept {}
+
+    Future(const Future& other) = default;
+    Future& operator=(const Future& other) = default;
+
+public:
+    bool valid() const { return static_cast<bool>(_state); }
+    bool ready() const { return _state->ready(); }
+
+    std::shared_ptr<TaskState> state() const { return _state; }
+
+    // waits for the task, running other work from the pool while it waits
+    void wait() const { _state->wait(_pool); }
+
+    // waits for the task and returns its result
+    // rethrows the exception if the task threw one
+    result_type get() const
+    {
+        wait();
+        if(_state->error()) {
+            std::rethrow_exception(_state->error());
+        }
+        return _state->value();
+    }
+
+    // runs f with the result once this task completes,
+    // if this task throws then f is skipped and its future gets the exception instead
+    template<typename F>
+    auto then(F f, int priority=0) const -> Future<decltype(FutureState<T>::call(std::declval<F&>(), std::declval<const FutureState<T>&>()))>
+    {
+        typedef decltype(FutureState<T>::call(f, *_state)) U;
+
+        ThreadPool* pool = _pool;
+        std::shared_ptr<FutureState<T>> state(_state);
+        std::shared_ptr<FutureState<U>> next(new FutureState<U>());
+        _state->on_complete([pool, priority, state, next, f]() {
+            if(state->error()) {
+                next->complete(state->error());
+                return;
+            }
+            schedule(pool, priority, next, [state, f]() mutable { return FutureState<T>::call(f, *state); });
+        });
+        return Future<U>(pool, next);
+    }
+
+private:
+    ThreadPool* _pool;
+    std::shared_ptr<FutureState<T>> _state;
+};
+
+// runs f on the pool
+template<typename F>
+auto submit(ThreadPool& pool, F f, int priority=0) -> Future<decltype(f())>
+{
+    typedef decltype(f()) T;
+
+    std::shared_ptr<FutureState<T>> state(new FutureState<T>());
+    schedule(&pool, priority, state, f);
+    return Future<T>(&pool, state);
+}
+
+// runs f on the pool once all of its dependencies complete,
+// if any of them throw then f is skipped and its future gets the first exception instead
+template<typename F>
+auto submit_after(ThreadPool& pool, const std::vector<std::shared_ptr<TaskState>>& dependencies, F f, int priority=0) -> Future<decltype(f())>
+{
+    typedef decltype(f()) T;
+
+    std::shared_ptr<FutureState<T>> state(new FutureState<T>());
+
+    // the extra count keeps the task from starting before every callback is registered
+    std::shared_ptr<std::atomic<size_t>> remaining(new std::atomic<size_t>(dependencies.size() + 1));
+    ThreadPool* target = &pool;
+    auto dependency_complete = [target, priority, dependencies, state, remaining, f]() {
+        if(0 != --(*remaining)) {
+            return;
+        }
+
+        for(const auto& dependency : dependencies) {
+            if(dependency->error()) {
+                state->complete(dependency->error());
+                return;
+            }
+        }
+        schedule(target, priority, state, f);
+    };
+
+    for(const auto& dependency : dependencies) {
+        dependency->on_complete(dependency_complete);
+    }
+    dependency_complete();
+
+    return Future<T>(&pool, state);
+}
+
+// completes once all of the tasks complete
+Future<void> when_all(ThreadPool& pool, const std::vector<std::shared_ptr<TaskState>>& tasks);
+
+// waits for all of the tasks, running other work from the pool while it waits
+void wait_all(ThreadPool& pool, const std::vector<std::shared_ptr<TaskState>>& tasks);
+
+}
+
+#endif
@@ -1,14 +1,25 @@
 #include "src/pch.h"
-#include "ThreadPool.h"
 #include "BaseThread.h"
+#include "WorkQueue.h"
+#include "ThreadPool.h"
 
 namespace energonsoftware {
 
+// the pool and queue of the worker running on this thread
+static thread_local const ThreadPool* worker_pool = nullptr;
+static thread_local size_t worker_queue = 0;
+
 Logger& ThreadPool::logger(Logger::instance("energonsoftware.core.thread.ThreadPool"));
 
-ThreadPool::ThreadPool(size_t size)
-    : std::recursive_mutex(), _size(size), _threads(), _running(false), _work()
+ThreadPool::ThreadPool(size_t size, const ThreadPlacement& placement)
+    : _size(size), _placement(placement), _mutex(), _threads(), _running(false), _worker_cpus(), _scratch(),
+        _queues(), _next_queue(0), _pending(0),
+        _idle_mutex(), _idle(), _idle_count(0)
 {
+    // always have a queue so work can be pushed and popped without any threads
+    for(size_t i=0; i<std::max<size_t>(_size, 1); ++i) {
+        _queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+    }
 }
 
 ThreadPool::~ThreadPool() noexcept
@@ -18,7 +29,7 @@ ThreadPool::~ThreadPool() noexcept
 
 void ThreadPool::start(const ThreadFactory& factory)
 {
-    std::lock_guard<std::recursive_mutex> guard(*this);
+    std::lock_guard<std::recursive_mutex> guard(_mutex);
 
     stop();
 
@@ -27,51 +38,338 @@ void ThreadPool::start(const ThreadFactory& factory)
     }
 
     LOG_INFO("Initializing " << _size << " threads...\n");
+
+    _worker_cpus = placement_cpus(_placement, numa_nodes(), _size);
+    _scratch.clear();
+    _scratch.resize(_size);
+
+    // the threads have to all be created before any of them look for their queue
     for(size_t i=0; i<_size; ++i) {
         std::shared_ptr<BaseThread> thread(factory.new_thread(this));
-        thread->start();
-
-        std::shared_ptr<std::thread> native(thread->release());
-        _threads.push_back(native);
+        if(!_placement.name.empty()) {
+            thread->set_name(_placement.name + "-" + std::to_string(i));
+        }
+        _threads.push_back(thread);
     }
     _running = true;
+
+    for(auto thread : _threads) {
+        thread->start();
+    }
 }
 
 void ThreadPool::push_work(std::shared_ptr<BaseJob> job)
 {
-    std::lock_guard<std::recursive_mutex> guard(*this);
+    int worker = current_worker();
+    size_t queue = worker >= 0 ? static_cast<size_t>(worker) : _next_queue.fetch_add(1) % _queues.size();
+
+    _queues[queue]->push(job);
+    _pending.fetch_add(1);
 
-    _work.push(job);
+    // NOTE: idle workers bump the idle count before they check for work,
+    // so at least one of us sees the other
+    if(_idle_count.load() > 0) {
+        {
+            std::lock_guard<std::mutex> guard(_idle_mutex);
+        }
+        _idle.notify_one();
+    }
 }
 
-bool ThreadPool::has_work()
+unsigned char* ThreadPool::scratch()
 {
-    std::lock_guard<std::recursive_mutex> guard(*this);
-
-    return !_work.empty();
+    int worker = current_worker();
+    return worker >= 0 ? _scratch[worker].get() : nullptr;
 }
 
 std::shared_ptr<BaseJob> ThreadPool::pop_work()
 {
-    std::lock_guard<std::recursive_mutex> guard(*this);
+    int worker = current_worker();
+    if(worker >= 0) {
+        return next_work(static_cast<size_t>(worker), true);
+    }
+    return next_work(_next_queue.load() % _queues.size(), false);
+}
+
+std::shared_ptr<BaseJob> ThreadPool::wait_work(BaseThread& thread)
+{
+    if(worker_pool != this) {
+        for(size_t i=0; i<_threads.size(); ++i) {
+            if(_threads[i].get() == &thread) {
+                worker_pool = this;
+                worker_queue = i;
+                break;
+            }
+        }
+        assert(worker_pool == this);
+
+        init_worker(worker_queue);
+    }
+
+    while(!thread.should_quit()) {
+        std::shared_ptr<BaseJob> job(next_work(worker_queue, true));
+        if(job) {
+            return job;
+        }
 
-    std::shared_ptr<BaseJob> ret(_work.top());
-    _work.pop();
-    return ret;
+        std::unique_lock<std::mutex> lock(_idle_mutex);
+        ++_idle_count;
+        _idle.wait(lock, [this, &thread]() { return thread.should_quit() || _pending.load() > 0; });
+        --_idle_count;
+    }
+    return std::shared_ptr<BaseJob>();
 }
 
 void ThreadPool::stop()
 {
-    std::lock_guard<std::recursive_mutex> guard(*this);
+    std::lock_guard<std::recursive_mutex> guard(_mutex);
 
     if(running()) {
         LOG_INFO("Waiting for " << _size << " threads to finish...\n");
         for(auto thread : _threads) {
-            thread->join();
+            thread->quit();
+        }
+
+        {
+            std::lock_guard<std::mutex> idle_guard(_idle_mutex);
+        }
+        _idle.notify_all();
+
+        for(auto thread : _threads) {
+            thread->stop();
         }
         LOG_DEBUG("Finished!\n");
     }
+    _threads.clear();
+    _scratch.clear();
     _running = false;
 }
 
+int ThreadPool::current_worker() const
+{
+    return worker_pool == this ? static_cast<int>(worker_queue) : -1;
+}
+
+void ThreadPool::init_worker(size_t worker)
+{
+    // pin first so the scratch memory lands on this worker's node
+    const std::vector<size_t>& cpus(_worker_cpus[worker]);
+    if(!cpus.empty() && !set_thread_affinity(cpus)) {
+        LOG_WARNING("Unable to set the affinity of worker " << worker << "\n");
+    }
+
+    if(_placement.scratch_size > 0) {
+        _scratch[worker].reset(new unsigned char[_placement.scratch_size]);
+        std::memset(_scratch[worker].get(), 0, _placement.scratch_size);
+    }
+}
+
+std::shared_ptr<BaseJob> ThreadPool::next_work(size_t worker, bool owner)
+{
+    if(_pending.load() <= 0) {
+        return std::shared_ptr<BaseJob>();
+    }
+
+    // find the highest priority work, ties go to the worker's own queue
+    size_t count = _queues.size();
+    size_t best = worker;
+    int top = _queues[worker]->top();
+    for(size_t i=1; i<count; ++i) {
+        size_t victim = (worker + i) % count;
+        int victim_top = _queues[victim]->top();
+        if(victim_top > top) {
+            best = victim;
+            top = victim_top;
+        }
+    }
+
+    std::shared_ptr<BaseJob> job(owner && best == worker ? _queues[best]->pop() : _queues[best]->steal());
+    if(!job) {
+        // the tops are only hints, so take anything we can find
+        for(size_t i=0; !job && i<count; ++i) {
+            size_t victim = (worker + i) % count;
+            job = owner && victim == worker ? _queues[victim]->pop() : _queues[victim]->steal();
+        }
+    }
+
+    if(job) {
+        _pending.fetch_sub(1);
+    }
+    return job;
 }
+
+}
+
+#if defined WITH_UNIT_TESTS
+#include "src/test/UnitTest.h"
+#include "src/test/TestThreadPool.h"
+
+class ThreadPoolTest : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(ThreadPoolTest);
+        CPPUNIT_TEST(test_pop_work);
+        CPPUNIT_TEST(test_priority);
+        CPPUNIT_TEST(test_throughput);
+        CPPUNIT_TEST(test_spawn);
+        CPPUNIT_TEST(test_placement);
+    CPPUNIT_TEST_SUITE_END();
+
+private:
+    class TestJob : public energonsoftware::BaseJob
+    {
+    public:
+        TestJob(int priority, std::function<void()> work) : energonsoftware::BaseJob(priority), _work(work) {}
+        virtual ~TestJob() noexcept {}
+
+    protected:
+        virtual void on_process_work() override { _work(); }
+
+    private:
+        std::function<void()> _work;
+    };
+
+public:
+    ThreadPoolTest() : CppUnit::TestFixture() {}
+    virtual ~ThreadPoolTest() noexcept {}
+
+public:
+    void test_pop_work()
+    {
+        energonsoftware::ThreadPool pool(0);
+        CPPUNIT_ASSERT(!pool.has_work());
+        CPPUNIT_ASSERT(!pool.pop_work());
+
+        std::vector<int> order;
+        for(int priority : { 1, 5, 3 }) {
+            pool.push_work(job(priority, [&order, priority]() { order.push_back(priority); }));
+        }
+        CPPUNIT_ASSERT(pool.has_work());
+
+        std::shared_ptr<energonsoftware::BaseJob> work;
+        while((work = pool.pop_work())) {
+            work->process_work();
+        }
+        CPPUNIT_ASSERT(!pool.has_work());
+        CPPUNIT_ASSERT(std::vector<int>({ 5, 3, 1 }) == order);
+    }
+
+    void test_priority()
+    {
+        energonsoftware::ThreadPool pool(1);
+
+        std::mutex mutex;
+        std::vector<int> order;
+        for(int i=0; i<10; ++i) {
+            int priority = (i * 7) % 10;
+            pool.push_work(job(priority, [&mutex, &order, priority]() {
+                std::lock_guard<std::mutex> guard(mutex);
+                order.push_back(priority);
+            }));
+        }
+
+        pool.start(TestThreadFactory());
+        CPPUNIT_ASSERT(wait([&pool]() { return !pool.has_work(); }));
+        pool.stop();
+
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(10), order.size());
+        CPPUNIT_ASSERT(std::is_sorted(order.begin(), order.end(), std::greater<int>()));
+    }
+
+    void test_throughput()
+    {
+        static const int COUNT = 100000;
+
+        energonsoftware::ThreadPool pool(4);
+        pool.start(TestThreadFactory());
+
+        std::atomic<int> count(0);
+        for(int i=0; i<COUNT; ++i) {
+            pool.push_work(job(i % 3, [&count]() { ++count; }));
+        }
+
+        // this used to be bound by the worker sleep time
+        CPPUNIT_ASSERT(wait([&count]() { return COUNT == count.load(); }));
+        pool.stop();
+    }
+
+    void test_spawn()
+    {
+        static const int COUNT = 1000;
+
+        energonsoftware::ThreadPool pool(4);
+        pool.start(TestThreadFactory());
+
+        // spawned work goes on the spawning worker's queue and gets stolen from there
+        std::atomic<int> count(0);
+        pool.push_work(job(0, [this, &pool, &count]() {
+            for(int i=0; i<COUNT; ++i) {
+                pool.push_work(job(0, [&count]() { ++count; }));
+            }
+        }));
+
+        CPPUNIT_ASSERT(wait([&count]() { return COUNT == count.load(); }));
+        pool.stop();
+        CPPUNIT_ASSERT(!pool.running());
+    }
+
+    void test_placement()
+    {
+        energonsoftware::ThreadPlacement placement;
+        placement.name = "pool";
+        placement.affinity = energonsoftware::ThreadAffinity::Node;
+        placement.scratch_size = 4096;
+
+        energonsoftware::ThreadPool pool(2, placement);
+        CPPUNIT_ASSERT(nullptr == pool.scratch());
+        pool.start(TestThreadFactory());
+
+        std::mutex mutex;
+        std::vector<std::string> names;
+        std::atomic<int> scratch(0);
+        for(int i=0; i<20; ++i) {
+            pool.push_work(job(0, [&pool, &mutex, &names, &scratch]() {
+                if(nullptr != pool.scratch()) {
+                    ++scratch;
+                }
+
+#if defined __linux__
+                char name[16];
+                pthread_getname_np(pthread_self(), name, sizeof(name));
+
+                std::lock_guard<std::mutex> guard(mutex);
+                names.push_back(name);
+#endif
+            }));
+        }
+
+        CPPUNIT_ASSERT(wait([&scratch]() { return 20 == scratch.load(); }));
+        pool.stop();
+
+        for(const std::string& name : names) {
+            CPPUNIT_ASSERT(name == "pool-0" || name == "pool-1");
+        }
+    }
+
+private:
+    std::shared_ptr<energonsoftware::BaseJob> job(int priority, std::function<void()> work)
+    {
+        return std::shared_ptr<energonsoftware::BaseJob>(new TestJob(priority, work));
+    }
+
+    bool wait(std::function<bool()> done)
+    {
+        auto start(std::chrono::steady_clock::now());
+        while(!done()) {
+            if(std::chrono::steady_clock::now() - start > std::chrono::seconds(10)) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ThreadPoolTest);
+
+#endif
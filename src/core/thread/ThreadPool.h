@@ -1,50 +1,102 @@
 #if !defined __THREADPOOL_H__
 #define __THREADPOOL_H__
 
+#include <condition_variable>
 #include "BaseJob.h"
+#include "thread_util.h"
 
 namespace energonsoftware {
 
+class BaseThread;
 class ThreadFactory;
+class WorkQueue;
 
-struct base_job_less : public std::binary_function<std::shared_ptr<BaseJob>, std::shared_ptr<BaseJob>, bool>
-{
-    bool operator()(const std::shared_ptr<BaseJob>& lhs, const std::shared_ptr<BaseJob>& rhs) const
-    { return lhs->priority() < rhs->priority(); }
-};
+/*
+Work-stealing thread pool.
+
+Each worker has its own WorkQueue, work pushed from a worker goes on its own queue
+and work pushed from anywhere else is spread across the queues.
+Workers serve the highest priority work in the pool (preferring their own queue when it's tied),
+stealing from the other workers when it's not on their own queue,
+and sleep on a condition variable when there isn't any work at all.
 
-// TODO: this should *not* inherit from std::recursive_mutex
-class ThreadPool : public std::recursive_mutex
+Workers are named, pinned and given scratch memory according to the pool's ThreadPlacement.
+Each worker pins itself before allocating its scratch memory so that it's first touched
+(and so placed by the OS) on the worker's own NUMA node.
+
+NOTE: priority is only approximate across the pool as each worker picks its next job
+from the queue tops, a higher priority job pushed at the same time may start after a lower one
+*/
+class ThreadPool
 {
 private:
     static Logger& logger;
 
 public:
-    explicit ThreadPool(size_t size);
+    explicit ThreadPool(size_t size, const ThreadPlacement& placement=ThreadPlacement());
     virtual ~ThreadPool() noexcept;
 
 public:
+    size_t size() const { return _size; }
+
+    const ThreadPlacement& placement() const { return _placement; }
+
+    // the calling worker's scratch memory (placement().scratch_size bytes),
+    // nullptr if it isn't one of our workers or there isn't any
+    unsigned char* scratch();
+
     // starts the threads in the pool
     void start(const ThreadFactory& factory);
 
     // adds work to the pool
     void push_work(std::shared_ptr<BaseJob> job);
 
-    bool has_work();
+    bool has_work() const { return _pending.load() > 0; }
 
-    // gets work from the pool
+    // gets work from the pool, returns nullptr if there isn't any
     std::shared_ptr<BaseJob> pop_work();
 
+    // waits for work for a pooled thread,
+    // returns nullptr if the thread should quit
+    std::shared_ptr<BaseJob> wait_work(BaseThread& thread);
+
     // stops all threads
+    // NOTE: work that hasn't started is left in the pool
     void stop();
 
-    bool running() const { return _running; }
+    bool running() const { return _running.load(); }
+
+private:
+    // the calling thread's queue index, or -1 if it isn't one of our workers
+    int current_worker() const;
+
+    // applies the placement to the calling worker
+    void init_worker(size_t worker);
+
+    std::shared_ptr<BaseJob> next_work(size_t worker, bool owner);
 
 private:
     size_t _size;
-    std::list<std::shared_ptr<std::thread>> _threads;
-    bool _running;
-    std::priority_queue<std::shared_ptr<BaseJob>, std::deque<std::shared_ptr<BaseJob>>, base_job_less > _work;
+    ThreadPlacement _placement;
+    std::recursive_mutex _mutex;
+    std::vector<std::shared_ptr<BaseThread>> _threads;
+    std::atomic<bool> _running;
+
+    // per-worker placement, only touched by the worker once it starts
+    std::vector<std::vector<size_t>> _worker_cpus;
+    std::vector<std::unique_ptr<unsigned char[]>> _scratch;
+
+    // one queue per thread
+    std::vector<std::unique_ptr<WorkQueue>> _queues;
+    std::atomic<size_t> _next_queue;
+
+    // number of queued jobs, this can briefly go negative
+    std::atomic<int64_t> _pending;
+
+    // idle workers sleep on this
+    std::mutex _idle_mutex;
+    std::condition_variable _idle;
+    std::atomic<size_t> _idle_count;
 
 private:
     ThreadPool() = delete;
@@ -0,0 +1,62 @@
+#include "src/pch.h"
+#include "WorkQueue.h"
+
+namespace energonsoftware {
+
+const int WorkQueue::EMPTY = INT_MIN;
+
+WorkQueue::WorkQueue()
+    : _mutex(), _lanes(), _top(EMPTY)
+{
+}
+
+WorkQueue::~WorkQueue() noexcept
+{
+}
+
+void WorkQueue::push(std::shared_ptr<BaseJob> job)
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+
+    _lanes[job->priority()].push_back(job);
+    _top.store(_lanes.begin()->first, std::memory_order_release);
+}
+
+std::shared_ptr<BaseJob> WorkQueue::pop()
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return take(true);
+}
+
+std::shared_ptr<BaseJob> WorkQueue::steal()
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return take(false);
+}
+
+std::shared_ptr<BaseJob> WorkQueue::take(bool newest)
+{
+    if(_lanes.empty()) {
+        return std::shared_ptr<BaseJob>();
+    }
+
+    auto lane = _lanes.begin();
+
+    std::shared_ptr<BaseJob> job;
+    if(newest) {
+        job = lane->second.back();
+        lane->second.pop_back();
+    } else {
+        job = lane->second.front();
+        lane->second.pop_front();
+    }
+
+    if(lane->second.empty()) {
+        _lanes.erase(lane);
+    }
+    _top.store(_lanes.empty() ? EMPTY : _lanes.begin()->first, std::memory_order_release);
+
+    return job;
+}
+
+}
@@ -0,0 +1,57 @@
+#if !defined __WORKQUEUE_H__
+#define __WORKQUEUE_H__
+
+#include "BaseJob.h"
+
+namespace energonsoftware {
+
+/*
+A thread pool worker's queue of jobs.
+
+Jobs are kept in lanes by priority and the highest priority lane is always served first.
+Within a lane the owning worker takes the newest job (so work it spawns stays hot in cache)
+while other workers steal the oldest.
+*/
+class WorkQueue final
+{
+public:
+    // top() when the queue is empty
+    static const int EMPTY;
+
+public:
+    WorkQueue();
+    ~WorkQueue() noexcept;
+
+public:
+    // the highest priority in the queue, this is only a hint as it can change at any time
+    int top() const { return _top.load(std::memory_order_acquire); }
+
+    bool empty() const { return EMPTY == top(); }
+
+    void push(std::shared_ptr<BaseJob> job);
+
+    // these return nullptr if the queue is empty
+    std::shared_ptr<BaseJob> pop();
+    std::shared_ptr<BaseJob> steal();
+
+private:
+    typedef std::deque<std::shared_ptr<BaseJob>> Lane;
+
+    // NOTE: this must be called with the mutex held
+    std::shared_ptr<BaseJob> take(bool newest);
+
+private:
+    std::mutex _mutex;
+
+    // empty lanes are removed
+    std::map<int, Lane, std::greater<int>> _lanes;
+
+    std::atomic<int> _top;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(WorkQueue);
+};
+
+}
+
+#endif
@@ -0,0 +1,206 @@
+#include "src/pch.h"
+#include "parallel.h"
+
+namespace energonsoftware {
+
+ParallelState::ParallelState(ThreadPool& pool, ParallelMode mode)
+    : _pool(pool), _mode(mode), _split_depth(0), _pending(0), _error_mutex(), _error()
+{
+    // enough pieces to keep every worker (and the calling thread) busy
+    // with some slack for uneven work
+    for(size_t pieces = 1; pieces < (_pool.size() + 1) * 4; pieces *= 2) {
+        ++_split_depth;
+    }
+}
+
+ParallelState::~ParallelState() noexcept
+{
+}
+
+void ParallelState::fail(std::exception_ptr error)
+{
+    std::lock_guard<std::mutex> guard(_error_mutex);
+    if(!_error) {
+        _error = error;
+    }
+}
+
+void ParallelState::wait()
+{
+    while(_pending.load() > 0) {
+        std::shared_ptr<BaseJob> job(_pool.pop_work());
+        if(job) {
+            job->process_work();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    if(_error) {
+        std::rethrow_exception(_error);
+    }
+}
+
+}
+
+#if defined WITH_UNIT_TESTS
+#include "src/test/UnitTest.h"
+#include "src/test/TestThreadPool.h"
+
+class ParallelTest : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(ParallelTest);
+        CPPUNIT_TEST(test_for);
+        CPPUNIT_TEST(test_for_deterministic);
+        CPPUNIT_TEST(test_for_empty);
+        CPPUNIT_TEST(test_for_exception);
+        CPPUNIT_TEST(test_reduce);
+        CPPUNIT_TEST(test_reduce_deterministic);
+        CPPUNIT_TEST(test_nested);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    ParallelTest() : CppUnit::TestFixture(), _pool(4) {}
+    virtual ~ParallelTest() noexcept {}
+
+public:
+    void setUp() override
+    {
+        _pool.start(TestThreadFactory());
+    }
+
+    void tearDown() override
+    {
+        _pool.stop();
+    }
+
+    void test_for()
+    {
+        static const size_t COUNT = 100000;
+
+        std::vector<int> values(COUNT, 0);
+        energonsoftware::parallel_for(_pool, 0, COUNT, 64, [&values](size_t begin, size_t end) {
+            for(size_t i=begin; i<end; ++i) {
+                values[i] += static_cast<int>(i % 7);
+            }
+        });
+
+        for(size_t i=0; i<COUNT; ++i) {
+            CPPUNIT_ASSERT_EQUAL(static_cast<int>(i % 7), values[i]);
+        }
+    }
+
+    void test_for_deterministic()
+    {
+        std::mutex mutex;
+        std::vector<std::pair<size_t, size_t>> ranges;
+        energonsoftware::parallel_for(_pool, 5, 1005, 100, [&mutex, &ranges](size_t begin, size_t end) {
+            std::lock_guard<std::mutex> guard(mutex);
+            ranges.push_back(std::make_pair(begin, end));
+        }, energonsoftware::ParallelMode::Deterministic);
+
+        // always the same chunks
+        std::sort(ranges.begin(), ranges.end());
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(10), ranges.size());
+        for(size_t i=0; i<ranges.size(); ++i) {
+            CPPUNIT_ASSERT_EQUAL(5 + i * 100, ranges[i].first);
+            CPPUNIT_ASSERT_EQUAL(5 + (i + 1) * 100, ranges[i].second);
+        }
+    }
+
+    void test_for_empty()
+    {
+        bool called = false;
+        energonsoftware::parallel_for(_pool, 10, 10, 1, [&called](size_t begin, size_t end) { called = true; });
+        CPPUNIT_ASSERT(!called);
+
+        // a pool without threads runs everything on the calling thread
+        energonsoftware::ThreadPool pool(0);
+        size_t count = 0;
+        energonsoftware::parallel_for(pool, 0, 100, 0, [&count](size_t begin, size_t end) { count += end - begin; });
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(100), count);
+    }
+
+    void test_for_exception()
+    {
+        std::atomic<size_t> count(0);
+        CPPUNIT_ASSERT_THROW(energonsoftware::parallel_for(_pool, 0, 1000, 10, [&count](size_t begin, size_t end) {
+            count += end - begin;
+            if(begin <= 500 && 500 < end) {
+                throw std::runtime_error("failed");
+            }
+        }), std::runtime_error);
+
+        // everything else still ran
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1000), count.load());
+    }
+
+    void test_reduce()
+    {
+        static const size_t COUNT = 100000;
+
+        uint64_t sum = energonsoftware::parallel_reduce(_pool, 0, COUNT, 100, static_cast<uint64_t>(0),
+            [](size_t begin, size_t end) {
+                uint64_t partial = 0;
+                for(size_t i=begin; i<end; ++i) {
+                    partial += i;
+                }
+                return partial;
+            },
+            [](uint64_t lhs, uint64_t rhs) { return lhs + rhs; });
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint64_t>(COUNT) * (COUNT - 1) / 2, sum);
+
+        // partials are combined in range order
+        std::string str = energonsoftware::parallel_reduce(_pool, 0, 26, 1, std::string(),
+            [](size_t begin, size_t end) {
+                std::string partial;
+                for(size_t i=begin; i<end; ++i) {
+                    partial += static_cast<char>('a' + i);
+                }
+                return partial;
+            },
+            [](const std::string& lhs, const std::string& rhs) { return lhs + rhs; });
+        CPPUNIT_ASSERT_EQUAL(std::string("abcdefghijklmnopqrstuvwxyz"), str);
+    }
+
+    void test_reduce_deterministic()
+    {
+        static const size_t COUNT = 100000;
+
+        auto map = [](size_t begin, size_t end) {
+            float partial = 0.0f;
+            for(size_t i=begin; i<end; ++i) {
+                partial += 1.0f / (1.0f + i);
+            }
+            return partial;
+        };
+        auto reduce = [](float lhs, float rhs) { return lhs + rhs; };
+
+        float expected = energonsoftware::parallel_reduce(_pool, 0, COUNT, 1000, 0.0f, map, reduce, energonsoftware::ParallelMode::Deterministic);
+        for(int i=0; i<10; ++i) {
+            float sum = energonsoftware::parallel_reduce(_pool, 0, COUNT, 1000, 0.0f, map, reduce, energonsoftware::ParallelMode::Deterministic);
+            CPPUNIT_ASSERT(expected == sum);
+        }
+    }
+
+    void test_nested()
+    {
+        std::atomic<size_t> count(0);
+        energonsoftware::parallel_for(_pool, 0, 16, 1, [this, &count](size_t begin, size_t end) {
+            for(size_t i=begin; i<end; ++i) {
+                energonsoftware::parallel_for(_pool, 0, 100, 10, [&count](size_t inner_begin, size_t inner_end) {
+                    count += inner_end - inner_begin;
+                });
+            }
+        });
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1600), count.load());
+    }
+
+private:
+    energonsoftware::ThreadPool _pool;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ParallelTest);
+
+#endif
@@ -0,0 +1,139 @@
+#if !defined __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include <exception>
+#include "Task.h"
+#include "ThreadPool.h"
+
+namespace energonsoftware {
+
+enum class ParallelMode
+{
+    // ranges are split in half until every worker has something to do,
+    // stolen ranges get split again so idle workers keep getting fed
+    Adaptive,
+
+    // ranges are always split into the same grain sized chunks
+    // so results don't depend on how the work was scheduled
+    Deterministic,
+};
+
+// tracks the outstanding pieces of a parallel loop
+class ParallelState final
+{
+public:
+    ParallelState(ThreadPool& pool, ParallelMode mode);
+    ~ParallelState() noexcept;
+
+public:
+    ThreadPool& pool() { return _pool; }
+    ParallelMode mode() const { return _mode; }
+
+    // how many times a range can be split before it's handed to the loop body
+    size_t split_depth() const { return _split_depth; }
+
+    void add() { ++_pending; }
+    void done() { --_pending; }
+    void fail(std::exception_ptr error);
+
+    // waits for every piece, running other work from the pool while it waits
+    // rethrows the first exception thrown by the loop body
+    void wait();
+
+private:
+    ThreadPool& _pool;
+    ParallelMode _mode;
+    size_t _split_depth;
+
+    std::atomic<size_t> _pending;
+
+    std::mutex _error_mutex;
+    std::exception_ptr _error;
+
+private:
+    ParallelState() = delete;
+    DISALLOW_COPY_AND_ASSIGN(ParallelState);
+};
+
+template<typename F>
+void parallel_range(ParallelState& state, size_t begin, size_t end, size_t grain, size_t depth, std::thread::id owner, const F& f)
+{
+    try {
+        // stolen ranges start splitting over
+        if(std::this_thread::get_id() != owner) {
+            depth = state.split_depth();
+        }
+
+        while(end - begin > grain && depth > 0) {
+            size_t middle = begin + (end - begin) / 2;
+            if(ParallelMode::Deterministic == state.mode()) {
+                // split on chunk boundaries
+                size_t chunks = (end - begin + grain - 1) / grain;
+                middle = begin + (chunks / 2) * grain;
+            } else {
+                --depth;
+            }
+
+            size_t right = end;
+            std::thread::id self(std::this_thread::get_id());
+            ParallelState* shared = &state;
+            state.add();
+            state.pool().push_work(std::shared_ptr<BaseJob>(new FunctionJob([shared, middle, right, grain, depth, self, &f]() {
+                parallel_range(*shared, middle, right, grain, depth, self, f);
+            })));
+            end = middle;
+        }
+
+        f(begin, end);
+    } catch(...) {
+        state.fail(std::current_exception());
+    }
+    state.done();
+}
+
+// calls f(begin, end) on sub-ranges of [begin, end) across the pool,
+// ranges no longer than grain are never split
+// the calling thread works on the loop too and this returns once it's all done
+// NOTE: f is called concurrently
+template<typename F>
+void parallel_for(ThreadPool& pool, size_t begin, size_t end, size_t grain, const F& f, ParallelMode mode=ParallelMode::Adaptive)
+{
+    if(begin >= end) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+
+    ParallelState state(pool, mode);
+    state.add();
+    parallel_range(state, begin, end, grain, state.split_depth(), std::this_thread::get_id(), f);
+    state.wait();
+}
+
+// map(begin, end) reduces a sub-range to a value
+// and reduce(lhs, rhs) combines the values in range order starting from identity
+// Deterministic mode gives the same result every run even if reduce isn't associative (eg. floating point sums)
+template<typename T, typename Map, typename Reduce>
+T parallel_reduce(ThreadPool& pool, size_t begin, size_t end, size_t grain, const T& identity, const Map& map, const Reduce& reduce, ParallelMode mode=ParallelMode::Adaptive)
+{
+    std::mutex mutex;
+    std::vector<std::pair<size_t, T>> partials;
+    parallel_for(pool, begin, end, grain, [&mutex, &partials, &map](size_t range_begin, size_t range_end) {
+        T partial(map(range_begin, range_end));
+
+        std::lock_guard<std::mutex> guard(mutex);
+        partials.push_back(std::make_pair(range_begin, partial));
+    }, mode);
+
+    std::sort(partials.begin(), partials.end(),
+        [](const std::pair<size_t, T>& lhs, const std::pair<size_t, T>& rhs) { return lhs.first < rhs.first; });
+
+    T result(identity);
+    for(const auto& partial : partials) {
+        result = reduce(result, partial.second);
+    }
+    return result;
+}
+
+}
+
+#endif
@@ -0,0 +1,314 @@
+#include "src/pch.h"
+#include <fstream>
+#if defined __linux__
+    #include <pthread.h>
+    #include <sched.h>
+#elif defined __APPLE__
+    #include <pthread.h>
+#endif
+#include "src/core/text/string_util.h"
+#include "thread_util.h"
+
+namespace energonsoftware {
+
+bool parse_thread_affinity(const std::string& value, ThreadAffinity& affinity)
+{
+    std::string scratch(boost::algorithm::to_lower_copy(trim_all(value)));
+    if(scratch == "none" || scratch.empty()) {
+        affinity = ThreadAffinity::None;
+    } else if(scratch == "core") {
+        affinity = ThreadAffinity::Core;
+    } else if(scratch == "node") {
+        affinity = ThreadAffinity::Node;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parse_cpu_list(const std::string& list, std::vector<size_t>& cpus)
+{
+    cpus.clear();
+
+    std::vector<std::string> ranges;
+    tokenize(list, ranges, ",");
+    for(const std::string& range : ranges) {
+        std::string scratch(trim_all(range));
+        if(scratch.empty()) {
+            continue;
+        }
+
+        size_t pos = scratch.find('-');
+        std::string first(scratch.substr(0, pos)), last(pos == std::string::npos ? first : scratch.substr(pos + 1));
+        if(first.empty() || last.empty()
+            || first.find_first_not_of("0123456789") != std::string::npos
+            || last.find_first_not_of("0123456789") != std::string::npos)
+        {
+            return false;
+        }
+
+        size_t begin = std::strtoul(first.c_str(), nullptr, 10), end = std::strtoul(last.c_str(), nullptr, 10);
+        if(end < begin) {
+            return false;
+        }
+
+        for(size_t cpu=begin; cpu<=end; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return true;
+}
+
+size_t cpu_count()
+{
+    return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+std::vector<std::vector<size_t>> numa_nodes()
+{
+    std::vector<std::vector<size_t>> nodes;
+
+#if defined __linux__
+    // node directories can have gaps in their numbering
+    boost::system::error_code ec;
+    std::map<size_t, std::vector<size_t>> found;
+    for(boost::filesystem::directory_iterator it("/sys/devices/system/node", ec), end; !ec && it != end; it.increment(ec)) {
+        std::string name(it->path().filename().string());
+        if(name.compare(0, 4, "node") != 0 || name.size() == 4 || name.find_first_not_of("0123456789", 4) != std::string::npos) {
+            continue;
+        }
+
+        std::ifstream f((it->path() / "cpulist").string().c_str());
+        std::string list;
+        std::vector<size_t> cpus;
+        if(std::getline(f, list) && parse_cpu_list(list, cpus) && !cpus.empty()) {
+            found[std::strtoul(name.c_str() + 4, nullptr, 10)] = cpus;
+        }
+    }
+
+    for(const auto& node : found) {
+        nodes.push_back(node.second);
+    }
+#endif
+
+    if(nodes.empty()) {
+        std::vector<size_t> cpus;
+        for(size_t cpu=0; cpu<cpu_count(); ++cpu) {
+            cpus.push_back(cpu);
+        }
+        nodes.push_back(cpus);
+    }
+    return nodes;
+}
+
+std::vector<std::vector<size_t>> placement_cpus(const ThreadPlacement& placement, const std::vector<std::vector<size_t>>& nodes, size_t count)
+{
+    std::vector<std::vector<size_t>> workers(count);
+    if(ThreadAffinity::None == placement.affinity) {
+        return workers;
+    }
+
+    // drop the cpus we aren't allowed to use (and any nodes left empty)
+    std::vector<std::vector<size_t>> allowed;
+    for(const auto& node : nodes) {
+        std::vector<size_t> cpus;
+        for(size_t cpu : node) {
+            if(placement.cpus.empty() || std::find(placement.cpus.begin(), placement.cpus.end(), cpu) != placement.cpus.end()) {
+                cpus.push_back(cpu);
+            }
+        }
+
+        if(!cpus.empty()) {
+            allowed.push_back(cpus);
+        }
+    }
+
+    if(allowed.empty()) {
+        return workers;
+    }
+
+    for(size_t i=0; i<count; ++i) {
+        const std::vector<size_t>& node = allowed[i % allowed.size()];
+        if(ThreadAffinity::Node == placement.affinity) {
+            workers[i] = node;
+        } else {
+            // the (i / nodes)th worker on this node
+            workers[i].push_back(node[(i / allowed.size()) % node.size()]);
+        }
+    }
+    return workers;
+}
+
+bool set_thread_name(const std::string& name)
+{
+#if defined __linux__
+    // the limit is 16 characters including the terminator
+    return 0 == pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#elif defined __APPLE__
+    return 0 == pthread_setname_np(name.c_str());
+#elif defined _MSC_VER
+    // the debugger picks the name up from this exception
+    // https://msdn.microsoft.com/en-us/library/xcb2z8hs.aspx
+    #pragma pack(push, 8)
+    struct ThreadNameInfo
+    {
+        DWORD type;
+        LPCSTR name;
+        DWORD thread_id;
+        DWORD flags;
+    };
+    #pragma pack(pop)
+
+    ThreadNameInfo info = { 0x1000, name.c_str(), static_cast<DWORD>(-1), 0 };
+    __try {
+        RaiseException(0x406D1388, 0, sizeof(info) / sizeof(ULONG_PTR), reinterpret_cast<ULONG_PTR*>(&info));
+    } __except(EXCEPTION_EXECUTE_HANDLER) {
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool set_thread_affinity(const std::vector<size_t>& cpus)
+{
+    if(cpus.empty()) {
+        return false;
+    }
+
+#if defined __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for(size_t cpu : cpus) {
+        if(cpu >= CPU_SETSIZE) {
+            return false;
+        }
+        CPU_SET(cpu, &set);
+    }
+    return 0 == pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#elif defined WIN32
+    DWORD_PTR mask = 0;
+    for(size_t cpu : cpus) {
+        if(cpu >= sizeof(mask) * CHAR_BIT) {
+            return false;
+        }
+        mask |= static_cast<DWORD_PTR>(1) << cpu;
+    }
+    return 0 != SetThreadAffinityMask(GetCurrentThread(), mask);
+#else
+    // OSX only supports affinity hints
+    return false;
+#endif
+}
+
+}
+
+#if defined WITH_UNIT_TESTS
+#include "src/test/UnitTest.h"
+
+class ThreadUtilTest : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(ThreadUtilTest);
+        CPPUNIT_TEST(test_parse_affinity);
+        CPPUNIT_TEST(test_parse_cpu_list);
+        CPPUNIT_TEST(test_numa_nodes);
+        CPPUNIT_TEST(test_placement);
+        CPPUNIT_TEST(test_current_thread);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    ThreadUtilTest() : CppUnit::TestFixture() {}
+    virtual ~ThreadUtilTest() noexcept {}
+
+public:
+    void test_parse_affinity()
+    {
+        energonsoftware::ThreadAffinity affinity;
+        CPPUNIT_ASSERT(energonsoftware::parse_thread_affinity("core", affinity));
+        CPPUNIT_ASSERT(energonsoftware::ThreadAffinity::Core == affinity);
+        CPPUNIT_ASSERT(energonsoftware::parse_thread_affinity(" Node ", affinity));
+        CPPUNIT_ASSERT(energonsoftware::ThreadAffinity::Node == affinity);
+        CPPUNIT_ASSERT(energonsoftware::parse_thread_affinity("", affinity));
+        CPPUNIT_ASSERT(energonsoftware::ThreadAffinity::None == affinity);
+        CPPUNIT_ASSERT(!energonsoftware::parse_thread_affinity("socket", affinity));
+    }
+
+    void test_parse_cpu_list()
+    {
+        std::vector<size_t> cpus;
+        CPPUNIT_ASSERT(energonsoftware::parse_cpu_list("0-3, 8,10-11,2", cpus));
+        CPPUNIT_ASSERT(std::vector<size_t>({ 0, 1, 2, 3, 8, 10, 11 }) == cpus);
+
+        CPPUNIT_ASSERT(energonsoftware::parse_cpu_list("", cpus));
+        CPPUNIT_ASSERT(cpus.empty());
+
+        CPPUNIT_ASSERT(!energonsoftware::parse_cpu_list("3-1", cpus));
+        CPPUNIT_ASSERT(!energonsoftware::parse_cpu_list("a-b", cpus));
+        CPPUNIT_ASSERT(!energonsoftware::parse_cpu_list("1-", cpus));
+    }
+
+    void test_numa_nodes()
+    {
+        std::vector<std::vector<size_t>> nodes(energonsoftware::numa_nodes());
+        CPPUNIT_ASSERT(!nodes.empty());
+        for(const auto& node : nodes) {
+            CPPUNIT_ASSERT(!node.empty());
+        }
+    }
+
+    void test_placement()
+    {
+        std::vector<std::vector<size_t>> nodes({ { 0, 1, 2, 3 }, { 4, 5, 6, 7 } });
+
+        energonsoftware::ThreadPlacement placement;
+        std::vector<std::vector<size_t>> workers(energonsoftware::placement_cpus(placement, nodes, 3));
+        CPPUNIT_ASSERT_EQUAL(size_t(3), workers.size());
+        CPPUNIT_ASSERT(workers[0].empty());
+
+        placement.affinity = energonsoftware::ThreadAffinity::Core;
+        workers = energonsoftware::placement_cpus(placement, nodes, 3);
+        CPPUNIT_ASSERT(std::vector<size_t>({ 0 }) == workers[0]);
+        CPPUNIT_ASSERT(std::vector<size_t>({ 4 }) == workers[1]);
+        CPPUNIT_ASSERT(std::vector<size_t>({ 1 }) == workers[2]);
+
+        placement.affinity = energonsoftware::ThreadAffinity::Node;
+        placement.cpus = { 2, 3, 4 };
+        workers = energonsoftware::placement_cpus(placement, nodes, 3);
+        CPPUNIT_ASSERT(std::vector<size_t>({ 2, 3 }) == workers[0]);
+        CPPUNIT_ASSERT(std::vector<size_t>({ 4 }) == workers[1]);
+        CPPUNIT_ASSERT(std::vector<size_t>({ 2, 3 }) == workers[2]);
+
+        // nothing allowed, nothing pinned
+        placement.cpus = { 100 };
+        workers = energonsoftware::placement_cpus(placement, nodes, 1);
+        CPPUNIT_ASSERT(workers[0].empty());
+    }
+
+    void test_current_thread()
+    {
+        // run on a thread of our own so we don't rename or pin the test runner
+        bool named = false, pinned = false;
+        std::thread thread([&named, &pinned]() {
+            named = energonsoftware::set_thread_name("thread_util_test");
+#if defined __linux__
+            // the cpu we're on is always one we're allowed to use
+            pinned = energonsoftware::set_thread_affinity(std::vector<size_t>({ static_cast<size_t>(sched_getcpu()) }));
+#endif
+        });
+        thread.join();
+
+#if defined __linux__
+        CPPUNIT_ASSERT(named);
+        CPPUNIT_ASSERT(pinned);
+#endif
+        CPPUNIT_ASSERT(!energonsoftware::set_thread_affinity(std::vector<size_t>()));
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ThreadUtilTest);
+
+#endif
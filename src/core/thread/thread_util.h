@@ -0,0 +1,59 @@
+#if !defined __THREAD_UTIL_H__
+#define __THREAD_UTIL_H__
+
+namespace energonsoftware {
+
+enum class ThreadAffinity
+{
+    // let the OS schedule threads wherever it likes
+    None,
+
+    // pin each thread to a single core
+    Core,
+
+    // pin each thread to every core on a single NUMA node
+    Node,
+};
+
+// none, core or node
+bool parse_thread_affinity(const std::string& value, ThreadAffinity& affinity);
+
+// parses cpu lists like 0-3,8,10-11 (the format used by /sys and taskset)
+bool parse_cpu_list(const std::string& list, std::vector<size_t>& cpus);
+
+// where to run a thread pool's workers
+struct ThreadPlacement
+{
+    // workers are named <name>-<index>, empty to leave them unnamed
+    std::string name;
+
+    ThreadAffinity affinity;
+
+    // the cpus the workers may use, empty for all of them
+    std::vector<size_t> cpus;
+
+    // bytes of scratch memory allocated by each worker on its own node
+    size_t scratch_size;
+
+    ThreadPlacement() : name(), affinity(ThreadAffinity::None), cpus(), scratch_size(0) {}
+};
+
+// the number of cpus the OS reports (at least 1)
+size_t cpu_count();
+
+// the cpus in each NUMA node,
+// this is a single node with every cpu if there's no NUMA information
+std::vector<std::vector<size_t>> numa_nodes();
+
+// the cpus each of count workers should be pinned to (empty if they shouldn't be)
+// workers are spread round robin across the nodes so that neighbouring workers land on different nodes
+std::vector<std::vector<size_t>> placement_cpus(const ThreadPlacement& placement, const std::vector<std::vector<size_t>>& nodes, size_t count);
+
+// these apply to the calling thread and return false if the OS doesn't support them
+// NOTE: names longer than 15 characters are truncated on Linux
+bool set_thread_name(const std::string& name);
+bool set_thread_affinity(const std::vector<size_t>& cpus);
+
+}
+
+#endif
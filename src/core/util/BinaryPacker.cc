@@ -5,7 +5,7 @@
 namespace energonsoftware {
 
 BinaryPacker::BinaryPacker()
-    : Packer(), _buffer()
+    : Packer(), _buffer(), _bits(0), _bit_count(0)
 {
 }
 
@@ -16,6 +16,56 @@ BinaryPacker::~BinaryPacker() noexcept
 Packer& BinaryPacker::reset()
 {
     _buffer.str("");
+    _bits = 0;
+    _bit_count = 0;
+    return *this;
+}
+
+std::string BinaryPacker::buffer() const
+{
+    std::string buffer(_buffer.str());
+    if(_bit_count > 0) {
+        buffer.push_back(static_cast<char>(_bits << (8 - _bit_count)));
+    }
+    return buffer;
+}
+
+BinaryPacker& BinaryPacker::pack_bits(uint32_t v, unsigned int bits, const std::string& name) throw(PackerError)
+{
+    if(bits < 1 || bits > 32) {
+        throw PackerError("Invalid bit count for " + name);
+    }
+
+    if(bits < 32 && v >> bits) {
+        throw PackerError("Value doesn't fit in its bits for " + name);
+    }
+
+    // never more than 7 bits are pending so this goes out a byte at a time
+    while(bits > 0) {
+        const unsigned int count = std::min(bits, 8 - _bit_count);
+        bits -= count;
+
+        _bits = (_bits << count) | ((v >> bits) & ((1 << count) - 1));
+        _bit_count += count;
+
+        if(8 == _bit_count) {
+            const char byte = static_cast<char>(_bits);
+            _buffer.write(&byte, 1);
+            _bits = 0;
+            _bit_count = 0;
+        }
+    }
+    return *this;
+}
+
+BinaryPacker& BinaryPacker::flush_bits()
+{
+    if(_bit_count > 0) {
+        const char byte = static_cast<char>(_bits << (8 - _bit_count));
+        _buffer.write(&byte, 1);
+        _bits = 0;
+        _bit_count = 0;
+    }
     return *this;
 }
 
@@ -62,18 +112,21 @@ Packer& BinaryPacker::pack(const char* const v, const std::string& name) throw(P
 
 Packer& BinaryPacker::pack(int8_t v, const std::string& name) throw(PackerError)
 {
+    flush_bits();
     _buffer.write(reinterpret_cast<const char*>(&v), 1);
     return *this;
 }
 
 Packer& BinaryPacker::pack(uint8_t v, const std::string& name) throw(PackerError)
 {
+    flush_bits();
     _buffer.write(reinterpret_cast<const char*>(&v), 1);
     return *this;
 }
 
 Packer& BinaryPacker::pack(int32_t v, const std::string& name) throw(PackerError)
 {
+    flush_bits();
     char* bytes = reinterpret_cast<char*>(&v);
     if(is_little_endian()) {
         _buffer.write(&bytes[3], 1);
@@ -91,6 +144,7 @@ Packer& BinaryPacker::pack(int32_t v, const std::string& name) throw(PackerError
 
 Packer& BinaryPacker::pack(uint32_t v, const std::string& name) throw(PackerError)
 {
+    flush_bits();
     char* bytes = reinterpret_cast<char*>(&v);
     if(is_little_endian()) {
         _buffer.write(&bytes[3], 1);
@@ -108,6 +162,7 @@ Packer& BinaryPacker::pack(uint32_t v, const std::string& name) throw(PackerErro
 
 Packer& BinaryPacker::pack(int64_t v, const std::string& name) throw(PackerError)
 {
+    flush_bits();
     char* bytes = reinterpret_cast<char*>(&v);
     if(is_little_endian()) {
         _buffer.write(&bytes[7], 1);
@@ -133,6 +188,7 @@ Packer& BinaryPacker::pack(int64_t v, const std::string& name) throw(PackerError
 
 Packer& BinaryPacker::pack(uint64_t v, const std::string& name) throw(PackerError)
 {
+    flush_bits();
     char* bytes = reinterpret_cast<char*>(&v);
     if(is_little_endian()) {
         _buffer.write(&bytes[7], 1);
@@ -159,6 +215,7 @@ Packer& BinaryPacker::pack(uint64_t v, const std::string& name) throw(PackerErro
 // NOTE: this may not always follow XDR format
 Packer& BinaryPacker::pack(float v, const std::string& name) throw(PackerError)
 {
+    flush_bits();
     char* bytes = reinterpret_cast<char*>(&v);
     _buffer.write(&bytes[0], 1);
     _buffer.write(&bytes[1], 1);
@@ -170,6 +227,7 @@ Packer& BinaryPacker::pack(float v, const std::string& name) throw(PackerError)
 // NOTE: this may not always follow XDR format
 Packer& BinaryPacker::pack(double v, const std::string& name) throw(PackerError)
 {
+    flush_bits();
     char* bytes = reinterpret_cast<char*>(&v);
     _buffer.write(&bytes[0], 1);
     _buffer.write(&bytes[1], 1);
@@ -189,18 +247,18 @@ Packer& BinaryPacker::pack(bool v, const std::string& name) throw(PackerError)
 }
 
 BinaryUnpacker::BinaryUnpacker(const std::string& obj)
-    : Unpacker(obj), _buffer(obj)
+    : Unpacker(obj), _buffer(obj), _bits(0), _bit_count(0)
 {
 }
 
 BinaryUnpacker::BinaryUnpacker(const std::vector<unsigned char>& obj)
-    : Unpacker(obj), _buffer()
+    : Unpacker(obj), _buffer(), _bits(0), _bit_count(0)
 {
     _buffer.str(_obj);
 }
 
 BinaryUnpacker::BinaryUnpacker(const unsigned char* obj, size_t len)
-    : Unpacker(obj, len), _buffer()
+    : Unpacker(obj, len), _buffer(), _bits(0), _bit_count(0)
 {
     _buffer.str(_obj);
 }
@@ -216,6 +274,7 @@ Unpacker& BinaryUnpacker::position(unsigned int position) throw(PackerError)
     }
 
     _buffer.seekg(position, std::ios_base::beg);
+    align_bits();
     return *this;
 }
 
@@ -226,6 +285,7 @@ Unpacker& BinaryUnpacker::skip(unsigned int count) throw(PackerError)
     }*/
 
     _buffer.ignore(count);
+    align_bits();
     return *this;
 }
 
@@ -256,18 +316,21 @@ Unpacker& BinaryUnpacker::unpack(std::string& v, const std::string& name) throw(
 
 Unpacker& BinaryUnpacker::unpack(int8_t& v, const std::string& name) throw(PackerError)
 {
+    align_bits();
     _buffer.read(reinterpret_cast<char*>(&v), 1);
     return *this;
 }
 
 Unpacker& BinaryUnpacker::unpack(uint8_t& v, const std::string& name) throw(PackerError)
 {
+    align_bits();
     _buffer.read(reinterpret_cast<char*>(&v), 1);
     return *this;
 }
 
 Unpacker& BinaryUnpacker::unpack(int32_t& v, const std::string& name) throw(PackerError)
 {
+    align_bits();
     char* bytes = reinterpret_cast<char*>(&v);
     if(is_little_endian()) {
         _buffer.read(&bytes[3], 1);
@@ -285,6 +348,7 @@ Unpacker& BinaryUnpacker::unpack(int32_t& v, const std::string& name) throw(Pack
 
 Unpacker& BinaryUnpacker::unpack(uint32_t& v, const std::string& name) throw(PackerError)
 {
+    align_bits();
     char* bytes = reinterpret_cast<char*>(&v);
     if(is_little_endian()) {
         _buffer.read(&bytes[3], 1);
@@ -302,6 +366,7 @@ Unpacker& BinaryUnpacker::unpack(uint32_t& v, const std::string& name) throw(Pac
 
 Unpacker& BinaryUnpacker::unpack(int64_t& v, const std::string& name) throw(PackerError)
 {
+    align_bits();
     char* bytes = reinterpret_cast<char*>(&v);
     if(is_little_endian()) {
         _buffer.read(&bytes[7], 1);
@@ -327,6 +392,7 @@ Unpacker& BinaryUnpacker::unpack(int64_t& v, const std::string& name) throw(Pack
 
 Unpacker& BinaryUnpacker::unpack(uint64_t& v, const std::string& name) throw(PackerError)
 {
+    align_bits();
     char* bytes = reinterpret_cast<char*>(&v);
     if(is_little_endian()) {
         _buffer.read(&bytes[7], 1);
@@ -353,6 +419,7 @@ Unpacker& BinaryUnpacker::unpack(uint64_t& v, const std::string& name) throw(Pac
 // NOTE: this may not always follow XDR format
 Unpacker& BinaryUnpacker::unpack(float& v, const std::string& name) throw(PackerError)
 {
+    align_bits();
     char* bytes = reinterpret_cast<char*>(&v);
     _buffer.read(&bytes[0], 1);
     _buffer.read(&bytes[1], 1);
@@ -364,6 +431,7 @@ Unpacker& BinaryUnpacker::unpack(float& v, const std::string& name) throw(Packer
 // NOTE: this may not always follow XDR format
 Unpacker& BinaryUnpacker::unpack(double& v, const std::string& name) throw(PackerError)
 {
+    align_bits();
     char* bytes = reinterpret_cast<char*>(&v);
     _buffer.read(&bytes[0], 1);
     _buffer.read(&bytes[1], 1);
@@ -384,6 +452,32 @@ Unpacker& BinaryUnpacker::unpack(bool& v, const std::string& name) throw(PackerE
     return *this;
 }
 
+BinaryUnpacker& BinaryUnpacker::unpack_bits(uint32_t& v, unsigned int bits, const std::string& name) throw(PackerError)
+{
+    if(bits < 1 || bits > 32) {
+        throw PackerError("Invalid bit count for " + name);
+    }
+
+    v = 0;
+    while(bits > 0) {
+        if(0 == _bit_count) {
+            char byte;
+            if(!_buffer.read(&byte, 1)) {
+                throw PackerError("Ran out of bits for " + name);
+            }
+            _bits = static_cast<unsigned char>(byte);
+            _bit_count = 8;
+        }
+
+        const unsigned int count = std::min(bits, _bit_count);
+        bits -= count;
+        _bit_count -= count;
+
+        v = (v << count) | ((_bits >> _bit_count) & ((1 << count) - 1));
+    }
+    return *this;
+}
+
 Unpacker& BinaryUnpacker::on_reset()
 {
     position(0);
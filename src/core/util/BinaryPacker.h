@@ -5,7 +5,14 @@
 
 namespace energonsoftware {
 
-// uses XDR standard for packing
+/*
+Uses XDR standard for packing.
+
+pack_bits() packs fields that aren't a whole number of bytes,
+most significant bit first. The bits are padded out to a byte
+boundary before the next regular pack() so the rest of the buffer
+stays byte aligned, unpack() does the same on the other end.
+*/
 class BinaryPacker : public Packer
 {
 public:
@@ -25,11 +32,21 @@ public:
     virtual Packer& pack(float v, const std::string& name) throw(PackerError) override;
     virtual Packer& pack(double v, const std::string& name) throw(PackerError) override;
     virtual Packer& pack(bool v, const std::string& name) throw(PackerError) override;
-    virtual std::string buffer() const override { return _buffer.str(); }
+    virtual std::string buffer() const override;
+
+    // packs the low bits (1 - 32) of v, v must fit in bits
+    BinaryPacker& pack_bits(uint32_t v, unsigned int bits, const std::string& name) throw(PackerError);
+
+    // pads any pending bits out to a byte
+    BinaryPacker& flush_bits();
 
 private:
     std::stringstream _buffer;
 
+    // bits that haven't filled a byte yet, in the low _bit_count bits
+    uint32_t _bits;
+    unsigned int _bit_count;
+
 private:
     DISALLOW_COPY_AND_ASSIGN(BinaryPacker);
 };
@@ -58,12 +75,22 @@ public:
     virtual Unpacker& unpack(bool& v, const std::string& name) throw(PackerError) override;
     virtual bool done() const override { return _buffer.eof(); }
 
+    // unpacks a field packed with BinaryPacker::pack_bits()
+    BinaryUnpacker& unpack_bits(uint32_t& v, unsigned int bits, const std::string& name) throw(PackerError);
+
+    // drops the rest of the current byte
+    BinaryUnpacker& align_bits() { _bit_count = 0; return *this; }
+
 private:
     virtual Unpacker& on_reset() override;
 
 private:
     std::stringstream _buffer;
 
+    // bits left over from the last byte read, in the low _bit_count bits
+    uint32_t _bits;
+    unsigned int _bit_count;
+
 private:
     BinaryUnpacker() = delete;
     DISALLOW_COPY_AND_ASSIGN(BinaryUnpacker);
@@ -0,0 +1,72 @@
+#include "src/pch.h"
+#include "FrameAllocator.h"
+
+namespace energonsoftware {
+
+FrameAllocator::FrameAllocator(size_t size, MemoryAllocator::Threading threading)
+    : _frames{ std::unique_ptr<StackAllocator>(new StackAllocator(size, threading)), std::unique_ptr<StackAllocator>(new StackAllocator(size, threading)) },
+        _frame(0)
+{
+}
+
+FrameAllocator::~FrameAllocator() noexcept
+{
+}
+
+void FrameAllocator::next_frame()
+{
+    ++_frame;
+    current().reset();
+}
+
+void FrameAllocator::claim()
+{
+    _frames[0]->claim();
+    _frames[1]->claim();
+}
+
+}
+
+#if defined WITH_UNIT_TESTS
+#include "src/test/UnitTest.h"
+
+class FrameAllocatorTest : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(FrameAllocatorTest);
+        CPPUNIT_TEST(test_frames);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    FrameAllocatorTest() : CppUnit::TestFixture() {}
+    virtual ~FrameAllocatorTest() noexcept {}
+
+public:
+    void test_frames()
+    {
+        energonsoftware::FrameAllocator allocator(1024);
+
+        int* first = new(allocator.current()) int(10);
+        CPPUNIT_ASSERT(allocator.current().used() > 0);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), allocator.previous().used());
+
+        // last frame's memory is still around
+        allocator.next_frame();
+        CPPUNIT_ASSERT_EQUAL(1UL, allocator.frame());
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), allocator.current().used());
+        CPPUNIT_ASSERT_EQUAL(10, *first);
+
+        int* second = new(allocator.current()) int(20);
+        CPPUNIT_ASSERT(first != second);
+
+        // and is reused the frame after
+        allocator.next_frame();
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), allocator.current().used());
+        CPPUNIT_ASSERT_EQUAL(20, *second);
+        CPPUNIT_ASSERT_EQUAL(first, new(allocator.current()) int(30));
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FrameAllocatorTest);
+
+#endif
@@ -0,0 +1,52 @@
+#if !defined __FRAMEALLOCATOR_H__
+#define __FRAMEALLOCATOR_H__
+
+#include "StackAllocator.h"
+
+namespace energonsoftware {
+
+/*
+Double buffered frame allocator.
+
+Per-frame scratch memory comes from the current frame's arena
+and is all freed at once when the frame comes around again,
+so anything allocated in a frame stays valid until the end of the next one.
+
+Frame scratch is usually only touched by the thread running the frame,
+so the arenas default to SingleOwner and don't lock.
+*/
+class FrameAllocator final
+{
+public:
+    // size is in bytes per frame
+    explicit FrameAllocator(size_t size, MemoryAllocator::Threading threading=MemoryAllocator::Threading::SingleOwner);
+    ~FrameAllocator() noexcept;
+
+public:
+    unsigned long frame() const { return _frame; }
+
+    StackAllocator& current() { return *_frames[_frame % 2]; }
+    const StackAllocator& current() const { return *_frames[_frame % 2]; }
+
+    // the memory allocated last frame
+    StackAllocator& previous() { return *_frames[(_frame + 1) % 2]; }
+    const StackAllocator& previous() const { return *_frames[(_frame + 1) % 2]; }
+
+    // flips the frames, freeing everything allocated two frames ago
+    void next_frame();
+
+    // makes the calling thread the owner of both arenas
+    void claim();
+
+private:
+    std::unique_ptr<StackAllocator> _frames[2];
+    unsigned long _frame;
+
+private:
+    FrameAllocator() = delete;
+    DISALLOW_COPY_AND_ASSIGN(FrameAllocator);
+};
+
+}
+
+#endif
@@ -0,0 +1,255 @@
+#include "src/pch.h"
+#if !defined WIN32
+#include <sys/mman.h>
+#endif
+#include "util.h"
+#include "MappedRegion.h"
+
+namespace energonsoftware {
+
+static size_t round_up(size_t value, size_t multiple)
+{
+    return ((value + multiple - 1) / multiple) * multiple;
+}
+
+const size_t MappedRegion::HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+Logger& MappedRegion::logger(Logger::instance("energonsoftware.core.util.MappedRegion"));
+
+size_t MappedRegion::page_size()
+{
+#if defined WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+MappedRegion::MappedRegion(size_t size, MemoryAllocator::HugePages pages, bool prefault)
+    : _data(nullptr), _size(0), _pages(MemoryAllocator::HugePages::None)
+{
+    size = std::max<size_t>(size, 1);
+
+    switch(pages)
+    {
+    case MemoryAllocator::HugePages::Explicit:
+        if(map_explicit(size)) {
+            break;
+        }
+        LOG_WARNING("Unable to map " << size << " bytes of explicit huge pages, falling back to transparent huge pages\n");
+        // fall through
+    case MemoryAllocator::HugePages::Transparent:
+        if(map_transparent(size)) {
+            break;
+        }
+        // fall through
+    case MemoryAllocator::HugePages::None:
+        if(!map(size)) {
+            throw std::bad_alloc();
+        }
+        break;
+    }
+
+    if(prefault) {
+        this->prefault();
+    }
+}
+
+MappedRegion::~MappedRegion() noexcept
+{
+    unmap();
+}
+
+bool MappedRegion::map(size_t size)
+{
+    size_t bytes = round_up(size, page_size());
+
+#if defined WIN32
+    void* ptr = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if(nullptr == ptr) {
+        return false;
+    }
+#else
+    void* ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(MAP_FAILED == ptr) {
+        return false;
+    }
+#endif
+
+    _data = reinterpret_cast<unsigned char*>(ptr);
+    _size = bytes;
+    _pages = MemoryAllocator::HugePages::None;
+    return true;
+}
+
+bool MappedRegion::map_explicit(size_t size)
+{
+    size_t bytes = size;
+    void* ptr = nullptr;
+
+#if defined WIN32
+    // this needs the lock pages in memory privilege
+    size_t large_page_size = GetLargePageMinimum();
+    if(0 != large_page_size) {
+        bytes = round_up(size, large_page_size);
+        ptr = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    }
+#elif defined __linux__ && defined MAP_HUGETLB
+    // this needs pages reserved in /proc/sys/vm/nr_hugepages
+    bytes = round_up(size, HUGE_PAGE_SIZE);
+    ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if(MAP_FAILED == ptr) {
+        ptr = nullptr;
+    }
+#endif
+
+    if(nullptr == ptr) {
+        return false;
+    }
+
+    _data = reinterpret_cast<unsigned char*>(ptr);
+    _size = bytes;
+    _pages = MemoryAllocator::HugePages::Explicit;
+    return true;
+}
+
+bool MappedRegion::map_transparent(size_t size)
+{
+#if defined __linux__ && defined MADV_HUGEPAGE
+    size_t bytes = round_up(size, HUGE_PAGE_SIZE);
+
+    // the kernel can only use huge pages for huge page aligned ranges,
+    // so map an extra page and trim the region down to an aligned one
+    size_t mapped = bytes + HUGE_PAGE_SIZE;
+    void* ptr = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(MAP_FAILED == ptr) {
+        return false;
+    }
+
+    size_t address = reinterpret_cast<size_t>(ptr);
+    size_t aligned = round_up(address, HUGE_PAGE_SIZE);
+    if(aligned > address) {
+        munmap(ptr, aligned - address);
+    }
+
+    size_t tail = (address + mapped) - (aligned + bytes);
+    if(tail > 0) {
+        munmap(reinterpret_cast<void*>(aligned + bytes), tail);
+    }
+
+    _data = reinterpret_cast<unsigned char*>(aligned);
+    _size = bytes;
+    _pages = MemoryAllocator::HugePages::Transparent;
+
+    // this fails if the kernel was built without transparent huge pages,
+    // the region is still usable with regular pages
+    if(0 != madvise(_data, _size, MADV_HUGEPAGE)) {
+        LOG_WARNING("Unable to enable transparent huge pages: " << last_std_error() << "\n");
+        _pages = MemoryAllocator::HugePages::None;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void MappedRegion::unmap()
+{
+    if(nullptr == _data) {
+        return;
+    }
+
+#if defined WIN32
+    VirtualFree(_data, 0, MEM_RELEASE);
+#else
+    munmap(_data, _size);
+#endif
+
+    _data = nullptr;
+    _size = 0;
+}
+
+void MappedRegion::prefault()
+{
+    // writing (rather than reading) makes sure we get a private page
+    // rather than the shared zero page
+    volatile unsigned char* data = _data;
+    const size_t step = page_size();
+    for(size_t offset=0; offset<_size; offset += step) {
+        data[offset] = 0;
+    }
+}
+
+}
+
+#if defined WITH_UNIT_TESTS
+#include "src/test/UnitTest.h"
+
+class MappedRegionTest : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(MappedRegionTest);
+        CPPUNIT_TEST(test_map);
+        CPPUNIT_TEST(test_transparent);
+        CPPUNIT_TEST(test_explicit);
+        CPPUNIT_TEST(test_prefault);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    MappedRegionTest() : CppUnit::TestFixture() {}
+    virtual ~MappedRegionTest() noexcept {}
+
+public:
+    void test_map()
+    {
+        energonsoftware::MappedRegion region(1000);
+        CPPUNIT_ASSERT(energonsoftware::MemoryAllocator::HugePages::None == region.pages());
+        CPPUNIT_ASSERT_EQUAL(energonsoftware::MappedRegion::page_size(), region.size());
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), reinterpret_cast<size_t>(region.data()) % energonsoftware::MappedRegion::page_size());
+
+        check_region(region);
+        CPPUNIT_ASSERT(!region.contains(region.data() + region.size()));
+    }
+
+    void test_transparent()
+    {
+        // whether we get huge pages depends on the system,
+        // but the region should always be usable
+        energonsoftware::MappedRegion region(3 * 1024 * 1024, energonsoftware::MemoryAllocator::HugePages::Transparent);
+        if(energonsoftware::MemoryAllocator::HugePages::Transparent == region.pages()) {
+            CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), reinterpret_cast<size_t>(region.data()) % energonsoftware::MappedRegion::HUGE_PAGE_SIZE);
+            CPPUNIT_ASSERT_EQUAL(2 * energonsoftware::MappedRegion::HUGE_PAGE_SIZE, region.size());
+        }
+        check_region(region);
+    }
+
+    void test_explicit()
+    {
+        // most systems don't reserve huge pages, so this usually falls back
+        energonsoftware::MappedRegion region(1024 * 1024, energonsoftware::MemoryAllocator::HugePages::Explicit);
+        CPPUNIT_ASSERT(region.size() >= 1024 * 1024);
+        check_region(region);
+    }
+
+    void test_prefault()
+    {
+        energonsoftware::MappedRegion region(256 * 1024, energonsoftware::MemoryAllocator::HugePages::None, true);
+        for(size_t i=0; i<region.size(); ++i) {
+            CPPUNIT_ASSERT_EQUAL(static_cast<unsigned char>(0), region.data()[i]);
+        }
+    }
+
+private:
+    void check_region(const energonsoftware::MappedRegion& region)
+    {
+        std::memset(region.data(), 0xab, region.size());
+        CPPUNIT_ASSERT_EQUAL(static_cast<unsigned char>(0xab), region.data()[region.size() - 1]);
+        CPPUNIT_ASSERT(region.contains(region.data() + region.size() - 1));
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(MappedRegionTest);
+
+#endif
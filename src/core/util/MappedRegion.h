@@ -0,0 +1,75 @@
+#if !defined __MAPPEDREGION_H__
+#define __MAPPEDREGION_H__
+
+#include "MemoryAllocator.h"
+
+namespace energonsoftware {
+
+/*
+A region of memory mapped straight from the system (mmap or VirtualAlloc)
+rather than the heap, optionally backed by huge pages so that
+big arenas don't burn through the TLB.
+
+Huge pages are only a request, if the system can't provide them
+the region falls back to whatever it can get (see pages()).
+Transparent huge pages are only supported on Linux
+and explicit huge pages on Linux and Windows.
+
+Prefaulting touches every page when the region is mapped
+so that the first pass over it doesn't take the page faults.
+
+Construction throws std::bad_alloc if the region can't be mapped at all.
+*/
+class MappedRegion final
+{
+public:
+    // the huge page size we ask for (2MB on x86-64)
+    static const size_t HUGE_PAGE_SIZE;
+
+    // the system's regular page size
+    static size_t page_size();
+
+private:
+    static Logger& logger;
+
+public:
+    MappedRegion(size_t size, MemoryAllocator::HugePages pages=MemoryAllocator::HugePages::None, bool prefault=false);
+    ~MappedRegion() noexcept;
+
+public:
+    unsigned char* data() const { return _data; }
+
+    // this is rounded up to a whole number of pages
+    size_t size() const { return _size; }
+
+    // the pages we actually got
+    MemoryAllocator::HugePages pages() const { return _pages; }
+
+    bool contains(const void* ptr) const
+    {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(ptr);
+        return p >= _data && p < _data + _size;
+    }
+
+private:
+    // these return false if the mapping failed
+    bool map(size_t size);
+    bool map_explicit(size_t size);
+    bool map_transparent(size_t size);
+
+    void unmap();
+    void prefault();
+
+private:
+    unsigned char* _data;
+    size_t _size;
+    MemoryAllocator::HugePages _pages;
+
+private:
+    MappedRegion() = delete;
+    DISALLOW_COPY_AND_ASSIGN(MappedRegion);
+};
+
+}
+
+#endif
@@ -1,4 +1,6 @@
 #include "src/pch.h"
+#include "MappedRegion.h"
+#include "PoolAllocator.h"
 #include "StackAllocator.h"
 #include "SystemAllocator.h"
 #include "MemoryAllocator.h"
@@ -8,20 +10,128 @@ namespace energonsoftware {
 #define ARRAY_OFFSET 0x10
 //#define ARRAY_OFFSET 0x00
 
-std::shared_ptr<MemoryAllocator> MemoryAllocator::new_allocator(Type type, size_t size)
+// every allocator created by new_allocator(), for the stats
+static std::mutex& allocators_mutex()
 {
+    static std::mutex mutex;
+    return mutex;
+}
+
+static std::vector<std::weak_ptr<MemoryAllocator>>& allocators()
+{
+    static std::vector<std::weak_ptr<MemoryAllocator>> allocators;
+    return allocators;
+}
+
+std::string MemoryAllocator::Stats::str() const
+{
+    std::stringstream ss;
+    ss << (tag.empty() ? "(untagged)" : tag) << ": "
+        << count << " live allocations, "
+        << bytes << " live bytes, "
+        << peak_bytes << " peak bytes, "
+        << used << "/" << total << " bytes reserved, "
+        << total_count << " allocations (" << total_bytes << " bytes) "
+        << "at " << allocation_rate() << "/s";
+    return ss.str();
+}
+
+Logger& MemoryAllocator::logger(Logger::instance("energonsoftware.core.util.MemoryAllocator"));
+
+std::shared_ptr<MemoryAllocator> MemoryAllocator::new_allocator(Type type, size_t size, const std::string& tag, Threading threading)
+{
+    std::shared_ptr<MemoryAllocator> allocator;
     switch(type)
     {
     case Type::Stack:
-        return std::shared_ptr<MemoryAllocator>(new StackAllocator(size));
+        allocator.reset(new StackAllocator(size, threading));
+        break;
     case Type::System:
-        return std::shared_ptr<MemoryAllocator>(new SystemAllocator(size));
+        allocator.reset(new SystemAllocator(size, threading));
+        break;
+    case Type::Pool:
+        allocator.reset(new PoolAllocator(size, threading));
+        break;
+    case Type::Mapped:
+        return new_mapped_allocator(size, HugePages::Transparent, false, tag, threading);
+    }
+
+    if(allocator) {
+        register_allocator(allocator, tag);
+    }
+    return allocator;
+}
+
+std::shared_ptr<MemoryAllocator> MemoryAllocator::new_mapped_allocator(size_t size, HugePages pages, bool prefault, const std::string& tag, Threading threading)
+{
+    std::unique_ptr<MappedRegion> region(new MappedRegion(size, pages, prefault));
+    std::shared_ptr<MemoryAllocator> allocator(new PoolAllocator(size, threading, std::move(region)));
+    register_allocator(allocator, tag);
+    return allocator;
+}
+
+void MemoryAllocator::register_allocator(const std::shared_ptr<MemoryAllocator>& allocator, const std::string& tag)
+{
+    allocator->set_tag(tag);
+
+    std::lock_guard<std::mutex> guard(allocators_mutex());
+    std::vector<std::weak_ptr<MemoryAllocator>>& all(allocators());
+    all.erase(std::remove_if(all.begin(), all.end(), [](const std::weak_ptr<MemoryAllocator>& a) { return a.expired(); }), all.end());
+    all.push_back(allocator);
+}
+
+void MemoryAllocator::all_stats(std::vector<Stats>& stats)
+{
+    std::vector<std::shared_ptr<MemoryAllocator>> live;
+    {
+        std::lock_guard<std::mutex> guard(allocators_mutex());
+        for(const std::weak_ptr<MemoryAllocator>& allocator : allocators()) {
+            std::shared_ptr<MemoryAllocator> a(allocator.lock());
+            if(a) {
+                live.push_back(a);
+            }
+        }
+    }
+
+    for(const std::shared_ptr<MemoryAllocator>& allocator : live) {
+        stats.push_back(allocator->stats());
+    }
+}
+
+void MemoryAllocator::tag_stats(std::map<std::string, Stats>& stats)
+{
+    std::vector<Stats> all;
+    all_stats(all);
+
+    for(const Stats& s : all) {
+        Stats& tagged(stats[s.tag]);
+        tagged.tag = s.tag;
+        tagged.total += s.total;
+        tagged.used += s.used;
+        tagged.count += s.count;
+        tagged.bytes += s.bytes;
+        tagged.peak_bytes += s.peak_bytes;
+        tagged.total_count += s.total_count;
+        tagged.total_bytes += s.total_bytes;
+        tagged.age = std::max(tagged.age, s.age);
+    }
+}
+
+void MemoryAllocator::log_stats()
+{
+    std::map<std::string, Stats> stats;
+    tag_stats(stats);
+
+    LOG_INFO("Memory allocators:\n");
+    for(const auto& s : stats) {
+        LOG_INFO("\t" << s.second.str() << "\n");
     }
-    return std::shared_ptr<MemoryAllocator>();
 }
 
-MemoryAllocator::MemoryAllocator()
-    : _mutex(), _allocation_count(0), _allocation_bytes(0)
+MemoryAllocator::MemoryAllocator(Threading threading)
+    : _mutex(), _allocation_count(0), _allocation_bytes(0), _tag(), _threading(threading), _owner(std::this_thread::get_id()),
+        _created(std::chrono::steady_clock::now()),
+        _peak_bytes(0), _total_count(0), _total_bytes(0)
 {
 }
 
@@ -29,6 +139,45 @@ MemoryAllocator::~MemoryAllocator() noexcept
 {
 }
 
+MemoryAllocator::Stats MemoryAllocator::stats() const
+{
+    Stats stats;
+    stats.tag = _tag;
+    stats.total = total();
+    stats.used = used();
+    stats.count = _allocation_count;
+    stats.bytes = _allocation_bytes;
+    stats.peak_bytes = _peak_bytes;
+    stats.total_count = _total_count;
+    stats.total_bytes = _total_bytes;
+    stats.age = std::chrono::duration<double>(std::chrono::steady_clock::now() - _created).count();
+    return stats;
+}
+
+void MemoryAllocator::track_allocation(size_t bytes)
+{
+    _allocation_count++;
+    _total_count++;
+    _total_bytes += bytes;
+
+    size_t live = _allocation_bytes += bytes;
+    size_t peak = _peak_bytes.load();
+    while(live > peak && !_peak_bytes.compare_exchange_weak(peak, live)) {
+    }
+}
+
+void MemoryAllocator::track_release(size_t bytes)
+{
+    _allocation_count--;
+    _allocation_bytes -= bytes;
+}
+
+void MemoryAllocator::track_reset(size_t count, size_t bytes)
+{
+    _allocation_count = count;
+    _allocation_bytes = bytes;
+}
+
 /*void* MemoryAllocator::allocate_array(size_t bytes)
 {
     // need to allocate a little extra for systems
@@ -180,7 +329,7 @@ MemoryAllocatorTest::MemoryAllocatorTest(energonsoftware::MemoryAllocator::Type
 void MemoryAllocatorTest::setUp()
 {
     // 5MB
-    _allocator = energonsoftware::MemoryAllocator::new_allocator(_type, 5 * 1024 * 1024);
+    _allocator = energonsoftware::MemoryAllocator::new_allocator(_type, 5 * 1024 * 1024, "MemoryAllocatorTest");
 }
 
 void MemoryAllocatorTest::tearDown()
@@ -216,22 +365,22 @@ void MemoryAllocatorTest::test_allocate_nosmart()
     int* value = new(*_allocator) int;
     check_value(value);
     CPPUNIT_ASSERT_EQUAL(1U, _allocator->allocation_count());
-    //CPPUNIT_ASSERT_EQUAL(sizeof(int), _allocator->allocation_bytes());
+    CPPUNIT_ASSERT_EQUAL(sizeof(int), _allocator->allocation_bytes());
 
     operator delete(value, *_allocator);
     value = nullptr;
     CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_count());
-    //CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_bytes());
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), _allocator->allocation_bytes());
 
     char* buffer = new(*_allocator) char[MAX_BUFFER];
     check_buffer(buffer);
     CPPUNIT_ASSERT_EQUAL(1U, _allocator->allocation_count());
-    //CPPUNIT_ASSERT_EQUAL(MAX_BUFFER * sizeof(char), _allocator->allocation_bytes());
+    CPPUNIT_ASSERT_EQUAL(MAX_BUFFER * sizeof(char), _allocator->allocation_bytes());
 
     operator delete[](buffer, *_allocator);
     buffer = nullptr;
     CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_count());
-    //CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_bytes());
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), _allocator->allocation_bytes());
 }
 
 void MemoryAllocatorTest::test_allocate_shared()
@@ -239,20 +388,20 @@ void MemoryAllocatorTest::test_allocate_shared()
     std::shared_ptr<int> value(new(*_allocator) int, std::bind(&energonsoftware::MemoryAllocator::release, _allocator.get(), std::placeholders::_1));
     check_value(value.get());
     CPPUNIT_ASSERT_EQUAL(1U, _allocator->allocation_count());
-    //CPPUNIT_ASSERT_EQUAL(sizeof(int), _allocator->allocation_bytes());
+    CPPUNIT_ASSERT_EQUAL(sizeof(int), _allocator->allocation_bytes());
 
     value.reset();
     CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_count());
-    //CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_bytes());
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), _allocator->allocation_bytes());
 
     std::shared_ptr<char> buffer(new(*_allocator) char[MAX_BUFFER], std::bind(&energonsoftware::MemoryAllocator::release, _allocator.get(), std::placeholders::_1));
     check_buffer(buffer.get());
     CPPUNIT_ASSERT_EQUAL(1U, _allocator->allocation_count());
-    //CPPUNIT_ASSERT_EQUAL(MAX_BUFFER * sizeof(char), _allocator->allocation_bytes());
+    CPPUNIT_ASSERT_EQUAL(MAX_BUFFER * sizeof(char), _allocator->allocation_bytes());
 
     buffer.reset();
     CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_count());
-    //CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_bytes());
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), _allocator->allocation_bytes());
 }
 
 void MemoryAllocatorTest::test_allocate_unique()
@@ -262,20 +411,20 @@ void MemoryAllocatorTest::test_allocate_unique()
     std::unique_ptr<int> value(new(*_allocator) int, std::bind(&energonsoftware::MemoryAllocator::release, _allocator.get(), std::placeholders::_1));
     check_value(value.get());
     CPPUNIT_ASSERT_EQUAL(1U, _allocator->allocation_count());
-    //CPPUNIT_ASSERT_EQUAL(sizeof(int), _allocator->allocation_bytes());
+    CPPUNIT_ASSERT_EQUAL(sizeof(int), _allocator->allocation_bytes());
 
     value.reset();
     CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_count());
-    //CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_bytes());
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), _allocator->allocation_bytes());
 
     std::unique_ptr<char[]> buffer(new(*_allocator) char[MAX_BUFFER], std::bind(&energonsoftware::MemoryAllocator::release, _allocator.get(), std::placeholders::_1));
     check_buffer(buffer.get());
     CPPUNIT_ASSERT_EQUAL(1U, _allocator->allocation_count());
-    //CPPUNIT_ASSERT_EQUAL(MAX_BUFFER * sizeof(char), _allocator->allocation_bytes());
+    CPPUNIT_ASSERT_EQUAL(MAX_BUFFER * sizeof(char), _allocator->allocation_bytes());
 
     buffer.reset();
     CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_count());
-    //CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_bytes());
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), _allocator->allocation_bytes());
 #endif
 throw energonsoftware::NotImplementedError("MemoryAllocatorTest::test_allocate_unique");
 }
@@ -288,11 +437,11 @@ void MemoryAllocatorTest::test_allocate_object()
     obj->do_stuff();
     obj->check_data();
     CPPUNIT_ASSERT_EQUAL(1U, _allocator->allocation_count());
-    //CPPUNIT_ASSERT_EQUAL(sizeof(DerivedObject), _allocator->allocation_bytes());
+    CPPUNIT_ASSERT_EQUAL(sizeof(DerivedObject), _allocator->allocation_bytes());
 
     obj.reset();
     CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_count());
-    //CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_bytes());
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), _allocator->allocation_bytes());
 
     static const int OBJ_COUNT = 100;
 
@@ -304,11 +453,46 @@ void MemoryAllocatorTest::test_allocate_object()
         objs.get()[i].check_data();
     }
     CPPUNIT_ASSERT_EQUAL(1U, _allocator->allocation_count());
-    //CPPUNIT_ASSERT_EQUAL(OBJ_COUNT * sizeof(DerivedObject), _allocator->allocation_bytes());
+    CPPUNIT_ASSERT_EQUAL(OBJ_COUNT * sizeof(DerivedObject), _allocator->allocation_bytes());
 
     objs.reset();
     CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_count());
-    //CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_bytes());
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), _allocator->allocation_bytes());
+}
+
+void MemoryAllocatorTest::test_stats()
+{
+    void* first = _allocator->allocate(100);
+    void* second = _allocator->allocate(50);
+    CPPUNIT_ASSERT_EQUAL(2U, _allocator->allocation_count());
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(150), _allocator->allocation_bytes());
+
+    _allocator->release(second);
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(100), _allocator->allocation_bytes());
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(150), _allocator->peak_bytes());
+
+    energonsoftware::MemoryAllocator::Stats stats(_allocator->stats());
+    CPPUNIT_ASSERT_EQUAL(std::string("MemoryAllocatorTest"), stats.tag);
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), stats.count);
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), stats.total_count);
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(150), stats.total_bytes);
+    CPPUNIT_ASSERT(stats.used >= stats.bytes);
+
+    // this should be the only allocator with our tag
+    std::map<std::string, energonsoftware::MemoryAllocator::Stats> tagged;
+    energonsoftware::MemoryAllocator::tag_stats(tagged);
+    CPPUNIT_ASSERT(tagged.find("MemoryAllocatorTest") != tagged.end());
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(100), tagged["MemoryAllocatorTest"].bytes);
+
+    _allocator->release(first);
+    if(energonsoftware::MemoryAllocator::Type::Stack == _type) {
+        // first isn't the top anymore, so it's live until the stack is reset
+        CPPUNIT_ASSERT_EQUAL(1U, _allocator->allocation_count());
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(100), _allocator->allocation_bytes());
+        _allocator->reset();
+    }
+    CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_count());
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), _allocator->allocation_bytes());
 }
 
 void MemoryAllocatorTest::test_allocate_aligned_nosmart()
@@ -322,7 +506,7 @@ void MemoryAllocatorTest::test_allocate_aligned_nosmart()
     operator delete(value, ALIGNMENT, *_allocator);
     value = nullptr;
     CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_count());
-    //CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_bytes());
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), _allocator->allocation_bytes());
 
     char* buffer = new(ALIGNMENT, *_allocator) char[1024];
     check_buffer(buffer);
@@ -331,7 +515,7 @@ void MemoryAllocatorTest::test_allocate_aligned_nosmart()
     operator delete[](buffer, ALIGNMENT, *_allocator);
     buffer = nullptr;
     CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_count());
-    //CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_bytes());
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), _allocator->allocation_bytes());
 }
 
 void MemoryAllocatorTest::test_allocate_aligned_shared()
@@ -357,7 +541,7 @@ void MemoryAllocatorTest::test_allocate_object_aligned()
 
     obj.reset();
     CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_count());
-    //CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_bytes());
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), _allocator->allocation_bytes());
 
     static const int OBJ_COUNT = 100;
 
@@ -372,6 +556,6 @@ void MemoryAllocatorTest::test_allocate_object_aligned()
 
     objs.reset();
     CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_count());
-    //CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_bytes());
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), _allocator->allocation_bytes());
 }
 #endif
@@ -9,34 +9,128 @@ public:
     enum class Type
     {
         Stack,
-        System
+        System,
+        Pool,
+
+        // a pool allocator whose spans are carved out of
+        // one region mapped up front (see MappedRegion)
+        Mapped
+    };
+
+    // what pages a Mapped allocator asks the system for
+    enum class HugePages
+    {
+        // regular pages
+        None,
+
+        // regular pages the kernel is asked to back with huge pages (Linux only)
+        Transparent,
+
+        // pages from the reserved huge page pool (MAP_HUGETLB or MEM_LARGE_PAGES),
+        // falls back to Transparent if there aren't enough of them
+        Explicit
+    };
+
+    enum class Threading
+    {
+        // allocate() and release() lock the allocator
+        Locked,
+
+        // only the owning thread may use the allocator so nothing is locked,
+        // debug builds assert if any other thread uses it
+        SingleOwner,
+
+        // nothing is locked and any thread may use the allocator
+        // (the stack allocator bumps its marker atomically)
+        Concurrent
+    };
+
+    // a snapshot of an allocator's statistics
+    struct Stats
+    {
+        std::string tag;
+
+        // memory reserved by the allocator
+        size_t total, used;
+
+        // live allocations and the bytes requested for them
+        size_t count, bytes;
+
+        // the most live bytes there have been
+        size_t peak_bytes;
+
+        // every allocation ever made
+        size_t total_count, total_bytes;
+
+        // seconds since the allocator was created
+        double age;
+
+        Stats() : tag(), total(0), used(0), count(0), bytes(0), peak_bytes(0), total_count(0), total_bytes(0), age(0.0) {}
+
+        // allocations per second
+        double allocation_rate() const { return age > 0.0 ? total_count / age : 0.0; }
+
+        std::string str() const;
     };
 
+private:
+    static Logger& logger;
+
+    // tags the allocator and adds it to the stats
+    static void register_allocator(const std::shared_ptr<MemoryAllocator>& allocator, const std::string& tag);
+
 public:
-    // size is in bytes
-    static std::shared_ptr<MemoryAllocator> new_allocator(Type type, size_t size);
+    // size is in bytes, the tag groups allocators together in the stats
+    static std::shared_ptr<MemoryAllocator> new_allocator(Type type, size_t size, const std::string& tag=std::string(), Threading threading=Threading::Locked);
+
+    // creates a Mapped allocator, prefaulting touches every page up front
+    // so the first allocations don't take the page faults
+    // (new_allocator() maps Transparent huge pages and doesn't prefault)
+    static std::shared_ptr<MemoryAllocator> new_mapped_allocator(size_t size, HugePages pages, bool prefault,
+        const std::string& tag=std::string(), Threading threading=Threading::Locked);
+
+    // stats for every allocator created by new_allocator() that's still alive
+    static void all_stats(std::vector<Stats>& stats);
+
+    // the same stats summed by tag
+    static void tag_stats(std::map<std::string, Stats>& stats);
+
+    // logs the stats for each tag
+    static void log_stats();
 
 public:
     virtual ~MemoryAllocator() noexcept;
 
 public:
+    const std::string& tag() const { return _tag; }
+    void set_tag(const std::string& tag) { _tag = tag; }
+
+    Threading threading() const { return _threading; }
+
+    // makes the calling thread the owner of a SingleOwner allocator
+    // (allocators are owned by the thread that created them)
+    // NOTE: the previous owner must be done with the allocator
+    void claim() { _owner = std::this_thread::get_id(); }
+
     // values returned in bytes
-    // TODO: used and unused counts are not accurate wrt release() calls
     virtual size_t total() const = 0;
     virtual size_t used() const = 0;
     virtual size_t unused() const = 0;
 
+    // live allocations
     virtual unsigned int allocation_count() const final { return _allocation_count; }
-    // TODO: this is unreliable for now because we don't know deletion bytes
-    // if we can sort out a good way to handle that, re-enable this
-    //virtual size_t allocation_bytes() const final { return _allocation_bytes; }
+    virtual size_t allocation_bytes() const final { return _allocation_bytes; }
+    virtual size_t peak_bytes() const final { return _peak_bytes; }
+
+    virtual Stats stats() const final;
 
     // NOTE: all of the allocation() and release() overrides
-    // must lock the allocator with a std::lock_guard
+    // must lock the allocator with a Guard
+    // (or otherwise be thread safe)
 
     // allocate unaligned memory
     // NOTE: overriding classes *must* maintain
-    // allocation statistics inside of this
+    // allocation statistics inside of this (see track_allocation())
     virtual void* allocate(size_t bytes) = 0;
     //virtual void* allocate_array(size_t bytes) final;
 
@@ -57,12 +151,68 @@ public:
     virtual void reset() = 0;
 
 protected:
-    MemoryAllocator();
+    // locks the allocator if it's Locked, and checks the owner if it's SingleOwner
+    class Guard final
+    {
+    public:
+        explicit Guard(MemoryAllocator& allocator)
+            : _allocator(allocator), _locked(Threading::Locked == allocator._threading)
+        {
+            if(_locked) {
+                _allocator._mutex.lock();
+            } else {
+                _allocator.check_owner();
+            }
+        }
+
+        ~Guard() noexcept
+        {
+            if(_locked) {
+                _allocator._mutex.unlock();
+            }
+        }
+
+    private:
+        MemoryAllocator& _allocator;
+        bool _locked;
+
+    private:
+        Guard() = delete;
+        DISALLOW_COPY_AND_ASSIGN(Guard);
+    };
+
+protected:
+    explicit MemoryAllocator(Threading threading);
+
+    void check_owner() const
+    {
+        assert(Threading::SingleOwner != _threading || std::this_thread::get_id() == _owner);
+    }
+
+    // overriding classes call these with the requested size of each block
+    // as it's allocated and when it's actually given back
+    void track_allocation(size_t bytes);
+    void track_release(size_t bytes);
+
+    // for allocators that free everything at once
+    void track_reset(size_t count, size_t bytes);
 
 protected:
     std::recursive_mutex _mutex;
-    size_t _allocation_count;
-    unsigned int _allocation_bytes;
+
+    // these are atomic for allocators that don't lock
+    std::atomic<size_t> _allocation_count;
+    std::atomic<size_t> _allocation_bytes;
+
+private:
+    std::string _tag;
+    Threading _threading;
+    std::thread::id _owner;
+    std::chrono::steady_clock::time_point _created;
+
+    std::atomic<size_t> _peak_bytes;
+    std::atomic<size_t> _total_count;
+    std::atomic<size_t> _total_bytes;
 
 private:
     DISALLOW_COPY_AND_ASSIGN(MemoryAllocator);
@@ -271,6 +421,7 @@ CPPUNIT_TEST(test_allocate_shared);
 CPPUNIT_TEST(test_allocate_unique);
 
 CPPUNIT_TEST(test_allocate_object);
+CPPUNIT_TEST(test_stats);
 
 CPPUNIT_TEST(test_allocate_aligned_nosmart);
 CPPUNIT_TEST(test_allocate_aligned_shared);
@@ -294,6 +445,7 @@ public:
     void test_allocate_unique();
 
     void test_allocate_object();
+    void test_stats();
 
     void test_allocate_aligned_nosmart();
     void test_allocate_aligned_shared();
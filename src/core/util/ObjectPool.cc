@@ -0,0 +1,162 @@
+#include "src/pch.h"
+#include "ObjectPool.h"
+
+#if defined WITH_UNIT_TESTS
+#include "src/test/UnitTest.h"
+
+class ObjectPoolTest : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(ObjectPoolTest);
+        CPPUNIT_TEST(test_acquire);
+        CPPUNIT_TEST(test_grow);
+        CPPUNIT_TEST(test_handle);
+        CPPUNIT_TEST(test_adopt);
+        CPPUNIT_TEST(test_allocator);
+    CPPUNIT_TEST_SUITE_END();
+
+private:
+    class BaseObject
+    {
+    public:
+        explicit BaseObject(int value) : _value(value) { ++live; }
+        virtual ~BaseObject() noexcept { --live; }
+
+        int value() const { return _value; }
+
+    public:
+        static int live;
+
+    private:
+        int _value;
+    };
+
+    class DerivedObject : public BaseObject
+    {
+    public:
+        DerivedObject(int value, float scale) : BaseObject(value), _scale(scale) {}
+        virtual ~DerivedObject() noexcept {}
+
+        float scale() const { return _scale; }
+
+    private:
+        float _scale;
+    };
+
+public:
+    ObjectPoolTest() : CppUnit::TestFixture() {}
+    virtual ~ObjectPoolTest() noexcept {}
+
+public:
+    void setUp()
+    {
+        BaseObject::live = 0;
+    }
+
+    void test_acquire()
+    {
+        energonsoftware::ObjectPool<BaseObject> pool(nullptr, 4);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), pool.capacity());
+
+        BaseObject* first = pool.acquire(1);
+        BaseObject* second = pool.acquire(2);
+        CPPUNIT_ASSERT_EQUAL(1, first->value());
+        CPPUNIT_ASSERT_EQUAL(2, second->value());
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), pool.size());
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(4), pool.capacity());
+        CPPUNIT_ASSERT_EQUAL(2, BaseObject::live);
+
+        // released slots are handed straight back out
+        pool.release(second);
+        CPPUNIT_ASSERT_EQUAL(1, BaseObject::live);
+        BaseObject* third = pool.acquire(3);
+        CPPUNIT_ASSERT_EQUAL(second, third);
+        CPPUNIT_ASSERT_EQUAL(3, third->value());
+
+        pool.release(first);
+        pool.release(third);
+        pool.release(nullptr);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), pool.size());
+        CPPUNIT_ASSERT_EQUAL(0, BaseObject::live);
+    }
+
+    void test_grow()
+    {
+        energonsoftware::ObjectPool<BaseObject> pool(nullptr, 4);
+
+        std::vector<BaseObject*> objects;
+        for(int i=0; i<10; ++i) {
+            objects.push_back(pool.acquire(i));
+        }
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(12), pool.capacity());
+
+        // every slab starts on a cache line
+        for(size_t i=0; i<objects.size(); i += 4) {
+            CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), reinterpret_cast<size_t>(objects[i]) % energonsoftware::CACHE_LINE_SIZE);
+        }
+
+        for(size_t i=0; i<objects.size(); ++i) {
+            CPPUNIT_ASSERT_EQUAL(static_cast<int>(i), objects[i]->value());
+            pool.release(objects[i]);
+        }
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(12), pool.capacity());
+    }
+
+    void test_handle()
+    {
+        energonsoftware::ObjectPool<DerivedObject> pool;
+        {
+            energonsoftware::PoolHandle<DerivedObject> derived(pool.make(5, 2.0f));
+            CPPUNIT_ASSERT(static_cast<bool>(derived));
+            CPPUNIT_ASSERT_EQUAL(2.0f, derived->scale());
+            CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), pool.size());
+
+            // converting to the base type keeps the object in the pool
+            energonsoftware::PoolHandle<BaseObject> base(std::move(derived));
+            CPPUNIT_ASSERT(!derived);
+            CPPUNIT_ASSERT_EQUAL(5, base->value());
+            CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), pool.size());
+
+            energonsoftware::PoolHandle<DerivedObject> back(base.static_cast_to<DerivedObject>());
+            CPPUNIT_ASSERT(!base);
+            CPPUNIT_ASSERT_EQUAL(2.0f, back->scale());
+        }
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), pool.size());
+        CPPUNIT_ASSERT_EQUAL(0, BaseObject::live);
+
+        energonsoftware::PoolHandle<DerivedObject> handle(pool.make(1, 1.0f));
+        handle.reset();
+        CPPUNIT_ASSERT(!handle);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), pool.size());
+    }
+
+    void test_adopt()
+    {
+        {
+            energonsoftware::PoolHandle<BaseObject> handle(energonsoftware::PoolHandle<BaseObject>::adopt(new DerivedObject(1, 1.0f)));
+            CPPUNIT_ASSERT_EQUAL(1, BaseObject::live);
+        }
+        CPPUNIT_ASSERT_EQUAL(0, BaseObject::live);
+    }
+
+    void test_allocator()
+    {
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(
+            energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::System, 1024 * 1024));
+        {
+            energonsoftware::ObjectPool<BaseObject> pool(allocator.get(), 16);
+
+            BaseObject* object = pool.acquire(7);
+            CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), reinterpret_cast<size_t>(object) % energonsoftware::CACHE_LINE_SIZE);
+            CPPUNIT_ASSERT(allocator->allocation_count() > 0);
+            pool.release(object);
+        }
+        CPPUNIT_ASSERT_EQUAL(0U, allocator->allocation_count());
+    }
+};
+
+int ObjectPoolTest::BaseObject::live = 0;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ObjectPoolTest);
+
+#endif
@@ -0,0 +1,269 @@
+#if !defined __OBJECTPOOL_H__
+#define __OBJECTPOOL_H__
+
+#include "MemoryAllocator.h"
+
+namespace energonsoftware {
+
+// slabs are aligned to this so objects don't share a line with another slab's
+static const size_t CACHE_LINE_SIZE = 64;
+
+/*
+Owns a single object, like a std::unique_ptr, but releases it through a function
+so it can be handed back to the ObjectPool it came from.
+A handle can be converted to a handle of a base type.
+*/
+template<typename T>
+class PoolHandle final
+{
+public:
+    typedef void (*ReleaseFunction)(void* owner, void* object);
+
+    // takes ownership of an object that was allocated with new
+    static PoolHandle adopt(T* object) { return PoolHandle(object, nullptr, object, &delete_object); }
+
+public:
+    PoolHandle() : _object(nullptr), _owner(nullptr), _slot(nullptr), _release(nullptr) {}
+
+    PoolHandle(T* object, void* owner, void* slot, ReleaseFunction release)
+        : _object(object), _owner(owner), _slot(slot), _release(release)
+    {
+    }
+
+    PoolHandle(PoolHandle&& other) noexcept
+        : _object(other._object), _owner(other._owner), _slot(other._slot), _release(other._release)
+    {
+        other.clear();
+    }
+
+    template<typename U, typename = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+    PoolHandle(PoolHandle<U>&& other) noexcept
+        : _object(other._object), _owner(other._owner), _slot(other._slot), _release(other._release)
+    {
+        other.clear();
+    }
+
+    ~PoolHandle() noexcept { reset(); }
+
+    PoolHandle& operator=(PoolHandle&& rhs) noexcept
+    {
+        if(this != &rhs) {
+            reset();
+
+            _object = rhs._object;
+            _owner = rhs._owner;
+            _slot = rhs._slot;
+            _release = rhs._release;
+            rhs.clear();
+        }
+        return *this;
+    }
+
+public:
+    T* get() const { return _object; }
+    T& operator*() const { return *_object; }
+    T* operator->() const { return _object; }
+    explicit operator bool() const { return nullptr != _object; }
+
+    void reset()
+    {
+        if(nullptr != _object) {
+            _release(_owner, _slot);
+            clear();
+        }
+    }
+
+    // converts to a handle of a derived type
+    // NOTE: the object must actually be a U
+    template<typename U>
+    PoolHandle<U> static_cast_to()
+    {
+        PoolHandle<U> handle(static_cast<U*>(_object), _owner, _slot, _release);
+        clear();
+        return handle;
+    }
+
+private:
+    template<typename U> friend class PoolHandle;
+
+    static void delete_object(void*, void* object)
+    {
+        delete reinterpret_cast<T*>(object);
+    }
+
+    void clear()
+    {
+        _object = nullptr;
+        _owner = nullptr;
+        _slot = nullptr;
+        _release = nullptr;
+    }
+
+private:
+    T* _object;
+    void* _owner;
+
+    // the object as it was allocated (before any conversions)
+    void* _slot;
+    ReleaseFunction _release;
+
+private:
+    PoolHandle(const PoolHandle&) = delete;
+    PoolHandle& operator=(const PoolHandle&) = delete;
+};
+
+// so pools of different types can be shared around
+class BaseObjectPool
+{
+public:
+    virtual ~BaseObjectPool() noexcept {}
+
+protected:
+    BaseObjectPool() {}
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(BaseObjectPool);
+};
+
+/*
+Fixed size object pool.
+
+Objects are constructed in slots carved out of cache line aligned slabs
+and released slots are kept on an intrusive free list,
+so acquiring and releasing an object is O(1) (apart from when a new slab is needed).
+Slabs come from the given allocator (or the heap if there isn't one)
+and are only freed when the pool is destroyed.
+
+NOTE: this is not thread safe
+NOTE: every object must be released before the pool is destroyed
+*/
+template<typename T>
+class ObjectPool final : public BaseObjectPool
+{
+public:
+    static_assert(std::alignment_of<T>::value <= CACHE_LINE_SIZE, "ObjectPool can't align objects that strictly");
+
+public:
+    explicit ObjectPool(MemoryAllocator* const allocator=nullptr, size_t slab_count=64)
+        : BaseObjectPool(), _allocator(allocator), _slab_count(std::max<size_t>(slab_count, 1)),
+            _slabs(), _free(nullptr), _size(0)
+    {
+    }
+
+    virtual ~ObjectPool() noexcept
+    {
+        assert(0 == _size);
+
+        for(unsigned char* slab : _slabs) {
+            if(nullptr != _allocator) {
+                _allocator->release_aligned(slab, CACHE_LINE_SIZE);
+            } else {
+                delete[] slab;
+            }
+        }
+    }
+
+public:
+    // number of live objects
+    size_t size() const { return _size; }
+
+    size_t capacity() const { return _slabs.size() * _slab_count; }
+
+    template<typename... Args>
+    T* acquire(Args&&... args)
+    {
+        if(nullptr == _free) {
+            grow();
+        }
+
+        Slot* slot = _free;
+        _free = slot->next;
+
+        T* object = nullptr;
+        try {
+            object = new(&slot->storage) T(std::forward<Args>(args)...);
+        } catch(...) {
+            slot->next = _free;
+            _free = slot;
+            throw;
+        }
+
+        ++_size;
+        return object;
+    }
+
+    // NOTE: object must have come from acquire()
+    void release(T* object)
+    {
+        if(nullptr == object) {
+            return;
+        }
+
+        object->~T();
+
+        Slot* slot = reinterpret_cast<Slot*>(object);
+        slot->next = _free;
+        _free = slot;
+        --_size;
+    }
+
+    template<typename... Args>
+    PoolHandle<T> make(Args&&... args)
+    {
+        T* object = acquire(std::forward<Args>(args)...);
+        return PoolHandle<T>(object, this, object, &release_object);
+    }
+
+private:
+    union Slot
+    {
+        Slot* next;
+        typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type storage;
+    };
+
+    static void release_object(void* owner, void* object)
+    {
+        reinterpret_cast<ObjectPool<T>*>(owner)->release(reinterpret_cast<T*>(object));
+    }
+
+    void grow()
+    {
+        size_t bytes = sizeof(Slot) * _slab_count;
+
+        unsigned char* slab = nullptr;
+        if(nullptr != _allocator) {
+            slab = reinterpret_cast<unsigned char*>(_allocator->allocate_aligned(bytes, CACHE_LINE_SIZE));
+        } else {
+            // new[] doesn't do over-aligned allocations, so line the slab up ourselves
+            slab = new unsigned char[bytes + CACHE_LINE_SIZE];
+        }
+        _slabs.push_back(slab);
+
+        size_t address = reinterpret_cast<size_t>(slab);
+        if(nullptr == _allocator) {
+            address = (address + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
+        }
+
+        // thread the slots from the back so they come out in address order
+        Slot* slots = reinterpret_cast<Slot*>(address);
+        for(size_t i=_slab_count; i>0; --i) {
+            slots[i - 1].next = _free;
+            _free = &slots[i - 1];
+        }
+    }
+
+private:
+    MemoryAllocator* _allocator;
+    size_t _slab_count;
+
+    std::vector<unsigned char*> _slabs;
+    Slot* _free;
+    size_t _size;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(ObjectPool);
+};
+
+}
+
+#endif
@@ -124,6 +124,7 @@ public:
         CPPUNIT_TEST(test_binary);
         //CPPUNIT_TEST(test_protobuf);
         CPPUNIT_TEST(test_xml);
+        CPPUNIT_TEST(test_binary_bits);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -151,6 +152,46 @@ public:
         test_packer(energonsoftware::PackerType::XML);
     }
 
+    void test_binary_bits()
+    {
+        energonsoftware::BinaryPacker packer;
+        packer.pack_bits(5, 3, "three");
+        packer.pack_bits(0x1ff, 9, "nine");
+        packer.pack_bits(0xdeadbeef, 32, "thirtytwo");
+
+        // 44 bits rounds up to 6 bytes
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(6), packer.buffer().length());
+
+        // the bits are padded out before the regular fields
+        packer.pack(static_cast<uint32_t>(12), "test_uint");
+        packer.pack_bits(1, 1, "one");
+        packer.pack(true, "test_bool");
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(15), packer.buffer().length());
+
+        CPPUNIT_ASSERT_THROW(packer.pack_bits(8, 3, "too_big"), energonsoftware::PackerError);
+        CPPUNIT_ASSERT_THROW(packer.pack_bits(0, 33, "too_many"), energonsoftware::PackerError);
+
+        energonsoftware::BinaryUnpacker unpacker(packer.buffer());
+        uint32_t v;
+        unpacker.unpack_bits(v, 3, "three");
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(5), v);
+        unpacker.unpack_bits(v, 9, "nine");
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(0x1ff), v);
+        unpacker.unpack_bits(v, 32, "thirtytwo");
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(0xdeadbeef), v);
+
+        unpacker.unpack(v, "test_uint");
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(12), v);
+        unpacker.unpack_bits(v, 1, "one");
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(1), v);
+
+        bool b;
+        unpacker.unpack(b, "test_bool");
+        CPPUNIT_ASSERT_EQUAL(true, b);
+
+        CPPUNIT_ASSERT_THROW(unpacker.unpack_bits(v, 1, "past_the_end"), energonsoftware::PackerError);
+    }
+
 private:
     std::shared_ptr<energonsoftware::Packer> create_packer(energonsoftware::PackerType type, const boost::any& data)
     {
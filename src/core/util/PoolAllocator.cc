@@ -0,0 +1,445 @@
+#include "src/pch.h"
+#include "PoolAllocator.h"
+
+namespace energonsoftware {
+
+// every block starts with one of these so release() knows where it came from,
+// the header is padded out so blocks stay 16 byte aligned
+struct BlockHeader
+{
+    size_t size_class;
+    size_t bytes;
+};
+static const size_t HEADER_SIZE = 16;
+static_assert(sizeof(BlockHeader) <= HEADER_SIZE, "BlockHeader is too big");
+
+// block sizes (including the header), 4 classes per power of 2 above 128 bytes
+static const size_t SIZE_CLASSES[] = {
+    16, 32, 48, 64, 80, 96, 112, 128,
+    160, 192, 224, 256,
+    320, 384, 448, 512,
+    640, 768, 896, 1024,
+    1280, 1536, 1792, 2048,
+    2560, 3072, 3584, 4096,
+    5120, 6144, 7168, 8192,
+    10240, 12288, 14336, 16384,
+    20480, 24576, 28672, 32768,
+};
+static const size_t SIZE_CLASS_COUNT = sizeof(SIZE_CLASSES) / sizeof(SIZE_CLASSES[0]);
+
+// the size class of blocks that go straight to the system
+static const size_t LARGE_CLASS = SIZE_CLASS_COUNT;
+
+// spans hold at least 8 blocks
+static const size_t SPAN_SIZE = 64 * 1024;
+
+// roughly how much memory moves between the thread caches and the central lists at once
+static const size_t BATCH_SIZE = 32 * 1024;
+
+static size_t batch_count(size_t size_class)
+{
+    return std::min<size_t>(std::max<size_t>(BATCH_SIZE / SIZE_CLASSES[size_class], 2), 64);
+}
+
+// the last few allocators each thread used and its caches for them
+// NOTE: allocator ids are never reused so a stale slot is never matched
+struct CacheSlot
+{
+    uint64_t id;
+    void* cache;
+};
+static const size_t CACHE_SLOTS = 4;
+static thread_local CacheSlot cache_slots[CACHE_SLOTS];
+static thread_local size_t next_cache_slot = 0;
+
+static std::atomic<uint64_t> next_id(1);
+
+const size_t PoolAllocator::MAX_BLOCK_SIZE = SIZE_CLASSES[SIZE_CLASS_COUNT - 1] - HEADER_SIZE;
+
+Logger& PoolAllocator::logger(Logger::instance("energonsoftware.core.util.PoolAllocator"));
+
+size_t PoolAllocator::size_class(size_t bytes)
+{
+    const size_t* it = std::lower_bound(SIZE_CLASSES, SIZE_CLASSES + SIZE_CLASS_COUNT, bytes);
+    return static_cast<size_t>(it - SIZE_CLASSES);
+}
+
+PoolAllocator::PoolAllocator(size_t size, Threading threading, std::unique_ptr<MappedRegion> region)
+    : MemoryAllocator(threading), _id(next_id.fetch_add(1)), _size(size), _reserved(0), _region(std::move(region)),
+        _central(), _region_used(0), _spans(), _caches()
+{
+    for(size_t i=0; i<SIZE_CLASS_COUNT; ++i) {
+        _central.push_back(std::unique_ptr<CentralList>(new CentralList()));
+    }
+}
+
+PoolAllocator::~PoolAllocator() noexcept
+{
+}
+
+void* PoolAllocator::allocate(size_t bytes)
+{
+    check_owner();
+
+    size_t needed = bytes + HEADER_SIZE;
+    size_t block_class = size_class(needed);
+
+    unsigned char* block = nullptr;
+    if(LARGE_CLASS == block_class) {
+        if(!reserve(needed)) {
+            throw std::bad_alloc();
+        }
+        block = new unsigned char[needed];
+    } else {
+        FreeList& list = thread_cache().lists[block_class];
+        if(nullptr == list.head && !refill(block_class, list)) {
+            throw std::bad_alloc();
+        }
+
+        FreeBlock* free = list.head;
+        list.head = free->next;
+        --list.count;
+        block = reinterpret_cast<unsigned char*>(free);
+    }
+
+    BlockHeader* header = reinterpret_cast<BlockHeader*>(block);
+    header->size_class = block_class;
+    header->bytes = bytes;
+
+    track_allocation(bytes);
+
+    return block + HEADER_SIZE;
+}
+
+void PoolAllocator::release(void* ptr)
+{
+    if(nullptr == ptr) {
+        return;
+    }
+    check_owner();
+
+    unsigned char* block = reinterpret_cast<unsigned char*>(ptr) - HEADER_SIZE;
+    const BlockHeader* header = reinterpret_cast<const BlockHeader*>(block);
+
+    track_release(header->bytes);
+
+    size_t block_class = header->size_class;
+    if(LARGE_CLASS == block_class) {
+        _reserved.fetch_sub(header->bytes + HEADER_SIZE);
+        delete[] block;
+        return;
+    }
+    assert(block_class < SIZE_CLASS_COUNT);
+
+    FreeList& list = thread_cache().lists[block_class];
+    FreeBlock* free = reinterpret_cast<FreeBlock*>(block);
+    free->next = list.head;
+    list.head = free;
+    ++list.count;
+
+    // keep up to two batches around so alternating allocate/release doesn't thrash the central list
+    if(list.count > 2 * batch_count(block_class)) {
+        spill(block_class, list);
+    }
+}
+
+PoolAllocator::ThreadCache& PoolAllocator::thread_cache()
+{
+    for(size_t i=0; i<CACHE_SLOTS; ++i) {
+        if(cache_slots[i].id == _id) {
+            return *reinterpret_cast<ThreadCache*>(cache_slots[i].cache);
+        }
+    }
+
+    std::lock_guard<std::recursive_mutex> guard(_mutex);
+
+    std::unique_ptr<ThreadCache>& cache = _caches[std::this_thread::get_id()];
+    if(!cache) {
+        cache.reset(new ThreadCache(SIZE_CLASS_COUNT));
+    }
+
+    CacheSlot& slot = cache_slots[next_cache_slot++ % CACHE_SLOTS];
+    slot.id = _id;
+    slot.cache = cache.get();
+    return *cache;
+}
+
+bool PoolAllocator::refill(size_t size_class, FreeList& list)
+{
+    CentralList& central = *_central[size_class];
+    std::lock_guard<std::mutex> guard(central.mutex);
+
+    if(nullptr == central.list.head) {
+        size_t block_size = SIZE_CLASSES[size_class];
+        size_t span_size = std::max(SPAN_SIZE, block_size * 8);
+        if(!reserve(span_size)) {
+            return false;
+        }
+
+        unsigned char* span = new_span(span_size);
+        if(nullptr == span) {
+            _reserved.fetch_sub(span_size);
+            return false;
+        }
+
+        // thread the blocks from the back so they come out in address order
+        for(size_t offset=(span_size / block_size) * block_size; offset > 0; offset -= block_size) {
+            FreeBlock* free = reinterpret_cast<FreeBlock*>(span + offset - block_size);
+            free->next = central.list.head;
+            central.list.head = free;
+            ++central.list.count;
+        }
+    }
+
+    size_t count = std::min(batch_count(size_class), central.list.count);
+    FreeBlock* first = central.list.head;
+    FreeBlock* last = first;
+    for(size_t i=1; i<count; ++i) {
+        last = last->next;
+    }
+
+    central.list.head = last->next;
+    central.list.count -= count;
+
+    last->next = list.head;
+    list.head = first;
+    list.count += count;
+    return true;
+}
+
+void PoolAllocator::spill(size_t size_class, FreeList& list)
+{
+    size_t count = batch_count(size_class);
+    FreeBlock* first = list.head;
+    FreeBlock* last = first;
+    for(size_t i=1; i<count; ++i) {
+        last = last->next;
+    }
+
+    list.head = last->next;
+    list.count -= count;
+
+    CentralList& central = *_central[size_class];
+    std::lock_guard<std::mutex> guard(central.mutex);
+
+    last->next = central.list.head;
+    central.list.head = first;
+    central.list.count += count;
+}
+
+unsigned char* PoolAllocator::new_span(size_t bytes)
+{
+    std::lock_guard<std::recursive_mutex> guard(_mutex);
+
+    if(_region) {
+        // large allocations come from the heap, so the region should never run out first,
+        // but the budget and the region are tracked separately so check anyway
+        if(_region_used + bytes > _region->size()) {
+            return nullptr;
+        }
+
+        unsigned char* span = _region->data() + _region_used;
+        _region_used += bytes;
+        return span;
+    }
+
+    unsigned char* span = new unsigned char[bytes];
+    _spans.push_back(std::unique_ptr<unsigned char[]>(span));
+    return span;
+}
+
+bool PoolAllocator::reserve(size_t bytes)
+{
+    size_t reserved = _reserved.fetch_add(bytes);
+    if(reserved + bytes > _size) {
+        _reserved.fetch_sub(bytes);
+        return false;
+    }
+    return true;
+}
+
+}
+
+#if defined WITH_UNIT_TESTS
+#include "src/test/UnitTest.h"
+
+class PoolAllocatorTest : public MemoryAllocatorTest
+{
+public:
+    CPPUNIT_TEST_SUITE(PoolAllocatorTest);
+        CPPUNIT_TEST(test_allocate_nosmart);
+        CPPUNIT_TEST(test_allocate_shared);
+        CPPUNIT_TEST(test_allocate_unique);
+
+        CPPUNIT_TEST(test_allocate_object);
+        CPPUNIT_TEST(test_stats);
+
+        CPPUNIT_TEST(test_allocate_aligned_nosmart);
+        CPPUNIT_TEST(test_allocate_aligned_shared);
+        CPPUNIT_TEST(test_allocate_aligned_unique);
+
+        CPPUNIT_TEST(test_allocate_object_aligned);
+
+        CPPUNIT_TEST(test_recycle);
+        CPPUNIT_TEST(test_large);
+        CPPUNIT_TEST(test_threads);
+
+        CPPUNIT_TEST_EXCEPTION(test_unreasonable_allocation, std::bad_alloc);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    PoolAllocatorTest() : MemoryAllocatorTest(energonsoftware::MemoryAllocator::Type::Pool) {}
+    virtual ~PoolAllocatorTest() noexcept {}
+
+public:
+    void test_recycle()
+    {
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(
+            energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::Pool, 1024 * 1024));
+
+        void* first = allocator->allocate(100);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), reinterpret_cast<size_t>(first) % 16);
+        allocator->release(first);
+
+        // the same size class should hand the block straight back
+        void* second = allocator->allocate(110);
+        CPPUNIT_ASSERT_EQUAL(first, second);
+        allocator->release(second);
+
+        // churning through the pool shouldn't reserve any more memory
+        size_t used = allocator->used();
+        for(int i=0; i<10000; ++i) {
+            allocator->release(allocator->allocate(100));
+        }
+        CPPUNIT_ASSERT_EQUAL(used, allocator->used());
+        CPPUNIT_ASSERT_EQUAL(0U, allocator->allocation_count());
+    }
+
+    void test_large()
+    {
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(
+            energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::Pool, 1024 * 1024));
+
+        void* large = allocator->allocate(energonsoftware::PoolAllocator::MAX_BLOCK_SIZE + 1);
+        CPPUNIT_ASSERT(allocator->used() > energonsoftware::PoolAllocator::MAX_BLOCK_SIZE);
+        allocator->release(large);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), allocator->used());
+    }
+
+    void test_threads()
+    {
+        static const int THREADS = 4;
+        static const int COUNT = 10000;
+
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(
+            energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::Pool, 64 * 1024 * 1024));
+
+        // blocks are released by a different thread than the one that allocated them
+        std::mutex mutex;
+        std::vector<void*> shared;
+        std::vector<std::thread> threads;
+        for(int i=0; i<THREADS; ++i) {
+            threads.push_back(std::thread([&allocator, &mutex, &shared, i]() {
+                for(int j=0; j<COUNT; ++j) {
+                    size_t bytes = 8 + ((i * COUNT + j) * 37) % 2000;
+                    unsigned char* block = reinterpret_cast<unsigned char*>(allocator->allocate(bytes));
+                    std::memset(block, i, bytes);
+
+                    void* other = nullptr;
+                    {
+                        std::lock_guard<std::mutex> guard(mutex);
+                        shared.push_back(block);
+                        if(shared.size() > 100) {
+                            other = shared.front();
+                            shared.erase(shared.begin());
+                        }
+                    }
+                    allocator->release(other);
+                }
+            }));
+        }
+
+        for(auto& thread : threads) {
+            thread.join();
+        }
+
+        for(void* block : shared) {
+            allocator->release(block);
+        }
+        CPPUNIT_ASSERT_EQUAL(0U, allocator->allocation_count());
+    }
+
+    void test_unreasonable_allocation()
+    {
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(
+            energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::Pool, 1024 * 1024));
+
+        // more than the pool is allowed to reserve
+        allocator->allocate(2 * 1024 * 1024);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PoolAllocatorTest);
+
+class MappedPoolAllocatorTest : public MemoryAllocatorTest
+{
+public:
+    CPPUNIT_TEST_SUITE(MappedPoolAllocatorTest);
+        CPPUNIT_TEST(test_allocate_nosmart);
+        CPPUNIT_TEST(test_allocate_shared);
+        CPPUNIT_TEST(test_allocate_unique);
+
+        CPPUNIT_TEST(test_allocate_object);
+        CPPUNIT_TEST(test_stats);
+
+        CPPUNIT_TEST(test_allocate_aligned_nosmart);
+        CPPUNIT_TEST(test_allocate_aligned_shared);
+        CPPUNIT_TEST(test_allocate_aligned_unique);
+
+        CPPUNIT_TEST(test_allocate_object_aligned);
+
+        CPPUNIT_TEST(test_huge_pages);
+        CPPUNIT_TEST_EXCEPTION(test_full, std::bad_alloc);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    MappedPoolAllocatorTest() : MemoryAllocatorTest(energonsoftware::MemoryAllocator::Type::Mapped) {}
+    virtual ~MappedPoolAllocatorTest() noexcept {}
+
+public:
+    void test_huge_pages()
+    {
+        // explicit huge pages fall back if none are reserved
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(
+            energonsoftware::MemoryAllocator::new_mapped_allocator(4 * 1024 * 1024, energonsoftware::MemoryAllocator::HugePages::Explicit, true));
+
+        std::vector<void*> blocks;
+        for(int i=0; i<1000; ++i) {
+            void* block = allocator->allocate(1000);
+            CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), reinterpret_cast<size_t>(block) % 16);
+            std::memset(block, i, 1000);
+            blocks.push_back(block);
+        }
+        CPPUNIT_ASSERT_EQUAL(1000U, allocator->allocation_count());
+
+        for(void* block : blocks) {
+            allocator->release(block);
+        }
+        CPPUNIT_ASSERT_EQUAL(0U, allocator->allocation_count());
+    }
+
+    void test_full()
+    {
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(
+            energonsoftware::MemoryAllocator::new_mapped_allocator(256 * 1024, energonsoftware::MemoryAllocator::HugePages::None, false));
+
+        // every span comes out of the region, so this runs out after a few spans
+        for(int i=0; i<1000; ++i) {
+            allocator->allocate(1000);
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(MappedPoolAllocatorTest);
+
+#endif
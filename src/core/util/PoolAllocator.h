@@ -0,0 +1,130 @@
+#if !defined __POOLALLOCATOR_H__
+#define __POOLALLOCATOR_H__
+
+#include "MappedRegion.h"
+#include "MemoryAllocator.h"
+
+namespace energonsoftware {
+
+/*
+This allocator rounds allocations up to a fixed set of size classes
+and recycles released blocks through per-class free lists.
+
+Each thread has its own cache of free blocks per class so that most allocations
+and releases don't lock anything. Caches refill from (and spill back to)
+a central free list per class in batches, and the central lists carve new blocks
+out of spans reserved from the system. Allocations bigger than the largest class
+go straight to the system.
+
+The size is the most memory the allocator will reserve from the system,
+allocations that would go over it throw std::bad_alloc.
+
+Mapped allocators carve their spans out of a MappedRegion the size of the allocator
+(rather than the heap) so that the pool can sit on huge pages. Allocations bigger
+than the largest class still go to the heap.
+
+The thread caches already keep locking off the fast path,
+so the threading mode only matters for catching misuse of SingleOwner allocators.
+
+NOTE: spans are only returned to the system when the allocator is destroyed
+NOTE: blocks cached by a thread that exits stay with the allocator until it's destroyed
+*/
+class PoolAllocator : public MemoryAllocator
+{
+public:
+    // blocks bigger than this go straight to the system
+    static const size_t MAX_BLOCK_SIZE;
+
+private:
+    static Logger& logger;
+
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    struct FreeList
+    {
+        FreeBlock* head;
+        size_t count;
+    };
+
+    // each thread's cache of free blocks
+    struct ThreadCache
+    {
+        std::vector<FreeList> lists;
+
+        explicit ThreadCache(size_t count) : lists(count, FreeList{ nullptr, 0 }) {}
+    };
+
+    struct CentralList
+    {
+        std::mutex mutex;
+        FreeList list;
+
+        CentralList() : mutex(), list{ nullptr, 0 } {}
+    };
+
+public:
+    virtual ~PoolAllocator() noexcept;
+
+public:
+    // total is the most the allocator will reserve,
+    // used is what has been reserved (including free blocks held in the pool)
+    virtual size_t total() const override { return _size; }
+    virtual size_t used() const override { return _reserved.load(); }
+    virtual size_t unused() const override { return _size - _reserved.load(); }
+
+    virtual void* allocate(size_t bytes) override;
+    virtual void release(void* ptr) override;
+
+    // released blocks are already recycled, so there's nothing to reset
+    virtual void reset() override {}
+
+private:
+    // returns the size class for a block of the given size
+    static size_t size_class(size_t bytes);
+
+    ThreadCache& thread_cache();
+
+    // moves a batch of blocks from the central list (carving a new span if it's empty)
+    // into the list, returns false if the allocator is out of memory
+    bool refill(size_t size_class, FreeList& list);
+
+    // moves a batch of blocks from the list back to the central list
+    void spill(size_t size_class, FreeList& list);
+
+    // accounts for memory reserved from the system, returns false if it would go over our size
+    bool reserve(size_t bytes);
+
+private:
+    friend class MemoryAllocator;
+    PoolAllocator(size_t size, Threading threading, std::unique_ptr<MappedRegion> region=std::unique_ptr<MappedRegion>());
+
+    // returns a new span from the region (or the heap if there isn't one),
+    // nullptr if the region is full
+    unsigned char* new_span(size_t bytes);
+
+private:
+    const uint64_t _id;
+    size_t _size;
+    std::atomic<size_t> _reserved;
+
+    std::unique_ptr<MappedRegion> _region;
+
+    // one per size class
+    std::vector<std::unique_ptr<CentralList>> _central;
+
+    // _mutex guards these
+    size_t _region_used;
+    std::vector<std::unique_ptr<unsigned char[]>> _spans;
+    std::unordered_map<std::thread::id, std::unique_ptr<ThreadCache>> _caches;
+
+private:
+    PoolAllocator() = delete;
+    DISALLOW_COPY_AND_ASSIGN(PoolAllocator);
+};
+
+}
+
+#endif
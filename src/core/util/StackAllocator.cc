@@ -3,12 +3,36 @@
 
 namespace energonsoftware {
 
+const size_t StackAllocator::ALIGNMENT = 16;
+const size_t StackAllocator::MAX_BLOCKS;
+
+// the block index lives in the top bits of the head
+static const unsigned int BLOCK_SHIFT = 56;
+static const uint64_t OFFSET_MASK = (static_cast<uint64_t>(1) << BLOCK_SHIFT) - 1;
+
+static uint64_t pack_head(size_t block, size_t offset)
+{
+    return (static_cast<uint64_t>(block) << BLOCK_SHIFT) | offset;
+}
+
+static size_t head_block(uint64_t head)
+{
+    return static_cast<size_t>(head >> BLOCK_SHIFT);
+}
+
+static size_t head_offset(uint64_t head)
+{
+    return static_cast<size_t>(head & OFFSET_MASK);
+}
+
 Logger& StackAllocator::logger(Logger::instance("energonsoftware.core.util.StackAllocator"));
 
-StackAllocator::StackAllocator(size_t size)
-    : MemoryAllocator(), _pool(new unsigned char[_size]), _size(size), _marker(0)
+StackAllocator::StackAllocator(size_t size, Threading threading)
+    : MemoryAllocator(threading), _size(std::max(size, ALIGNMENT)), _total(_size), _used(0),
+        _blocks(), _block_count(1), _head(0), _top(nullptr), _top_bytes(0)
 {
-    //LOG_DEBUG("Pool at " << reinterpret_cast<void*>(_pool.get()) << "\n");
+    _blocks[0] = Block(_size);
+    //LOG_DEBUG("Pool at " << reinterpret_cast<void*>(_blocks[0].memory.get()) << "\n");
 }
 
 StackAllocator::~StackAllocator() noexcept
@@ -17,29 +41,135 @@ StackAllocator::~StackAllocator() noexcept
 
 void* StackAllocator::allocate(size_t bytes)
 {
-    std::lock_guard<std::recursive_mutex> guard(_mutex);
+    size_t aligned = (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
 
-    assert(_marker + bytes < _size);
+    unsigned char* r = nullptr;
+    if(Threading::Concurrent == threading()) {
+        r = bump(aligned);
+    } else {
+        Guard guard(*this);
 
-    size_t r = _marker;
-    _marker += bytes;
+        uint64_t head = _head.load(std::memory_order_relaxed);
+        if(head_offset(head) + aligned > _blocks[head_block(head)].size) {
+            next_block(head_block(head), aligned);
+            head = _head.load(std::memory_order_relaxed);
+        }
 
-    _allocation_count++;
-    _allocation_bytes += bytes;
+        r = _blocks[head_block(head)].memory.get() + head_offset(head);
+        _head.store(head + aligned, std::memory_order_relaxed);
 
-    //LOG_DEBUG("Allocating memory at " << reinterpret_cast<void*>(_pool.get() + r) << "\n");
-    return _pool.get() + r;
+        _top = r;
+        _top_bytes = bytes;
+    }
+
+    _used += aligned;
+    track_allocation(bytes);
+
+    //LOG_DEBUG("Allocating memory at " << reinterpret_cast<void*>(r) << "\n");
+    return r;
 }
 
 void StackAllocator::release(void* ptr)
 {
-    std::lock_guard<std::recursive_mutex> guard(_mutex);
+    if(nullptr == ptr) {
+        return;
+    }
+
+    // Concurrent allocators can't tell what was allocated last,
+    // so everything stays live until it's rewound or reset
+    if(Threading::Concurrent == threading()) {
+        return;
+    }
+
+    Guard guard(*this);
 
-    //_marker -= ???;
-    _allocation_count--;
-    /*_allocation_bytes -= ???;
+    // the most recent allocation can just be popped off,
+    // anything else stays live until it's rewound or reset
+    if(ptr == _top) {
+        uint64_t head = _head.load(std::memory_order_relaxed);
+        size_t offset = static_cast<size_t>(_top - _blocks[head_block(head)].memory.get());
+        _used -= head_offset(head) - offset;
+        _head.store(pack_head(head_block(head), offset), std::memory_order_relaxed);
+        _top = nullptr;
+
+        track_release(_top_bytes);
+    }
+}
+
+void StackAllocator::reset()
+{
+    Guard guard(*this);
 
-    _used -= ???;*/
+    _head = 0;
+    _used = 0;
+    _top = nullptr;
+    track_reset(0, 0);
+}
+
+StackAllocator::Marker StackAllocator::marker()
+{
+    Guard guard(*this);
+
+    uint64_t head = _head.load();
+    return Marker{ head_block(head), head_offset(head), _used, _allocation_count, _allocation_bytes };
+}
+
+void StackAllocator::rewind(const Marker& marker)
+{
+    Guard guard(*this);
+
+    assert(marker.block < _block_count);
+    assert(pack_head(marker.block, marker.offset) <= _head.load());
+
+    _head = pack_head(marker.block, marker.offset);
+    _used = marker.used;
+    _top = nullptr;
+    track_reset(marker.count, marker.bytes);
+}
+
+unsigned char* StackAllocator::bump(size_t bytes)
+{
+    while(true) {
+        uint64_t head = _head.fetch_add(bytes);
+
+        size_t block = head_block(head), offset = head_offset(head);
+        if(offset + bytes <= _blocks[block].size) {
+            return _blocks[block].memory.get() + offset;
+        }
+
+        // ran off the end of the block, the first thread here moves everybody on to the next one
+        // NOTE: offsets only go up, so nobody else can fit in this block now either
+        std::lock_guard<std::recursive_mutex> guard(_mutex);
+        if(head_block(_head.load()) == block) {
+            next_block(block, bytes);
+        }
+    }
+}
+
+void StackAllocator::next_block(size_t block, size_t bytes)
+{
+    // the blocks after the current one are all free
+    size_t count = _block_count;
+    for(size_t i=block+1; i<count; ++i) {
+        if(_blocks[i].size >= bytes) {
+            _head = pack_head(i, 0);
+            return;
+        }
+    }
+
+    if(count >= MAX_BLOCKS) {
+        LOG_ERROR("StackAllocator can't chain any more blocks!\n");
+        throw std::bad_alloc();
+    }
+
+    size_t size = std::max(_size, bytes);
+    LOG_WARNING("StackAllocator overflowed " << _total << " bytes, chaining another " << size << " bytes\n");
+
+    _blocks[count] = Block(size);
+    _block_count = count + 1;
+    _total += size;
+
+    _head = pack_head(count, 0);
 }
 
 }
@@ -56,6 +186,7 @@ public:
         CPPUNIT_TEST(test_allocate_unique);
 
         CPPUNIT_TEST(test_allocate_object);
+        CPPUNIT_TEST(test_stats);
 
         CPPUNIT_TEST(test_allocate_aligned_nosmart);
         CPPUNIT_TEST(test_allocate_aligned_shared);
@@ -63,6 +194,13 @@ public:
 
         CPPUNIT_TEST(test_allocate_object_aligned);
 
+        CPPUNIT_TEST(test_release);
+        CPPUNIT_TEST(test_rewind);
+        CPPUNIT_TEST(test_scope);
+        CPPUNIT_TEST(test_overflow);
+        CPPUNIT_TEST(test_single_owner);
+        CPPUNIT_TEST(test_concurrent);
+
         CPPUNIT_TEST_EXCEPTION(test_unreasonable_allocation, std::bad_alloc);
     CPPUNIT_TEST_SUITE_END();
 
@@ -71,6 +209,161 @@ public:
     virtual ~StackAllocatorTest() noexcept {}
 
 public:
+    void test_release()
+    {
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(
+            energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::Stack, 1024));
+
+        void* first = allocator->allocate(10);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), reinterpret_cast<size_t>(first) % energonsoftware::StackAllocator::ALIGNMENT);
+        CPPUNIT_ASSERT_EQUAL(energonsoftware::StackAllocator::ALIGNMENT, allocator->used());
+
+        // the top allocation is popped
+        void* second = allocator->allocate(100);
+        allocator->release(second);
+        CPPUNIT_ASSERT_EQUAL(energonsoftware::StackAllocator::ALIGNMENT, allocator->used());
+        CPPUNIT_ASSERT_EQUAL(second, allocator->allocate(20));
+
+        // anything else just stays put until the allocator is rewound
+        allocator->release(first);
+        CPPUNIT_ASSERT_EQUAL(3 * energonsoftware::StackAllocator::ALIGNMENT, allocator->used());
+        CPPUNIT_ASSERT_EQUAL(2U, allocator->allocation_count());
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(30), allocator->allocation_bytes());
+
+        allocator->reset();
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), allocator->used());
+        CPPUNIT_ASSERT_EQUAL(0U, allocator->allocation_count());
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), allocator->allocation_bytes());
+        CPPUNIT_ASSERT_EQUAL(first, allocator->allocate(10));
+    }
+
+    void test_rewind()
+    {
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(
+            energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::Stack, 1024));
+        energonsoftware::StackAllocator& stack(dynamic_cast<energonsoftware::StackAllocator&>(*allocator));
+
+        stack.allocate(32);
+        energonsoftware::StackAllocator::Marker marker(stack.marker());
+        void* expected = stack.allocate(64);
+        stack.allocate(64);
+        stack.allocate(64);
+        CPPUNIT_ASSERT_EQUAL(4U, stack.allocation_count());
+
+        stack.rewind(marker);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(32), stack.used());
+        CPPUNIT_ASSERT_EQUAL(1U, stack.allocation_count());
+        CPPUNIT_ASSERT_EQUAL(expected, stack.allocate(64));
+    }
+
+    void test_scope()
+    {
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(
+            energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::Stack, 1024));
+        energonsoftware::StackAllocator& stack(dynamic_cast<energonsoftware::StackAllocator&>(*allocator));
+
+        stack.allocate(16);
+        {
+            energonsoftware::StackAllocator::Scope outer(stack);
+            stack.allocate(100);
+            {
+                energonsoftware::StackAllocator::Scope inner(stack);
+                stack.allocate(200);
+            }
+            CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(16 + 112), stack.used());
+        }
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(16), stack.used());
+        CPPUNIT_ASSERT_EQUAL(1U, stack.allocation_count());
+    }
+
+    void test_overflow()
+    {
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(
+            energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::Stack, 256));
+        energonsoftware::StackAllocator& stack(dynamic_cast<energonsoftware::StackAllocator&>(*allocator));
+
+        energonsoftware::StackAllocator::Marker marker(stack.marker());
+        for(int i=0; i<10; ++i) {
+            std::memset(stack.allocate(64), i, 64);
+        }
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(3), stack.block_count());
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(768), stack.total());
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(640), stack.used());
+
+        // bigger than a whole block
+        std::memset(stack.allocate(1000), 0, 1000);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(4), stack.block_count());
+
+        // chained blocks are reused after a rewind
+        stack.rewind(marker);
+        for(int i=0; i<10; ++i) {
+            stack.allocate(64);
+        }
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(4), stack.block_count());
+    }
+
+    void test_single_owner()
+    {
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(
+            energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::Stack, 1024, "",
+                energonsoftware::MemoryAllocator::Threading::SingleOwner));
+        allocator->release(allocator->allocate(64));
+
+        // hand it off to another thread and back
+        std::thread thread([&allocator]() {
+            allocator->claim();
+            allocator->allocate(64);
+        });
+        thread.join();
+
+        allocator->claim();
+        CPPUNIT_ASSERT_EQUAL(1U, allocator->allocation_count());
+        allocator->reset();
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), allocator->used());
+    }
+
+    void test_concurrent()
+    {
+        static const int THREADS = 4;
+        static const int COUNT = 1000;
+        static const size_t SIZE = 48;
+
+        // small enough that the threads overflow it a few times
+        std::shared_ptr<energonsoftware::MemoryAllocator> allocator(
+            energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::Stack, 32 * 1024, "",
+                energonsoftware::MemoryAllocator::Threading::Concurrent));
+
+        std::vector<std::vector<unsigned char*>> blocks(THREADS);
+        std::vector<std::thread> threads;
+        for(int i=0; i<THREADS; ++i) {
+            threads.push_back(std::thread([&allocator, &blocks, i]() {
+                for(int j=0; j<COUNT; ++j) {
+                    unsigned char* block = reinterpret_cast<unsigned char*>(allocator->allocate(SIZE));
+                    std::memset(block, i, SIZE);
+                    blocks[i].push_back(block);
+                }
+            }));
+        }
+
+        for(auto& thread : threads) {
+            thread.join();
+        }
+
+        // nobody stepped on anybody else
+        for(int i=0; i<THREADS; ++i) {
+            for(unsigned char* block : blocks[i]) {
+                for(size_t j=0; j<SIZE; ++j) {
+                    CPPUNIT_ASSERT_EQUAL(static_cast<int>(i), static_cast<int>(block[j]));
+                }
+            }
+        }
+        CPPUNIT_ASSERT_EQUAL(static_cast<unsigned int>(THREADS * COUNT), allocator->allocation_count());
+        CPPUNIT_ASSERT_EQUAL(THREADS * COUNT * SIZE, allocator->used());
+
+        allocator->reset();
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), allocator->used());
+    }
+
     void test_unreasonable_allocation()
     {
         // 2-4 terabytes is pretty unreasonable, right?
@@ -6,33 +6,120 @@
 namespace energonsoftware {
 
 /*
-This allocator uses the global new to allocate (reserve) a chunk of memory on the heap.
+Linear (arena) allocator.
+
+This allocator uses the global new to allocate (reserve) a chunk of memory on the heap
+and allocates by bumping a marker through it. Memory is freed by rewinding to a marker
+saved earlier (see Scope) or by resetting the whole allocator, so freeing
+everything allocated in a scope or a frame is a single pointer reset.
+
+If the chunk fills up another one is chained on rather than failing,
+chained chunks are kept around (and reused) until the allocator is destroyed.
+Allocations only fail (with std::bad_alloc) once MAX_BLOCKS chunks are chained.
+
+Concurrent allocators bump the marker atomically rather than locking.
+
+release() only gives memory back if it's the most recent allocation,
+anything else is counted as live until it's rewound or reset.
 */
 class StackAllocator : public MemoryAllocator
 {
+public:
+    // allocations are rounded up to (and aligned on) this
+    static const size_t ALIGNMENT;
+
+    // the most chunks the allocator will chain together
+    static const size_t MAX_BLOCKS = 64;
+
+    // a point in the allocator that can be rewound to
+    struct Marker
+    {
+        size_t block;
+        size_t offset;
+        size_t used;
+        size_t count;
+        size_t bytes;
+    };
+
+    // rewinds the allocator to where it was when the scope was created
+    class Scope final
+    {
+    public:
+        explicit Scope(StackAllocator& allocator) : _allocator(allocator), _marker(allocator.marker()) {}
+        ~Scope() noexcept { _allocator.rewind(_marker); }
+
+    private:
+        StackAllocator& _allocator;
+        Marker _marker;
+
+    private:
+        Scope() = delete;
+        DISALLOW_COPY_AND_ASSIGN(Scope);
+    };
+
 private:
     static Logger& logger;
 
+    struct Block
+    {
+        std::unique_ptr<unsigned char[]> memory;
+        size_t size;
+
+        Block() : memory(), size(0) {}
+        explicit Block(size_t bytes) : memory(new unsigned char[bytes]), size(bytes) {}
+    };
+
 public:
     virtual ~StackAllocator() noexcept;
 
 public:
-    virtual size_t total() const override { return _size; }
-    virtual size_t used() const override { return _marker; }
-    virtual size_t unused() const override { return _size - _marker; }
+    // total includes any chained blocks
+    virtual size_t total() const override { return _total; }
+    virtual size_t used() const override { return _used; }
+    virtual size_t unused() const override { return _total - _used; }
+
+    // the number of chunks the allocator has reserved
+    size_t block_count() const { return _block_count; }
 
     virtual void* allocate(size_t bytes) override;
     virtual void release(void* ptr) override;
 
-    virtual void reset() override { _marker = 0; }
+    virtual void reset() override;
+
+    Marker marker();
+
+    // frees everything allocated since the marker was saved
+    // NOTE: the marker must not be older than the last reset
+    // NOTE: rewinding (or resetting) a Concurrent allocator must not race with allocations
+    void rewind(const Marker& marker);
 
 private:
     friend class MemoryAllocator;
-    explicit StackAllocator(size_t size);
+    friend class FrameAllocator;
+    StackAllocator(size_t size, Threading threading);
+
+    // lock-free allocation for Concurrent allocators
+    unsigned char* bump(size_t bytes);
+
+    // moves on from the given block to the next one that can hold bytes,
+    // chaining a new one if there isn't one
+    void next_block(size_t block, size_t bytes);
 
 private:
-    std::unique_ptr<unsigned char[]> _pool;
-    uint32_t _size, _marker;
+    size_t _size;
+    std::atomic<size_t> _total, _used;
+
+    // blocks never move so Concurrent allocations can read them without locking
+    std::array<Block, MAX_BLOCKS> _blocks;
+    std::atomic<size_t> _block_count;
+
+    // the current block and the offset into it,
+    // packed together so that they can be bumped atomically
+    std::atomic<uint64_t> _head;
+
+    // the most recent allocation (for release)
+    unsigned char* _top;
+    size_t _top_bytes;
 
 private:
     StackAllocator() = delete;
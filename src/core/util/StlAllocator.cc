@@ -0,0 +1,139 @@
+#include "src/pch.h"
+#include "StlAllocator.h"
+
+#if defined WITH_UNIT_TESTS
+#include "src/test/UnitTest.h"
+
+class StlAllocatorTest : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(StlAllocatorTest);
+        CPPUNIT_TEST(test_vector);
+        CPPUNIT_TEST(test_node_containers);
+        CPPUNIT_TEST(test_propagation);
+        CPPUNIT_TEST(test_aligned);
+        CPPUNIT_TEST(test_default);
+    CPPUNIT_TEST_SUITE_END();
+
+private:
+    struct alignas(32) AlignedObject
+    {
+        float values[8];
+    };
+
+public:
+    StlAllocatorTest() : CppUnit::TestFixture(), _allocator() {}
+    virtual ~StlAllocatorTest() noexcept {}
+
+public:
+    void setUp() override
+    {
+        _allocator = energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::Pool, 1024 * 1024);
+    }
+
+    void tearDown() override
+    {
+        _allocator.reset();
+    }
+
+    void test_vector()
+    {
+        {
+            std::vector<int, energonsoftware::StlAllocator<int>> values(energonsoftware::StlAllocator<int>(_allocator.get()));
+            for(int i=0; i<1000; ++i) {
+                values.push_back(i);
+            }
+            CPPUNIT_ASSERT_EQUAL(1U, _allocator->allocation_count());
+            CPPUNIT_ASSERT_EQUAL(999, values.back());
+        }
+        CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_count());
+    }
+
+    void test_node_containers()
+    {
+        typedef std::pair<const int, std::string> Value;
+        typedef std::unordered_map<int, std::string, std::hash<int>, std::equal_to<int>, energonsoftware::StlAllocator<Value>> Map;
+        {
+            // the allocator is rebound to the list and map nodes
+            std::list<int, energonsoftware::StlAllocator<int>> list(energonsoftware::StlAllocator<int>(_allocator.get()));
+            Map map(0, Map::hasher(), Map::key_equal(), Map::allocator_type(_allocator.get()));
+            for(int i=0; i<100; ++i) {
+                list.push_back(i);
+                map[i] = "value";
+            }
+            CPPUNIT_ASSERT(_allocator->allocation_count() >= 200U);
+
+            list.remove(50);
+            map.erase(50);
+            CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(99), list.size());
+            CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(99), map.size());
+        }
+        CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_count());
+    }
+
+    void test_propagation()
+    {
+        typedef std::vector<int, energonsoftware::StlAllocator<int>> Vector;
+
+        std::shared_ptr<energonsoftware::MemoryAllocator> other(
+            energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::Pool, 1024 * 1024));
+        {
+            Vector first(10, 1, Vector::allocator_type(_allocator.get()));
+
+            // copies keep the allocator
+            Vector copy(first);
+            CPPUNIT_ASSERT(_allocator.get() == copy.get_allocator().allocator());
+            CPPUNIT_ASSERT_EQUAL(2U, _allocator->allocation_count());
+
+            // and so does assignment and swapping
+            Vector second(5, 2, Vector::allocator_type(other.get()));
+            copy = second;
+            CPPUNIT_ASSERT(other.get() == copy.get_allocator().allocator());
+            CPPUNIT_ASSERT_EQUAL(1U, _allocator->allocation_count());
+            CPPUNIT_ASSERT_EQUAL(2U, other->allocation_count());
+
+            first.swap(second);
+            CPPUNIT_ASSERT(other.get() == first.get_allocator().allocator());
+            CPPUNIT_ASSERT(_allocator.get() == second.get_allocator().allocator());
+            CPPUNIT_ASSERT_EQUAL(2, first[0]);
+
+            Vector moved(std::move(second));
+            CPPUNIT_ASSERT(_allocator.get() == moved.get_allocator().allocator());
+            CPPUNIT_ASSERT_EQUAL(1, moved[0]);
+        }
+        CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_count());
+        CPPUNIT_ASSERT_EQUAL(0U, other->allocation_count());
+
+        CPPUNIT_ASSERT(energonsoftware::StlAllocator<int>(_allocator.get()) == energonsoftware::StlAllocator<float>(_allocator.get()));
+        CPPUNIT_ASSERT(energonsoftware::StlAllocator<int>(_allocator.get()) != energonsoftware::StlAllocator<int>(other.get()));
+    }
+
+    void test_aligned()
+    {
+        std::vector<AlignedObject, energonsoftware::StlAllocator<AlignedObject>> objects(
+            energonsoftware::StlAllocator<AlignedObject>(_allocator.get()));
+        for(int i=0; i<10; ++i) {
+            objects.push_back(AlignedObject());
+            CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), reinterpret_cast<size_t>(objects.data()) % 32);
+        }
+        objects.clear();
+        objects.shrink_to_fit();
+        CPPUNIT_ASSERT_EQUAL(0U, _allocator->allocation_count());
+    }
+
+    void test_default()
+    {
+        // no allocator uses the heap
+        std::vector<int, energonsoftware::StlAllocator<int>> values;
+        values.resize(100, 3);
+        CPPUNIT_ASSERT(nullptr == values.get_allocator().allocator());
+        CPPUNIT_ASSERT_EQUAL(3, values[99]);
+    }
+
+private:
+    std::shared_ptr<energonsoftware::MemoryAllocator> _allocator;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(StlAllocatorTest);
+
+#endif
@@ -0,0 +1,131 @@
+#if !defined __STLALLOCATOR_H__
+#define __STLALLOCATOR_H__
+
+#include <cstddef>
+#include <limits>
+#include "MemoryAllocator.h"
+
+namespace energonsoftware {
+
+/*
+Standard library allocator that allocates from a MemoryAllocator
+so that containers can be backed by pools and arenas.
+
+The allocator travels with the container when it's copied, moved or swapped,
+and a default constructed allocator falls back to the global new.
+
+Types that need more alignment than the allocators guarantee
+(like the SSE vectors) are allocated with allocate_aligned().
+
+NOTE: the MemoryAllocator must outlive every container using it
+*/
+template<typename T>
+class StlAllocator
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    template<typename U>
+    struct rebind
+    {
+        typedef StlAllocator<U> other;
+    };
+
+private:
+    static const size_t ALIGNMENT = std::alignment_of<T>::value;
+    static const bool OVER_ALIGNED = ALIGNMENT > std::alignment_of<std::max_align_t>::value;
+
+public:
+    StlAllocator() noexcept : _allocator(nullptr) {}
+    explicit StlAllocator(MemoryAllocator* const allocator) noexcept : _allocator(allocator) {}
+
+    StlAllocator(const StlAllocator& other) noexcept : _allocator(other._allocator) {}
+
+    template<typename U>
+    StlAllocator(const StlAllocator<U>& other) noexcept : _allocator(other.allocator()) {}
+
+    ~StlAllocator() noexcept {}
+
+    StlAllocator& operator=(const StlAllocator& rhs) noexcept
+    {
+        _allocator = rhs._allocator;
+        return *this;
+    }
+
+public:
+    // nullptr if this uses the global new
+    MemoryAllocator* allocator() const { return _allocator; }
+
+    T* address(T& value) const noexcept { return std::addressof(value); }
+    const T* address(const T& value) const noexcept { return std::addressof(value); }
+
+    size_t max_size() const noexcept { return std::numeric_limits<size_t>::max() / sizeof(T); }
+
+    T* allocate(size_t count, const void* =nullptr)
+    {
+        if(count > max_size()) {
+            throw std::bad_alloc();
+        }
+
+        size_t bytes = count * sizeof(T);
+        if(nullptr == _allocator) {
+            return reinterpret_cast<T*>(::operator new(bytes));
+        }
+        return reinterpret_cast<T*>(OVER_ALIGNED ? _allocator->allocate_aligned(bytes, ALIGNMENT) : _allocator->allocate(bytes));
+    }
+
+    void deallocate(T* ptr, size_t)
+    {
+        if(nullptr == _allocator) {
+            ::operator delete(ptr);
+        } else if(OVER_ALIGNED) {
+            _allocator->release_aligned(ptr, ALIGNMENT);
+        } else {
+            _allocator->release(ptr);
+        }
+    }
+
+    template<typename U, typename... Args>
+    void construct(U* ptr, Args&&... args)
+    {
+        ::new(reinterpret_cast<void*>(ptr)) U(std::forward<Args>(args)...);
+    }
+
+    template<typename U>
+    void destroy(U* ptr)
+    {
+        ptr->~U();
+    }
+
+    StlAllocator select_on_container_copy_construction() const { return *this; }
+
+private:
+    MemoryAllocator* _allocator;
+};
+
+// allocators are equal if memory from one can be released by the other
+template<typename T, typename U>
+bool operator==(const StlAllocator<T>& lhs, const StlAllocator<U>& rhs) noexcept
+{
+    return lhs.allocator() == rhs.allocator();
+}
+
+template<typename T, typename U>
+bool operator!=(const StlAllocator<T>& lhs, const StlAllocator<U>& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+}
+
+#endif
@@ -3,10 +3,15 @@
 
 namespace energonsoftware {
 
+// blocks are prefixed with their size,
+// padded out so that blocks stay 16 byte aligned
+static const size_t HEADER_SIZE = 16;
+static_assert(sizeof(size_t) <= HEADER_SIZE, "Block header is too big");
+
 Logger& SystemAllocator::logger(Logger::instance("energonsoftware.core.util.SystemAllocator"));
 
-SystemAllocator::SystemAllocator(size_t size)
-    : MemoryAllocator(), _size(size), _used(0)
+SystemAllocator::SystemAllocator(size_t size, Threading threading)
+    : MemoryAllocator(threading), _size(size), _used(0)
 {
 }
 
@@ -16,30 +21,49 @@ SystemAllocator::~SystemAllocator() noexcept
 
 void* SystemAllocator::allocate(size_t bytes)
 {
-    std::lock_guard<std::recursive_mutex> guard(_mutex);
+    Guard guard(*this);
 
-    assert(_used + bytes < _size);
+    size_t needed = bytes + HEADER_SIZE;
+    if(needed < bytes) {
+        throw std::bad_alloc();
+    }
 
-    _allocation_count++;
-    _allocation_bytes += bytes;
+    size_t used = _used.fetch_add(needed);
+    if(used + needed > _size) {
+        _used -= needed;
+        throw std::bad_alloc();
+    }
 
-    _used += bytes;
-    unsigned char* r = new unsigned char[bytes];
+    unsigned char* r = nullptr;
+    try {
+        r = new unsigned char[needed];
+    } catch(const std::bad_alloc&) {
+        _used -= needed;
+        throw;
+    }
+    *reinterpret_cast<size_t*>(r) = bytes;
+
+    track_allocation(bytes);
 
     //LOG_DEBUG("Allocating memory at " << reinterpret_cast<void*>(r) << "\n");
-    return r;
+    return r + HEADER_SIZE;
 }
 
 void SystemAllocator::release(void* ptr)
 {
-    std::lock_guard<std::recursive_mutex> guard(_mutex);
+    Guard guard(*this);
+
+    if(nullptr == ptr) {
+        return;
+    }
 
-    _allocation_count--;
-    /*_allocation_bytes -= ???;
+    unsigned char* block = reinterpret_cast<unsigned char*>(ptr) - HEADER_SIZE;
+    size_t bytes = *reinterpret_cast<size_t*>(block);
 
-    _used -= ???;*/
+    _used -= bytes + HEADER_SIZE;
+    track_release(bytes);
 
-    delete[] reinterpret_cast<unsigned char*>(ptr);
+    delete[] block;
 }
 
 }
@@ -56,6 +80,7 @@ public:
         CPPUNIT_TEST(test_allocate_unique);
 
         CPPUNIT_TEST(test_allocate_object);
+        CPPUNIT_TEST(test_stats);
 
         CPPUNIT_TEST(test_allocate_aligned_nosmart);
         CPPUNIT_TEST(test_allocate_aligned_shared);
@@ -82,8 +107,8 @@ public:
 
         std::shared_ptr<energonsoftware::MemoryAllocator> allocator(
             energonsoftware::MemoryAllocator::new_allocator(energonsoftware::MemoryAllocator::Type::System, size));
-        // have to use size-1 here because of the allocation < size assertion in allocate()
-        allocator->allocate(size-1);
+        // the block header puts this over the budget
+        allocator->allocate(size);
     }
 };
 
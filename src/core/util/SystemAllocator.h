@@ -5,6 +5,15 @@
 
 namespace energonsoftware {
 
+/*
+This allocator passes allocations through to the global new,
+each block is prefixed with its size so that releases can be tracked.
+
+The size is the most memory the allocator will hand out,
+allocations that would go over it throw std::bad_alloc.
+
+The global new is already thread safe, so the allocator only locks if it's Locked.
+*/
 class SystemAllocator : public MemoryAllocator
 {
 private:
@@ -21,14 +30,16 @@ public:
     virtual void* allocate(size_t bytes) override;
     virtual void release(void* ptr) override;
 
-    virtual void reset() override { _used = 0; }
+    // released blocks go straight back to the system, so there's nothing to reset
+    virtual void reset() override {}
 
 private:
     friend class MemoryAllocator;
-    explicit SystemAllocator(size_t size);
+    SystemAllocator(size_t size, Threading threading);
 
 private:
-    uint32_t _size, _used;
+    size_t _size;
+    std::atomic<size_t> _used;
 
 private:
     SystemAllocator() = delete;
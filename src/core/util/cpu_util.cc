@@ -0,0 +1,188 @@
+#include "src/pch.h"
+#if defined USE_SSE
+    #if defined _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#endif
+#include "cpu_util.h"
+
+namespace energonsoftware {
+
+#if defined USE_SSE
+static void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int registers[4])
+{
+#if defined _MSC_VER
+    int info[4];
+    __cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+    for(int i=0; i<4; ++i) {
+        registers[i] = static_cast<unsigned int>(info[i]);
+    }
+#else
+    __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+// which register state the OS saves on a context switch
+static uint64_t xgetbv()
+{
+#if defined _MSC_VER
+    return _xgetbv(0);
+#else
+    // the intrinsic needs -mxsave, so do it by hand
+    unsigned int eax = 0, edx = 0;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+static SimdLevel detect_simd_level()
+{
+#if defined USE_SSE
+    unsigned int registers[4];      // eax, ebx, ecx, edx
+    cpuid(0, 0, registers);
+    const unsigned int max_leaf = registers[0];
+
+    cpuid(1, 0, registers);
+    const unsigned int features = registers[2];
+    if(!(features & (1 << 0))) {
+        return SimdLevel::None;
+    }
+
+    // AVX also needs the OS to save the YMM registers (OSXSAVE and XCR0)
+    const bool fma = 0 != (features & (1 << 12));
+    const bool osxsave = 0 != (features & (1 << 27));
+    const bool avx = 0 != (features & (1 << 28));
+    if(!osxsave || !avx || !fma || max_leaf < 7) {
+        return SimdLevel::SSE3;
+    }
+
+    const uint64_t xcr0 = xgetbv();
+    if(0x06 != (xcr0 & 0x06)) {
+        return SimdLevel::SSE3;
+    }
+
+    cpuid(7, 0, registers);
+    const unsigned int extended = registers[1];
+    if(!(extended & (1 << 5))) {
+        return SimdLevel::SSE3;
+    }
+
+    // AVX-512 also needs the opmask and ZMM state saved
+    if((extended & (1 << 16)) && 0xe6 == (xcr0 & 0xe6)) {
+        return SimdLevel::AVX512;
+    }
+    return SimdLevel::AVX2;
+#else
+    return SimdLevel::None;
+#endif
+}
+
+static std::atomic<int>& current_level()
+{
+    static std::atomic<int> level(static_cast<int>(detected_simd_level()));
+    return level;
+}
+
+SimdLevel detected_simd_level()
+{
+    static const SimdLevel level = detect_simd_level();
+    return level;
+}
+
+SimdLevel simd_level()
+{
+    return static_cast<SimdLevel>(current_level().load(std::memory_order_relaxed));
+}
+
+void set_simd_level(SimdLevel level)
+{
+    current_level().store(std::min(static_cast<int>(level), static_cast<int>(detected_simd_level())));
+}
+
+const char* simd_level_name(SimdLevel level)
+{
+    switch(level)
+    {
+    case SimdLevel::None:
+        return "None";
+    case SimdLevel::SSE3:
+        return "SSE3";
+    case SimdLevel::AVX2:
+        return "AVX2";
+    case SimdLevel::AVX512:
+        return "AVX-512";
+    }
+    return "Unknown";
+}
+
+std::vector<SimdLevel> supported_simd_levels()
+{
+    std::vector<SimdLevel> levels;
+    for(int level=static_cast<int>(SimdLevel::None); level<=static_cast<int>(detected_simd_level()); ++level) {
+        levels.push_back(static_cast<SimdLevel>(level));
+    }
+    return levels;
+}
+
+}
+
+#if defined WITH_UNIT_TESTS
+#include "src/test/UnitTest.h"
+
+class CpuUtilTest : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(CpuUtilTest);
+        CPPUNIT_TEST(test_detect);
+        CPPUNIT_TEST(test_set_level);
+        CPPUNIT_TEST(test_supported_levels);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    CpuUtilTest() : CppUnit::TestFixture() {}
+    virtual ~CpuUtilTest() noexcept {}
+
+public:
+    void tearDown() override
+    {
+        energonsoftware::set_simd_level(energonsoftware::detected_simd_level());
+    }
+
+    void test_detect()
+    {
+#if defined USE_SSE
+        // we're built for SSE3 so we have to be running with at least that
+        CPPUNIT_ASSERT(energonsoftware::detected_simd_level() >= energonsoftware::SimdLevel::SSE3);
+#else
+        CPPUNIT_ASSERT(energonsoftware::SimdLevel::None == energonsoftware::detected_simd_level());
+#endif
+        CPPUNIT_ASSERT(energonsoftware::detected_simd_level() == energonsoftware::simd_level());
+        CPPUNIT_ASSERT_EQUAL(std::string("AVX2"), std::string(energonsoftware::simd_level_name(energonsoftware::SimdLevel::AVX2)));
+    }
+
+    void test_set_level()
+    {
+        energonsoftware::set_simd_level(energonsoftware::SimdLevel::None);
+        CPPUNIT_ASSERT(energonsoftware::SimdLevel::None == energonsoftware::simd_level());
+
+        // can't go above what the CPU supports
+        energonsoftware::set_simd_level(energonsoftware::SimdLevel::AVX512);
+        CPPUNIT_ASSERT(energonsoftware::detected_simd_level() == energonsoftware::simd_level());
+    }
+
+    void test_supported_levels()
+    {
+        const std::vector<energonsoftware::SimdLevel> levels(energonsoftware::supported_simd_levels());
+        CPPUNIT_ASSERT(!levels.empty());
+        CPPUNIT_ASSERT(energonsoftware::SimdLevel::None == levels.front());
+        CPPUNIT_ASSERT(energonsoftware::detected_simd_level() == levels.back());
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(energonsoftware::detected_simd_level()) + 1, levels.size());
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CpuUtilTest);
+
+#endif
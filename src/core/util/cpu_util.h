@@ -0,0 +1,74 @@
+#if !defined __CPUUTIL_H__
+#define __CPUUTIL_H__
+
+namespace energonsoftware {
+
+// instruction set levels that kernels can be dispatched on,
+// each level implies the ones before it
+enum class SimdLevel
+{
+    None,
+    SSE3,
+
+    // AVX2 and FMA
+    AVX2,
+
+    // AVX-512F
+    AVX512
+};
+
+// marks a function to be compiled for a specific instruction set,
+// regardless of what the rest of the build targets,
+// these must only be called if simd_level() says the CPU supports it
+// NOTE: anything a TARGET_ function inlines must have the same target
+#if defined _MSC_VER
+    // VC++ will emit any intrinsic without needing the target enabled
+    #define TARGET_AVX2
+    #define TARGET_AVX512
+#else
+    #define TARGET_AVX2 __attribute__((target("avx2,fma")))
+    #define TARGET_AVX512 __attribute__((target("avx2,fma,avx512f")))
+#endif
+
+// runs the widest version of a kernel that the current simd_level() allows
+// and then each narrower one over whatever is left, kernels are named
+// kernel_avx512, kernel_avx2 and kernel_sse, and look like
+//      size_t kernel_xxx(size_t i, ...)
+// starting at index i and returning the index of the first element
+// they didn't get to, which is left in i for the scalar code to finish
+#define SIMD_DISPATCH(i, kernel, ...) \
+    do { \
+        const energonsoftware::SimdLevel level = energonsoftware::simd_level(); \
+        if(level >= energonsoftware::SimdLevel::AVX512) { \
+            i = kernel##_avx512(i, __VA_ARGS__); \
+        } \
+        if(level >= energonsoftware::SimdLevel::AVX2) { \
+            i = kernel##_avx2(i, __VA_ARGS__); \
+        } \
+        if(level >= energonsoftware::SimdLevel::SSE3) { \
+            i = kernel##_sse(i, __VA_ARGS__); \
+        } \
+    } while(0)
+
+// the best level the CPU (and OS) supports,
+// this is detected (with CPUID) once at startup
+// NOTE: this is None if the build doesn't use SSE
+SimdLevel detected_simd_level();
+
+// the level kernels should dispatch on, this is the detected level
+// unless it's been lowered by set_simd_level()
+SimdLevel simd_level();
+
+// lowers the level that kernels dispatch on (for testing and benchmarking),
+// levels higher than the detected level are clamped to it
+void set_simd_level(SimdLevel level);
+
+const char* simd_level_name(SimdLevel level);
+
+// every level up to the detected level, lowest first,
+// for tests and benchmarks that run kernels at each level
+std::vector<SimdLevel> supported_simd_levels();
+
+}
+
+#endif
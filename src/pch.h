@@ -77,6 +77,10 @@
 #if defined USE_SSE
     // SSE3
     #include <pmmintrin.h>
+
+    // AVX2/AVX-512, these are only used by
+    // runtime dispatched functions (see cpu_util.h)
+    #include <immintrin.h>
 #endif
 
 #if defined WIN32
@@ -109,6 +113,11 @@ static const int MAX_BUFFER = 1024;
 #define noexcept throw()
 #endif
 
+#if defined _MSC_VER && _MSC_VER < 1900
+// NOTE: this only works with POD types
+#define thread_local __declspec(thread)
+#endif
+
 // NOTE: also disables move operations
 #define DISALLOW_COPY_AND_ASSIGN(TypeName) \
 TypeName(const TypeName&) = delete; \
@@ -0,0 +1,30 @@
+#if !defined __TESTTHREADPOOL_H__
+#define __TESTTHREADPOOL_H__
+
+#if defined WITH_UNIT_TESTS
+#include "src/core/thread/BaseThread.h"
+#include "src/core/thread/ThreadPool.h"
+
+// plain pool threads for the suites that need a running ThreadPool
+class TestThread : public energonsoftware::BaseThread
+{
+public:
+    explicit TestThread(energonsoftware::ThreadPool* const pool) : energonsoftware::BaseThread(pool) {}
+    virtual ~TestThread() noexcept {}
+};
+
+class TestThreadFactory : public energonsoftware::ThreadFactory
+{
+public:
+    TestThreadFactory() : energonsoftware::ThreadFactory() {}
+    virtual ~TestThreadFactory() noexcept {}
+
+public:
+    virtual std::shared_ptr<energonsoftware::BaseThread> new_thread(energonsoftware::ThreadPool* pool) const noexcept override
+    {
+        return std::shared_ptr<energonsoftware::BaseThread>(new TestThread(pool));
+    }
+};
+#endif
+
+#endif
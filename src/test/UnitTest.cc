@@ -57,6 +57,7 @@ int main(int argc, char* argv[])
         LOG_INFO("Including TLS tests...\n");
 #endif
         runner.run(controller, testPath);
+        energonsoftware::Logger::flush();
 
         CppUnit::CompilerOutputter outputter(&result, std::cerr);
         outputter.write();